@@ -0,0 +1,462 @@
+/**
+ * @file PipelineBench.cpp
+ * @brief Benchmark sin ventana de todo el pipeline: generacion, interpretacion y subida.
+ *
+ * Recorre cada preset de PRESETS en un rango de generaciones y mide, por etapa,
+ * el mejor tiempo de varias repeticiones:
+ * - generate: LSystem::generate desde el axioma (sin cache de generaciones).
+ * - interpret: buildGeometry con una tortuga nueva (incluye compilar la cadena).
+ * - reinterpret: buildGeometry reutilizando el programa compilado.
+ * - stream: buildGeometry desde LSystem::stream(), sin materializar la cadena.
+ * - pack: escritura de las instancias que upload() copia a la GPU (packInstances).
+ * - cache_load: GeometryCache::load de la misma geometria (mmap y copia, sin generar).
+ * - generate_packed / interpret_packed: generate e interpretacion con la cadena en
+ *   codigos de 4 bits (SymbolPacking::Nibbles); en bytes si el preset no se empaqueta.
+ *
+ * Cada caso reporta ns/simbolo, millones de simbolos por segundo, ramas,
+ * decoraciones, bytes de la cadena (normal y empaquetada) y memoria residente maxima. La salida es JSON para comparar
+ * resultados entre versiones.
+ *
+ * Uso: ./bench_pipeline [--repeats N] [--min-gen N] [--max-gen N]
+ *                       [--max-symbols N] [--output archivo.json]
+ *        ./bench_pipeline --check
+ *
+ * Con --check no mide nada: comprueba que los caminos en paralelo den
+ * exactamente lo mismo que en serie y termina con 1 ante cualquier diferencia:
+ * - interpretacion: cada preset en serie y con 2, 3 y 8 hilos; ramas, hojas,
+ *   flores y rangos de corchetes byte a byte.
+ * - reescritura: cada preset estocastico o parametrico con 1, 2 y N hilos
+ *   (hardware_concurrency) y en streaming; cadena y buffer de parametros.
+ *
+ * Por defecto cada preset va de la generacion 1 a la suya; --max-gen la reemplaza.
+ * Un preset deja de crecer cuando su cadena supera --max-symbols.
+ *
+ * @author Julian Parra
+ * @date 2025
+ * @course Graficacion
+ * @project Proyecto Final - "Arboles: La Belleza Algoritmica de las Plantas"
+ */
+
+#include <sys/resource.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <filesystem>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "lsystem/GeometryCache.h"
+#include "lsystem/LSystem.h"
+#include "lsystem/TurtleGraphics.h"
+#include "ui/Presets.h"
+
+namespace {
+
+struct BenchOptions {
+    int repeats{5};
+    int minGeneration{1};
+    int maxGeneration{0};  // 0 = la del preset
+    size_t maxSymbols{size_t{1} << 26};
+    const char* output{nullptr};  // nullptr = stdout
+    bool check{false};            // --check: comprobaciones serie/paralelo en lugar de medir
+};
+
+struct StageTiming {
+    const char* name;
+    double ms;
+};
+
+/*
+ * @brief Mejor tiempo (ms) de 'repeats' ejecuciones de 'stage'.
+ */
+template <typename Stage>
+double bestMs(int repeats, Stage&& stage) {
+    double best = 1e30;
+    for (int i = 0; i < repeats; ++i) {
+        auto start = std::chrono::steady_clock::now();
+        stage();
+        auto end = std::chrono::steady_clock::now();
+        best = std::min(best, std::chrono::duration<double, std::milli>(end - start).count());
+    }
+    return best;
+}
+
+/*
+ * @brief Reinicia el maximo de memoria residente del proceso (Linux >= 4.0).
+ * @return false si no se puede: el maximo reportado sera el de todo el proceso.
+ */
+bool resetPeakRss() {
+    FILE* file = std::fopen("/proc/self/clear_refs", "w");
+    if (file == nullptr)
+        return false;
+    bool ok = std::fputs("5", file) >= 0;
+    return std::fclose(file) == 0 && ok;
+}
+
+/*
+ * @brief Memoria residente maxima en KiB (VmHWM, o getrusage si no hay /proc).
+ */
+long peakRssKb() {
+    if (FILE* file = std::fopen("/proc/self/status", "r")) {
+        char line[256];
+        long kb = -1;
+        while (std::fgets(line, sizeof(line), file) != nullptr) {
+            if (std::strncmp(line, "VmHWM:", 6) == 0) {
+                kb = std::strtol(line + 6, nullptr, 10);
+                break;
+            }
+        }
+        std::fclose(file);
+        if (kb >= 0)
+            return kb;
+    }
+
+    rusage usage{};
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_maxrss;
+}
+
+/*
+ * @brief Escribe una cadena JSON con comillas y escapes minimos.
+ */
+void writeJsonString(FILE* out, const char* text) {
+    std::fputc('"', out);
+    for (const char* c = text; *c != '\0'; ++c) {
+        if (*c == '"' || *c == '\\') {
+            std::fputc('\\', out);
+            std::fputc(*c, out);
+        } else if (static_cast<unsigned char>(*c) < 0x20) {
+            std::fprintf(out, "\\u%04x", static_cast<unsigned>(static_cast<unsigned char>(*c)));
+        } else {
+            std::fputc(*c, out);
+        }
+    }
+    std::fputc('"', out);
+}
+
+bool parseOptions(int argc, char** argv, BenchOptions& options) {
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        if (arg == "--check") {
+            options.check = true;
+            continue;
+        }
+        if (i + 1 >= argc) {
+            std::fprintf(stderr, "Falta el valor de %s\n", arg.c_str());
+            return false;
+        }
+        const char* value = argv[++i];
+        if (arg == "--repeats") {
+            options.repeats = std::max(1, std::atoi(value));
+        } else if (arg == "--min-gen") {
+            options.minGeneration = std::max(0, std::atoi(value));
+        } else if (arg == "--max-gen") {
+            options.maxGeneration = std::max(0, std::atoi(value));
+        } else if (arg == "--max-symbols") {
+            options.maxSymbols = std::strtoull(value, nullptr, 10);
+        } else if (arg == "--output") {
+            options.output = value;
+        } else {
+            std::fprintf(stderr, "Opcion desconocida: %s\n", arg.c_str());
+            return false;
+        }
+    }
+    return true;
+}
+
+// Smallest string the checks interpret: the parallel paths stay serial below 1 << 16
+constexpr size_t CHECK_MIN_SYMBOLS = size_t{1} << 17;
+constexpr int CHECK_EXTRA_GENERATIONS = 6;
+
+/*
+ * @brief true si los dos vectores tienen el mismo tamano y los mismos bytes.
+ */
+template <typename T>
+bool sameBytes(const std::vector<T>& a, const std::vector<T>& b) {
+    return a.size() == b.size() &&
+           (a.empty() || std::memcmp(a.data(), b.data(), a.size() * sizeof(T)) == 0);
+}
+
+/*
+ * @brief Genera 'preset' en su generacion, o en mas si la cadena no llega a
+ *        CHECK_MIN_SYMBOLS (a lo mas CHECK_EXTRA_GENERATIONS mas).
+ * @param lsystem Sistema nuevo; los hilos de reescritura ya elegidos.
+ * @return Generacion usada.
+ */
+int generateForCheck(const LSystemPreset& preset, LSystem& lsystem) {
+    lsystem.setAxiom(preset.axiom);
+    lsystem.addRulesFromString(preset.rules);
+    int generation = preset.generations;
+    lsystem.generate(generation);
+    while (lsystem.getLength() < CHECK_MIN_SYMBOLS &&
+           generation < preset.generations + CHECK_EXTRA_GENERATIONS) {
+        lsystem.generate(++generation);
+    }
+    return generation;
+}
+
+/*
+ * @brief Interpreta cada preset en serie y en paralelo con 2, 3 y 8 hilos y
+ *        compara la geometria byte a byte.
+ * @return Numero de casos distintos al serie.
+ */
+int checkParallelInterpretation() {
+    int failures = 0;
+    for (int p = 0; p < NUM_PRESETS; ++p) {
+        const LSystemPreset& preset = PRESETS[p];
+        LSystem lsystem;
+        const int generation = generateForCheck(preset, lsystem);
+        const std::string& str = lsystem.getString();
+        const std::vector<float>& parameters = lsystem.getParameters();
+
+        TurtleGraphics serial;
+        serial.set3DMode(preset.is3D);
+        serial.setParallelInterpretation(false);
+        serial.buildGeometry(str, parameters, preset.angle);
+
+        for (unsigned threads : {2U, 3U, 8U}) {
+            TurtleGraphics parallel;
+            parallel.set3DMode(preset.is3D);
+            parallel.setParallelInterpretation(true, threads);
+            parallel.buildGeometry(str, parameters, preset.angle);
+
+            const bool same = sameBytes(serial.getBranches(), parallel.getBranches()) &&
+                              sameBytes(serial.getLeaves(), parallel.getLeaves()) &&
+                              sameBytes(serial.getFlowers(), parallel.getFlowers()) &&
+                              sameBytes(serial.getSpans(), parallel.getSpans());
+            std::fprintf(stderr, "%-22s gen %2d %10zu simbolos  interpretar %u hilos: %s\n",
+                         preset.name, generation, str.size(), threads, same ? "ok" : "DISTINTO");
+            failures += same ? 0 : 1;
+        }
+    }
+    return failures;
+}
+
+/*
+ * @brief Reescribe cada preset estocastico o parametrico con 1, 2 y N hilos y en
+ *        streaming, y compara la cadena y el buffer de parametros con los de 1 hilo.
+ * @return Numero de casos distintos al de 1 hilo.
+ */
+int checkParallelRewrite() {
+    const unsigned hardwareThreads = std::max(3U, std::thread::hardware_concurrency());
+    int failures = 0;
+    for (int p = 0; p < NUM_PRESETS; ++p) {
+        const LSystemPreset& preset = PRESETS[p];
+        LSystem serial;
+        serial.setParallel(false);
+        const int generation = generateForCheck(preset, serial);
+        if (!serial.isExtended())
+            continue;
+
+        for (unsigned threads : {2U, hardwareThreads}) {
+            LSystem parallel;
+            parallel.setParallel(true, threads);
+            generateForCheck(preset, parallel);
+            const bool same = parallel.getString() == serial.getString() &&
+                              sameBytes(parallel.getParameters(), serial.getParameters());
+            std::fprintf(stderr, "%-22s gen %2d %10zu simbolos  reescribir %u hilos: %s\n",
+                         preset.name, generation, serial.getLength(), threads,
+                         same ? "ok" : "DISTINTO");
+            failures += same ? 0 : 1;
+        }
+
+        // The stream yields modules: rebuild the string with its parameter markers
+        std::string streamed;
+        std::vector<float> streamedParameters;
+        SymbolStream symbols = serial.stream(generation);
+        char symbol = 0;
+        int birth = 0;
+        const float* values = nullptr;
+        int count = 0;
+        while (symbols.next(symbol, birth, values, count)) {
+            streamed.push_back(symbol);
+            if (count > 0) {
+                streamed.push_back(static_cast<char>(count));
+                streamedParameters.insert(streamedParameters.end(), values, values + count);
+            }
+        }
+        const bool same = streamed == serial.getString() &&
+                          sameBytes(streamedParameters, serial.getParameters());
+        std::fprintf(stderr, "%-22s gen %2d %10zu simbolos  streaming: %s\n", preset.name,
+                     generation, serial.getLength(), same ? "ok" : "DISTINTO");
+        failures += same ? 0 : 1;
+    }
+    return failures;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    BenchOptions options;
+    if (!parseOptions(argc, argv, options)) {
+        std::fprintf(stderr,
+                     "Uso: %s [--repeats N] [--min-gen N] [--max-gen N] [--max-symbols N] "
+                     "[--output archivo.json]\n       %s --check\n",
+                     argv[0], argv[0]);
+        return 1;
+    }
+
+    // Silenciar los mensajes de progreso de LSystem y TurtleGraphics
+    std::cout.setstate(std::ios::failbit);
+
+    if (options.check) {
+        const int failures = checkParallelInterpretation() + checkParallelRewrite();
+        std::fprintf(stderr, "%s: %d diferencias\n", failures == 0 ? "OK" : "FALLO", failures);
+        return failures == 0 ? 0 : 1;
+    }
+
+    FILE* out = stdout;
+    if (options.output != nullptr) {
+        out = std::fopen(options.output, "w");
+        if (out == nullptr) {
+            std::perror(options.output);
+            return 1;
+        }
+    }
+
+    char timestamp[32];
+    std::time_t now = std::time(nullptr);
+    std::strftime(timestamp, sizeof(timestamp), "%Y-%m-%dT%H:%M:%SZ", std::gmtime(&now));
+
+    std::fprintf(out, "{\n  \"benchmark\": \"pipeline\",\n  \"timestamp\": \"%s\",\n", timestamp);
+    std::fprintf(out, "  \"compiler\": ");
+    writeJsonString(out, __VERSION__);
+    std::fprintf(out, ",\n  \"repeats\": %d,\n  \"results\": [", options.repeats);
+
+    bool firstResult = true;
+    std::vector<unsigned char> packed;
+
+    // Cache files go to the temporary directory and are removed at the end
+    const std::filesystem::path cacheDirectory =
+        std::filesystem::temp_directory_path() / "arboles_bench_cache";
+    const GeometryCache cache(cacheDirectory.string());
+
+    for (int p = 0; p < NUM_PRESETS; ++p) {
+        const LSystemPreset& preset = PRESETS[p];
+        const int maxGeneration =
+            options.maxGeneration > 0 ? options.maxGeneration : preset.generations;
+
+        for (int generation = options.minGeneration; generation <= maxGeneration; ++generation) {
+            const bool peakIsPerCase = resetPeakRss();
+
+            // A fresh system per repeat so the generation cache never serves the result
+            LSystem lsystem;
+            double generateMs = bestMs(options.repeats, [&]() {
+                lsystem = LSystem();
+                lsystem.setAxiom(preset.axiom);
+                lsystem.addRulesFromString(preset.rules);
+                lsystem.generate(generation);
+            });
+            const std::string& str = lsystem.getString();
+            const std::vector<float>& parameters = lsystem.getParameters();
+
+            double interpretMs = bestMs(options.repeats, [&]() {
+                TurtleGraphics fresh;
+                fresh.set3DMode(preset.is3D);
+                fresh.buildGeometry(str, parameters, preset.angle);
+            });
+
+            TurtleGraphics turtle;
+            turtle.set3DMode(preset.is3D);
+            double reinterpretMs = bestMs(
+                options.repeats, [&]() { turtle.buildGeometry(str, parameters, preset.angle); });
+
+            TurtleGraphics streamed;
+            streamed.set3DMode(preset.is3D);
+            double streamMs = bestMs(options.repeats, [&]() {
+                SymbolStream symbols = lsystem.stream(generation);
+                streamed.buildGeometry(symbols, preset.angle);
+            });
+
+            const bool compact = turtle.getCompactInstances();
+            double packMs =
+                bestMs(options.repeats, [&]() { turtle.packInstances(packed, compact); });
+
+            // Any key will do: each case overwrites the previous file
+            constexpr uint64_t CACHE_KEY = 1;
+            cache.store(CACHE_KEY, turtle, str.size());
+            TurtleGraphics loaded;
+            double cacheLoadMs =
+                bestMs(options.repeats, [&]() { cache.load(CACHE_KEY, loaded); });
+
+            LSystem packedSystem;
+            double generatePackedMs = bestMs(options.repeats, [&]() {
+                packedSystem = LSystem();
+                packedSystem.setPacking(SymbolPacking::Nibbles);
+                packedSystem.setAxiom(preset.axiom);
+                packedSystem.addRulesFromString(preset.rules);
+                packedSystem.generate(generation);
+            });
+            double interpretPackedMs = bestMs(options.repeats, [&]() {
+                TurtleGraphics fresh;
+                fresh.set3DMode(preset.is3D);
+                fresh.buildGeometry(packedSystem, preset.angle);
+            });
+
+            // The current string only: getStringBytes() also counts the generation cache
+            const size_t packedBytes = packedSystem.isPacked()
+                                           ? packedSystem.getPackedString().getBytes()
+                                           : packedSystem.getString().capacity();
+
+            const long peakKb = peakRssKb();
+            const size_t symbols = str.size();
+            const StageTiming stages[] = {{"generate", generateMs},
+                                          {"interpret", interpretMs},
+                                          {"reinterpret", reinterpretMs},
+                                          {"stream", streamMs},
+                                          {"pack", packMs},
+                                          {"cache_load", cacheLoadMs},
+                                          {"generate_packed", generatePackedMs},
+                                          {"interpret_packed", interpretPackedMs}};
+
+            std::fprintf(out, "%s\n    {\"preset\": ", firstResult ? "" : ",");
+            writeJsonString(out, preset.name);
+            std::fprintf(out,
+                         ", \"generation\": %d, \"symbols\": %zu, \"branches\": %zu, "
+                         "\"decorations\": %zu, \"coalesced_segments\": %zu,\n",
+                         generation, symbols, turtle.getBranchCount(),
+                         turtle.getDecorationCount(), turtle.getCoalescedSegmentCount());
+            std::fprintf(out,
+                         "     \"peak_rss_kb\": %ld, \"peak_rss_scope\": \"%s\", "
+                         "\"pack_bytes\": %zu, \"pack_format\": \"%s\",\n",
+                         peakKb, peakIsPerCase ? "case" : "process", packed.size(),
+                         compact ? "compact" : "full");
+            std::fprintf(out,
+                         "     \"string_bytes\": %zu, \"packed_string_bytes\": %zu, "
+                         "\"string_packed\": %s,\n     \"stages\": {",
+                         str.capacity(), packedBytes, packedSystem.isPacked() ? "true" : "false");
+            for (size_t s = 0; s < sizeof(stages) / sizeof(stages[0]); ++s) {
+                const double ns = stages[s].ms * 1e6;
+                const double perSymbol = symbols > 0 ? ns / static_cast<double>(symbols) : 0.0;
+                const double throughput =
+                    ns > 0.0 ? static_cast<double>(symbols) * 1e3 / ns : 0.0;  // Msimbolos/s
+                std::fprintf(out,
+                             "%s\n       \"%s\": {\"ms\": %.4f, \"ns_per_symbol\": %.3f, "
+                             "\"msymbols_per_s\": %.3f}",
+                             s == 0 ? "" : ",", stages[s].name, stages[s].ms, perSymbol,
+                             throughput);
+            }
+            std::fprintf(out, "\n     }}");
+            firstResult = false;
+
+            std::fprintf(stderr, "%-18s gen %2d %10zu simbolos %8.2f ms\n", preset.name,
+                         generation, symbols, generateMs + interpretMs);
+
+            if (symbols > options.maxSymbols)
+                break;
+        }
+    }
+
+    cache.clear();
+    std::fprintf(out, "\n  ]\n}\n");
+    if (out != stdout) {
+        std::fclose(out);
+    }
+    return 0;
+}
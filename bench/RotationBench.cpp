@@ -0,0 +1,79 @@
+/**
+ * @file RotationBench.cpp
+ * @brief Benchmark de rotaciones de la tortuga: Rodrigues por comando vs matrices precalculadas.
+ *
+ * Genera cada preset de PRESETS y mide TurtleGraphics::buildGeometry con ambas rutas
+ * de rotacion. No crea ventana ni contexto OpenGL: solo ejercita la interpretacion en CPU.
+ *
+ * Uso: ./bench_rotations [repeticiones]
+ *
+ * @author Julian Parra
+ * @date 2025
+ * @course Graficacion
+ * @project Proyecto Final - "Arboles: La Belleza Algoritmica de las Plantas"
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+
+#include "lsystem/LSystem.h"
+#include "lsystem/TurtleGraphics.h"
+#include "ui/Presets.h"
+
+/*
+ * @brief Mejor tiempo (ms) de 'repeats' interpretaciones de la cadena.
+ */
+static double bestInterpretMs(TurtleGraphics& turtle, const std::string& str, float angle,
+                              int repeats) {
+    double best = 1e30;
+    for (int i = 0; i < repeats; ++i) {
+        auto start = std::chrono::steady_clock::now();
+        turtle.buildGeometry(str, angle);
+        auto end = std::chrono::steady_clock::now();
+        best = std::min(best, std::chrono::duration<double, std::milli>(end - start).count());
+    }
+    return best;
+}
+
+int main(int argc, char** argv) {
+    int repeats = argc > 1 ? std::max(1, std::atoi(argv[1])) : 5;
+
+    // Silenciar los mensajes de progreso de LSystem
+    std::cout.setstate(std::ios::failbit);
+
+    std::printf("%-18s %4s %10s %12s %12s %8s\n", "preset", "gen", "simbolos", "rodrigues_ms",
+                "matriz_ms", "speedup");
+
+    double totalReference = 0.0;
+    double totalFast = 0.0;
+
+    for (int i = 0; i < NUM_PRESETS; ++i) {
+        const LSystemPreset& preset = PRESETS[i];
+
+        LSystem lsystem;
+        lsystem.setAxiom(preset.axiom);
+        lsystem.addRulesFromString(preset.rules);
+        lsystem.generate(preset.generations);
+        const std::string& str = lsystem.getString();
+
+        TurtleGraphics turtle;
+        turtle.set3DMode(preset.is3D);
+
+        turtle.setFastRotations(false);
+        double reference = bestInterpretMs(turtle, str, preset.angle, repeats);
+        turtle.setFastRotations(true);
+        double fast = bestInterpretMs(turtle, str, preset.angle, repeats);
+
+        totalReference += reference;
+        totalFast += fast;
+        std::printf("%-18s %4d %10zu %12.3f %12.3f %7.2fx\n", preset.name, preset.generations,
+                    str.size(), reference, fast, reference / std::max(fast, 1e-9));
+    }
+
+    std::printf("%-18s %4s %10s %12.3f %12.3f %7.2fx\n", "total", "", "", totalReference,
+                totalFast, totalReference / std::max(totalFast, 1e-9));
+    return 0;
+}
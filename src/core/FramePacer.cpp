@@ -0,0 +1,49 @@
+/**
+ * @file FramePacer.cpp
+ * @brief Implementacion del ritmo de cuadros.
+ *
+ * @author Julian Parra
+ * @date 2025
+ * @course Graficacion
+ * @project Proyecto Final - "Arboles: La Belleza Algoritmica de las Plantas"
+ */
+
+#include "FramePacer.h"
+
+#include <algorithm>
+#include <thread>
+
+void FramePacer::setFrameCap(int fps) {
+    m_frameCap = std::clamp(fps, 0, MAX_FRAME_CAP);
+}
+
+double FramePacer::getBudgetMs() const {
+    return 1000.0 / static_cast<double>(m_frameCap > 0 ? m_frameCap : DEFAULT_FRAME_CAP);
+}
+
+void FramePacer::endFrame() {
+    if (!m_frameHadScene) {
+        m_cachedFrames++;
+    }
+    m_frameHadScene = false;
+    if (m_settleFrames > 0) {
+        m_settleFrames--;
+    }
+
+    // Dormir el resto del periodo; un cuadro tardio empieza el siguiente de inmediato
+    if (m_frameCap > 0) {
+        const Clock::time_point deadline =
+            m_lastFrame + std::chrono::duration_cast<Clock::duration>(
+                              std::chrono::duration<double>(1.0 / m_frameCap));
+        if (Clock::now() < deadline) {
+            std::this_thread::sleep_until(deadline);
+        }
+    }
+    m_lastFrame = Clock::now();
+}
+
+double FramePacer::getIdleWait(bool busy) const {
+    if (!m_onDemand || busy || m_sceneDirty || m_settleFrames > 0)
+        return 0.0;
+    return IDLE_WAIT_SECONDS;
+}
@@ -0,0 +1,134 @@
+/**
+ * @file FramePacer.h
+ * @brief Ritmo de cuadros del visualizador: redibujo bajo demanda y limite de FPS.
+ *
+ * Bajo demanda, la escena (planta, bosque y piso) solo se vuelve a dibujar cuando
+ * algo la invalida: entrada que mueve la camara, un control de la interfaz en
+ * uso, una regeneracion o la animacion de crecimiento. Mientras tanto el bucle
+ * reusa el ultimo cuadro guardado en un framebuffer y solo dibuja la interfaz
+ * encima; sin eventos ni trabajo pendiente, duerme en glfwWaitEventsTimeout().
+ *
+ * El limite de FPS duerme el hilo al final de cada cuadro hasta cumplir el
+ * periodo, con o sin redibujo bajo demanda.
+ *
+ * No depende de OpenGL ni de GLFW: main.cpp hace las esperas y los dibujos.
+ *
+ * @author Julian Parra
+ * @date 2025
+ * @course Graficacion
+ * @project Proyecto Final - "Arboles: La Belleza Algoritmica de las Plantas"
+ */
+
+#ifndef FRAME_PACER_H
+#define FRAME_PACER_H
+
+#include <chrono>
+#include <cstddef>
+
+/**
+ * @class FramePacer
+ * @brief Decide cuando redibujar la escena, cuanto dormir y cuanto esperar eventos.
+ *
+ * Uso por cuadro:
+ * @code
+ *   if (entrada) pacer.notifyInput();
+ *   if (cambio de escena) pacer.invalidateScene();
+ *   if (pacer.needsSceneRender()) { dibujar escena; pacer.sceneRendered(); }
+ *   dibujar interfaz; swap;
+ *   pacer.endFrame();
+ *   esperar eventos hasta pacer.getIdleWait(ocupado) segundos
+ * @endcode
+ */
+class FramePacer {
+public:
+    static constexpr int SETTLE_FRAMES = 3;           ///< Cuadros de interfaz tras la ultima entrada
+    static constexpr double IDLE_WAIT_SECONDS = 0.5;  ///< Espera maxima sin eventos
+    static constexpr int DEFAULT_FRAME_CAP = 60;
+    static constexpr int MAX_FRAME_CAP = 240;
+
+    void setOnDemand(bool enable) {
+        m_onDemand = enable;
+        m_sceneDirty = true;
+    }
+    bool isOnDemand() const {
+        return m_onDemand;
+    }
+
+    /**
+     * @param fps Cuadros por segundo maximos; 0 sin limite.
+     */
+    void setFrameCap(int fps);
+    int getFrameCap() const {
+        return m_frameCap;
+    }
+
+    /**
+     * @brief Presupuesto de un cuadro en milisegundos: el periodo del limite, o 60 Hz sin limite.
+     */
+    double getBudgetMs() const;
+
+    /**
+     * @brief Hubo eventos de entrada: la interfaz se dibuja SETTLE_FRAMES cuadros mas.
+     */
+    void notifyInput() {
+        m_settleFrames = SETTLE_FRAMES;
+    }
+
+    /**
+     * @brief La escena cambio: el proximo cuadro la vuelve a dibujar.
+     */
+    void invalidateScene() {
+        m_sceneDirty = true;
+    }
+
+    /**
+     * @brief Hay que dibujar la escena este cuadro (siempre sin redibujo bajo demanda).
+     */
+    bool needsSceneRender() const {
+        return !m_onDemand || m_sceneDirty;
+    }
+
+    /**
+     * @brief La escena quedo dibujada y guardada para los siguientes cuadros.
+     */
+    void sceneRendered() {
+        m_sceneDirty = false;
+        m_frameHadScene = true;
+        m_sceneFrames++;
+    }
+
+    /**
+     * @brief Cierra el cuadro: cuenta los cuadros reusados y aplica el limite de FPS.
+     */
+    void endFrame();
+
+    /**
+     * @brief Segundos que el bucle puede bloquearse esperando eventos.
+     * @param busy Trabajo que avanza sin entrada (generacion en curso, animacion).
+     * @return 0 si hay que sondear eventos y seguir dibujando.
+     */
+    double getIdleWait(bool busy) const;
+
+    size_t getSceneFrames() const {
+        return m_sceneFrames;
+    }
+    size_t getCachedFrames() const {
+        return m_cachedFrames;
+    }
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    bool m_onDemand{true};
+    int m_frameCap{DEFAULT_FRAME_CAP};
+    bool m_sceneDirty{true};
+    int m_settleFrames{SETTLE_FRAMES};
+    bool m_frameHadScene{false};  ///< sceneRendered() en el cuadro actual
+    Clock::time_point m_lastFrame{Clock::now()};
+
+    // Estadisticas
+    size_t m_sceneFrames{0};
+    size_t m_cachedFrames{0};
+};
+
+#endif  // FRAME_PACER_H
@@ -0,0 +1,275 @@
+/**
+ * @file PngWriter.cpp
+ * @brief Implementacion del codificador PNG (filtro Sub y deflate de Huffman fijo).
+ *
+ * @author Julian Parra
+ * @date 2025
+ * @course Graficacion
+ * @project Proyecto Final - "Arboles: La Belleza Algoritmica de las Plantas"
+ */
+
+#include "PngWriter.h"
+
+#include <array>
+#include <cstdio>
+
+namespace {
+
+constexpr size_t MAX_MATCH = 258;
+constexpr size_t MIN_MATCH = 3;
+
+// Codigos de longitud de deflate 257..285: longitud base y bits extra (RFC 1951, 3.2.5)
+constexpr std::array<uint16_t, 29> LENGTH_BASE = {3,  4,  5,  6,  7,  8,  9,  10,  11,  13,
+                                                  15, 17, 19, 23, 27, 31, 35, 43,  51,  59,
+                                                  67, 83, 99, 115, 131, 163, 195, 227, 258};
+constexpr std::array<uint8_t, 29> LENGTH_EXTRA = {0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2,
+                                                  2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0};
+
+uint32_t reverseBits(uint32_t value, int bits) {
+    uint32_t reversed = 0;
+    for (int i = 0; i < bits; ++i) {
+        reversed = (reversed << 1) | ((value >> i) & 1U);
+    }
+    return reversed;
+}
+
+// Codigo Huffman fijo de literales/longitudes, ya invertido para escribir desde el LSB
+struct FixedCode {
+    uint16_t bits;
+    uint8_t length;
+};
+
+const std::array<FixedCode, 288>& fixedCodes() {
+    static const std::array<FixedCode, 288> codes = [] {
+        std::array<FixedCode, 288> table{};
+        for (uint32_t symbol = 0; symbol < 288; ++symbol) {
+            uint32_t code = 0;
+            int length = 0;
+            if (symbol < 144) {
+                code = 0x30 + symbol;
+                length = 8;
+            } else if (symbol < 256) {
+                code = 0x190 + (symbol - 144);
+                length = 9;
+            } else if (symbol < 280) {
+                code = symbol - 256;
+                length = 7;
+            } else {
+                code = 0xC0 + (symbol - 280);
+                length = 8;
+            }
+            table[symbol] = {static_cast<uint16_t>(reverseBits(code, length)),
+                             static_cast<uint8_t>(length)};
+        }
+        return table;
+    }();
+    return codes;
+}
+
+// Indice del codigo de longitud para cada longitud de coincidencia
+const std::array<uint8_t, MAX_MATCH + 1>& lengthCodes() {
+    static const std::array<uint8_t, MAX_MATCH + 1> codes = [] {
+        std::array<uint8_t, MAX_MATCH + 1> table{};
+        size_t code = 0;
+        for (size_t length = MIN_MATCH; length <= MAX_MATCH; ++length) {
+            while (code + 1 < LENGTH_BASE.size() && LENGTH_BASE[code + 1] <= length) {
+                code++;
+            }
+            table[length] = static_cast<uint8_t>(code);
+        }
+        return table;
+    }();
+    return codes;
+}
+
+const std::array<uint32_t, 256>& crcTable() {
+    static const std::array<uint32_t, 256> table = [] {
+        std::array<uint32_t, 256> values{};
+        for (uint32_t n = 0; n < 256; ++n) {
+            uint32_t c = n;
+            for (int k = 0; k < 8; ++k) {
+                c = (c & 1U) != 0 ? 0xEDB88320U ^ (c >> 1) : c >> 1;
+            }
+            values[n] = c;
+        }
+        return values;
+    }();
+    return table;
+}
+
+uint32_t crc32(const uint8_t* data, size_t size, uint32_t crc = 0) {
+    const auto& table = crcTable();
+    crc = ~crc;
+    for (size_t i = 0; i < size; ++i) {
+        crc = table[(crc ^ data[i]) & 0xFFU] ^ (crc >> 8);
+    }
+    return ~crc;
+}
+
+uint32_t adler32(const uint8_t* data, size_t size) {
+    uint32_t a = 1;
+    uint32_t b = 0;
+    while (size > 0) {
+        // Bloque mas grande cuyas sumas no se desbordan antes del modulo
+        const size_t block = size < 5552 ? size : 5552;
+        for (size_t i = 0; i < block; ++i) {
+            a += data[i];
+            b += a;
+        }
+        a %= 65521U;
+        b %= 65521U;
+        data += block;
+        size -= block;
+    }
+    return (b << 16) | a;
+}
+
+class BitWriter {
+public:
+    explicit BitWriter(std::vector<uint8_t>& out) : m_out(out) {}
+
+    void put(uint32_t value, int bits) {
+        m_bits |= static_cast<uint64_t>(value) << m_count;
+        m_count += bits;
+        while (m_count >= 8) {
+            m_out.push_back(static_cast<uint8_t>(m_bits));
+            m_bits >>= 8;
+            m_count -= 8;
+        }
+    }
+
+    void putSymbol(uint32_t symbol) {
+        const FixedCode& code = fixedCodes()[symbol];
+        put(code.bits, code.length);
+    }
+
+    void flush() {
+        if (m_count > 0) {
+            m_out.push_back(static_cast<uint8_t>(m_bits));
+        }
+        m_bits = 0;
+        m_count = 0;
+    }
+
+private:
+    std::vector<uint8_t>& m_out;
+    uint64_t m_bits{0};
+    int m_count{0};
+};
+
+void putBigEndian(std::vector<uint8_t>& out, uint32_t value) {
+    out.push_back(static_cast<uint8_t>(value >> 24));
+    out.push_back(static_cast<uint8_t>(value >> 16));
+    out.push_back(static_cast<uint8_t>(value >> 8));
+    out.push_back(static_cast<uint8_t>(value));
+}
+
+// Completa la longitud del chunk iniciado en lengthAt y agrega su CRC
+void finishChunk(std::vector<uint8_t>& out, size_t lengthAt) {
+    const size_t dataBegin = lengthAt + 8;
+    const auto length = static_cast<uint32_t>(out.size() - dataBegin);
+    out[lengthAt] = static_cast<uint8_t>(length >> 24);
+    out[lengthAt + 1] = static_cast<uint8_t>(length >> 16);
+    out[lengthAt + 2] = static_cast<uint8_t>(length >> 8);
+    out[lengthAt + 3] = static_cast<uint8_t>(length);
+    // El CRC cubre el tipo del chunk y sus datos
+    putBigEndian(out, crc32(out.data() + lengthAt + 4, length + 4));
+}
+
+size_t beginChunk(std::vector<uint8_t>& out, const char* type) {
+    const size_t lengthAt = out.size();
+    out.insert(out.end(), 4, 0);
+    out.insert(out.end(), type, type + 4);
+    return lengthAt;
+}
+
+}  // namespace
+
+void encodePng(const uint8_t* rgba, int width, int height, bool bottomUp,
+               std::vector<uint8_t>& out) {
+    const auto w = static_cast<size_t>(width);
+    const auto h = static_cast<size_t>(height);
+    const size_t stride = 1 + w * 3;
+
+    // Filtro Sub en filas RGB: cada byte menos el mismo canal del pixel anterior
+    std::vector<uint8_t> filtered(stride * h);
+    for (size_t y = 0; y < h; ++y) {
+        const uint8_t* src = rgba + (bottomUp ? h - 1 - y : y) * w * 4;
+        uint8_t* dst = filtered.data() + y * stride;
+        *dst++ = 1;
+        uint8_t previous[3] = {0, 0, 0};
+        for (size_t x = 0; x < w; ++x, src += 4, dst += 3) {
+            for (int c = 0; c < 3; ++c) {
+                dst[c] = static_cast<uint8_t>(src[c] - previous[c]);
+                previous[c] = src[c];
+            }
+        }
+    }
+
+    out.clear();
+    out.reserve(filtered.size() / 4 + 1024);
+    static const uint8_t SIGNATURE[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+    out.insert(out.end(), SIGNATURE, SIGNATURE + 8);
+
+    size_t chunk = beginChunk(out, "IHDR");
+    putBigEndian(out, static_cast<uint32_t>(width));
+    putBigEndian(out, static_cast<uint32_t>(height));
+    const uint8_t format[5] = {8, 2, 0, 0, 0};  // 8 bits, RGB, deflate, adaptativo, sin entrelazado
+    out.insert(out.end(), format, format + 5);
+    finishChunk(out, chunk);
+
+    // Flujo zlib: encabezado, un solo bloque final de Huffman fijo, Adler-32
+    chunk = beginChunk(out, "IDAT");
+    out.push_back(0x78);
+    out.push_back(0x01);
+    BitWriter bits(out);
+    bits.put(1, 1);  // BFINAL
+    bits.put(1, 2);  // BTYPE = Huffman fijo
+
+    const auto& lengthCode = lengthCodes();
+    const uint8_t* data = filtered.data();
+    const size_t size = filtered.size();
+    size_t i = 0;
+    while (i < size) {
+        // Racha del byte anterior: una coincidencia a distancia 1
+        size_t run = 0;
+        if (i > 0) {
+            const uint8_t previous = data[i - 1];
+            const size_t limit = (size - i < MAX_MATCH) ? size - i : MAX_MATCH;
+            while (run < limit && data[i + run] == previous) {
+                run++;
+            }
+        }
+        if (run < MIN_MATCH) {
+            bits.putSymbol(data[i++]);
+            continue;
+        }
+        const uint8_t code = lengthCode[run];
+        bits.putSymbol(257U + code);
+        if (LENGTH_EXTRA[code] > 0) {
+            bits.put(static_cast<uint32_t>(run - LENGTH_BASE[code]), LENGTH_EXTRA[code]);
+        }
+        bits.put(0, 5);  // Codigo de distancia 0: distancia 1, sin bits extra
+        i += run;
+    }
+    bits.putSymbol(256);  // Fin de bloque
+    bits.flush();
+    putBigEndian(out, adler32(data, size));
+    finishChunk(out, chunk);
+
+    chunk = beginChunk(out, "IEND");
+    finishChunk(out, chunk);
+}
+
+bool writePng(const std::string& path, const uint8_t* rgba, int width, int height,
+              bool bottomUp) {
+    std::vector<uint8_t> png;
+    encodePng(rgba, width, height, bottomUp, png);
+
+    FILE* file = std::fopen(path.c_str(), "wb");
+    if (file == nullptr)
+        return false;
+    bool ok = std::fwrite(png.data(), 1, png.size(), file) == png.size();
+    ok = (std::fclose(file) == 0) && ok;
+    return ok;
+}
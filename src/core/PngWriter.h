@@ -0,0 +1,41 @@
+/**
+ * @file PngWriter.h
+ * @brief Codificador PNG minimo y sin dependencias para exportar cuadros.
+ *
+ * Escribe RGB de 8 bits con el filtro Sub en cada fila y un solo bloque deflate
+ * con codigos Huffman fijos, cuyas unicas coincidencias son rachas a distancia 1.
+ * Tras el filtro, un fondo liso es casi todo ceros, asi que las miniaturas se
+ * comprimen bien y el codificador se mantiene en una pasada lineal sin tablas
+ * hash ni zlib.
+ *
+ * No depende de OpenGL.
+ *
+ * @author Julian Parra
+ * @date 2025
+ * @course Graficacion
+ * @project Proyecto Final - "Arboles: La Belleza Algoritmica de las Plantas"
+ */
+
+#ifndef PNG_WRITER_H
+#define PNG_WRITER_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Codifica una imagen RGBA de 8 bits como PNG RGB (el alfa se descarta).
+ * @param bottomUp Filas de abajo hacia arriba (como las entrega glReadPixels).
+ * @param out Archivo PNG completo; se reemplaza su contenido.
+ */
+void encodePng(const uint8_t* rgba, int width, int height, bool bottomUp,
+               std::vector<uint8_t>& out);
+
+/**
+ * @brief Codifica con encodePng() y escribe el archivo.
+ * @return false si no se pudo escribir.
+ */
+bool writePng(const std::string& path, const uint8_t* rgba, int width, int height,
+              bool bottomUp);
+
+#endif  // PNG_WRITER_H
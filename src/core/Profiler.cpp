@@ -0,0 +1,156 @@
+/**
+ * @file Profiler.cpp
+ * @brief Implementacion del registro de mediciones por etapa.
+ *
+ * @author Julian Parra
+ * @date 2025
+ * @course Graficacion
+ * @project Proyecto Final - "Arboles: La Belleza Algoritmica de las Plantas"
+ */
+
+#include "Profiler.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+
+namespace {
+
+// Indexado por ProfileStage
+const char* const STAGE_NAMES[Profiler::STAGE_COUNT] = {
+    "Parseo de reglas",
+    "Generacion",
+    "Interpretacion",
+    "Jerarquia",
+    "Subida de ramas",
+    "Subida de decoraciones",
+    "Cuadro (CPU)",
+    "GPU piso",
+    "GPU ramas",
+    "GPU decoraciones",
+    "GPU cuadro",
+};
+
+// Tomado al inicio para que las marcas de tiempo de la traza empiecen cerca de cero
+const std::chrono::steady_clock::time_point PROFILER_EPOCH = std::chrono::steady_clock::now();
+
+}  // namespace
+
+Profiler& Profiler::instance() {
+    static Profiler profiler;
+    return profiler;
+}
+
+const char* Profiler::stageName(ProfileStage stage) {
+    return STAGE_NAMES[static_cast<int>(stage)];
+}
+
+bool Profiler::isGpuStage(ProfileStage stage) {
+    return stage == ProfileStage::GpuFloor || stage == ProfileStage::GpuBranches ||
+           stage == ProfileStage::GpuDecorations || stage == ProfileStage::GpuFrame;
+}
+
+double Profiler::nowMicroseconds() {
+    return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() -
+                                                     PROFILER_EPOCH)
+        .count();
+}
+
+int Profiler::currentThreadIndex() {
+    // Ids pequenos y estables para las filas de la traza; 0 queda reservado para la GPU
+    static std::atomic<int> nextIndex{GPU_THREAD + 1};
+    thread_local const int index = nextIndex.fetch_add(1);
+    return index;
+}
+
+void Profiler::addSample(ProfileStage stage, double startUs, double durationUs) {
+    const int thread = isGpuStage(stage) ? GPU_THREAD : currentThreadIndex();
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    StageRing& ring = m_stages[static_cast<int>(stage)];
+    ring.samples[ring.next] = static_cast<float>(durationUs / 1000.0);
+    ring.next = (ring.next + 1) % HISTORY;
+    ring.count = std::min(ring.count + 1, HISTORY);
+
+    if (m_tracing && m_trace.size() < MAX_TRACE_EVENTS) {
+        m_trace.push_back({startUs, durationUs, stage, thread});
+    }
+}
+
+Profiler::StageHistory Profiler::getHistory(ProfileStage stage) const {
+    StageHistory history;
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    const StageRing& ring = m_stages[static_cast<int>(stage)];
+    history.count = ring.count;
+    if (ring.count == 0)
+        return history;
+
+    // Muestra mas antigua primero para que la grafica avance hacia la izquierda
+    const int first = (ring.next - ring.count + HISTORY) % HISTORY;
+    float sum = 0.0F;
+    for (int i = 0; i < ring.count; ++i) {
+        const float sample = ring.samples[(first + i) % HISTORY];
+        history.samples[i] = sample;
+        history.peak = std::max(history.peak, sample);
+        sum += sample;
+    }
+    history.last = history.samples[ring.count - 1];
+    history.average = sum / static_cast<float>(ring.count);
+    return history;
+}
+
+void Profiler::setTracing(bool enable) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (enable && !m_tracing) {
+        m_trace.clear();
+    }
+    m_tracing = enable;
+}
+
+bool Profiler::isTracing() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_tracing;
+}
+
+size_t Profiler::getTraceEventCount() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_trace.size();
+}
+
+bool Profiler::writeChromeTrace(const char* filename) const {
+    FILE* file = std::fopen(filename, "w");
+    if (file == nullptr)
+        return false;
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    // Nombrar las filas: primero la de la GPU, luego una por hilo de CPU visto en la traza
+    int maxThread = GPU_THREAD;
+    for (const TraceEvent& event : m_trace) {
+        maxThread = std::max(maxThread, event.thread);
+    }
+
+    std::fprintf(file, "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n");
+    std::fprintf(file,
+                 "{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": %d, "
+                 "\"args\": {\"name\": \"GPU\"}}",
+                 GPU_THREAD);
+    for (int thread = GPU_THREAD + 1; thread <= maxThread; ++thread) {
+        std::fprintf(file,
+                     ",\n{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": %d, "
+                     "\"args\": {\"name\": \"CPU %d\"}}",
+                     thread, thread);
+    }
+    for (const TraceEvent& event : m_trace) {
+        std::fprintf(file,
+                     ",\n{\"name\": \"%s\", \"cat\": \"%s\", \"ph\": \"X\", \"pid\": 1, "
+                     "\"tid\": %d, \"ts\": %.3f, \"dur\": %.3f}",
+                     stageName(event.stage), isGpuStage(event.stage) ? "gpu" : "cpu",
+                     event.thread, event.startUs, event.durationUs);
+    }
+    std::fprintf(file, "\n]}\n");
+
+    return std::fclose(file) == 0;
+}
@@ -0,0 +1,156 @@
+/**
+ * @file Profiler.h
+ * @brief Temporizadores por etapa del pipeline y exportacion a trazas de Chrome.
+ *
+ * Las etapas de CPU (parseo de reglas, generacion, interpretacion, subida y cuadro) se
+ * miden con ProfileScope desde cualquier hilo, incluido el de GenerationWorker.
+ * Las etapas de GPU llegan como muestras ya resueltas de GpuTimer. Cada etapa
+ * guarda un historial circular para las graficas de la ventana de depuracion y,
+ * con la traza activa, cada medicion se anota como evento "X" del formato
+ * chrome://tracing.
+ *
+ * No depende de OpenGL: las herramientas sin ventana lo enlazan igual.
+ *
+ * @author Julian Parra
+ * @date 2025
+ * @course Graficacion
+ * @project Proyecto Final - "Arboles: La Belleza Algoritmica de las Plantas"
+ */
+
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <array>
+#include <cstddef>
+#include <mutex>
+#include <vector>
+
+/**
+ * @brief Etapas medidas del pipeline.
+ */
+enum class ProfileStage {
+    ParseRules,         ///< LSystem::addRulesFromString / loadRules
+    Generate,           ///< LSystem::generate
+    Interpret,          ///< TurtleGraphics::buildGeometry (cadena, flujo o memoizada)
+    Hierarchy,          ///< TurtleGraphics::buildHierarchy (BVH de subarboles)
+    UploadBranches,     ///< Instancias de rama a la GPU
+    UploadDecorations,  ///< Instancias de hojas y flores a la GPU
+    Frame,              ///< Trabajo de CPU de un cuadro interactivo (sin esperas)
+    GpuFloor,           ///< Dibujo del piso (GL_TIME_ELAPSED)
+    GpuBranches,        ///< Culling y dibujo de ramas (GL_TIME_ELAPSED)
+    GpuDecorations,     ///< Dibujo de hojas y flores (GL_TIME_ELAPSED)
+    GpuFrame,           ///< Cuadro completo con la interfaz (GL_TIMESTAMP)
+    Count
+};
+
+/**
+ * @class Profiler
+ * @brief Registro global y seguro entre hilos de las mediciones por etapa.
+ */
+class Profiler {
+public:
+    static constexpr int STAGE_COUNT = static_cast<int>(ProfileStage::Count);
+    static constexpr int HISTORY = 120;                          ///< Muestras por grafica
+    static constexpr size_t MAX_TRACE_EVENTS = size_t{1} << 20;  ///< Limite de la traza
+
+    /**
+     * @brief Historial de una etapa en orden cronologico.
+     */
+    struct StageHistory {
+        std::array<float, HISTORY> samples{};  ///< Milisegundos; los primeros 'count' son validos
+        int count{0};
+        float last{0.0F};     ///< Ultima muestra (ms)
+        float average{0.0F};  ///< Promedio del historial (ms)
+        float peak{0.0F};     ///< Maximo del historial (ms)
+    };
+
+    static Profiler& instance();
+
+    Profiler(const Profiler&) = delete;
+    Profiler& operator=(const Profiler&) = delete;
+
+    static const char* stageName(ProfileStage stage);
+    static bool isGpuStage(ProfileStage stage);
+
+    /**
+     * @brief Microsegundos desde el arranque del perfilador (reloj monotono).
+     */
+    static double nowMicroseconds();
+
+    /**
+     * @brief Agrega una medicion terminada.
+     * @param startUs Inicio segun nowMicroseconds() (para la traza).
+     * @param durationUs Duracion de la etapa.
+     * @note Las etapas de GPU se anotan en su propia fila de la traza.
+     */
+    void addSample(ProfileStage stage, double startUs, double durationUs);
+
+    /**
+     * @brief Copia el historial de una etapa.
+     */
+    StageHistory getHistory(ProfileStage stage) const;
+
+    /**
+     * @brief Activa la grabacion de eventos; al activarla se descarta la traza anterior.
+     */
+    void setTracing(bool enable);
+    bool isTracing() const;
+    size_t getTraceEventCount() const;
+
+    /**
+     * @brief Escribe la traza grabada en formato JSON de chrome://tracing (o Perfetto).
+     * @return false si no se pudo escribir el archivo.
+     */
+    bool writeChromeTrace(const char* filename) const;
+
+private:
+    Profiler() = default;
+
+    struct StageRing {
+        std::array<float, HISTORY> samples{};
+        int next{0};
+        int count{0};
+    };
+
+    struct TraceEvent {
+        double startUs;
+        double durationUs;
+        ProfileStage stage;
+        int thread;  ///< Indice de hilo de CPU; GPU_THREAD para etapas de GPU
+    };
+
+    static int currentThreadIndex();
+    static constexpr int GPU_THREAD = 0;
+
+    mutable std::mutex m_mutex;
+    std::array<StageRing, STAGE_COUNT> m_stages{};
+    std::vector<TraceEvent> m_trace;
+    bool m_tracing{false};
+};
+
+/**
+ * @class ProfileScope
+ * @brief Mide el tiempo de CPU de su alcance y lo registra en Profiler.
+ *
+ * Uso:
+ * @code
+ *   ProfileScope scope(ProfileStage::Generate);
+ * @endcode
+ */
+class ProfileScope {
+public:
+    explicit ProfileScope(ProfileStage stage)
+        : m_stage(stage), m_start(Profiler::nowMicroseconds()) {}
+    ~ProfileScope() {
+        Profiler::instance().addSample(m_stage, m_start, Profiler::nowMicroseconds() - m_start);
+    }
+
+    ProfileScope(const ProfileScope&) = delete;
+    ProfileScope& operator=(const ProfileScope&) = delete;
+
+private:
+    ProfileStage m_stage;
+    double m_start;
+};
+
+#endif  // PROFILER_H
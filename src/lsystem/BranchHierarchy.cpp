@@ -0,0 +1,452 @@
+/**
+ * @file BranchHierarchy.cpp
+ * @brief Implementacion de la BVH de subarboles: construccion, culling y seleccion.
+ *
+ * @author Julian Parra
+ * @date 2025
+ * @course Graficacion
+ * @project Proyecto Final - "Arboles: La Belleza Algoritmica de las Plantas"
+ */
+
+#include "BranchHierarchy.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <limits>
+
+#include "TurtleGraphics.h"
+
+namespace {
+
+// El quad de decoracion cubre x en [-0.5, 0.5] e y en [0, 1]: su esquina mas lejana
+constexpr float DECORATION_REACH = 1.12F;
+
+enum class Containment { Outside, Intersects, Inside };
+
+using FrustumPlanes = std::array<glm::vec4, 6>;
+
+// Gribb-Hartmann: planos a partir de las filas de la matriz de recorte, hacia adentro
+FrustumPlanes extractPlanes(const glm::mat4& m) {
+    const glm::vec4 row0(m[0][0], m[1][0], m[2][0], m[3][0]);
+    const glm::vec4 row1(m[0][1], m[1][1], m[2][1], m[3][1]);
+    const glm::vec4 row2(m[0][2], m[1][2], m[2][2], m[3][2]);
+    const glm::vec4 row3(m[0][3], m[1][3], m[2][3], m[3][3]);
+    return {row3 + row0, row3 - row0, row3 + row1, row3 - row1, row3 + row2, row3 - row2};
+}
+
+Containment classify(const FrustumPlanes& planes, const glm::vec3& boxMin,
+                     const glm::vec3& boxMax) {
+    Containment result = Containment::Inside;
+    for (const glm::vec4& plane : planes) {
+        const glm::vec3 normal(plane);
+        // Esquina mas lejana a lo largo de la normal, y la mas cercana
+        const glm::vec3 positive(normal.x >= 0.0F ? boxMax.x : boxMin.x,
+                                 normal.y >= 0.0F ? boxMax.y : boxMin.y,
+                                 normal.z >= 0.0F ? boxMax.z : boxMin.z);
+        if (glm::dot(normal, positive) + plane.w < 0.0F)
+            return Containment::Outside;
+        const glm::vec3 negative(normal.x >= 0.0F ? boxMin.x : boxMax.x,
+                                 normal.y >= 0.0F ? boxMin.y : boxMax.y,
+                                 normal.z >= 0.0F ? boxMin.z : boxMax.z);
+        if (glm::dot(normal, negative) + plane.w < 0.0F) {
+            result = Containment::Intersects;
+        }
+    }
+    return result;
+}
+
+// Prueba de slabs; distancia de entrada en 'near' (0 si el origen esta dentro)
+bool rayHitsBox(const glm::vec3& origin, const glm::vec3& inverseDirection,
+                const glm::vec3& boxMin, const glm::vec3& boxMax, float maxDistance,
+                float& near) {
+    const glm::vec3 t0 = (boxMin - origin) * inverseDirection;
+    const glm::vec3 t1 = (boxMax - origin) * inverseDirection;
+    const glm::vec3 tMin = glm::min(t0, t1);
+    const glm::vec3 tMax = glm::max(t0, t1);
+    near = std::max(std::max(tMin.x, tMin.y), std::max(tMin.z, 0.0F));
+    const float far = std::min(std::min(tMax.x, tMax.y), std::min(tMax.z, maxDistance));
+    return near <= far;
+}
+
+// Acercamiento minimo entre el rayo o + s*d (s >= 0, |d| = 1) y el segmento [a, b]
+// (Ericson, Real-Time Collision Detection 5.1.9); devuelve la distancia al cuadrado
+float raySegmentDistance2(const glm::vec3& origin, const glm::vec3& direction, const glm::vec3& a,
+                          const glm::vec3& b, float& s, float& t) {
+    const glm::vec3 segment = b - a;
+    const glm::vec3 r = origin - a;
+    const float e = glm::dot(segment, segment);
+    const float f = glm::dot(segment, r);
+    const float c = glm::dot(direction, r);
+
+    if (e <= 1e-12F) {
+        t = 0.0F;
+        s = std::max(-c, 0.0F);
+    } else {
+        const float bDot = glm::dot(direction, segment);
+        const float denominator = e - bDot * bDot;  // |d| = 1
+        s = denominator > 1e-12F ? std::max((bDot * f - c * e) / denominator, 0.0F) : 0.0F;
+        t = (bDot * s + f) / e;
+        if (t < 0.0F) {
+            t = 0.0F;
+            s = std::max(-c, 0.0F);
+        } else if (t > 1.0F) {
+            t = 1.0F;
+            s = std::max(bDot - c, 0.0F);
+        }
+    }
+    const glm::vec3 difference = (origin + direction * s) - (a + segment * t);
+    return glm::dot(difference, difference);
+}
+
+void appendRange(std::vector<InstanceRange>& ranges, InstanceRange range) {
+    if (range.begin == range.end)
+        return;
+    if (!ranges.empty() && ranges.back().end == range.begin) {
+        ranges.back().end = range.end;
+        return;
+    }
+    ranges.push_back(range);
+}
+
+// Demasiados dibujos para un arreglo: unir los huecos mas chicos hasta que quepan
+void limitRanges(std::vector<InstanceRange>& ranges, size_t maxRanges) {
+    uint32_t tolerance = 1;
+    while (ranges.size() > maxRanges) {
+        size_t kept = 0;
+        for (size_t i = 1; i < ranges.size(); ++i) {
+            if (ranges[i].begin - ranges[kept].end <= tolerance) {
+                ranges[kept].end = ranges[i].end;
+            } else {
+                ranges[++kept] = ranges[i];
+            }
+        }
+        ranges.resize(kept + 1);
+        tolerance *= 2;
+    }
+}
+
+}  // namespace
+
+// =============================================================================
+// Construccion
+// =============================================================================
+
+void BranchHierarchy::clear() {
+    m_nodes.clear();
+}
+
+void BranchHierarchy::build(const std::vector<BranchData>& branches,
+                            const std::vector<DecorationData>& leaves,
+                            const std::vector<DecorationData>& flowers,
+                            const std::vector<InstanceSpan>& spans) {
+    m_nodes.clear();
+    if (branches.empty() && leaves.empty() && flowers.empty())
+        return;
+
+    m_branches = &branches;
+    m_leaves = &leaves;
+    m_flowers = &flowers;
+
+    InstanceSpan root;
+    root.branchEnd = static_cast<uint32_t>(branches.size());
+    root.leafEnd = static_cast<uint32_t>(leaves.size());
+    root.flowerEnd = static_cast<uint32_t>(flowers.size());
+
+    // Cerrar los corchetes abiertos al final de su padre y conservar solo los tramos
+    // que justifican un nodo. Los tramos estan en preorden, asi que un padre siempre
+    // se resuelve antes que sus hijos.
+    std::vector<InstanceSpan> resolved(spans);
+    std::vector<uint32_t> owner(spans.size(), InstanceSpan::NO_PARENT);  // Ancestro conservado
+    std::vector<char> kept(spans.size(), 0);
+    std::vector<std::vector<uint32_t>> spanChildren(spans.size());
+    std::vector<uint32_t> rootChildren;
+
+    auto close = [](uint32_t& begin, uint32_t& end, uint32_t outerBegin, uint32_t outerEnd) {
+        end = std::min(end, outerEnd);
+        begin = std::clamp(begin, outerBegin, end);
+    };
+
+    for (size_t i = 0; i < resolved.size(); ++i) {
+        InstanceSpan& span = resolved[i];
+        const uint32_t parent = span.parent < i ? span.parent : InstanceSpan::NO_PARENT;
+        const InstanceSpan& outer = parent == InstanceSpan::NO_PARENT ? root : resolved[parent];
+        close(span.branchBegin, span.branchEnd, outer.branchBegin, outer.branchEnd);
+        close(span.leafBegin, span.leafEnd, outer.leafBegin, outer.leafEnd);
+        close(span.flowerBegin, span.flowerEnd, outer.flowerBegin, outer.flowerEnd);
+
+        if (parent != InstanceSpan::NO_PARENT) {
+            owner[i] = kept[parent] != 0 ? parent : owner[parent];
+        }
+        const InstanceSpan& container =
+            owner[i] == InstanceSpan::NO_PARENT ? root : resolved[owner[i]];
+        // Un tramo que cubre todo su contenedor ("[[...]]") agregaria un nivel sin ganancia
+        const bool same = span.branchBegin == container.branchBegin &&
+                          span.branchEnd == container.branchEnd &&
+                          span.leafBegin == container.leafBegin &&
+                          span.leafEnd == container.leafEnd &&
+                          span.flowerBegin == container.flowerBegin &&
+                          span.flowerEnd == container.flowerEnd;
+        if (span.instanceCount() >= MIN_SPAN_INSTANCES && !same) {
+            kept[i] = 1;
+            (owner[i] == InstanceSpan::NO_PARENT ? rootChildren : spanChildren[owner[i]])
+                .push_back(static_cast<uint32_t>(i));
+        }
+    }
+
+    m_nodes.reserve(2 * (branches.size() + leaves.size() + flowers.size()) / MAX_LEAF_INSTANCES +
+                    2 * spans.size() / MIN_SPAN_INSTANCES + 1);
+    m_nodes.emplace_back();
+    buildNode(0, root, rootChildren, spanChildren, resolved);
+
+    m_branches = nullptr;
+    m_leaves = nullptr;
+    m_flowers = nullptr;
+}
+
+void BranchHierarchy::buildNode(uint32_t slot, const InstanceSpan& range,
+                                const std::vector<uint32_t>& children,
+                                const std::vector<std::vector<uint32_t>>& spanChildren,
+                                const std::vector<InstanceSpan>& spans) {
+    // Hijos en orden de instancias: las hojas de cada hueco y luego el siguiente subarbol
+    std::vector<Node> childNodes;
+    std::vector<uint32_t> childSpan;  // Tramo de cada hijo; NO_PARENT para las hojas de un hueco
+    InstanceSpan gap = range;
+    auto flushGap = [&](uint32_t branchEnd, uint32_t leafEnd, uint32_t flowerEnd) {
+        gap.branchEnd = branchEnd;
+        gap.leafEnd = leafEnd;
+        gap.flowerEnd = flowerEnd;
+        appendLeaves(gap, childNodes);
+        childSpan.resize(childNodes.size(), InstanceSpan::NO_PARENT);
+    };
+    for (uint32_t child : children) {
+        const InstanceSpan& span = spans[child];
+        flushGap(span.branchBegin, span.leafBegin, span.flowerBegin);
+        Node node;
+        node.branches = {span.branchBegin, span.branchEnd};
+        node.leaves = {span.leafBegin, span.leafEnd};
+        node.flowers = {span.flowerBegin, span.flowerEnd};
+        childNodes.push_back(node);
+        childSpan.push_back(child);
+        gap.branchBegin = span.branchEnd;
+        gap.leafBegin = span.leafEnd;
+        gap.flowerBegin = span.flowerEnd;
+    }
+    flushGap(range.branchEnd, range.leafEnd, range.flowerEnd);
+
+    m_nodes[slot].branches = {range.branchBegin, range.branchEnd};
+    m_nodes[slot].leaves = {range.leafBegin, range.leafEnd};
+    m_nodes[slot].flowers = {range.flowerBegin, range.flowerEnd};
+
+    // Un solo bloque es el propio nodo
+    if (childNodes.size() <= 1 && (childSpan.empty() || childSpan[0] == InstanceSpan::NO_PARENT)) {
+        fitLeaf(m_nodes[slot]);
+        return;
+    }
+
+    // Reservar el bloque entero para que los hermanos queden contiguos; los subarboles van detras.
+    // m_nodes puede reubicarse en la recursion: a traves de ella solo se guardan indices.
+    const auto first = static_cast<uint32_t>(m_nodes.size());
+    m_nodes[slot].firstChild = first;
+    m_nodes[slot].childCount = static_cast<uint32_t>(childNodes.size());
+    m_nodes.insert(m_nodes.end(), childNodes.begin(), childNodes.end());
+
+    glm::vec3 boundsMin(std::numeric_limits<float>::max());
+    glm::vec3 boundsMax(std::numeric_limits<float>::lowest());
+    float maxRadius = 0.0F;
+    float maxDecoration = 0.0F;
+    for (uint32_t i = 0; i < childNodes.size(); ++i) {
+        if (childSpan[i] != InstanceSpan::NO_PARENT) {
+            const uint32_t span = childSpan[i];
+            buildNode(first + i, spans[span], spanChildren[span], spanChildren, spans);
+        }
+        const Node& child = m_nodes[first + i];
+        boundsMin = glm::min(boundsMin, child.boundsMin);
+        boundsMax = glm::max(boundsMax, child.boundsMax);
+        maxRadius = std::max(maxRadius, child.maxRadius);
+        maxDecoration = std::max(maxDecoration, child.maxDecoration);
+    }
+
+    Node& node = m_nodes[slot];
+    node.boundsMin = boundsMin;
+    node.boundsMax = boundsMax;
+    node.maxRadius = maxRadius;
+    node.maxDecoration = maxDecoration;
+}
+
+void BranchHierarchy::appendLeaves(const InstanceSpan& gap, std::vector<Node>& out) const {
+    const uint64_t branchCount = gap.branchEnd - gap.branchBegin;
+    const uint64_t leafCount = gap.leafEnd - gap.leafBegin;
+    const uint64_t flowerCount = gap.flowerEnd - gap.flowerBegin;
+    const uint64_t largest = std::max(branchCount, leafCount + flowerCount);
+    if (largest == 0)
+        return;
+
+    // Las decoraciones cuelgan de las ramas del mismo tramo: dividirlas igual
+    const uint64_t chunks = (largest + MAX_LEAF_INSTANCES - 1) / MAX_LEAF_INSTANCES;
+    auto split = [chunks](uint32_t begin, uint64_t count, uint64_t k) {
+        return static_cast<uint32_t>(begin + count * k / chunks);
+    };
+    for (uint64_t k = 0; k < chunks; ++k) {
+        Node node;
+        node.branches = {split(gap.branchBegin, branchCount, k),
+                         split(gap.branchBegin, branchCount, k + 1)};
+        node.leaves = {split(gap.leafBegin, leafCount, k), split(gap.leafBegin, leafCount, k + 1)};
+        node.flowers = {split(gap.flowerBegin, flowerCount, k),
+                        split(gap.flowerBegin, flowerCount, k + 1)};
+        fitLeaf(node);
+        out.push_back(node);
+    }
+}
+
+void BranchHierarchy::fitLeaf(Node& node) const {
+    glm::vec3 boundsMin(std::numeric_limits<float>::max());
+    glm::vec3 boundsMax(std::numeric_limits<float>::lowest());
+    float maxRadius = 0.0F;
+    float maxDecoration = 0.0F;
+
+    for (uint32_t i = node.branches.begin; i < node.branches.end; ++i) {
+        const BranchData& branch = (*m_branches)[i];
+        boundsMin = glm::min(boundsMin, glm::min(branch.start, branch.end));
+        boundsMax = glm::max(boundsMax, glm::max(branch.start, branch.end));
+        maxRadius = std::max(maxRadius, std::max(branch.radiusStart, branch.radiusEnd));
+    }
+    auto fitDecorations = [&](const std::vector<DecorationData>& decorations, InstanceRange range) {
+        for (uint32_t i = range.begin; i < range.end; ++i) {
+            boundsMin = glm::min(boundsMin, decorations[i].position);
+            boundsMax = glm::max(boundsMax, decorations[i].position);
+            maxDecoration = std::max(maxDecoration, decorations[i].size);
+        }
+    };
+    fitDecorations(*m_leaves, node.leaves);
+    fitDecorations(*m_flowers, node.flowers);
+
+    if (boundsMin.x > boundsMax.x) {
+        boundsMin = glm::vec3(0.0F);
+        boundsMax = glm::vec3(0.0F);
+    }
+    node.boundsMin = boundsMin;
+    node.boundsMax = boundsMax;
+    node.maxRadius = maxRadius;
+    node.maxDecoration = maxDecoration;
+}
+
+// =============================================================================
+// Consultas
+// =============================================================================
+
+glm::vec3 BranchHierarchy::worldMin(const Node& node, const InstanceScale& scale) const {
+    const float padding = node.maxRadius * scale.width +
+                          node.maxDecoration * scale.decoration * DECORATION_REACH;
+    return node.boundsMin * scale.step - glm::vec3(padding);
+}
+
+glm::vec3 BranchHierarchy::worldMax(const Node& node, const InstanceScale& scale) const {
+    const float padding = node.maxRadius * scale.width +
+                          node.maxDecoration * scale.decoration * DECORATION_REACH;
+    return node.boundsMax * scale.step + glm::vec3(padding);
+}
+
+bool BranchHierarchy::getBounds(const InstanceScale& scale, glm::vec3& boundsMin,
+                                glm::vec3& boundsMax) const {
+    if (m_nodes.empty())
+        return false;
+    boundsMin = worldMin(m_nodes[0], scale);
+    boundsMax = worldMax(m_nodes[0], scale);
+    return true;
+}
+
+void BranchHierarchy::collectVisible(const glm::mat4& viewProjection, const InstanceScale& scale,
+                                     VisibleRanges& out) const {
+    out.branches.clear();
+    out.leaves.clear();
+    out.flowers.clear();
+    out.visitedNodes = 0;
+    out.culledNodes = 0;
+    if (m_nodes.empty())
+        return;
+
+    const FrustumPlanes planes = extractPlanes(viewProjection);
+    auto emit = [&out](const Node& node) {
+        appendRange(out.branches, node.branches);
+        appendRange(out.leaves, node.leaves);
+        appendRange(out.flowers, node.flowers);
+    };
+
+    // En profundidad y en orden de instancias, asi los rangos emitidos salen ordenados
+    std::vector<uint32_t> stack{0};
+    while (!stack.empty()) {
+        const Node& node = m_nodes[stack.back()];
+        stack.pop_back();
+        ++out.visitedNodes;
+
+        const Containment containment =
+            classify(planes, worldMin(node, scale), worldMax(node, scale));
+        if (containment == Containment::Outside) {
+            ++out.culledNodes;
+        } else if (containment == Containment::Inside || node.childCount == 0) {
+            emit(node);
+        } else {
+            for (uint32_t i = node.childCount; i-- > 0;) {
+                stack.push_back(node.firstChild + i);
+            }
+        }
+    }
+
+    limitRanges(out.branches, MAX_DRAW_RANGES);
+    limitRanges(out.leaves, MAX_DRAW_RANGES);
+    limitRanges(out.flowers, MAX_DRAW_RANGES);
+}
+
+int64_t BranchHierarchy::pick(const glm::vec3& origin, const glm::vec3& direction,
+                              const InstanceScale& scale, const std::vector<BranchData>& branches,
+                              float& distance) const {
+    if (m_nodes.empty())
+        return -1;
+
+    // Evitar 0 * inf en la prueba de slabs con rayos alineados a los ejes
+    auto inverse = [](float d) {
+        return std::abs(d) > 1e-12F ? 1.0F / d : std::copysign(1e30F, d);
+    };
+    const glm::vec3 inverseDirection(inverse(direction.x), inverse(direction.y),
+                                     inverse(direction.z));
+
+    int64_t best = -1;
+    float bestDistance = std::numeric_limits<float>::max();
+    std::vector<uint32_t> stack{0};
+    while (!stack.empty()) {
+        const Node& node = m_nodes[stack.back()];
+        stack.pop_back();
+
+        float near = 0.0F;
+        if (!rayHitsBox(origin, inverseDirection, worldMin(node, scale), worldMax(node, scale),
+                        bestDistance, near))
+            continue;
+
+        if (node.childCount > 0) {
+            for (uint32_t i = 0; i < node.childCount; ++i) {
+                stack.push_back(node.firstChild + i);
+            }
+            continue;
+        }
+
+        const uint32_t end = std::min(node.branches.end, static_cast<uint32_t>(branches.size()));
+        for (uint32_t i = node.branches.begin; i < end; ++i) {
+            const BranchData& branch = branches[i];
+            const float radius = std::max(branch.radiusStart, branch.radiusEnd) * scale.width;
+            float s = 0.0F;
+            float t = 0.0F;
+            const float distance2 = raySegmentDistance2(origin, direction, branch.start * scale.step,
+                                                        branch.end * scale.step, s, t);
+            if (distance2 <= radius * radius && s < bestDistance) {
+                bestDistance = s;
+                best = i;
+            }
+        }
+    }
+
+    if (best >= 0) {
+        distance = bestDistance;
+    }
+    return best;
+}
@@ -0,0 +1,169 @@
+/**
+ * @file BranchHierarchy.h
+ * @brief Jerarquia de volumenes envolventes (BVH) sobre los subarboles de una planta.
+ *
+ * La tortuga emite la geometria en el orden de la cadena, asi que todo lo que
+ * sale entre un '[' y su ']' ocupa un rango contiguo de cada arreglo de
+ * instancias (ramas, hojas y flores). Cada uno de esos rangos (InstanceSpan) es
+ * un nodo con su caja envolvente; lo que queda entre los subarboles de un nodo
+ * se reparte en hojas de a lo mas MAX_LEAF_INSTANCES ramas, que siguen siendo
+ * rangos contiguos.
+ *
+ * Con eso:
+ * - El culling en CPU descarta subarboles completos y entrega rangos de
+ *   instancias para dibujar con glDraw*BaseInstance.
+ * - La seleccion con el raton solo prueba las ramas de las hojas que el rayo
+ *   atraviesa.
+ *
+ * Las cajas estan en el espacio unitario de las instancias: paso, ancho inicial
+ * y tamano de hoja se aplican en cada consulta, como en los shaders.
+ *
+ * No usa OpenGL.
+ *
+ * @author Julian Parra
+ * @date 2025
+ * @course Graficacion
+ * @project Proyecto Final - "Arboles: La Belleza Algoritmica de las Plantas"
+ */
+
+#ifndef BRANCH_HIERARCHY_H
+#define BRANCH_HIERARCHY_H
+
+#include <cstdint>
+#include <glm/glm.hpp>
+#include <vector>
+
+struct BranchData;
+struct DecorationData;
+
+/**
+ * @brief Rangos de instancias emitidos entre un '[' y su ']' (ver TurtleGraphics::pushState()).
+ *
+ * Se guardan en preorden: el padre siempre tiene un indice menor que sus hijos.
+ */
+struct InstanceSpan {
+    static constexpr uint32_t NO_PARENT = UINT32_MAX;
+    static constexpr uint32_t OPEN = UINT32_MAX;  ///< Fin de un '[' sin cerrar
+
+    uint32_t parent{NO_PARENT};
+    uint32_t branchBegin{0}, branchEnd{OPEN};
+    uint32_t leafBegin{0}, leafEnd{OPEN};
+    uint32_t flowerBegin{0}, flowerEnd{OPEN};
+
+    uint32_t instanceCount() const {
+        return (branchEnd - branchBegin) + (leafEnd - leafBegin) + (flowerEnd - flowerBegin);
+    }
+};
+
+/**
+ * @brief Rango [begin, end) de un arreglo de instancias.
+ */
+struct InstanceRange {
+    uint32_t begin;
+    uint32_t end;
+};
+
+/**
+ * @brief Escalas de las instancias (uniforms de la tortuga) para pasar a espacio de mundo.
+ */
+struct InstanceScale {
+    float step{1.0F};        ///< Posiciones
+    float width{1.0F};       ///< Radios de rama
+    float decoration{1.0F};  ///< Tamano de hojas y flores
+};
+
+/**
+ * @class BranchHierarchy
+ * @brief BVH de subarboles con rangos contiguos de instancias.
+ */
+class BranchHierarchy {
+public:
+    /// Subarboles mas pequenos no forman nodo propio (quedan en las hojas del padre)
+    static constexpr uint32_t MIN_SPAN_INSTANCES = 32;
+    /// Ramas por hoja al repartir lo que hay entre subarboles
+    static constexpr uint32_t MAX_LEAF_INSTANCES = 512;
+    /// Dibujos por arreglo: por encima se unen rangos cercanos
+    static constexpr size_t MAX_DRAW_RANGES = 256;
+
+    /**
+     * @brief Rangos visibles de cada arreglo, en orden y sin solaparse.
+     */
+    struct VisibleRanges {
+        std::vector<InstanceRange> branches;
+        std::vector<InstanceRange> leaves;
+        std::vector<InstanceRange> flowers;
+        size_t visitedNodes{0};
+        size_t culledNodes{0};  ///< Nodos descartados completos (con todo su subarbol)
+    };
+
+    /**
+     * @brief Construye la jerarquia de una geometria.
+     * @param spans Subarboles en preorden; pueden faltar (p. ej. geometria cargada
+     *        del cache): entonces solo se reparte en hojas.
+     */
+    void build(const std::vector<BranchData>& branches, const std::vector<DecorationData>& leaves,
+               const std::vector<DecorationData>& flowers, const std::vector<InstanceSpan>& spans);
+
+    void clear();
+
+    bool isEmpty() const {
+        return m_nodes.empty();
+    }
+
+    size_t getNodeCount() const {
+        return m_nodes.size();
+    }
+
+    /**
+     * @brief Caja envolvente de toda la planta en espacio de mundo.
+     * @return false si no hay geometria.
+     */
+    bool getBounds(const InstanceScale& scale, glm::vec3& boundsMin, glm::vec3& boundsMax) const;
+
+    /**
+     * @brief Rangos de instancias dentro del frustum de 'viewProjection'.
+     * @note Un nodo totalmente dentro entrega su rango completo sin visitar a sus hijos.
+     */
+    void collectVisible(const glm::mat4& viewProjection, const InstanceScale& scale,
+                        VisibleRanges& out) const;
+
+    /**
+     * @brief Rama mas cercana que atraviesa un rayo en espacio de mundo.
+     * @param direction Normalizada.
+     * @param distance Recibe la distancia al impacto.
+     * @return Indice de la rama, o -1 si el rayo no toca ninguna.
+     */
+    int64_t pick(const glm::vec3& origin, const glm::vec3& direction, const InstanceScale& scale,
+                 const std::vector<BranchData>& branches, float& distance) const;
+
+private:
+    struct Node {
+        glm::vec3 boundsMin{0.0F};  ///< Extremos de ramas y posiciones de decoraciones
+        glm::vec3 boundsMax{0.0F};
+        float maxRadius{0.0F};      ///< Radio unitario maximo de sus ramas
+        float maxDecoration{0.0F};  ///< Tamano maximo de sus decoraciones
+        InstanceRange branches{0, 0};
+        InstanceRange leaves{0, 0};
+        InstanceRange flowers{0, 0};
+        uint32_t firstChild{0};  ///< Hijos contiguos en m_nodes; 0 hijos: hoja
+        uint32_t childCount{0};
+    };
+
+    void buildNode(uint32_t slot, const InstanceSpan& range, const std::vector<uint32_t>& children,
+                   const std::vector<std::vector<uint32_t>>& spanChildren,
+                   const std::vector<InstanceSpan>& spans);
+    void appendLeaves(const InstanceSpan& gap, std::vector<Node>& out) const;
+    void fitLeaf(Node& node) const;
+
+    glm::vec3 worldMin(const Node& node, const InstanceScale& scale) const;
+    glm::vec3 worldMax(const Node& node, const InstanceScale& scale) const;
+
+    std::vector<Node> m_nodes;  ///< m_nodes[0] es la raiz
+
+    // Solo valido durante build()
+    const std::vector<BranchData>* m_branches{nullptr};
+    const std::vector<DecorationData>* m_leaves{nullptr};
+    const std::vector<DecorationData>* m_flowers{nullptr};
+};
+
+#endif  // BRANCH_HIERARCHY_H
@@ -0,0 +1,167 @@
+/**
+ * @file GenerationWorker.cpp
+ * @brief Implementacion del trabajador de generacion en segundo plano.
+ *
+ * @author Julian Parra
+ * @date 2025
+ * @course Graficacion
+ * @project Proyecto Final - "Arboles: La Belleza Algoritmica de las Plantas"
+ */
+
+#include "GenerationWorker.h"
+
+#include <iostream>
+
+GeometryCacheKey makeCacheKey(const GenerationRequest& request) {
+    GeometryCacheKey key;
+    key.axiom = request.axiom;
+    key.rules = request.rules;
+    key.angle = request.angle;
+    key.generations = request.generations;
+    key.seed = request.seed;
+    key.expansion = static_cast<int>(request.mode);
+    return key;
+}
+
+GenerationWorker::~GenerationWorker() {
+    cancel();
+    join();
+}
+
+void GenerationWorker::start(const GenerationRequest& request, const TurtleGraphics& settings) {
+    cancel();
+    join();
+
+    m_request = request;
+    m_builder.copySettings(settings);
+    m_streamedLength = 0;
+    m_cacheHit = false;
+    m_cachedLength = 0;
+
+    m_cancel.store(false);
+    m_done.store(false);
+    m_completed.store(false);
+    m_progress.store(0.0F);
+
+    m_thread = std::thread(&GenerationWorker::run, this);
+}
+
+void GenerationWorker::cancel() {
+    m_cancel.store(true);
+}
+
+void GenerationWorker::join() {
+    if (m_thread.joinable()) {
+        m_thread.join();
+    }
+}
+
+bool GenerationWorker::collect(LSystem& lsystem, TurtleGraphics& turtle) {
+    if (!m_thread.joinable() || !m_done.load(std::memory_order_acquire))
+        return false;
+
+    join();
+    if (!m_completed.load()) {
+        std::cout << "Generacion cancelada\n";
+        return false;
+    }
+
+    // Solo la subida a la GPU ocurre en el hilo de render
+    if (m_request.derived == nullptr) {
+        lsystem = std::move(m_lsystem);
+    }
+    turtle.swapGeometry(m_builder);
+    turtle.upload();
+    m_builder.clear();
+
+    std::cout << "TurtleGraphics: Generated " << turtle.getBranchCount() << " branches, "
+              << turtle.getDecorationCount() << " decorations\n";
+    return true;
+}
+
+void GenerationWorker::run() {
+    m_lsystem = LSystem();
+    m_lsystem.setAxiom(m_request.axiom);
+    m_lsystem.addRulesFromString(m_request.rules);
+    m_lsystem.setSeed(m_request.seed);
+
+    // Misma derivacion que el arbol visible: continuar desde sus generaciones calculadas
+    // (copiarlas aqui es mucho mas barato que reescribirlas otra vez)
+    const LSystem* base = m_request.base;
+    if (m_request.mode == ExpansionMode::String && base != nullptr &&
+        base->hasSameDerivation(m_lsystem)) {
+        m_lsystem = *base;
+    }
+    m_lsystem.setAngle(m_request.angle);
+    m_lsystem.setParallel(m_request.parallelRewrite);
+    m_lsystem.setPacking(m_request.packing);
+
+    // Geometria ya en disco: nada que reescribir ni interpretar
+    const GeometryCache* cache = m_request.derived == nullptr ? m_request.cache : nullptr;
+    const uint64_t cacheKey = cache != nullptr ? makeCacheKey(m_request).hash(m_builder) : 0;
+    GeometryCacheInfo cached;
+    if (cache != nullptr && cache->load(cacheKey, m_builder, &cached)) {
+        m_builder.buildHierarchy();
+        m_cacheHit = true;
+        m_cachedLength = cached.stringLength;
+        m_progress.store(1.0F, std::memory_order_relaxed);
+        m_completed.store(!m_cancel.load());
+        m_done.store(true, std::memory_order_release);
+        return;
+    }
+
+    // Publicar el progreso mapeado a [begin, begin + span]; negativo sigue indeterminado
+    auto reporter = [this](float begin, float span) {
+        return ProgressCallback([this, begin, span](float fraction) {
+            m_progress.store(fraction < 0.0F ? fraction : begin + fraction * span,
+                             std::memory_order_relaxed);
+            return !m_cancel.load(std::memory_order_relaxed);
+        });
+    };
+
+    bool completed = false;
+    switch (m_request.mode) {
+        case ExpansionMode::Streaming: {
+            SymbolStream symbols = m_lsystem.stream(m_request.generations);
+            completed = m_builder.buildGeometry(symbols, m_request.angle, reporter(0.0F, 1.0F));
+            m_streamedLength = symbols.getEmittedCount();
+            break;
+        }
+        case ExpansionMode::Memoized:
+            completed = m_builder.buildGeometryMemoized(m_lsystem, m_request.generations,
+                                                        m_request.angle, reporter(0.0F, 1.0F));
+            break;
+        case ExpansionMode::String:
+        default:
+            if (m_request.derived != nullptr) {
+                // Misma derivacion: el programa cacheado del constructor se reproduce tal cual
+                completed = m_builder.buildGeometry(*m_request.derived, m_request.angle,
+                                                    reporter(0.0F, 1.0F));
+                break;
+            }
+            // Reescritura e interpretacion toman cada una cerca de la mitad del trabajo
+            completed = m_lsystem.generate(m_request.generations, reporter(0.0F, 0.5F)) &&
+                        m_builder.buildGeometry(m_lsystem, m_request.angle, reporter(0.5F, 0.5F));
+            break;
+    }
+
+    completed = completed && !m_cancel.load();
+    if (completed && cache != nullptr) {
+        // Un arbol memoizado nunca materializa su cadena
+        size_t length = 0;
+        if (m_request.mode == ExpansionMode::Streaming) {
+            length = m_streamedLength;
+        } else if (m_request.mode == ExpansionMode::String) {
+            length = m_lsystem.getLength();
+        }
+        cache->store(cacheKey, m_builder, length);
+    }
+    if (completed) {
+        // Fuera del hilo de render: upload() despues solo envia las instancias
+        m_builder.buildHierarchy();
+    }
+
+    m_progress.store(1.0F, std::memory_order_relaxed);
+    m_completed.store(completed);
+    m_done.store(true, std::memory_order_release);
+}
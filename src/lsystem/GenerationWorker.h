@@ -0,0 +1,184 @@
+/**
+ * @file GenerationWorker.h
+ * @brief Generacion de L-System e interpretacion de tortuga en un hilo de trabajo.
+ *
+ * La reescritura y la construccion de geometria en CPU pueden tardar segundos con
+ * muchas generaciones. Este trabajador las ejecuta fuera del bucle de render con
+ * un LSystem y una tortuga propios (sin recursos OpenGL); el hilo principal solo
+ * recoge el resultado y hace la subida final a GPU.
+ *
+ * @author Julian Parra
+ * @date 2025
+ * @course Graficacion
+ * @project Proyecto Final - "Arboles: La Belleza Algoritmica de las Plantas"
+ */
+
+#ifndef GENERATION_WORKER_H
+#define GENERATION_WORKER_H
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <thread>
+
+#include "GeometryCache.h"
+#include "LSystem.h"
+#include "TurtleGraphics.h"
+
+/**
+ * @brief Estrategia de expansion de la derivacion.
+ * @note Mismo orden que el combo "Expansion" de la interfaz.
+ */
+enum class ExpansionMode {
+    String = 0,     ///< Generar la cadena completa e interpretarla
+    Streaming = 1,  ///< Interpretar un flujo perezoso de simbolos
+    Memoized = 2    ///< Reutilizar geometria de subarboles repetidos
+};
+
+/**
+ * @brief Parametros de un trabajo de generacion.
+ */
+struct GenerationRequest {
+    std::string axiom;
+    std::string rules;  ///< Reglas separadas por salto de linea o coma
+    float angle{25.0F};
+    int generations{4};
+    uint64_t seed{1};  ///< Semilla de las producciones estocasticas
+    ExpansionMode mode{ExpansionMode::String};
+    bool parallelRewrite{true};
+    SymbolPacking packing{SymbolPacking::None};  ///< Representacion de la cadena (modo String)
+
+    /**
+     * @brief Derivacion ya generada que solo se reinterpreta (modo String), p. ej. al
+     *        cambiar el decaimiento de ancho. Debe seguir viva y sin cambios hasta
+     *        collect(), que en ese caso no toca el LSystem visible.
+     */
+    const LSystem* derived{nullptr};
+
+    /**
+     * @brief LSystem visible (modo String): si tiene la misma derivacion (axioma,
+     *        reglas y semilla), el trabajo parte de una copia suya y reutiliza sus
+     *        generaciones. Mismas condiciones de vida que 'derived'.
+     */
+    const LSystem* base{nullptr};
+
+    /**
+     * @brief Cache de geometria en disco (nullptr = sin cache). Con un acierto no se
+     *        genera ni se interpreta; si no, el resultado se guarda al terminar. No
+     *        se usa al reinterpretar una derivacion ('derived').
+     */
+    const GeometryCache* cache{nullptr};
+};
+
+/**
+ * @brief Clave de cache de la geometria que produce 'request'.
+ */
+GeometryCacheKey makeCacheKey(const GenerationRequest& request);
+
+/**
+ * @class GenerationWorker
+ * @brief Ejecuta un trabajo de generacion a la vez en un hilo de fondo.
+ *
+ * Uso desde el hilo principal: start() lanza el trabajo, getProgress() y
+ * isRunning() alimentan la interfaz, cancel() lo aborta y collect() entrega el
+ * resultado terminado a la tortuga y al LSystem visibles.
+ */
+class GenerationWorker {
+public:
+    GenerationWorker() = default;
+
+    /**
+     * @brief Cancela y espera el trabajo en curso.
+     */
+    ~GenerationWorker();
+
+    // No copiable
+    GenerationWorker(const GenerationWorker&) = delete;
+    GenerationWorker& operator=(const GenerationWorker&) = delete;
+
+    /**
+     * @brief Lanza un trabajo nuevo, cancelando el anterior si sigue en curso.
+     * @param request Parametros del L-System y de la expansion.
+     * @param settings Tortuga visible; se copian sus parametros de interpretacion.
+     */
+    void start(const GenerationRequest& request, const TurtleGraphics& settings);
+
+    /**
+     * @brief Pide cancelar el trabajo en curso (no bloquea).
+     */
+    void cancel();
+
+    /**
+     * @brief Indica si hay un trabajo lanzado que aun no se recogio.
+     */
+    bool isRunning() const {
+        return m_thread.joinable();
+    }
+
+    /**
+     * @brief Progreso del trabajo en [0, 1], o negativo si es indeterminado.
+     */
+    float getProgress() const {
+        return m_progress.load(std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief Entrega el resultado de un trabajo terminado.
+     *
+     * Intercambia la geometria con 'turtle', mueve el LSystem generado a 'lsystem'
+     * y sube la geometria a GPU. Debe llamarse desde el hilo con el contexto OpenGL.
+     *
+     * @return true si habia un trabajo completo (no cancelado) y se entrego.
+     */
+    bool collect(LSystem& lsystem, TurtleGraphics& turtle);
+
+    /**
+     * @brief Modo del ultimo trabajo recogido.
+     */
+    ExpansionMode getMode() const {
+        return m_request.mode;
+    }
+
+    /**
+     * @brief Simbolos entregados por el flujo en el ultimo trabajo en modo Streaming.
+     */
+    size_t getStreamedLength() const {
+        return m_streamedLength;
+    }
+
+    /**
+     * @brief Indica si el ultimo trabajo recogido se cargo del cache de geometria.
+     *
+     * En ese caso el LSystem entregado no tiene la derivacion calculada (solo axioma
+     * y reglas) y la longitud de la cadena viene de getCachedLength().
+     */
+    bool wasCacheHit() const {
+        return m_cacheHit;
+    }
+
+    /**
+     * @brief Longitud de cadena guardada con la geometria del ultimo acierto.
+     */
+    size_t getCachedLength() const {
+        return m_cachedLength;
+    }
+
+private:
+    void run();
+    void join();
+
+    GenerationRequest m_request;
+    LSystem m_lsystem;
+    TurtleGraphics m_builder;  ///< Nunca se inicializa: solo geometria en CPU
+    size_t m_streamedLength{0};
+    bool m_cacheHit{false};
+    size_t m_cachedLength{0};
+
+    std::thread m_thread;
+    std::atomic<bool> m_cancel{false};
+    std::atomic<bool> m_done{false};
+    std::atomic<bool> m_completed{false};  ///< Termino sin cancelarse
+    std::atomic<float> m_progress{0.0F};
+};
+
+#endif  // GENERATION_WORKER_H
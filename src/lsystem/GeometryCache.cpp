@@ -0,0 +1,292 @@
+/**
+ * @file GeometryCache.cpp
+ * @brief Implementacion del cache binario de geometria (escritura y carga con mmap).
+ *
+ * @author Julian Parra
+ * @date 2025
+ * @course Graficacion
+ * @project Proyecto Final - "Arboles: La Belleza Algoritmica de las Plantas"
+ */
+
+#include "GeometryCache.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <system_error>
+#include <utility>
+
+#include "TurtleGraphics.h"
+
+namespace {
+
+constexpr char MAGIC[4] = {'A', 'R', 'B', 'G'};
+
+// Encabezado de tamano fijo en el desplazamiento 0; los arreglos de instancias lo siguen contiguos
+struct GeometryFileHeader {
+    char magic[4];
+    uint32_t version;
+    uint32_t branchStride;      // sizeof(BranchData) al escribir
+    uint32_t decorationStride;  // sizeof(DecorationData) al escribir
+    uint64_t key;
+    uint64_t branchCount;
+    uint64_t leafCount;
+    uint64_t flowerCount;
+    uint64_t stringLength;
+    float boundsMin[3];
+    float boundsMax[3];
+    float growthDuration;
+    uint32_t spanStride;  // sizeof(InstanceSpan) al escribir
+    uint64_t spanCount;
+};
+static_assert(sizeof(GeometryFileHeader) == 96, "GeometryFileHeader layout changed");
+
+// FNV-1a, 64 bits: estable entre ejecuciones y plataformas, a diferencia de std::hash
+class Fnv1a {
+public:
+    void add(const void* data, size_t bytes) {
+        const auto* p = static_cast<const unsigned char*>(data);
+        for (size_t i = 0; i < bytes; ++i) {
+            m_hash = (m_hash ^ p[i]) * 0x100000001B3ULL;
+        }
+    }
+
+    template <typename T>
+    void add(const T& value) {
+        add(&value, sizeof(T));
+    }
+
+    // La longitud primero, para que ("ab", "c") y ("a", "bc") difieran
+    void add(const std::string& text) {
+        add(static_cast<uint64_t>(text.size()));
+        add(text.data(), text.size());
+    }
+
+    uint64_t value() const {
+        return m_hash;
+    }
+
+private:
+    uint64_t m_hash{0xCBF29CE484222325ULL};
+};
+
+// Mapeo de solo lectura de un archivo completo, liberado al salir del ambito
+class MappedFile {
+public:
+    explicit MappedFile(const std::string& path) {
+        const int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0)
+            return;
+        struct stat status {};
+        if (::fstat(fd, &status) == 0 && status.st_size > 0) {
+            void* data = ::mmap(nullptr, static_cast<size_t>(status.st_size), PROT_READ,
+                                MAP_PRIVATE, fd, 0);
+            if (data != MAP_FAILED) {
+                m_data = data;
+                m_size = static_cast<size_t>(status.st_size);
+                // Se lee una vez de principio a fin
+                ::madvise(m_data, m_size, MADV_SEQUENTIAL);
+            }
+        }
+        // El mapeo mantiene vivo el archivo
+        ::close(fd);
+    }
+
+    ~MappedFile() {
+        if (m_data != nullptr)
+            ::munmap(m_data, m_size);
+    }
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    const unsigned char* data() const {
+        return static_cast<const unsigned char*>(m_data);
+    }
+    size_t size() const {
+        return m_size;
+    }
+
+private:
+    void* m_data{nullptr};
+    size_t m_size{0};
+};
+
+bool isCacheFile(const std::filesystem::directory_entry& entry) {
+    return entry.is_regular_file() && entry.path().extension() == GeometryCache::EXTENSION;
+}
+
+}  // namespace
+
+// =============================================================================
+// Clave
+// =============================================================================
+
+uint64_t GeometryCacheKey::hash(const TurtleGraphics& turtle) const {
+    Fnv1a fnv;
+    fnv.add(axiom);
+    fnv.add(rules);
+    fnv.add(angle);
+    fnv.add(generations);
+    fnv.add(seed);
+    fnv.add(expansion);
+
+    // Ajustes horneados en las instancias; los uniforms (paso, anchos, colores) no
+    fnv.add(turtle.is3DMode());
+    fnv.add(turtle.getWidthDecay());
+    fnv.add(turtle.getCoalesceSegments());
+    fnv.add(turtle.getFastRotations());
+    return fnv.value();
+}
+
+// =============================================================================
+// Cache
+// =============================================================================
+
+GeometryCache::GeometryCache(std::string directory) : m_directory(std::move(directory)) {}
+
+std::string GeometryCache::pathFor(uint64_t key) const {
+    char name[32];
+    std::snprintf(name, sizeof(name), "%016llx", static_cast<unsigned long long>(key));
+    return m_directory + "/" + name + EXTENSION;
+}
+
+bool GeometryCache::load(uint64_t key, TurtleGraphics& turtle, GeometryCacheInfo* info) const {
+    const MappedFile file(pathFor(key));
+    if (file.size() < sizeof(GeometryFileHeader))
+        return false;
+
+    GeometryFileHeader header;
+    std::memcpy(&header, file.data(), sizeof(header));
+    if (std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0 || header.version != VERSION ||
+        header.branchStride != sizeof(BranchData) ||
+        header.decorationStride != sizeof(DecorationData) ||
+        header.spanStride != sizeof(InstanceSpan) || header.key != key)
+        return false;
+
+    // Los tamanos vienen del archivo: validarlos (sin desbordar) antes de confiar en un puntero
+    const size_t payload = file.size() - sizeof(header);
+    const size_t maxDecorations = payload / sizeof(DecorationData);
+    if (header.branchCount > payload / sizeof(BranchData) || header.leafCount > maxDecorations ||
+        header.flowerCount > maxDecorations || header.spanCount > payload / sizeof(InstanceSpan) ||
+        header.branchCount * sizeof(BranchData) +
+                (header.leafCount + header.flowerCount) * sizeof(DecorationData) +
+                header.spanCount * sizeof(InstanceSpan) !=
+            payload)
+        return false;
+
+    // El encabezado queda alineado a 4 bytes en un mapeo alineado a pagina, como piden los floats
+    const unsigned char* cursor = file.data() + sizeof(header);
+    const auto* branches = reinterpret_cast<const BranchData*>(cursor);
+    const auto* leaves = reinterpret_cast<const DecorationData*>(branches + header.branchCount);
+    const DecorationData* flowers = leaves + header.leafCount;
+    const auto* spans = reinterpret_cast<const InstanceSpan*>(flowers + header.flowerCount);
+    turtle.assignGeometry(branches, header.branchCount, leaves, header.leafCount, flowers,
+                          header.flowerCount, spans, header.spanCount, header.growthDuration);
+
+    if (info != nullptr) {
+        info->stringLength = header.stringLength;
+        info->boundsMin = glm::vec3(header.boundsMin[0], header.boundsMin[1], header.boundsMin[2]);
+        info->boundsMax = glm::vec3(header.boundsMax[0], header.boundsMax[1], header.boundsMax[2]);
+    }
+    return true;
+}
+
+bool GeometryCache::store(uint64_t key, const TurtleGraphics& turtle, size_t stringLength) const {
+    const std::vector<BranchData>& branches = turtle.getBranches();
+    const std::vector<DecorationData>& leaves = turtle.getLeaves();
+    const std::vector<DecorationData>& flowers = turtle.getFlowers();
+    const std::vector<InstanceSpan>& spans = turtle.getSpans();
+
+    GeometryFileHeader header{};
+    std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.version = VERSION;
+    header.branchStride = sizeof(BranchData);
+    header.decorationStride = sizeof(DecorationData);
+    header.key = key;
+    header.branchCount = branches.size();
+    header.leafCount = leaves.size();
+    header.flowerCount = flowers.size();
+    header.spanStride = sizeof(InstanceSpan);
+    header.spanCount = spans.size();
+    header.stringLength = stringLength;
+    header.growthDuration = turtle.getGrowthDuration();
+
+    glm::vec3 minPos(0.0F);
+    glm::vec3 maxPos(0.0F);
+    bool first = true;
+    auto include = [&](const glm::vec3& point) {
+        minPos = first ? point : glm::min(minPos, point);
+        maxPos = first ? point : glm::max(maxPos, point);
+        first = false;
+    };
+    for (const BranchData& branch : branches) {
+        include(branch.start);
+        include(branch.end);
+    }
+    for (const auto* decorations : {&leaves, &flowers}) {
+        for (const DecorationData& decor : *decorations) {
+            include(decor.position);
+        }
+    }
+    for (int axis = 0; axis < 3; ++axis) {
+        header.boundsMin[axis] = minPos[axis];
+        header.boundsMax[axis] = maxPos[axis];
+    }
+
+    std::error_code error;
+    std::filesystem::create_directories(m_directory, error);
+
+    // Se escribe junto al nombre final y luego se renombra encima
+    const std::string path = pathFor(key);
+    const std::string temporary = path + ".tmp";
+    FILE* file = std::fopen(temporary.c_str(), "wb");
+    if (file == nullptr)
+        return false;
+
+    bool ok = std::fwrite(&header, sizeof(header), 1, file) == 1;
+    auto write = [&ok, file](const void* data, size_t count, size_t size) {
+        if (ok && count > 0) {
+            ok = std::fwrite(data, size, count, file) == count;
+        }
+    };
+    write(branches.data(), branches.size(), sizeof(BranchData));
+    write(leaves.data(), leaves.size(), sizeof(DecorationData));
+    write(flowers.data(), flowers.size(), sizeof(DecorationData));
+    write(spans.data(), spans.size(), sizeof(InstanceSpan));
+    ok = (std::fclose(file) == 0) && ok;
+
+    if (!ok || std::rename(temporary.c_str(), path.c_str()) != 0) {
+        std::remove(temporary.c_str());
+        return false;
+    }
+    return true;
+}
+
+size_t GeometryCache::clear() const {
+    std::error_code error;
+    size_t removed = 0;
+    for (const auto& entry : std::filesystem::directory_iterator(m_directory, error)) {
+        if (isCacheFile(entry) && std::filesystem::remove(entry.path(), error)) {
+            removed++;
+        }
+    }
+    return removed;
+}
+
+size_t GeometryCache::diskBytes() const {
+    std::error_code error;
+    size_t bytes = 0;
+    for (const auto& entry : std::filesystem::directory_iterator(m_directory, error)) {
+        if (isCacheFile(entry)) {
+            bytes += static_cast<size_t>(entry.file_size(error));
+        }
+    }
+    return bytes;
+}
@@ -0,0 +1,128 @@
+/**
+ * @file GeometryCache.h
+ * @brief Cache en disco de la geometria interpretada (formato binario versionado).
+ *
+ * Guarda las instancias de ramas, hojas y flores de una tortuga en el formato
+ * completo de GPU (BranchData, DecorationData), los rangos de sus corchetes
+ * (InstanceSpan, para reconstruir la jerarquia de subarboles) y su caja
+ * envolvente y metadatos, en un archivo por clave. La clave es un hash de todo lo que decide
+ * la geometria: axioma, reglas, angulo, generaciones, semilla, expansion y los
+ * ajustes de la tortuga que quedan en las instancias (3D, decaimiento de ancho,
+ * fusion de segmentos, rotaciones rapidas). Paso, anchos, tamano de hoja y
+ * colores son uniforms y no forman parte de la clave.
+ *
+ * La carga mapea el archivo en memoria (mmap) y copia las instancias y los
+ * rangos del mapeo a los vectores de la tortuga (una copia secuencial, sin
+ * generate() ni interpretacion); el mapeo se libera al terminar load(). La
+ * tortuga necesita sus arreglos en CPU de todos modos (jerarquia, seleccion,
+ * formato compacto, bosque) y upload() corre despues en el hilo de OpenGL, asi
+ * que la subida lee de esa copia y no del archivo.
+ *
+ * Formato (version 2, orden de bytes de la maquina):
+ * @code
+ *   GeometryFileHeader   (96 bytes: version, tamanos, clave, conteos, caja, crecimiento)
+ *   BranchData[branchCount]
+ *   DecorationData[leafCount]
+ *   DecorationData[flowerCount]
+ *   InstanceSpan[spanCount]
+ * @endcode
+ *
+ * La version 1 no guardaba los rangos; sus archivos se rechazan y se regeneran.
+ *
+ * @author Julian Parra
+ * @date 2025
+ * @course Graficacion
+ * @project Proyecto Final - "Arboles: La Belleza Algoritmica de las Plantas"
+ */
+
+#ifndef GEOMETRY_CACHE_H
+#define GEOMETRY_CACHE_H
+
+#include <cstdint>
+#include <glm/glm.hpp>
+#include <string>
+
+class TurtleGraphics;
+
+/**
+ * @brief Entradas de la clave de cache de una geometria.
+ */
+struct GeometryCacheKey {
+    std::string axiom;
+    std::string rules;
+    float angle{0.0F};
+    int generations{0};
+    uint64_t seed{1};
+    int expansion{0};  ///< ExpansionMode: el flujo registra nacimientos, la cadena no
+
+    /**
+     * @brief Hash FNV-1a de 64 bits de la clave y de los ajustes de 'turtle' que
+     *        quedan en la geometria.
+     */
+    uint64_t hash(const TurtleGraphics& turtle) const;
+};
+
+/**
+ * @brief Metadatos de una geometria guardada.
+ */
+struct GeometryCacheInfo {
+    size_t stringLength{0};        ///< Simbolos de la cadena que la produjo
+    glm::vec3 boundsMin{0.0F};     ///< Caja envolvente de las instancias (unidades de paso)
+    glm::vec3 boundsMax{0.0F};
+};
+
+/**
+ * @class GeometryCache
+ * @brief Directorio de archivos de geometria, uno por clave.
+ *
+ * No usa OpenGL: load() y store() pueden correr en el hilo de trabajo y la
+ * tortuga se sube despues con upload(). Es seguro usar una misma instancia desde
+ * varios hilos (no guarda estado mutable).
+ */
+class GeometryCache {
+public:
+    explicit GeometryCache(std::string directory = DEFAULT_DIRECTORY);
+
+    /**
+     * @brief Carga la geometria de 'key' en 'turtle'.
+     * @param info Si no es nullptr, recibe los metadatos guardados.
+     * @return false si no hay archivo o si es de otra version, esta truncado o
+     *         su clave no coincide (la tortuga no se modifica).
+     */
+    bool load(uint64_t key, TurtleGraphics& turtle, GeometryCacheInfo* info = nullptr) const;
+
+    /**
+     * @brief Guarda la geometria actual de 'turtle' bajo 'key'.
+     *
+     * Escribe un archivo temporal y lo renombra: un lector nunca ve un archivo a medias.
+     * @param stringLength Simbolos de la cadena interpretada (metadato).
+     * @return false si no se pudo escribir.
+     */
+    bool store(uint64_t key, const TurtleGraphics& turtle, size_t stringLength) const;
+
+    /**
+     * @brief Borra todos los archivos de geometria del directorio.
+     * @return Numero de archivos borrados.
+     */
+    size_t clear() const;
+
+    /**
+     * @brief Bytes ocupados por los archivos de geometria del directorio.
+     */
+    size_t diskBytes() const;
+
+    const std::string& getDirectory() const {
+        return m_directory;
+    }
+
+    static constexpr uint32_t VERSION = 2;  ///< Cambiar con BranchData/DecorationData/InstanceSpan
+    static constexpr const char* DEFAULT_DIRECTORY = "arboles_cache";
+    static constexpr const char* EXTENSION = ".arbg";
+
+private:
+    std::string pathFor(uint64_t key) const;
+
+    std::string m_directory;
+};
+
+#endif  // GEOMETRY_CACHE_H
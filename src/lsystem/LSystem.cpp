@@ -15,14 +15,224 @@
 
 #include "LSystem.h"
 
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <cstring>
 #include <fstream>
 #include <iostream>
+#include <thread>
+
+#include "core/Profiler.h"
+
+namespace {
+
+constexpr size_t ARROW_LENGTH = 2;
+
+// Finalizador de splitmix64: contadores consecutivos dan valores de 64 bits bien mezclados
+uint64_t mix64(uint64_t x) {
+    x += 0x9E3779B97F4A7C15ULL;
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+    return x ^ (x >> 31);
+}
+
+// Valor uniforme en [0, 1) para un modulo: solo depende de la semilla, la generacion
+// y la posicion en bytes del modulo, asi que cualquier division (o el flujo perezoso) sortea igual
+double counterRandom(uint64_t seed, int generation, uint64_t position) {
+    uint64_t key = mix64(seed ^ mix64(static_cast<uint64_t>(generation)));
+    key = mix64(key ^ position);
+    return static_cast<double>(key >> 11) * (1.0 / 9007199254740992.0);  // 53 bits
+}
+
+std::string trim(const std::string& text) {
+    const size_t first = text.find_first_not_of(" \t\r");
+    if (first == std::string::npos)
+        return std::string();
+    const size_t last = text.find_last_not_of(" \t\r");
+    return text.substr(first, last - first + 1);
+}
+
+// Divide en cualquiera de 'separators' fuera de parentesis, conservando piezas vacias
+std::vector<std::string> splitOutsideParentheses(const std::string& text, const char* separators) {
+    std::vector<std::string> pieces;
+    int depth = 0;
+    size_t start = 0;
+    for (size_t i = 0; i < text.size(); ++i) {
+        if (text[i] == '(') {
+            depth++;
+        } else if (text[i] == ')') {
+            depth = std::max(0, depth - 1);
+        } else if (depth == 0 && std::strchr(separators, text[i]) != nullptr) {
+            pieces.push_back(text.substr(start, i - start));
+            start = i + 1;
+        }
+    }
+    pieces.push_back(text.substr(start));
+    return pieces;
+}
+
+bool isIdentifier(const std::string& name) {
+    if (name.empty() || (std::isalpha(static_cast<unsigned char>(name[0])) == 0 && name[0] != '_'))
+        return false;
+    return std::all_of(name.begin(), name.end(), [](char c) {
+        return std::isalnum(static_cast<unsigned char>(c)) != 0 || c == '_';
+    });
+}
+
+/*
+ * @brief Analiza una cadena de modulos, p. ej. "F(l)[+X(l*0.7,w)]".
+ * @param formals Parametros formales que pueden usar los argumentos (vacio: constantes).
+ */
+bool parseModules(const std::string& text, const std::vector<std::string>& formals,
+                  ProductionSuccessor& out, std::string& error) {
+    out = ProductionSuccessor{};
+    for (size_t i = 0; i < text.size(); ++i) {
+        const char symbol = text[i];
+        if (symbol == '(' || symbol == ')') {
+            error = std::string("'") + symbol + "' sin modulo";
+            return false;
+        }
+        if (isParameterMarker(symbol)) {
+            error = "caracter de control no valido";
+            return false;
+        }
+        out.symbols.push_back(symbol);
+        if (i + 1 >= text.size() || text[i + 1] != '(')
+            continue;
+
+        // Parentesis que cierra la lista de argumentos
+        size_t close = i + 1;
+        for (int depth = 0; close < text.size(); ++close) {
+            depth += text[close] == '(' ? 1 : text[close] == ')' ? -1 : 0;
+            if (depth == 0)
+                break;
+        }
+        if (close == text.size()) {
+            error = std::string("falta ')' en los argumentos de ") + symbol;
+            return false;
+        }
+
+        const std::vector<std::string> arguments =
+            splitOutsideParentheses(text.substr(i + 2, close - i - 2), ",");
+        if (arguments.size() > static_cast<size_t>(MAX_MODULE_PARAMETERS)) {
+            error = std::string("demasiados argumentos en ") + symbol;
+            return false;
+        }
+        for (const std::string& argument : arguments) {
+            ParametricExpression expression;
+            std::string argumentError;
+            if (!expression.compile(argument, formals, argumentError)) {
+                error = "argumento '" + trim(argument) + "' de " + symbol + ": " + argumentError;
+                return false;
+            }
+            out.arguments.push_back(std::move(expression));
+        }
+        out.symbols.push_back(static_cast<char>(arguments.size()));
+        i = close;
+    }
+    return true;
+}
+
+// Escribe codigos de 4 bits en un buffer empaquetado ya reservado desde cualquier nibble, 16
+// a la vez. Un bloque que empieza a mitad de byte no es dueno de ese byte (el bloque anterior
+// escribe su mitad baja): su primer codigo va a 'seam', para combinarlo tras la union.
+class NibbleWriter {
+public:
+    NibbleWriter(uint8_t* data, size_t nibble, uint8_t& seam)
+        : m_out(data + nibble / 2), m_fill(static_cast<int>(nibble & 1U)),
+          m_seam(m_fill != 0 ? &seam : nullptr) {}
+
+    // 'length' codigos de 'words', 16 por palabra con el primero en los bits bajos
+    void put(const uint64_t* words, uint32_t length) {
+        if (length <= 16) {
+            putWord(*words, static_cast<int>(length));
+            return;
+        }
+        for (; length >= 16; length -= 16) {
+            putWord(*words++, 16);
+        }
+        putWord(*words, static_cast<int>(length));
+    }
+
+    void finish() {
+        if (m_fill > 0) {
+            store(static_cast<size_t>(m_fill + 1) / 2);
+        }
+    }
+
+private:
+    void putWord(uint64_t word, int count) {
+        m_bits |= word << (4 * m_fill);
+        const int total = m_fill + count;
+        if (total < 16) {
+            m_fill = total;
+            return;
+        }
+        if (m_seam == nullptr) {
+            // Escrituras de bytes de tamano fijo: el compilador las une en una escritura de 64 bits
+            for (size_t i = 0; i < 8; ++i) {
+                m_out[i] = static_cast<uint8_t>(m_bits >> (8 * i));
+            }
+            m_out += 8;
+        } else {
+            store(8);
+        }
+        m_bits = m_fill == 0 ? 0 : word >> (4 * (16 - m_fill));
+        m_fill = total - 16;
+    }
+
+    void store(size_t bytes) {
+        size_t first = 0;
+        if (m_seam != nullptr) {
+            *m_seam = static_cast<uint8_t>(m_bits);
+            m_seam = nullptr;
+            first = 1;
+        }
+        for (size_t i = first; i < bytes; ++i) {
+            m_out[i] = static_cast<uint8_t>(m_bits >> (8 * i));
+        }
+        m_out += bytes;
+    }
+
+    uint8_t* m_out;
+    uint64_t m_bits{0};
+    int m_fill;
+    uint8_t* m_seam;
+};
+
+// Ejecuta task(chunk) para cada bloque; el bloque 0 corre en el hilo que llama
+template <typename Task>
+void forEachChunk(size_t chunks, Task&& task) {
+    std::vector<std::thread> workers;
+    workers.reserve(chunks - 1);
+    for (size_t chunk = 1; chunk < chunks; ++chunk) {
+        workers.emplace_back(task, chunk);
+    }
+    task(0);
+    for (auto& worker : workers) {
+        worker.join();
+    }
+}
+
+}  // namespace
 
 /*
  * @brief Constructor por defecto.
  * Inicializa un L-System con valores vacios.
  */
-LSystem::LSystem() : angle(0.0F), currentGeneration(0) {}
+LSystem::LSystem()
+    : angle(0.0F),
+      currentGeneration(0),
+      ruleTableDirty(true),
+      packing(SymbolPacking::None),
+      stringPacked(false),
+      seed(1),
+      generationCacheSize(3),
+      cacheClock(0),
+      derivationDirty(true),
+      parallelEnabled(false),
+      threadCount(0) {}
 
 /*
  * @brief Destructor.
@@ -38,11 +248,14 @@ LSystem::~LSystem() {
  * @note El archivo debe tener el formato:
  *       axiom: [cadena]
  *       angle: [valor]
+ *       seed: [entero]
  *       [simbolo]->[reemplazo]
  */
 bool LSystem::loadRules(const char* filename) {
+    ProfileScope scope(ProfileStage::ParseRules);
+
     constexpr size_t PREFIX_LENGTH = 6;
-    constexpr size_t ARROW_LENGTH = 2;
+    constexpr size_t SEED_PREFIX_LENGTH = 5;
 
     std::ifstream file(filename);
     if (!file.is_open()) {
@@ -51,6 +264,9 @@ bool LSystem::loadRules(const char* filename) {
     }
 
     rules.clear();
+    productions.clear();
+    ruleErrors.clear();
+    invalidateDerivation();
     std::string line;
 
     // (c): Parsear el archivo linea por linea
@@ -65,10 +281,7 @@ bool LSystem::loadRules(const char* filename) {
 
         // Parsear axioma
         if (line.find("axiom:") == 0) {
-            axiom = line.substr(PREFIX_LENGTH);
-            // Eliminar espacios
-            axiom.erase(0, axiom.find_first_not_of(" \t"));
-            currentString = axiom;
+            setAxiom(trim(line.substr(PREFIX_LENGTH)));
             std::cout << "Axioma cargado: " << axiom << '\n';
         }
         // Parsear angulo
@@ -77,68 +290,983 @@ bool LSystem::loadRules(const char* filename) {
             angle = std::stof(angleStr);
             std::cout << "Angulo cargado: " << angle << " grados\n";
         }
-        // Parsear reglas de produccion (formato: A->BC)
-        else {
-            size_t arrowPos = line.find("->");
-            if (arrowPos != std::string::npos && arrowPos > 0) {
-                char symbol = line[0];
-                std::string replacement = line.substr(arrowPos + ARROW_LENGTH);
-                rules[symbol] = replacement;
-                std::cout << "Regla cargada: " << symbol << " -> " << replacement << '\n';
-            }
+        // Parsear semilla de las reglas estocasticas
+        else if (line.find("seed:") == 0) {
+            setSeed(std::strtoull(line.c_str() + SEED_PREFIX_LENGTH, nullptr, 10));
+            std::cout << "Semilla cargada: " << seed << '\n';
+        }
+        // Parsear reglas de produccion (formato: A->BC, ver addRulesFromString)
+        else if (line.find("->") != std::string::npos && addRuleLine(line)) {
+            std::cout << "Regla cargada: " << line << '\n';
         }
     }
 
     file.close();
+    resetToAxiom();
     currentGeneration = 0;
+    ruleTableDirty = true;
     return true;
 }
 
 /*
  * @brief Genera la cadena del L-System aplicando las reglas 'n' veces.
  * @param generations Numero de iteraciones a aplicar.
+ * @param progress Callback opcional de progreso/cancelacion.
  * @note Implementa reescritura paralela: todos los simbolos se
  *       reemplazan simultaneamente en cada generacion.
  */
-void LSystem::generate(int generations) {
-    // (c): Resetear a axioma antes de generar
-    currentString = axiom;
-    currentGeneration = 0;
+bool LSystem::generate(int generations, const ProgressCallback& progress) {
+    ProfileScope scope(ProfileStage::Generate);
 
-    // (c): Aplicar reglas de produccion 'n' veces
-    for (int gen = 0; gen < generations; gen++) {
-        std::string nextString;
+    if (ruleTableDirty) {
+        buildRuleTable();
+    }
 
-        // (c): Reescritura paralela - procesar cada simbolo
-        // de la cadena actual simultaneamente
-        for (char symbol : currentString) {
-            // Si existe una regla para este simbolo, aplicarla
-            if (rules.find(symbol) != rules.end()) {
-                nextString += rules[symbol];
-            }
-            // Si no hay regla, el simbolo se copia tal cual (constante)
-            else {
-                nextString += symbol;
+    // (c): Axioma o reglas nuevos: resetear a axioma (assign conserva la capacidad del buffer)
+    if (derivationDirty) {
+        generationCache.clear();
+        resetToAxiom();
+        currentGeneration = 0;
+        derivationDirty = false;
+    }
+
+    // (c): Punto de partida: la generacion guardada mas profunda que no pase de 'generations'
+    if (currentGeneration != generations) {
+        auto start = generationCache.end();
+        for (auto it = generationCache.begin(); it != generationCache.end(); ++it) {
+            if (it->generation <= generations &&
+                (start == generationCache.end() || it->generation > start->generation)) {
+                start = it;
             }
         }
 
-        // (c): Actualizar la cadena actual con la nueva generacion
-        currentString = nextString;
+        const bool currentUsable = currentGeneration < generations;
+        if (start != generationCache.end() &&
+            (!currentUsable || start->generation > currentGeneration)) {
+            std::string symbols = std::move(start->symbols);
+            std::vector<float> parameters = std::move(start->parameters);
+            PackedString packed = std::move(start->packed);
+            const int generation = start->generation;
+            generationCache.erase(start);
+
+            const int previous = currentGeneration;
+            currentGeneration = generation;
+            storeGeneration(previous, std::move(currentString), std::move(currentParameters),
+                            std::move(currentPacked));
+            currentString = std::move(symbols);
+            currentParameters = std::move(parameters);
+            currentPacked = std::move(packed);
+        } else if (!currentUsable) {
+            const int previous = currentGeneration;
+            currentGeneration = 0;
+            storeGeneration(previous, std::move(currentString), std::move(currentParameters),
+                            std::move(currentPacked));
+            resetToAxiom();
+        }
+    }
+
+    // (c): Aplicar reglas de produccion hasta llegar a 'generations'
+    const int first = currentGeneration;
+    for (int gen = first; gen < generations; gen++) {
+        if (progress && !progress(static_cast<float>(gen - first) /
+                                  static_cast<float>(generations - first))) {
+            std::cout << "Generacion cancelada en " << currentGeneration << ".\n";
+            return false;
+        }
+        rewriteOnce();
         currentGeneration++;
+
+        // El intercambio dejo la generacion anterior en nextString: conservarla en lugar de
+        // reusar su buffer, asi bajar de generacion no cuesta nada
+        if (generationCacheSize > 0) {
+            storeGeneration(currentGeneration - 1, std::move(nextString),
+                            std::move(nextParameters), std::move(nextPacked));
+            nextString.clear();
+            nextParameters.clear();
+            nextPacked.clear();
+        }
+    }
+
+    if (first > 0 && first < currentGeneration) {
+        std::cout << "Generacion " << currentGeneration << " completada (desde la " << first
+                  << ").\n";
+    } else {
+        std::cout << "Generacion " << currentGeneration << " completada.\n";
+    }
+    std::cout << "Longitud de cadena: " << getLength() << " simbolos\n";
+    return true;
+}
+
+/*
+ * @brief Guarda una generacion calculada y aplica el limite LRU.
+ */
+void LSystem::storeGeneration(int generation, std::string&& symbols,
+                              std::vector<float>&& parameters, PackedString&& packed) {
+    auto same = std::find_if(generationCache.begin(), generationCache.end(),
+                             [generation](const CachedGeneration& cached) {
+                                 return cached.generation == generation;
+                             });
+    if (same != generationCache.end()) {
+        same->symbols = std::move(symbols);
+        same->parameters = std::move(parameters);
+        same->packed = std::move(packed);
+        same->lastUse = ++cacheClock;
+    } else {
+        generationCache.push_back({generation, std::move(symbols), std::move(parameters),
+                                   std::move(packed), ++cacheClock});
+    }
+    trimGenerationCache();
+}
+
+/*
+ * @brief Descarta las generaciones menos usadas por encima del limite.
+ */
+void LSystem::trimGenerationCache() {
+    if (generationCache.empty())
+        return;
+
+    auto deepest = std::max_element(generationCache.begin(), generationCache.end(),
+                                    [](const CachedGeneration& a, const CachedGeneration& b) {
+                                        return a.generation < b.generation;
+                                    });
+    // La generacion mas profunda no cuenta contra el limite mientras sea mas profunda
+    // que la actual: es la que evita recalcular todo al volver a subir
+    const bool pinDeepest = deepest->generation > currentGeneration;
+    const int pinned = pinDeepest ? deepest->generation : -1;
+
+    while (generationCache.size() > generationCacheSize + (pinDeepest ? 1 : 0)) {
+        auto oldest = generationCache.end();
+        for (auto it = generationCache.begin(); it != generationCache.end(); ++it) {
+            if (it->generation != pinned &&
+                (oldest == generationCache.end() || it->lastUse < oldest->lastUse)) {
+                oldest = it;
+            }
+        }
+        generationCache.erase(oldest);
+    }
+}
+
+/*
+ * @brief Descarta las generaciones calculadas; generate() volvera a partir del axioma.
+ */
+void LSystem::invalidateDerivation() {
+    generationCache.clear();
+    derivationDirty = true;
+}
+
+/*
+ * @brief Cambia cuantas generaciones anteriores se conservan.
+ */
+void LSystem::setGenerationCacheSize(size_t count) {
+    generationCacheSize = count;
+    trimGenerationCache();
+}
+
+/*
+ * @brief Generaciones guardadas en cache.
+ */
+size_t LSystem::getCachedGenerationCount() const {
+    return generationCache.size();
+}
+
+/*
+ * @brief Construye la tabla plana de reescritura.
+ * @note Los primeros 256 bytes de ruleData son la identidad (simbolo i en la
+ *       posicion i), de modo que un simbolo sin regla se copia a si mismo.
+ */
+void LSystem::buildRuleTable() {
+    ruleData.clear();
+    ruleData.reserve(256);
+    for (int i = 0; i < 256; ++i) {
+        ruleData.push_back(static_cast<char>(i));
+        ruleOffset[i] = static_cast<uint32_t>(i);
+        ruleLength[i] = 1;
+        ruleSelfIndex[i] = SymbolStream::NO_INHERIT;
+    }
+
+    for (const auto& [symbol, replacement] : rules) {
+        auto index = static_cast<unsigned char>(symbol);
+        ruleOffset[index] = static_cast<uint32_t>(ruleData.size());
+        ruleLength[index] = static_cast<uint32_t>(replacement.size());
+        size_t self = replacement.find(symbol);
+        ruleSelfIndex[index] =
+            self == std::string::npos ? SymbolStream::NO_INHERIT : static_cast<uint32_t>(self);
+        ruleData += replacement;
+    }
+
+    if (isExtended()) {
+        buildProductionTable();
+    }
+    buildPackedRules();
+    ruleTableDirty = false;
+}
+
+/*
+ * @brief Une producciones y reglas simples en una tabla ordenada por predecesor.
+ * @note Una regla simple es una produccion sin parametros, sin condicion y con peso 1.
+ */
+void LSystem::buildProductionTable() {
+    productionTable = productions;
+    for (const auto& [symbol, replacement] : rules) {
+        Production plain;
+        plain.predecessor = symbol;
+        plain.successor.symbols = replacement;
+        size_t self = replacement.find(symbol);
+        plain.successor.selfIndex =
+            self == std::string::npos ? SymbolStream::NO_INHERIT : static_cast<uint32_t>(self);
+        plain.source = std::string(1, symbol) + "->" + replacement;
+        productionTable.push_back(std::move(plain));
+    }
+
+    // Estable: las producciones de un predecesor conservan su orden, que usa la eleccion ponderada
+    std::stable_sort(productionTable.begin(), productionTable.end(),
+                     [](const Production& a, const Production& b) {
+                         return static_cast<unsigned char>(a.predecessor) <
+                                static_cast<unsigned char>(b.predecessor);
+                     });
+
+    productionBegin.fill(0);
+    productionEnd.fill(0);
+    for (size_t i = 0; i < productionTable.size(); ++i) {
+        auto index = static_cast<unsigned char>(productionTable[i].predecessor);
+        if (productionBegin[index] == productionEnd[index]) {
+            productionBegin[index] = static_cast<uint32_t>(i);
+        }
+        productionEnd[index] = static_cast<uint32_t>(i + 1);
+    }
+}
+
+/*
+ * @brief Elige entre las producciones que se aplican a un modulo, segun su peso.
+ */
+const Production* LSystem::chooseSuccessor(char symbol, const float* values, int count,
+                                           int generation, uint64_t position) const {
+    auto index = static_cast<unsigned char>(symbol);
+    const Production* first = productionTable.data() + productionBegin[index];
+    const Production* last = productionTable.data() + productionEnd[index];
+
+    auto applies = [values, count](const Production& production) {
+        return production.formalCount == count &&
+               (production.condition.isEmpty() || production.condition.evaluate(values) != 0.0F);
+    };
+
+    // Peso total de las producciones aplicables; una sola no necesita sorteo
+    const Production* chosen = nullptr;
+    int matches = 0;
+    double total = 0.0;
+    for (const Production* it = first; it != last; ++it) {
+        if (applies(*it)) {
+            chosen = it;
+            matches++;
+            total += it->weight;
+        }
+    }
+    if (matches <= 1)
+        return chosen;
+
+    double target = counterRandom(seed, generation, position) * total;
+    for (const Production* it = first; it != last; ++it) {
+        if (applies(*it)) {
+            target -= it->weight;
+            if (target < 0.0)
+                return it;
+        }
+    }
+    return chosen;  // El redondeo dejo el sorteo al final: la ultima que aplica
+}
+
+/*
+ * @brief Aplica una generacion de reescritura paralela.
+ * @note Dos pasadas: la primera suma la longitud de expansion de cada simbolo
+ *       para conocer el tamano exacto de salida; la segunda copia los reemplazos
+ *       en el buffer ya dimensionado. Los buffers se reutilizan entre generaciones.
+ */
+void LSystem::rewriteOnce() {
+    unsigned threads = 1;
+    if (parallelEnabled && getLength() >= PARALLEL_MIN_SYMBOLS) {
+        threads = threadCount != 0 ? threadCount : std::thread::hardware_concurrency();
+    }
+
+    if (stringPacked) {
+        rewritePacked(std::max(threads, 1U));
+        return;
+    }
+
+    if (isExtended()) {
+        rewriteExtended(std::max(threads, 1U));
+        return;
+    }
+    if (threads > 1) {
+        rewriteParallel(threads);
+        return;
+    }
+
+    const char* begin = currentString.data();
+    const char* end = begin + currentString.size();
+
+    // (c): Pasada 1 - longitud exacta de la siguiente generacion
+    nextString.resize(expandedLength(begin, end));
+
+    // (c): Pasada 2 - escribir cada reemplazo en su posicion final
+    expandRange(begin, end, nextString.data());
+
+    // (c): Intercambiar buffers; la cadena anterior queda como buffer libre
+    currentString.swap(nextString);
+}
+
+/*
+ * @brief Reescritura multihilo con colocacion de salida por prefix sum.
+ * @param threads Numero de bloques/hilos; el hilo llamador procesa el bloque 0.
+ */
+void LSystem::rewriteParallel(unsigned threads) {
+    const size_t inputLength = currentString.size();
+    const size_t chunks = std::min<size_t>(threads, inputLength);
+    const char* input = currentString.data();
+
+    auto chunkBegin = [&](size_t chunk) { return input + inputLength * chunk / chunks; };
+
+    // (c): Pasada 1 - cada hilo cuenta la longitud de salida de su bloque
+    chunkOffsets.assign(chunks + 1, 0);
+    forEachChunk(chunks, [&](size_t chunk) {
+        chunkOffsets[chunk + 1] = expandedLength(chunkBegin(chunk), chunkBegin(chunk + 1));
+    });
+
+    // (c): Prefix sum - desplazamiento de salida de cada bloque
+    for (size_t chunk = 0; chunk < chunks; ++chunk) {
+        chunkOffsets[chunk + 1] += chunkOffsets[chunk];
+    }
+
+    nextString.resize(chunkOffsets[chunks]);
+    char* output = nextString.data();
+
+    // (c): Pasada 2 - cada hilo escribe su bloque directamente en el buffer compartido
+    forEachChunk(chunks, [&](size_t chunk) {
+        expandRange(chunkBegin(chunk), chunkBegin(chunk + 1), output + chunkOffsets[chunk]);
+    });
+
+    currentString.swap(nextString);
+}
+
+/*
+ * @brief Reescritura de modulos con producciones estocasticas o parametricas.
+ * @param threads Numero de bloques/hilos; el hilo llamador procesa el bloque 0.
+ * @note La produccion de cada modulo se elige en ambas pasadas con el mismo numero
+ *       aleatorio (por contador), asi que la longitud medida coincide con la escrita.
+ */
+void LSystem::rewriteExtended(unsigned threads) {
+    const size_t inputLength = currentString.size();
+    const size_t chunks = std::max<size_t>(1, std::min<size_t>(threads, inputLength));
+    const char* input = currentString.data();
+
+    // Un marcador pertenece al simbolo anterior, asi que un corte sobre un marcador se recorre
+    auto chunkBegin = [&](size_t chunk) {
+        size_t position = inputLength * chunk / chunks;
+        if (position < inputLength && isParameterMarker(input[position])) {
+            position++;
+        }
+        return position;
+    };
+
+    // (c): Pasada 0 - parametros de entrada que consume cada bloque
+    chunkInputParameters.assign(chunks + 1, 0);
+    if (chunks > 1 && !currentParameters.empty()) {
+        forEachChunk(chunks, [&](size_t chunk) {
+            size_t count = 0;
+            for (size_t i = chunkBegin(chunk), end = chunkBegin(chunk + 1); i < end; ++i) {
+                if (isParameterMarker(input[i])) {
+                    count += static_cast<size_t>(input[i]);
+                }
+            }
+            chunkInputParameters[chunk + 1] = count;
+        });
+        for (size_t chunk = 0; chunk < chunks; ++chunk) {
+            chunkInputParameters[chunk + 1] += chunkInputParameters[chunk];
+        }
+    }
+
+    // (c): Pasada 1 - simbolos y parametros de salida de cada bloque
+    chunkOffsets.assign(chunks + 1, 0);
+    chunkParameterOffsets.assign(chunks + 1, 0);
+    forEachChunk(chunks, [&](size_t chunk) {
+        measureModules(chunkBegin(chunk), chunkBegin(chunk + 1), chunkInputParameters[chunk],
+                       chunkOffsets[chunk + 1], chunkParameterOffsets[chunk + 1]);
+    });
+
+    // (c): Prefix sum - desplazamientos de salida de cada bloque en ambos buffers
+    for (size_t chunk = 0; chunk < chunks; ++chunk) {
+        chunkOffsets[chunk + 1] += chunkOffsets[chunk];
+        chunkParameterOffsets[chunk + 1] += chunkParameterOffsets[chunk];
+    }
+
+    nextString.resize(chunkOffsets[chunks]);
+    nextParameters.resize(chunkParameterOffsets[chunks]);
+    char* output = nextString.data();
+    float* outputParameters = nextParameters.data();
+
+    // (c): Pasada 2 - cada bloque escribe sus modulos y parametros en su posicion final
+    forEachChunk(chunks, [&](size_t chunk) {
+        expandModules(chunkBegin(chunk), chunkBegin(chunk + 1), chunkInputParameters[chunk],
+                      output + chunkOffsets[chunk],
+                      outputParameters + chunkParameterOffsets[chunk]);
+    });
+
+    currentString.swap(nextString);
+    currentParameters.swap(nextParameters);
+}
+
+/*
+ * @brief Mide la expansion de los modulos en [begin, end) sin escribirla.
+ */
+void LSystem::measureModules(size_t begin, size_t end, size_t parameter, size_t& symbols,
+                             size_t& parameters) const {
+    const char* input = currentString.data();
+    const size_t length = currentString.size();
+    const float* values = currentParameters.data();
+
+    symbols = 0;
+    parameters = 0;
+    for (size_t i = begin; i < end;) {
+        const int count = i + 1 < length && isParameterMarker(input[i + 1]) ? input[i + 1] : 0;
+        const size_t size = count > 0 ? 2 : 1;
+        const Production* production =
+            chooseSuccessor(input[i], values + parameter, count, currentGeneration, i);
+        if (production == nullptr) {
+            symbols += size;
+            parameters += static_cast<size_t>(count);
+        } else {
+            symbols += production->successor.symbols.size();
+            parameters += production->successor.arguments.size();
+        }
+        parameter += static_cast<size_t>(count);
+        i += size;
+    }
+}
+
+/*
+ * @brief Escribe la expansion de los modulos en [begin, end): simbolos en out y
+ *        argumentos evaluados en outParameters.
+ */
+void LSystem::expandModules(size_t begin, size_t end, size_t parameter, char* out,
+                            float* outParameters) const {
+    const char* input = currentString.data();
+    const size_t length = currentString.size();
+    const float* values = currentParameters.data();
+
+    for (size_t i = begin; i < end;) {
+        const int count = i + 1 < length && isParameterMarker(input[i + 1]) ? input[i + 1] : 0;
+        const size_t size = count > 0 ? 2 : 1;
+        const float* actuals = values + parameter;
+        const Production* production =
+            chooseSuccessor(input[i], actuals, count, currentGeneration, i);
+        if (production == nullptr) {
+            // Ninguna produccion aplica: el modulo sobrevive sin cambios
+            std::memcpy(out, input + i, size);
+            out += size;
+            std::copy(actuals, actuals + count, outParameters);
+            outParameters += count;
+        } else {
+            const ProductionSuccessor& successor = production->successor;
+            std::memcpy(out, successor.symbols.data(), successor.symbols.size());
+            out += successor.symbols.size();
+            for (const ParametricExpression& argument : successor.arguments) {
+                *outParameters++ = argument.evaluate(actuals);
+            }
+        }
+        parameter += static_cast<size_t>(count);
+        i += size;
+    }
+}
+
+/*
+ * @brief Suma las longitudes de reemplazo de los simbolos en [begin, end).
+ */
+size_t LSystem::expandedLength(const char* begin, const char* end) const {
+    size_t length = 0;
+    for (const char* it = begin; it != end; ++it) {
+        length += ruleLength[static_cast<unsigned char>(*it)];
+    }
+    return length;
+}
+
+/*
+ * @brief Copia el reemplazo de cada simbolo en [begin, end) de forma consecutiva.
+ */
+void LSystem::expandRange(const char* begin, const char* end, char* out) const {
+    const char* table = ruleData.data();
+    for (const char* it = begin; it != end; ++it) {
+        auto index = static_cast<unsigned char>(*it);
+        uint32_t length = ruleLength[index];
+        if (length == 1) {
+            *out = table[ruleOffset[index]];
+        } else {
+            std::memcpy(out, table + ruleOffset[index], length);
+        }
+        out += length;
+    }
+}
+
+/*
+ * @brief Traduce las reglas a codigos de 4 bits si se pidio una cadena empaquetada.
+ * @note El alfabeto son los simbolos del axioma y de las reglas, en orden de aparicion.
+ */
+void LSystem::buildPackedRules() {
+    packAlphabet.clear();
+    if (packing == SymbolPacking::None || isExtended())
+        return;
+
+    std::array<uint8_t, 256> codeOf;
+    codeOf.fill(PackedString::RUN_CODE);
+    auto addSymbols = [&](const std::string& symbols) {
+        for (char c : symbols) {
+            const auto index = static_cast<unsigned char>(c);
+            if (codeOf[index] != PackedString::RUN_CODE)
+                continue;
+            if (packAlphabet.size() == PackedString::MAX_SYMBOLS)
+                return false;
+            codeOf[index] = static_cast<uint8_t>(packAlphabet.size());
+            packAlphabet.push_back(c);
+        }
+        return true;
+    };
+    bool fits = addSymbols(axiomModules.symbols);
+    for (const auto& [symbol, replacement] : rules) {
+        fits = fits && addSymbols(std::string(1, symbol)) && addSymbols(replacement);
+    }
+    if (!fits) {
+        packAlphabet.clear();
+        return;
+    }
+
+    for (size_t code = 0; code < packAlphabet.size(); ++code) {
+        const auto found = rules.find(packAlphabet[code]);
+        const std::string successor =
+            found != rules.end() ? found->second : std::string(1, packAlphabet[code]);
+
+        PackedRule& rule = packedRules[code];
+        rule.length = static_cast<uint32_t>(successor.size());
+        rule.words.assign((successor.size() + 15) / 16, 0);
+        rule.runs.clear();
+        for (size_t i = 0; i < successor.size(); ++i) {
+            const uint8_t symbolCode = codeOf[static_cast<unsigned char>(successor[i])];
+            rule.words[i / 16] |= static_cast<uint64_t>(symbolCode) << (4 * (i % 16));
+            if (!rule.runs.empty() && rule.runs.back().first == symbolCode) {
+                rule.runs.back().second++;
+            } else {
+                rule.runs.emplace_back(symbolCode, 1);
+            }
+        }
+    }
+
+    // Los codigos fuera del alfabeto nunca aparecen, salvo como relleno de una cola impar
+    packedPairLength.fill(0);
+    for (size_t lo = 0; lo < packAlphabet.size(); ++lo) {
+        for (size_t hi = 0; hi < packAlphabet.size(); ++hi) {
+            packedPairLength[lo | (hi << 4)] = packedRules[lo].length + packedRules[hi].length;
+        }
+    }
+}
+
+/*
+ * @brief Reescribe currentPacked en nextPacked y los intercambia.
+ */
+void LSystem::rewritePacked(unsigned threads) {
+    if (packing == SymbolPacking::Runs) {
+        nextPacked.reset(packAlphabet, true);
+        PackedString::Writer out(nextPacked);
+        PackedString::Reader in(currentPacked);
+        uint8_t code = 0;
+        size_t count = 0;
+        while (in.next(code, count)) {
+            const auto& runs = packedRules[code].runs;
+            // Un solo simbolo repetido (F->FF, o sin regla) reescribe una racha en una sola racha
+            if (runs.size() == 1) {
+                out.put(runs[0].first, count * runs[0].second);
+                continue;
+            }
+            for (size_t n = 0; n < count; ++n) {
+                for (const auto& run : runs) {
+                    out.put(run.first, run.second);
+                }
+            }
+        }
+        out.finish();
+        currentPacked.swap(nextPacked);
+        return;
+    }
+
+    // Los bloques se dividen en bytes completos; el ultimo codigo impar (si hay) va al ultimo
+    const uint8_t* input = currentPacked.data();
+    const size_t fullBytes = currentPacked.getNibbleCount() / 2;
+    const bool oddTail = (currentPacked.getNibbleCount() & 1U) != 0;
+    const size_t chunks = std::max<size_t>(1, std::min<size_t>(threads, fullBytes));
+    auto chunkBegin = [&](size_t chunk) { return fullBytes * chunk / chunks; };
+
+    // (c): Pasada 1 - longitud de salida de cada bloque, con la tabla de pares
+    chunkOffsets.assign(chunks + 1, 0);
+    forEachChunk(chunks, [&](size_t chunk) {
+        size_t length = 0;
+        for (size_t i = chunkBegin(chunk), end = chunkBegin(chunk + 1); i < end; ++i) {
+            length += packedPairLength[input[i]];
+        }
+        chunkOffsets[chunk + 1] = length;
+    });
+    if (oddTail) {
+        chunkOffsets[chunks] += packedRules[input[fullBytes] & 0xFU].length;
+    }
+    for (size_t chunk = 0; chunk < chunks; ++chunk) {
+        chunkOffsets[chunk + 1] += chunkOffsets[chunk];
     }
 
-    std::cout << "Generacion " << currentGeneration << " completada.\n";
-    std::cout << "Longitud de cadena: " << currentString.length() << " simbolos\n";
+    nextPacked.reset(packAlphabet, false);
+    nextPacked.resizeLiteral(chunkOffsets[chunks]);
+    uint8_t* output = nextPacked.data();
+
+    // (c): Pasada 2 - cada hilo escribe su bloque desde su desplazamiento en codigos
+    std::vector<uint8_t> seams(chunks, 0);
+    forEachChunk(chunks, [&](size_t chunk) {
+        NibbleWriter out(output, chunkOffsets[chunk], seams[chunk]);
+        for (size_t i = chunkBegin(chunk), end = chunkBegin(chunk + 1); i < end; ++i) {
+            const PackedRule& low = packedRules[input[i] & 0xFU];
+            const PackedRule& high = packedRules[input[i] >> 4];
+            out.put(low.words.data(), low.length);
+            out.put(high.words.data(), high.length);
+        }
+        if (oddTail && chunk + 1 == chunks) {
+            const PackedRule& last = packedRules[input[fullBytes] & 0xFU];
+            out.put(last.words.data(), last.length);
+        }
+        out.finish();
+    });
+    for (size_t chunk = 0; chunk < chunks; ++chunk) {
+        if ((chunkOffsets[chunk] & 1U) != 0) {
+            output[chunkOffsets[chunk] / 2] |= seams[chunk];
+        }
+    }
+
+    currentPacked.swap(nextPacked);
+}
+
+/*
+ * @brief Habilita o deshabilita la reescritura multihilo.
+ */
+void LSystem::setParallel(bool enable, unsigned threads) {
+    parallelEnabled = enable;
+    threadCount = threads;
+}
+
+/*
+ * @brief Indica si la reescritura multihilo esta habilitada.
+ */
+bool LSystem::isParallel() const {
+    return parallelEnabled;
+}
+
+/*
+ * @brief Crea un flujo perezoso de la generacion indicada.
+ * @param generations Numero de iteraciones a expandir.
+ */
+SymbolStream LSystem::stream(int generations) {
+    if (ruleTableDirty) {
+        buildRuleTable();
+    }
+    if (isExtended()) {
+        return SymbolStream(*this, axiomModules, generations);
+    }
+    return SymbolStream(axiom, generations, ruleData.data(), ruleOffset.data(), ruleLength.data(),
+                        ruleSelfIndex.data());
+}
+
+/*
+ * @brief Flujo de la expansion extendida: parte del axioma ya analizado.
+ */
+SymbolStream::SymbolStream(const LSystem& lsystem, const ProductionSuccessor& axiom,
+                           int generations)
+    : owner(&lsystem) {
+    generations = std::max(generations, 0);
+    modules.reserve(static_cast<size_t>(generations) + 1);
+    levelPositions.assign(static_cast<size_t>(generations) + 1, 0);
+
+    ModuleFrame root{};
+    root.successor = &axiom;
+    root.depth = generations;
+    root.inherit = NO_INHERIT;
+    modules.push_back(root);
+}
+
+/*
+ * @brief Siguiente modulo terminal de la expansion extendida.
+ * @note levelPositions[g] es la posicion del siguiente modulo en la cadena de la
+ *       generacion g: con ella se reproduce el numero aleatorio de la reescritura.
+ */
+bool SymbolStream::nextModule(char& symbol, int& birth, const float*& values, int& count) {
+    while (!modules.empty()) {
+        ModuleFrame& top = modules.back();
+        const std::string& symbols = top.successor->symbols;
+        if (top.position == symbols.size()) {
+            modules.pop_back();
+            continue;
+        }
+
+        const uint32_t position = top.position;
+        const char current = symbols[position];
+        const bool parametric =
+            position + 1 < symbols.size() && isParameterMarker(symbols[position + 1]);
+        const int moduleCount = parametric ? symbols[position + 1] : 0;
+        const uint32_t size = moduleCount > 0 ? 2 : 1;
+        top.position += size;
+
+        // Parametros reales de este modulo, evaluados con los del modulo del que proviene
+        float actuals[MAX_MODULE_PARAMETERS];
+        for (int i = 0; i < moduleCount; ++i) {
+            actuals[i] = top.successor->arguments[top.argument++].evaluate(top.actuals);
+        }
+
+        const int currentBirth = position == top.inherit ? top.inheritedBirth : top.generation;
+        const int level = top.generation;
+        const int depth = top.depth;
+        const uint64_t levelPosition = levelPositions[level];
+        levelPositions[level] += size;
+
+        const Production* production =
+            depth == 0
+                ? nullptr
+                : owner->chooseSuccessor(current, actuals, moduleCount, level, levelPosition);
+        if (production == nullptr) {
+            // Sin cambios en las generaciones restantes: aun ocupa sus bytes en ellas
+            for (int generation = level + 1; generation <= level + depth; ++generation) {
+                levelPositions[generation] += size;
+            }
+
+            symbol = current;
+            birth = currentBirth;
+            std::copy(actuals, actuals + moduleCount, moduleValues);
+            values = moduleValues;
+            count = moduleCount;
+            emitted++;
+            return true;
+        }
+
+        ModuleFrame child{};
+        child.successor = &production->successor;
+        child.depth = depth - 1;
+        child.generation = level + 1;
+        child.inherit = production->successor.selfIndex;
+        child.inheritedBirth = currentBirth;
+        std::copy(actuals, actuals + moduleCount, child.actuals);
+        modules.push_back(child);
+    }
+    return false;
 }
 
 /*
  * @brief Obtiene la cadena generada actual.
  * @return Cadena del L-System.
  */
-std::string LSystem::getString() const {
+const std::string& LSystem::getString() const {
     return currentString;
 }
 
+/*
+ * @brief Cambia la representacion de la cadena; otra representacion recalcula la derivacion.
+ */
+void LSystem::setPacking(SymbolPacking newPacking) {
+    if (newPacking == packing)
+        return;
+    packing = newPacking;
+    ruleTableDirty = true;
+    invalidateDerivation();
+}
+
+/*
+ * @brief Obtiene la representacion pedida.
+ */
+SymbolPacking LSystem::getPacking() const {
+    return packing;
+}
+
+/*
+ * @brief Indica si la cadena actual esta empaquetada.
+ */
+bool LSystem::isPacked() const {
+    return stringPacked;
+}
+
+/*
+ * @brief Obtiene la cadena actual empaquetada.
+ */
+const PackedString& LSystem::getPackedString() const {
+    return currentPacked;
+}
+
+/*
+ * @brief Numero de simbolos de la cadena actual.
+ */
+size_t LSystem::getLength() const {
+    return stringPacked ? currentPacked.size() : currentString.size();
+}
+
+/*
+ * @brief Obtiene el buffer lateral de parametros de la cadena actual.
+ */
+const std::vector<float>& LSystem::getParameters() const {
+    return currentParameters;
+}
+
+/*
+ * @brief Memoria reservada por las cadenas y sus buffers de parametros.
+ * @return Bytes de capacidad de las cadenas (de bytes o empaquetadas), sus buffers de
+ *         reescritura y la cache de generaciones.
+ */
+size_t LSystem::getStringBytes() const {
+    size_t bytes = currentString.capacity() + nextString.capacity() +
+                   (currentParameters.capacity() + nextParameters.capacity()) * sizeof(float) +
+                   currentPacked.getBytes() + nextPacked.getBytes();
+    for (const auto& cached : generationCache) {
+        bytes += cached.symbols.capacity() + cached.parameters.capacity() * sizeof(float) +
+                 cached.packed.getBytes();
+    }
+    return bytes;
+}
+
+/*
+ * @brief Predice el tamano de las generaciones sin reescribir la cadena.
+ * @note Un modulo es un (simbolo, numero de parametros): la produccion que se le
+ *       aplica, y por tanto su reemplazo, solo depende de eso y de la condicion.
+ *       Se descubren los modulos alcanzables desde el axioma y la fila de cada uno
+ *       en la matriz de crecimiento (cuantos de cada modulo produce); el vector de
+ *       Parikh de la generacion n+1 es el de la n por la matriz.
+ */
+std::vector<GrowthPrediction> LSystem::predictGrowth(int generations) const {
+    struct Module {
+        char symbol;
+        int count;
+        std::vector<std::pair<uint32_t, double>> successors;  // (modulo, cantidad esperada)
+    };
+    std::vector<Module> modules;
+    std::map<std::pair<char, int>, uint32_t> moduleIndex;
+    bool exact = true;
+
+    // Histograma de modulos de un sucesor, registrando los modulos nuevos
+    auto histogram = [&modules, &moduleIndex](const std::string& symbols, double weight,
+                                              std::map<uint32_t, double>& counts) {
+        for (size_t i = 0; i < symbols.size(); ++i) {
+            int count = 0;
+            if (i + 1 < symbols.size() && isParameterMarker(symbols[i + 1])) {
+                count = symbols[i + 1];
+            }
+            auto [it, added] = moduleIndex.emplace(std::make_pair(symbols[i], count),
+                                                   static_cast<uint32_t>(modules.size()));
+            if (added) {
+                modules.push_back({symbols[i], count, {}});
+            }
+            counts[it->second] += weight;
+            i += count > 0 ? 1 : 0;
+        }
+    };
+
+    std::map<uint32_t, double> axiomCounts;
+    histogram(axiomModules.symbols, 1.0, axiomCounts);
+
+    // Lista de trabajo: modules crece mientras se llenan sus filas
+    for (size_t m = 0; m < modules.size(); ++m) {
+        const char symbol = modules[m].symbol;
+        const int count = modules[m].count;
+
+        std::vector<std::pair<const std::string*, float>> applicable;
+        bool conditional = false;
+        for (const Production& production : productions) {
+            if (production.predecessor == symbol && production.formalCount == count) {
+                applicable.emplace_back(&production.successor.symbols, production.weight);
+                conditional = conditional || !production.condition.isEmpty();
+            }
+        }
+        const auto rule = rules.find(symbol);
+        if (count == 0 && rule != rules.end()) {
+            applicable.emplace_back(&rule->second, 1.0F);
+        }
+        exact = exact && applicable.size() <= 1;
+
+        std::map<uint32_t, double> counts;
+        if (applicable.empty()) {
+            counts[static_cast<uint32_t>(m)] = 1.0;  // Identidad
+        } else if (conditional) {
+            // Cual aplica depende de los parametros, y quiza ninguna: cada
+            // entrada de la fila toma lo maximo que da cualquier alternativa (o el propio
+            // modulo). Los conteos nunca quedan por debajo de los reales, pues la matriz es
+            // no negativa y cada fila real esta por debajo de esta.
+            counts[static_cast<uint32_t>(m)] = 1.0;
+            for (const auto& alternative : applicable) {
+                std::map<uint32_t, double> alternativeCounts;
+                histogram(*alternative.first, 1.0, alternativeCounts);
+                for (const auto& [module, amount] : alternativeCounts) {
+                    counts[module] = std::max(counts[module], amount);
+                }
+            }
+        } else {
+            double total = 0.0;
+            for (const auto& alternative : applicable) {
+                total += alternative.second;
+            }
+            for (const auto& alternative : applicable) {
+                histogram(*alternative.first, alternative.second / total, counts);
+            }
+        }
+        modules[m].successors.assign(counts.begin(), counts.end());
+    }
+
+    std::vector<double> current(modules.size(), 0.0);
+    std::vector<double> next(modules.size(), 0.0);
+    for (const auto& [module, amount] : axiomCounts) {
+        current[module] = amount;
+    }
+
+    std::vector<GrowthPrediction> predictions;
+    predictions.reserve(static_cast<size_t>(std::max(generations, 0)) + 1);
+    for (int generation = 0;; ++generation) {
+        GrowthPrediction prediction;
+        prediction.generation = generation;
+        prediction.exact = exact;
+        for (size_t m = 0; m < modules.size(); ++m) {
+            const double amount = current[m];
+            const int count = modules[m].count;
+            prediction.symbols += amount * (count > 0 ? 2.0 : 1.0);
+            prediction.parameters += amount * count;
+            switch (modules[m].symbol) {
+                case 'F':
+                case 'G':
+                case 'A':
+                case 'B':
+                    prediction.branches += amount;
+                    break;
+                case 'L':
+                case 'l':
+                    prediction.leaves += amount;
+                    break;
+                case 'K':
+                case 'k':
+                    prediction.flowers += amount;
+                    break;
+                default:
+                    break;
+            }
+        }
+        predictions.push_back(prediction);
+        if (generation >= generations)
+            break;
+
+        std::fill(next.begin(), next.end(), 0.0);
+        for (size_t m = 0; m < modules.size(); ++m) {
+            if (current[m] == 0.0)
+                continue;
+            for (const auto& [successor, amount] : modules[m].successors) {
+                next[successor] += current[m] * amount;
+            }
+        }
+        current.swap(next);
+    }
+    return predictions;
+}
+
 /*
  * @brief Obtiene el angulo de rotacion.
  * @return Angulo en grados.
@@ -155,6 +1283,75 @@ std::string LSystem::getAxiom() const {
     return axiom;
 }
 
+/*
+ * @brief Obtiene las reglas de produccion.
+ * @return Mapa de simbolo a reemplazo.
+ */
+const std::map<char, std::string>& LSystem::getRules() const {
+    return rules;
+}
+
+/*
+ * @brief Obtiene las producciones estocasticas y parametricas.
+ */
+const std::vector<Production>& LSystem::getProductions() const {
+    return productions;
+}
+
+/*
+ * @brief Indica si la reescritura pasa por la tabla de producciones.
+ */
+bool LSystem::isExtended() const {
+    return !productions.empty() || !axiomModules.arguments.empty();
+}
+
+/*
+ * @brief Compara axioma, reglas, producciones y (si importa) la semilla.
+ */
+bool LSystem::hasSameDerivation(const LSystem& other) const {
+    if (axiom != other.axiom || rules != other.rules || ruleErrors != other.ruleErrors ||
+        productions.size() != other.productions.size())
+        return false;
+    for (size_t i = 0; i < productions.size(); ++i) {
+        if (productions[i].source != other.productions[i].source)
+            return false;
+    }
+    return seed == other.seed || !isExtended();
+}
+
+/*
+ * @brief Cambia la semilla; solo invalida la derivacion si hay producciones estocasticas.
+ */
+void LSystem::setSeed(uint64_t newSeed) {
+    if (newSeed == seed)
+        return;
+    seed = newSeed;
+    if (isExtended()) {
+        invalidateDerivation();
+    }
+}
+
+/*
+ * @brief Obtiene la semilla.
+ */
+uint64_t LSystem::getSeed() const {
+    return seed;
+}
+
+/*
+ * @brief Obtiene el error del axioma.
+ */
+const std::string& LSystem::getAxiomError() const {
+    return axiomError;
+}
+
+/*
+ * @brief Obtiene las reglas descartadas.
+ */
+const std::vector<std::string>& LSystem::getRuleErrors() const {
+    return ruleErrors;
+}
+
 /*
  * @brief Obtiene la generacion actual.
  * @return Numero de iteraciones aplicadas.
@@ -167,18 +1364,56 @@ int LSystem::getGeneration() const {
  * @brief Reinicia el L-System al estado inicial (axioma).
  */
 void LSystem::reset() {
-    currentString = axiom;
+    if (!derivationDirty && currentGeneration > 0) {
+        const int previous = currentGeneration;
+        currentGeneration = 0;
+        storeGeneration(previous, std::move(currentString), std::move(currentParameters),
+                        std::move(currentPacked));
+    }
+    resetToAxiom();
     currentGeneration = 0;
     std::cout << "L-System reiniciado al axioma.\n";
 }
 
+/*
+ * @brief Copia el axioma analizado (simbolos y argumentos) en la cadena actual.
+ */
+void LSystem::resetToAxiom() {
+    // Las reglas empaquetadas solo coinciden con el alfabeto con la tabla de reglas al dia
+    stringPacked = !ruleTableDirty && !packAlphabet.empty();
+    if (stringPacked) {
+        std::string().swap(currentString);
+        std::string().swap(nextString);
+        currentPacked.reset(packAlphabet, packing == SymbolPacking::Runs);
+        currentPacked.assign(axiomModules.symbols);
+    } else {
+        currentPacked.clear();
+        nextPacked.clear();
+        currentString.assign(axiomModules.symbols);
+    }
+    currentParameters.clear();
+    for (const ParametricExpression& argument : axiomModules.arguments) {
+        currentParameters.push_back(argument.evaluate(nullptr));
+    }
+}
+
 /*
  * @brief Establece el axioma directamente.
  */
 void LSystem::setAxiom(const std::string& newAxiom) {
     axiom = newAxiom;
-    currentString = axiom;
+    axiomError.clear();
+    if (!parseModules(axiom, {}, axiomModules, axiomError)) {
+        std::cerr << "Error en el axioma " << axiom << ": " << axiomError << '\n';
+        // Conservar el texto como simbolos simples para que haya algo que dibujar
+        axiomModules = ProductionSuccessor{};
+        axiomModules.symbols = axiom;
+    }
+
+    resetToAxiom();
     currentGeneration = 0;
+    ruleTableDirty = true;  // Un axioma parametrico cambia a la tabla de producciones
+    invalidateDerivation();
 }
 
 /*
@@ -193,6 +1428,122 @@ void LSystem::setAngle(float newAngle) {
  */
 void LSystem::addRule(char symbol, const std::string& replacement) {
     rules[symbol] = replacement;
+    ruleTableDirty = true;
+    invalidateDerivation();
+}
+
+/*
+ * @brief Agrega reglas de produccion desde texto (separadas por salto de linea o coma).
+ */
+void LSystem::addRulesFromString(const std::string& text) {
+    ProfileScope scope(ProfileStage::ParseRules);
+
+    // Saltos de linea y comas separan reglas; las comas de los argumentos no
+    for (const std::string& line : splitOutsideParentheses(text, "\n,")) {
+        addRuleLine(line);
+    }
+}
+
+/*
+ * @brief Analiza una regla simple, estocastica o parametrica.
+ * @note Sintaxis: X[(a,b,...)] [: condicion] [-(peso)] -> reemplazo
+ */
+bool LSystem::addRuleLine(const std::string& text) {
+    // Remover espacios al inicio
+    std::string line = text;
+    size_t start = line.find_first_not_of(" \t");
+    if (start != std::string::npos) {
+        line = line.substr(start);
+    }
+
+    size_t arrowPos = line.find("->");
+    if (arrowPos == std::string::npos || arrowPos == 0)
+        return true;  // No es regla: se ignora, como antes
+
+    auto reject = [this, &line](const std::string& reason) {
+        std::cerr << "Regla descartada (" << line << "): " << reason << '\n';
+        ruleErrors.push_back(trim(line) + ": " + reason);
+        return false;
+    };
+
+    std::string left = trim(line.substr(0, arrowPos));
+    const std::string replacement = line.substr(arrowPos + ARROW_LENGTH);
+
+    // Peso: un "-(p)" pegado a la flecha, como en F-(0.3)->...
+    bool weighted = false;
+    float weight = 1.0F;
+    const size_t weightPos = left.rfind("-(");
+    if (weightPos != std::string::npos && weightPos > 0 && left.back() == ')') {
+        const std::string weightText = left.substr(weightPos + 2, left.size() - weightPos - 3);
+        char* end = nullptr;
+        weight = std::strtof(weightText.c_str(), &end);
+        if (end == weightText.c_str() || !trim(end).empty() || !(weight > 0.0F))
+            return reject("peso invalido '" + weightText + "'");
+        weighted = true;
+        left = trim(left.substr(0, weightPos));
+    }
+
+    // Condicion: todo lo que sigue a ':'
+    std::string conditionText;
+    const size_t colonPos = left.find(':');
+    if (colonPos != std::string::npos) {
+        conditionText = trim(left.substr(colonPos + 1));
+        left = trim(left.substr(0, colonPos));
+        if (conditionText.empty())
+            return reject("condicion vacia");
+    }
+
+    // Predecesor: un simbolo, con sus parametros formales entre parentesis
+    if (left.empty())
+        return reject("falta el predecesor");
+    const char symbol = left[0];
+    if (symbol == '(' || symbol == ')' || isParameterMarker(symbol))
+        return reject("predecesor invalido");
+
+    std::vector<std::string> formals;
+    if (left.size() > 1) {
+        if (left[1] != '(' || left.back() != ')')
+            return reject("el predecesor debe ser un simbolo, p. ej. X o X(a,b)");
+        const std::string formalList = left.substr(2, left.size() - 3);
+        for (const std::string& piece : splitOutsideParentheses(formalList, ",")) {
+            const std::string name = trim(piece);
+            if (!isIdentifier(name))
+                return reject("parametro formal invalido '" + name + "'");
+            if (std::find(formals.begin(), formals.end(), name) != formals.end())
+                return reject("parametro formal repetido '" + name + "'");
+            formals.push_back(name);
+        }
+        if (formals.size() > static_cast<size_t>(MAX_MODULE_PARAMETERS))
+            return reject("demasiados parametros formales");
+    }
+
+    // Regla simple: va a la tabla plana de reescritura (D0L)
+    if (!weighted && conditionText.empty() && formals.empty() &&
+        replacement.find('(') == std::string::npos) {
+        addRule(symbol, replacement);
+        return true;
+    }
+
+    Production production;
+    production.predecessor = symbol;
+    production.formalCount = static_cast<int>(formals.size());
+    production.weight = weight;
+    production.source = trim(line);
+
+    std::string error;
+    if (!conditionText.empty() && !production.condition.compile(conditionText, formals, error))
+        return reject("condicion '" + conditionText + "': " + error);
+    if (!parseModules(trim(replacement), formals, production.successor, error))
+        return reject(error);
+
+    size_t self = production.successor.symbols.find(symbol);
+    production.successor.selfIndex =
+        self == std::string::npos ? SymbolStream::NO_INHERIT : static_cast<uint32_t>(self);
+
+    productions.push_back(std::move(production));
+    ruleTableDirty = true;
+    invalidateDerivation();
+    return true;
 }
 
 /*
@@ -200,4 +1551,8 @@ void LSystem::addRule(char symbol, const std::string& replacement) {
  */
 void LSystem::clearRules() {
     rules.clear();
+    productions.clear();
+    ruleErrors.clear();
+    ruleTableDirty = true;
+    invalidateDerivation();
 }
@@ -2,10 +2,14 @@
  * @file LSystem.h
  * @brief Implementacion de Sistema de Lindenmayer (L-System) para generacion procedural.
  *
- * Implementa un L-System deterministico y libre de contexto (D0L-system) para
- * generar cadenas mediante reglas de reescritura paralela. Esta clase maneja
- * el alfabeto, axioma y reglas de produccion para simular patrones de
- * crecimiento de plantas.
+ * Implementa un L-System libre de contexto para generar cadenas mediante reglas
+ * de reescritura paralela. Esta clase maneja el alfabeto, axioma y reglas de
+ * produccion para simular patrones de crecimiento de plantas.
+ *
+ * Las reglas simples (X->reemplazo) forman un D0L-system con tablas planas de
+ * reescritura. Ademas acepta producciones estocasticas (F-(0.3)->...) y
+ * parametricas (X(l,w) : l > 1 -> F(l)[+X(l*0.7,w)]); los parametros de los
+ * modulos viven en un buffer lateral de floats, no como texto en la cadena.
  *
  * Esta clase NO tiene dependencias de OpenGL - solo genera cadenas.
  *
@@ -18,12 +22,245 @@
 #ifndef LSYSTEM_H
 #define LSYSTEM_H
 
+#include <array>
+#include <cstdint>
+#include <functional>
 #include <map>
 #include <string>
+#include <vector>
+
+#include "PackedString.h"
+#include "ParametricExpression.h"
+
+class LSystem;
+
+/**
+ * @brief Callback de progreso para trabajos largos (generacion e interpretacion).
+ *
+ * Recibe la fraccion completada en [0, 1], o un valor negativo si el avance no
+ * se puede estimar. Devuelve false para cancelar el trabajo.
+ */
+using ProgressCallback = std::function<bool(float)>;
+
+/// Parametros maximos de un modulo, p. ej. X(l,w) tiene 2
+constexpr int MAX_MODULE_PARAMETERS = 8;
+
+/**
+ * @brief Indica si un byte de la cadena es el marcador de parametros de un modulo.
+ *
+ * Un modulo parametrico se guarda como su simbolo seguido de un byte con su numero
+ * de parametros (1..MAX_MODULE_PARAMETERS); los valores van, en el mismo orden que
+ * los modulos, en el buffer lateral (ver LSystem::getParameters()).
+ */
+inline bool isParameterMarker(char c) {
+    return c >= 1 && c <= MAX_MODULE_PARAMETERS;
+}
+
+/**
+ * @brief Lado derecho ya analizado de una produccion extendida (o el axioma).
+ */
+struct ProductionSuccessor {
+    std::string symbols;  ///< Simbolos, cada modulo parametrico seguido de su marcador
+    std::vector<ParametricExpression> arguments;  ///< Argumentos de todos los modulos, en orden
+    uint32_t selfIndex{UINT32_MAX};  ///< Primera aparicion del predecesor (UINT32_MAX: ninguna)
+};
+
+/**
+ * @brief Produccion estocastica y/o parametrica: X(a,b) : condicion -(peso)-> reemplazo.
+ *
+ * Se aplica a un modulo X con exactamente formalCount parametros cuya condicion
+ * se cumple; entre las que se aplican se elige una con probabilidad proporcional
+ * a su peso.
+ */
+struct Production {
+    char predecessor{0};
+    int formalCount{0};
+    ParametricExpression condition;  ///< Vacia: siempre se cumple
+    float weight{1.0F};
+    ProductionSuccessor successor;
+    std::string source;  ///< Texto de la regla, para comparar derivaciones
+};
+
+/**
+ * @brief Tamano de una generacion calculado sin generarla (ver LSystem::predictGrowth()).
+ *
+ * Conteos en double: las generaciones profundas pasan de 2^64 simbolos mucho antes
+ * de que importe la precision, y con producciones estocasticas son valores esperados.
+ */
+struct GrowthPrediction {
+    int generation{0};
+    double symbols{0.0};     ///< Bytes de la cadena (simbolos y marcadores de parametros)
+    double parameters{0.0};  ///< Valores del buffer lateral de parametros
+    double branches{0.0};    ///< F, G, A y B: ramas antes de fusionar segmentos
+    double leaves{0.0};      ///< L y l
+    double flowers{0.0};     ///< K y k
+    /// false: valor esperado (estocastica), cota superior (condiciones) o una mezcla
+    bool exact{true};
+
+    /**
+     * @brief Bytes de la cadena y de su buffer de parametros.
+     */
+    double stringBytes() const {
+        return symbols + parameters * static_cast<double>(sizeof(float));
+    }
+};
+
+/**
+ * @class SymbolStream
+ * @brief Expansion perezosa (streaming) de la derivacion de un L-System.
+ *
+ * En lugar de materializar la cadena de la generacion n, recorre el arbol de
+ * derivacion en profundidad con una pila de marcos (regla, posicion, profundidad)
+ * y entrega los simbolos terminales uno por uno, en el mismo orden que tendria
+ * la cadena completa. La memoria crece con el numero de generaciones, no con la
+ * longitud de la cadena.
+ *
+ * @note El flujo apunta a las tablas de reglas del LSystem que lo creo; el
+ *       LSystem debe seguir vivo y sin modificar sus reglas mientras se consume.
+ * @note Con producciones estocasticas o parametricas recorre modulos (simbolo y
+ *       parametros) y elige cada reemplazo con el mismo generador por contador que
+ *       la reescritura, asi que entrega exactamente la cadena que generate() produce.
+ */
+class SymbolStream {
+public:
+    /*
+     * @brief Obtiene el siguiente simbolo de la derivacion.
+     * @param symbol Recibe el simbolo si hay uno disponible.
+     * @return true si se entrego un simbolo, false al terminar la derivacion.
+     */
+    bool next(char& symbol) {
+        int birth = 0;
+        return next(symbol, birth);
+    }
+
+    /*
+     * @brief Igual que next(char&), y ademas la generacion en que nacio el simbolo.
+     * @param birth Generacion de nacimiento: la de la reescritura que lo creo, salvo
+     *        la primera copia de si mismo en su reemplazo (p. ej. la primera F de
+     *        F->FF), que lo continua y conserva el nacimiento del simbolo expandido.
+     */
+    bool next(char& symbol, int& birth) {
+        if (owner != nullptr) {
+            const float* values = nullptr;
+            int count = 0;
+            return nextModule(symbol, birth, values, count);
+        }
+
+        while (!stack.empty()) {
+            Frame& top = stack.back();
+            if (top.position == top.length) {
+                stack.pop_back();
+                continue;
+            }
+
+            const uint32_t position = top.position++;
+            char current = top.rule[position];
+            auto index = static_cast<unsigned char>(current);
+            const int currentBirth = position == top.inherit ? top.inheritedBirth : top.generation;
+
+            // Sin reescrituras restantes o sin regla (identidad): simbolo terminal
+            if (top.depth == 0 || ruleOffset[index] < IDENTITY_SPAN) {
+                symbol = current;
+                birth = currentBirth;
+                emitted++;
+                return true;
+            }
+
+            stack.push_back({ruleData + ruleOffset[index], ruleLength[index], 0, top.depth - 1,
+                             top.generation + 1, ruleSelfIndex[index], currentBirth});
+        }
+        return false;
+    }
+
+    /*
+     * @brief Igual que next(char&, int&), y ademas los parametros del modulo.
+     * @param values Recibe los parametros; validos hasta la siguiente llamada.
+     * @param count Numero de parametros (0 si el modulo no lleva).
+     */
+    bool next(char& symbol, int& birth, const float*& values, int& count) {
+        if (owner != nullptr)
+            return nextModule(symbol, birth, values, count);
+        values = nullptr;
+        count = 0;
+        return next(symbol, birth);
+    }
+
+    /*
+     * @brief Indica si el flujo recorre producciones estocasticas o parametricas.
+     */
+    bool isExtended() const {
+        return owner != nullptr;
+    }
+
+    /*
+     * @brief Numero de simbolos (modulos) entregados hasta ahora.
+     */
+    size_t getEmittedCount() const {
+        return emitted;
+    }
+
+private:
+    friend class LSystem;
+
+    // Los primeros 256 bytes de la tabla de reglas son la identidad
+    static constexpr uint32_t IDENTITY_SPAN = 256;
+
+    struct Frame {
+        const char* rule;    // Cadena que se esta recorriendo (axioma o reemplazo)
+        uint32_t length;     // Longitud de esa cadena
+        uint32_t position;   // Siguiente simbolo a visitar
+        int depth;           // Reescrituras restantes para los simbolos de este marco
+        int generation;      // Generacion en que nacen los simbolos de este marco
+        uint32_t inherit;    // Posicion que continua al simbolo expandido (o NO_INHERIT)
+        int inheritedBirth;  // Nacimiento del simbolo expandido
+    };
+
+    static constexpr uint32_t NO_INHERIT = UINT32_MAX;
+
+    // Marco de la expansion extendida: recorre un reemplazo ya analizado y evalua
+    // sus argumentos con los parametros del modulo que lo produjo
+    struct ModuleFrame {
+        const ProductionSuccessor* successor;  // Reemplazo que se recorre (o el axioma)
+        uint32_t position;                     // Siguiente byte de successor->symbols
+        uint32_t argument;                     // Siguiente expresion de successor->arguments
+        int depth;
+        int generation;
+        uint32_t inherit;
+        int inheritedBirth;
+        float actuals[MAX_MODULE_PARAMETERS];  // Parametros del modulo expandido
+    };
+
+    SymbolStream(const std::string& axiom, int generations, const char* data,
+                 const uint32_t* offsets, const uint32_t* lengths, const uint32_t* selfIndices)
+        : ruleData(data), ruleOffset(offsets), ruleLength(lengths), ruleSelfIndex(selfIndices) {
+        stack.reserve(static_cast<size_t>(generations) + 1);
+        stack.push_back(
+            {axiom.data(), static_cast<uint32_t>(axiom.size()), 0, generations, 0, NO_INHERIT, 0});
+    }
+
+    SymbolStream(const LSystem& lsystem, const ProductionSuccessor& axiom, int generations);
+
+    /*
+     * @brief next() de la expansion extendida (producciones estocasticas o parametricas).
+     */
+    bool nextModule(char& symbol, int& birth, const float*& values, int& count);
+
+    const char* ruleData{nullptr};
+    const uint32_t* ruleOffset{nullptr};
+    const uint32_t* ruleLength{nullptr};
+    const uint32_t* ruleSelfIndex{nullptr};
+    std::vector<Frame> stack;
+    size_t emitted{0};
+
+    const LSystem* owner{nullptr};  // Solo en la expansion extendida
+    std::vector<ModuleFrame> modules;
+    std::vector<uint64_t> levelPositions;  // Bytes recorridos de la cadena de cada generacion
+    float moduleValues[MAX_MODULE_PARAMETERS]{};  // Parametros del ultimo modulo entregado
+};
 
 /**
  * @class LSystem
- * @brief Representa un Sistema de Lindenmayer deterministico y libre de contexto.
+ * @brief Representa un Sistema de Lindenmayer libre de contexto.
  *
  * Un L-System consta de:
  * - Alfabeto (V): conjunto de simbolos (variables y constantes)
@@ -33,15 +270,195 @@
  * La clase permite cargar reglas desde un archivo de texto y generar
  * la cadena resultante aplicando las reglas de forma paralela durante
  * 'n' iteraciones.
+ *
+ * Las producciones estocasticas eligen su reemplazo con un generador por
+ * contador: el numero aleatorio de un modulo depende solo de la semilla, la
+ * generacion y la posicion del modulo en la cadena, de modo que la reescritura
+ * serial, la multihilo (con cualquier numero de hilos) y el flujo perezoso
+ * producen la misma derivacion.
  */
 class LSystem {
 private:
-    std::string axiom;                  // Cadena inicial (omega)
+    friend class SymbolStream;
+
+    std::string axiom;                  // Cadena inicial (omega), tal como se escribio
     std::map<char, std::string> rules;  // Reglas de produccion (P)
     std::string currentString;          // Cadena actual (resultado)
+    std::string nextString;             // Buffer de reescritura (ping-pong con currentString)
+    std::vector<float> currentParameters;  // Parametros de los modulos de currentString
+    std::vector<float> nextParameters;     // Buffer de reescritura de currentParameters
+    PackedString currentPacked;  // Cadena actual cuando isPacked() (currentString queda vacia)
+    PackedString nextPacked;     // Buffer de reescritura de currentPacked
     float angle;                        // Angulo de rotacion (delta) en grados
     int currentGeneration;              // Numero de generacion actual
 
+    // Tabla plana de reescritura: para cada uno de los 256 simbolos posibles,
+    // desplazamiento y longitud de su reemplazo dentro de ruleData. Los simbolos
+    // sin regla apuntan a si mismos (identidad), asi la reescritura no ramifica.
+    std::string ruleData;
+    std::array<uint32_t, 256> ruleOffset{};
+    std::array<uint32_t, 256> ruleLength{};
+    std::array<uint32_t, 256> ruleSelfIndex{};  // Primera aparicion del simbolo en su reemplazo
+    bool ruleTableDirty;  // true si las reglas cambiaron desde la ultima construccion
+
+    // Reglas en codigos de 4 bits (ver PackedString). Solo existen si se pidio una
+    // cadena empaquetada, la derivacion no es extendida y el alfabeto cabe.
+    struct PackedRule {
+        std::vector<uint64_t> words;  // Codigos del reemplazo, 16 por palabra
+        uint32_t length{1};
+        std::vector<std::pair<uint8_t, uint32_t>> runs;  // El reemplazo en rachas
+    };
+    SymbolPacking packing;     // Representacion pedida para la cadena
+    std::string packAlphabet;  // Simbolo de cada codigo (vacio: sin empaquetar)
+    std::array<PackedRule, PackedString::MAX_SYMBOLS> packedRules;
+    std::array<uint32_t, 256> packedPairLength{};  // Longitud de reemplazo de cada byte (2 codigos)
+    bool stringPacked;  // La derivacion actual vive en currentPacked
+
+    // Producciones estocasticas y parametricas. Mientras haya alguna (o el axioma
+    // tenga parametros) la reescritura usa productionTable: estas producciones mas
+    // las reglas simples convertidas, ordenadas por predecesor.
+    ProductionSuccessor axiomModules;  // Axioma analizado, con argumentos constantes
+    std::vector<Production> productions;
+    std::vector<Production> productionTable;
+    std::array<uint32_t, 256> productionBegin{};  // Rango [begin, end) de cada predecesor
+    std::array<uint32_t, 256> productionEnd{};
+    uint64_t seed;                        // Semilla de las producciones estocasticas
+    std::string axiomError;               // Error al analizar el axioma (vacio si no hubo)
+    std::vector<std::string> ruleErrors;  // Reglas descartadas por errores de sintaxis
+
+    // Generaciones ya calculadas de la derivacion actual (aparte de currentString).
+    // La mas profunda se conserva siempre; las anteriores se descartan por LRU.
+    struct CachedGeneration {
+        int generation;
+        std::string symbols;
+        std::vector<float> parameters;
+        PackedString packed;  // En lugar de 'symbols' cuando la derivacion esta empaquetada
+        uint64_t lastUse;     // Valor de cacheClock al guardarla
+    };
+    std::vector<CachedGeneration> generationCache;
+    size_t generationCacheSize;  // Generaciones anteriores a conservar
+    uint64_t cacheClock;         // Orden LRU de generationCache
+    bool derivationDirty;        // Axioma o reglas cambiaron: lo calculado ya no vale
+
+    bool parallelEnabled;               // Reescritura multihilo habilitada
+    unsigned threadCount;               // Hilos a usar (0 = hardware_concurrency)
+    std::vector<size_t> chunkOffsets;   // Desplazamientos de salida por bloque (prefix sum)
+    std::vector<size_t> chunkParameterOffsets;  // Igual, para el buffer de parametros
+    std::vector<size_t> chunkInputParameters;   // Parametros de entrada antes de cada bloque
+
+    // Por debajo de este tamano la reescritura serial es mas rapida que lanzar hilos
+    static constexpr size_t PARALLEL_MIN_SYMBOLS = size_t{1} << 16;
+
+    /*
+     * @brief Reconstruye la tabla plana de reescritura a partir de 'rules'.
+     */
+    void buildRuleTable();
+
+    /*
+     * @brief Aplica una generacion de reescritura de currentString a nextString.
+     * @note Calcula primero la longitud exacta de salida, redimensiona una sola
+     *       vez y escribe los reemplazos directamente; luego intercambia buffers.
+     */
+    void rewriteOnce();
+
+    /*
+     * @brief Variante multihilo de rewriteOnce().
+     * @param threads Numero de hilos (bloques) a usar.
+     * @note Cada hilo cuenta la salida de su bloque, se calcula el prefix sum de
+     *       los desplazamientos y cada hilo escribe su bloque directamente en el
+     *       buffer compartido. El resultado es identico byte a byte al serial.
+     */
+    void rewriteParallel(unsigned threads);
+
+    /*
+     * @brief Reescritura con producciones estocasticas o parametricas.
+     * @param threads Numero de bloques; 1 reescribe en el hilo actual.
+     * @note Como rewriteParallel(), con una pasada previa que cuenta los parametros
+     *       de entrada de cada bloque; los bordes de bloque nunca separan un
+     *       simbolo de su marcador.
+     */
+    void rewriteExtended(unsigned threads);
+
+    /*
+     * @brief Reescritura de la cadena empaquetada, sin desempaquetarla.
+     * @param threads Numero de bloques; solo la cadena sin rachas se reparte.
+     * @note Sin rachas: como rewriteParallel(), leyendo dos codigos por byte y
+     *       escribiendo 16 por palabra. Con rachas la salida se comprime al
+     *       escribirla, asi que va en serie: una racha cuyo reemplazo es un solo
+     *       simbolo repetido (F->FF) se reescribe en una sola racha.
+     */
+    void rewritePacked(unsigned threads);
+
+    /*
+     * @brief Construye packAlphabet, packedRules y packedPairLength.
+     */
+    void buildPackedRules();
+
+    /*
+     * @brief Reconstruye productionTable y los rangos por predecesor.
+     */
+    void buildProductionTable();
+
+    /*
+     * @brief Elige la produccion que reescribe un modulo.
+     * @param symbol Simbolo del modulo.
+     * @param values Parametros del modulo.
+     * @param count Numero de parametros.
+     * @param generation Generacion de la cadena que contiene al modulo.
+     * @param position Posicion (en bytes) del modulo en esa cadena.
+     * @return La produccion elegida, o nullptr si ninguna se aplica (identidad).
+     */
+    const Production* chooseSuccessor(char symbol, const float* values, int count, int generation,
+                                      uint64_t position) const;
+
+    /*
+     * @brief Analiza una linea "predecesor -> reemplazo" y la agrega como regla.
+     * @return false si la linea tenia "->" pero no es valida (se registra el error).
+     */
+    bool addRuleLine(const std::string& line);
+
+    /*
+     * @brief Vuelve currentString (y sus parametros) al axioma; elige la representacion.
+     */
+    void resetToAxiom();
+
+    /*
+     * @brief Simbolos y parametros de salida de los modulos en [begin, end) de currentString.
+     * @param parameter Indice en currentParameters del primer parametro del rango.
+     */
+    void measureModules(size_t begin, size_t end, size_t parameter, size_t& symbols,
+                        size_t& parameters) const;
+
+    /*
+     * @brief Escribe la expansion de los modulos en [begin, end) de currentString.
+     */
+    void expandModules(size_t begin, size_t end, size_t parameter, char* out,
+                       float* outParameters) const;
+
+    /*
+     * @brief Guarda una generacion en la cache y descarta las menos usadas.
+     * @note Se llama con currentGeneration ya actualizado: la mas profunda solo
+     *       queda fija si es mas profunda que la actual.
+     */
+    void storeGeneration(int generation, std::string&& symbols, std::vector<float>&& parameters,
+                         PackedString&& packed);
+    void trimGenerationCache();
+
+    /*
+     * @brief Invalida la derivacion calculada (axioma o reglas nuevos).
+     */
+    void invalidateDerivation();
+
+    /*
+     * @brief Longitud de la expansion de los simbolos en [begin, end).
+     */
+    size_t expandedLength(const char* begin, const char* end) const;
+
+    /*
+     * @brief Escribe la expansion de los simbolos en [begin, end) a partir de out.
+     */
+    void expandRange(const char* begin, const char* end, char* out) const;
+
 public:
     /*
      * @brief Constructor por defecto.
@@ -54,6 +471,11 @@ public:
      */
     ~LSystem();
 
+    LSystem(const LSystem&) = default;
+    LSystem& operator=(const LSystem&) = default;
+    LSystem(LSystem&&) = default;
+    LSystem& operator=(LSystem&&) = default;
+
     /*
      * @brief Carga las reglas de produccion desde un archivo de texto.
      * @param filename Ruta del archivo que contiene el axioma, angulo y reglas.
@@ -61,11 +483,14 @@ public:
      * @note Formato esperado del archivo:
      *       axiom: [cadena]
      *       angle: [valor]
+     *       seed: [entero] (opcional)
      *       [simbolo]->[cadena_reemplazo]
      *       Ejemplo:
      *       axiom: F++F++F
      *       angle: 60
      *       F->F-F++F-F
+     * @note Las reglas admiten la sintaxis de addRulesFromString(); las invalidas
+     *       se descartan y quedan en getRuleErrors().
      */
     bool loadRules(const char* filename);
 
@@ -73,18 +498,106 @@ public:
      * @brief Aplica las reglas de produccion para generar la cadena final.
      * @pre La instancia debe tener un axioma y reglas cargadas.
      * @param generations Numero de iteraciones 'n' a aplicar.
-     * @return void. La cadena resultante se almacena en currentString.
+     * @param progress Callback opcional, invocado antes de cada generacion.
+     * @return true si se completo, false si el callback cancelo la generacion.
+     *         La cadena resultante se almacena en currentString.
      * @note Utiliza reescritura paralela: todas las reglas se aplican
      *       simultaneamente en cada generacion, simulando crecimiento
      *       biologico donde todas las celulas se dividen al mismo tiempo.
+     * @note Es incremental: parte de la generacion actual o de la mas cercana
+     *       guardada en cache (ver setGenerationCacheSize()), asi que subir una
+     *       generacion cuesta una sola reescritura y bajar suele no costar ninguna.
+     */
+    bool generate(int generations, const ProgressCallback& progress = nullptr);
+
+    /*
+     * @brief Numero de generaciones anteriores que se conservan para volver a ellas.
+     * @param count Generaciones en la cache LRU; 0 solo conserva la mas profunda.
+     * @note La generacion mas profunda calculada se conserva siempre.
+     */
+    void setGenerationCacheSize(size_t count);
+
+    /*
+     * @brief Generaciones guardadas en cache (sin contar la actual).
      */
-    void generate(int generations);
+    size_t getCachedGenerationCount() const;
+
+    /*
+     * @brief Habilita o deshabilita la reescritura multihilo.
+     * @param enable true para reescribir en paralelo cadenas grandes.
+     * @param threads Numero de hilos; 0 usa std::thread::hardware_concurrency().
+     */
+    void setParallel(bool enable, unsigned threads = 0);
+
+    /*
+     * @brief Indica si la reescritura multihilo esta habilitada.
+     */
+    bool isParallel() const;
+
+    /*
+     * @brief Predice el tamano de las generaciones 0..generations sin generarlas.
+     * @return generations + 1 predicciones, la i-esima de la generacion i.
+     * @note Usa la matriz de crecimiento (vectores de Parikh) sobre los modulos
+     *       (simbolo, numero de parametros): cada generacion es el vector anterior
+     *       por la matriz, O(modulos^2) por generacion. En un D0L es exacto. Con
+     *       varias producciones estocasticas para un modulo da el valor esperado
+     *       segun sus pesos. Si alguna tiene condicion, cada modulo cuenta el
+     *       maximo de cada simbolo entre todos sus reemplazos y el propio modulo
+     *       (ninguna condicion se cumple): una cota superior de cada generacion
+     *       (ver GrowthPrediction::exact).
+     */
+    std::vector<GrowthPrediction> predictGrowth(int generations) const;
+
+    /*
+     * @brief Crea un flujo perezoso de los simbolos de la generacion indicada.
+     * @param generations Numero de iteraciones 'n' a expandir.
+     * @return Flujo que recorre la derivacion sin materializar la cadena.
+     * @note No modifica currentString; util para generaciones muy profundas.
+     */
+    SymbolStream stream(int generations);
+
+    /*
+     * @brief Elige la representacion de la cadena.
+     * @note Con otra representacion la derivacion calculada se descarta. Las
+     *       derivaciones extendidas y los alfabetos de mas de 15 simbolos siguen
+     *       en un byte por simbolo (ver isPacked()).
+     */
+    void setPacking(SymbolPacking newPacking);
+    SymbolPacking getPacking() const;
+
+    /*
+     * @brief Indica si la cadena actual esta empaquetada (getPackedString()).
+     * @note En ese caso getString() esta vacia.
+     */
+    bool isPacked() const;
+
+    /*
+     * @brief Cadena actual empaquetada; vacia si no isPacked().
+     */
+    const PackedString& getPackedString() const;
+
+    /*
+     * @brief Numero de simbolos de la cadena actual, en cualquier representacion.
+     */
+    size_t getLength() const;
 
     /*
      * @brief Obtiene la cadena generada actual.
-     * @return La cadena del L-System despues de aplicar las reglas.
+     * @return Referencia a la cadena del L-System despues de aplicar las reglas.
+     */
+    const std::string& getString() const;
+
+    /*
+     * @brief Parametros de los modulos de getString(), en el orden de sus marcadores.
+     * @return Vacio si la cadena no tiene modulos parametricos.
      */
-    std::string getString() const;
+    const std::vector<float>& getParameters() const;
+
+    /*
+     * @brief Memoria reservada por las cadenas: actual, buffer de reescritura y cache.
+     * @return Bytes de capacidad (no de longitud).
+     */
+    size_t getStringBytes() const;
 
     /*
      * @brief Obtiene el angulo de rotacion configurado.
@@ -98,6 +611,50 @@ public:
      */
     std::string getAxiom() const;
 
+    /*
+     * @brief Obtiene las reglas de produccion.
+     * @return Mapa de simbolo a cadena de reemplazo.
+     */
+    const std::map<char, std::string>& getRules() const;
+
+    /*
+     * @brief Producciones estocasticas y parametricas (sin las reglas simples).
+     */
+    const std::vector<Production>& getProductions() const;
+
+    /*
+     * @brief Indica si la derivacion usa producciones estocasticas o parametricas.
+     * @note Las cadenas de estos sistemas pueden llevar marcadores de parametros
+     *       (ver isParameterMarker()).
+     */
+    bool isExtended() const;
+
+    /*
+     * @brief Indica si otro LSystem produce la misma derivacion (axioma, reglas y semilla).
+     */
+    bool hasSameDerivation(const LSystem& other) const;
+
+    /*
+     * @brief Cambia la semilla de las producciones estocasticas.
+     * @note Con otra semilla la derivacion calculada se descarta.
+     */
+    void setSeed(uint64_t newSeed);
+
+    /*
+     * @brief Obtiene la semilla de las producciones estocasticas.
+     */
+    uint64_t getSeed() const;
+
+    /*
+     * @brief Error del ultimo axioma analizado (vacio si es valido).
+     */
+    const std::string& getAxiomError() const;
+
+    /*
+     * @brief Reglas descartadas desde el ultimo clearRules(), con el motivo.
+     */
+    const std::vector<std::string>& getRuleErrors() const;
+
     /*
      * @brief Obtiene el numero de generacion actual.
      * @return Numero de iteraciones aplicadas.
@@ -106,12 +663,13 @@ public:
 
     /*
      * @brief Reinicia el L-System al axioma inicial.
+     * @note La generacion que se deja queda en cache.
      */
     void reset();
 
     /*
      * @brief Establece el axioma directamente.
-     * @param newAxiom Nuevo axioma.
+     * @param newAxiom Nuevo axioma; admite modulos con argumentos constantes, p. ej. X(1,0.5).
      */
     void setAxiom(const std::string& newAxiom);
 
@@ -128,6 +686,19 @@ public:
      */
     void addRule(char symbol, const std::string& replacement);
 
+    /*
+     * @brief Agrega reglas de produccion desde texto.
+     * @param text Reglas separadas por salto de linea o coma (las comas entre
+     *        parentesis separan argumentos). Formato de cada regla:
+     *        X->reemplazo                  regla simple
+     *        X-(0.3)->reemplazo            estocastica, con peso 0.3
+     *        X(l,w) : l > 1 -> F(l)X(l/2,w) parametrica con condicion opcional
+     *        Peso y condicion se combinan: X(l) : l > 1 -(0.5)-> ...
+     * @note Las lineas sin "->" se ignoran; las invalidas se descartan y quedan en
+     *       getRuleErrors(). Los pesos de un mismo predecesor se normalizan.
+     */
+    void addRulesFromString(const std::string& text);
+
     /*
      * @brief Limpia todas las reglas de produccion.
      */
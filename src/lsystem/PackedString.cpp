@@ -0,0 +1,149 @@
+/**
+ * @file PackedString.cpp
+ * @brief Implementacion de la cadena empaquetada en codigos de 4 bits.
+ *
+ * @author Julian Parra
+ * @date 2025
+ * @course Graficacion
+ * @project Proyecto Final - "Arboles: La Belleza Algoritmica de las Plantas"
+ */
+
+#include "PackedString.h"
+
+#include <array>
+#include <functional>
+#include <string_view>
+#include <utility>
+
+// =============================================================================
+// Escritor
+// =============================================================================
+
+PackedString::Writer::Writer(PackedString& target) : m_target(target) {
+    m_target.m_data.clear();
+    m_target.m_nibbles = 0;
+    m_target.m_length = 0;
+}
+
+void PackedString::Writer::store() {
+    // El orden little-endian del registro es el orden de nibbles de la cadena
+    std::vector<uint8_t>& data = m_target.m_data;
+    const size_t bytes = static_cast<size_t>(m_fill + 1) / 2;
+    const size_t offset = data.size();
+    data.resize(offset + bytes);
+    for (size_t i = 0; i < bytes; ++i) {
+        data[offset + i] = static_cast<uint8_t>(m_bits >> (8 * i));
+    }
+    m_target.m_nibbles += static_cast<size_t>(m_fill);
+    m_bits = 0;
+    m_fill = 0;
+}
+
+void PackedString::Writer::flushRun() {
+    if (m_runLength == 0)
+        return;
+
+    if (m_runLength < MIN_RUN) {
+        for (size_t i = 0; i < m_runLength; ++i) {
+            emit(m_runCode);
+        }
+    } else {
+        emit(RUN_CODE);
+        emit(m_runCode);
+        size_t extra = m_runLength - MIN_RUN;
+        do {
+            const auto group = static_cast<uint8_t>(extra & 7U);
+            extra >>= 3;
+            emit(extra != 0 ? static_cast<uint8_t>(group | 8U) : group);
+        } while (extra != 0);
+    }
+    m_target.m_length += m_runLength;
+    m_runLength = 0;
+}
+
+void PackedString::Writer::finish() {
+    flushRun();
+    m_runCode = RUN_CODE;
+    if (m_fill > 0) {
+        store();
+    }
+
+    // Crecer puede dejar reservado hasta el doble del tamano: lo que importa es la memoria
+    std::vector<uint8_t>& data = m_target.m_data;
+    if (data.capacity() - data.size() > data.size() / 8) {
+        data.shrink_to_fit();
+    }
+}
+
+// =============================================================================
+// PackedString
+// =============================================================================
+
+void PackedString::reset(const std::string& alphabet, bool runs) {
+    m_data.clear();
+    m_nibbles = 0;
+    m_length = 0;
+    m_alphabet = alphabet;
+    m_runs = runs;
+}
+
+bool PackedString::assign(const std::string& text) {
+    std::array<uint8_t, 256> codeOf;
+    codeOf.fill(RUN_CODE);
+    for (size_t code = 0; code < m_alphabet.size(); ++code) {
+        codeOf[static_cast<unsigned char>(m_alphabet[code])] = static_cast<uint8_t>(code);
+    }
+
+    Writer writer(*this);
+    for (char c : text) {
+        const uint8_t code = codeOf[static_cast<unsigned char>(c)];
+        if (code == RUN_CODE) {
+            clear();
+            return false;
+        }
+        writer.put(code);
+    }
+    writer.finish();
+    return true;
+}
+
+std::string PackedString::unpack() const {
+    std::string text;
+    text.reserve(m_length);
+    Reader reader(*this);
+    uint8_t code = 0;
+    size_t count = 0;
+    while (reader.next(code, count)) {
+        text.append(count, m_alphabet[code]);
+    }
+    return text;
+}
+
+void PackedString::clear() {
+    std::vector<uint8_t>().swap(m_data);
+    m_nibbles = 0;
+    m_length = 0;
+}
+
+void PackedString::swap(PackedString& other) noexcept {
+    m_data.swap(other.m_data);
+    std::swap(m_nibbles, other.m_nibbles);
+    std::swap(m_length, other.m_length);
+    m_alphabet.swap(other.m_alphabet);
+    std::swap(m_runs, other.m_runs);
+}
+
+size_t PackedString::hash() const {
+    const std::string_view bytes(reinterpret_cast<const char*>(m_data.data()),
+                                 (m_nibbles + 1) / 2);
+    size_t value = std::hash<std::string_view>{}(bytes);
+    value ^= std::hash<std::string>{}(m_alphabet) + 0x9E3779B97F4A7C15ULL + (value << 6);
+    return m_runs ? ~value : value;
+}
+
+void PackedString::resizeLiteral(size_t length) {
+    m_data.assign((length + 1) / 2, 0);
+    m_nibbles = length;
+    m_length = length;
+    m_runs = false;
+}
@@ -0,0 +1,245 @@
+/**
+ * @file PackedString.h
+ * @brief Cadena de L-System empaquetada: codigos de 4 bits y rachas opcionales.
+ *
+ * Casi todos los presets usan menos de 16 simbolos distintos, asi que cada simbolo
+ * cabe en medio byte: la cadena ocupa la mitad que con un byte por simbolo. Sobre
+ * los codigos hay una capa opcional de rachas: cuatro o mas simbolos iguales
+ * seguidos (p. ej. las F de F->FF) se guardan como un codigo de escape, el codigo
+ * del simbolo y la longitud de la racha.
+ *
+ * LSystem reescribe estas cadenas y TurtleGraphics las compila sin desempaquetarlas.
+ *
+ * Formato (medios bytes, el bajo primero):
+ * @code
+ *   c                  simbolo alphabet[c], c < RUN_CODE
+ *   RUN_CODE c n0 ..   racha de alphabet[c]; longitud - MIN_RUN en grupos de 3 bits,
+ *                      el menos significativo primero, bit 3 = siguen mas grupos
+ * @endcode
+ *
+ * @author Julian Parra
+ * @date 2025
+ * @course Graficacion
+ * @project Proyecto Final - "Arboles: La Belleza Algoritmica de las Plantas"
+ */
+
+#ifndef PACKED_STRING_H
+#define PACKED_STRING_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Representacion de la cadena de un LSystem.
+ * @note Mismo orden que el combo "Cadena" de la interfaz.
+ */
+enum class SymbolPacking : uint8_t {
+    None = 0,     ///< Un byte por simbolo (std::string)
+    Nibbles = 1,  ///< Codigos de 4 bits
+    Runs = 2      ///< Codigos de 4 bits con rachas
+};
+
+/**
+ * @class PackedString
+ * @brief Secuencia de codigos de 4 bits sobre un alfabeto de hasta 15 simbolos.
+ */
+class PackedString {
+public:
+    static constexpr size_t MAX_SYMBOLS = 15;  ///< El codigo 15 es el escape de racha
+    static constexpr uint8_t RUN_CODE = 15;
+    static constexpr size_t MIN_RUN = 4;  ///< Rachas mas cortas se escriben literales
+
+    /**
+     * @class Reader
+     * @brief Recorre una cadena empaquetada racha por racha.
+     */
+    class Reader {
+    public:
+        explicit Reader(const PackedString& packed) : m_packed(packed) {}
+
+        /**
+         * @brief Siguiente racha: 'count' copias del simbolo de codigo 'code'.
+         * @return false al terminar la cadena.
+         * @note Sin rachas en la cadena, count siempre es 1.
+         */
+        bool next(uint8_t& code, size_t& count) {
+            if (m_position >= m_packed.m_nibbles)
+                return false;
+            code = m_packed.nibble(m_position++);
+            count = 1;
+            if (code == RUN_CODE) {
+                code = m_packed.nibble(m_position++);
+                size_t extra = 0;
+                int shift = 0;
+                uint8_t group = 0;
+                do {
+                    group = m_packed.nibble(m_position++);
+                    extra |= static_cast<size_t>(group & 7U) << shift;
+                    shift += 3;
+                } while ((group & 8U) != 0);
+                count = extra + MIN_RUN;
+            }
+            return true;
+        }
+
+        /**
+         * @brief Medios bytes leidos hasta ahora.
+         */
+        size_t getPosition() const {
+            return m_position;
+        }
+
+    private:
+        const PackedString& m_packed;
+        size_t m_position{0};
+    };
+
+    /**
+     * @class Writer
+     * @brief Escribe una cadena empaquetada desde el principio, agrupando rachas.
+     *
+     * Vacia el destino (conservando su alfabeto, su modo de rachas y su capacidad)
+     * y escribe 16 codigos a la vez; la cadena queda completa al llamar a finish().
+     */
+    class Writer {
+    public:
+        explicit Writer(PackedString& target);
+
+        /**
+         * @brief Agrega 'count' copias del simbolo de codigo 'code'.
+         */
+        void put(uint8_t code, size_t count = 1) {
+            if (!m_target.m_runs) {
+                for (size_t i = 0; i < count; ++i) {
+                    emit(code);
+                }
+                m_target.m_length += count;
+                return;
+            }
+            if (code != m_runCode) {
+                flushRun();
+                m_runCode = code;
+            }
+            m_runLength += count;
+        }
+
+        /**
+         * @brief Escribe lo pendiente y fija el tamano de la cadena.
+         */
+        void finish();
+
+    private:
+        void emit(uint8_t code) {
+            m_bits |= static_cast<uint64_t>(code) << (4 * m_fill);
+            if (++m_fill == 16) {
+                store();
+            }
+        }
+        void store();
+        void flushRun();
+
+        PackedString& m_target;
+        uint64_t m_bits{0};  ///< Codigos pendientes, el primero en los 4 bits bajos
+        int m_fill{0};       ///< Codigos en m_bits
+        uint8_t m_runCode{RUN_CODE};  ///< Racha abierta (RUN_CODE: ninguna)
+        size_t m_runLength{0};
+    };
+
+    PackedString() = default;
+
+    /**
+     * @brief Vacia la cadena y fija su alfabeto y el modo de rachas.
+     * @param alphabet Simbolos distintos, a lo sumo MAX_SYMBOLS; el i-esimo tiene codigo i.
+     */
+    void reset(const std::string& alphabet, bool runs);
+
+    /**
+     * @brief Empaqueta 'text' con el alfabeto y el modo actuales.
+     * @return false (y la cadena queda vacia) si 'text' usa un simbolo fuera del alfabeto.
+     */
+    bool assign(const std::string& text);
+
+    /**
+     * @brief Cadena de un byte por simbolo equivalente.
+     */
+    std::string unpack() const;
+
+    /**
+     * @brief Libera la memoria de los codigos (el alfabeto se conserva).
+     */
+    void clear();
+
+    void swap(PackedString& other) noexcept;
+
+    /**
+     * @brief Numero de simbolos (cada racha cuenta su longitud).
+     */
+    size_t size() const {
+        return m_length;
+    }
+    bool empty() const {
+        return m_length == 0;
+    }
+
+    /**
+     * @brief Medios bytes ocupados, incluidos escapes y longitudes de racha.
+     */
+    size_t getNibbleCount() const {
+        return m_nibbles;
+    }
+
+    /**
+     * @brief Bytes reservados por los codigos.
+     */
+    size_t getBytes() const {
+        return m_data.capacity();
+    }
+
+    bool hasRuns() const {
+        return m_runs;
+    }
+    const std::string& getAlphabet() const {
+        return m_alphabet;
+    }
+    char symbolOf(uint8_t code) const {
+        return m_alphabet[code];
+    }
+
+    /**
+     * @brief Hash de los codigos, el alfabeto y el modo (para reconocer una cadena ya vista).
+     */
+    size_t hash() const;
+
+    uint8_t nibble(size_t index) const {
+        return static_cast<uint8_t>((m_data[index >> 1] >> ((index & 1U) * 4)) & 0xFU);
+    }
+
+    /**
+     * @brief Codigos en crudo, dos por byte (el primero en los 4 bits bajos).
+     *
+     * Para escritores que conocen el tamano de salida de antemano (reescritura
+     * multihilo): resizeLiteral() dimensiona la cadena y ellos llenan data().
+     */
+    const uint8_t* data() const {
+        return m_data.data();
+    }
+    uint8_t* data() {
+        return m_data.data();
+    }
+
+    /**
+     * @brief Dimensiona una cadena sin rachas a 'length' simbolos en cero.
+     */
+    void resizeLiteral(size_t length);
+
+private:
+    std::vector<uint8_t> m_data;
+    size_t m_nibbles{0};
+    size_t m_length{0};
+    std::string m_alphabet;
+    bool m_runs{false};
+};
+
+#endif  // PACKED_STRING_H
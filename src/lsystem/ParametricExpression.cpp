@@ -0,0 +1,330 @@
+/**
+ * @file ParametricExpression.cpp
+ * @brief Compilador (descenso recursivo) y evaluador de expresiones parametricas.
+ *
+ * @author Julian Parra
+ * @date 2025
+ * @course Graficacion
+ * @project Proyecto Final - "Arboles: La Belleza Algoritmica de las Plantas"
+ */
+
+#include "ParametricExpression.h"
+
+#include <cctype>
+#include <cmath>
+#include <cstdlib>
+
+/*
+ * @brief Analizador de una expresion; emite las operaciones en orden postfijo.
+ *
+ * Precedencia, de menor a mayor: || && comparaciones + - * / unarios ^
+ * (la potencia asocia a la derecha).
+ */
+struct ParametricExpression::Parser {
+    const std::string& text;
+    const std::vector<std::string>& formals;
+    std::vector<Op>& ops;
+    std::string& error;
+    size_t pos{0};
+
+    void skipSpaces() {
+        while (pos < text.size() && std::isspace(static_cast<unsigned char>(text[pos])) != 0) {
+            pos++;
+        }
+    }
+
+    // Consume 'token' si es el siguiente
+    bool accept(const char* token) {
+        skipSpaces();
+        size_t length = 0;
+        while (token[length] != '\0') {
+            if (pos + length >= text.size() || text[pos + length] != token[length])
+                return false;
+            length++;
+        }
+        pos += length;
+        return true;
+    }
+
+    bool fail(const std::string& message) {
+        if (error.empty()) {
+            error = message;
+        }
+        return false;
+    }
+
+    void emit(OpCode code) {
+        ops.push_back({code, 0, 0.0F});
+    }
+
+    bool parseOr() {
+        if (!parseAnd())
+            return false;
+        while (accept("||")) {
+            if (!parseAnd())
+                return false;
+            emit(OpCode::Or);
+        }
+        return true;
+    }
+
+    bool parseAnd() {
+        if (!parseComparison())
+            return false;
+        while (accept("&&")) {
+            if (!parseComparison())
+                return false;
+            emit(OpCode::And);
+        }
+        return true;
+    }
+
+    bool parseComparison() {
+        if (!parseSum())
+            return false;
+
+        // Operadores de dos caracteres primero para que "<=" no se lea como "<"
+        OpCode code;
+        if (accept("<=")) {
+            code = OpCode::LessEqual;
+        } else if (accept(">=")) {
+            code = OpCode::GreaterEqual;
+        } else if (accept("==")) {
+            code = OpCode::Equal;
+        } else if (accept("!=")) {
+            code = OpCode::NotEqual;
+        } else if (accept("<")) {
+            code = OpCode::Less;
+        } else if (accept(">")) {
+            code = OpCode::Greater;
+        } else if (accept("=")) {
+            code = OpCode::Equal;
+        } else {
+            return true;
+        }
+
+        if (!parseSum())
+            return false;
+        emit(code);
+        return true;
+    }
+
+    bool parseSum() {
+        if (!parseProduct())
+            return false;
+        for (;;) {
+            OpCode code;
+            if (accept("+")) {
+                code = OpCode::Add;
+            } else if (accept("-")) {
+                code = OpCode::Subtract;
+            } else {
+                return true;
+            }
+            if (!parseProduct())
+                return false;
+            emit(code);
+        }
+    }
+
+    bool parseProduct() {
+        if (!parseUnary())
+            return false;
+        for (;;) {
+            OpCode code;
+            if (accept("*")) {
+                code = OpCode::Multiply;
+            } else if (accept("/")) {
+                code = OpCode::Divide;
+            } else {
+                return true;
+            }
+            if (!parseUnary())
+                return false;
+            emit(code);
+        }
+    }
+
+    bool parseUnary() {
+        if (accept("-")) {
+            if (!parseUnary())
+                return false;
+            emit(OpCode::Negate);
+            return true;
+        }
+        // "!=" nunca inicia un operando, asi que un '!' suelto aqui es una negacion
+        if (accept("!")) {
+            if (!parseUnary())
+                return false;
+            emit(OpCode::Not);
+            return true;
+        }
+        return parsePower();
+    }
+
+    bool parsePower() {
+        if (!parsePrimary())
+            return false;
+        if (accept("^")) {
+            if (!parseUnary())
+                return false;
+            emit(OpCode::Power);
+        }
+        return true;
+    }
+
+    bool parsePrimary() {
+        skipSpaces();
+        if (pos >= text.size())
+            return fail("falta un operando");
+
+        if (accept("(")) {
+            if (!parseOr())
+                return false;
+            if (!accept(")"))
+                return fail("falta ')'");
+            return true;
+        }
+
+        const char* begin = text.c_str() + pos;
+        const auto first = static_cast<unsigned char>(text[pos]);
+        if (std::isdigit(first) != 0 || first == '.') {
+            char* end = nullptr;
+            float value = std::strtof(begin, &end);
+            if (end == begin)
+                return fail("numero invalido");
+            pos += static_cast<size_t>(end - begin);
+            ops.push_back({OpCode::Constant, 0, value});
+            return true;
+        }
+
+        if (std::isalpha(first) != 0 || first == '_') {
+            size_t end = pos;
+            while (end < text.size() && (std::isalnum(static_cast<unsigned char>(text[end])) != 0 ||
+                                         text[end] == '_')) {
+                end++;
+            }
+            const std::string name = text.substr(pos, end - pos);
+            pos = end;
+            for (size_t i = 0; i < formals.size(); ++i) {
+                if (formals[i] == name) {
+                    ops.push_back({OpCode::Parameter, static_cast<uint8_t>(i), 0.0F});
+                    return true;
+                }
+            }
+            return fail("parametro desconocido '" + name + "'");
+        }
+
+        return fail(std::string("caracter inesperado '") + text[pos] + "'");
+    }
+};
+
+ParametricExpression ParametricExpression::constant(float value) {
+    ParametricExpression expression;
+    expression.m_ops.push_back({OpCode::Constant, 0, value});
+    return expression;
+}
+
+bool ParametricExpression::compile(const std::string& text, const std::vector<std::string>& formals,
+                                   std::string& error) {
+    m_ops.clear();
+    error.clear();
+
+    Parser parser{text, formals, m_ops, error};
+    bool ok = parser.parseOr();
+    parser.skipSpaces();
+    if (ok && parser.pos != text.size()) {
+        ok = parser.fail(std::string("caracter inesperado '") + text[parser.pos] + "'");
+    }
+
+    // Simular la pila para que evaluate() pueda usar un arreglo de tamano fijo
+    int depth = 0;
+    for (const Op& op : m_ops) {
+        if (op.code == OpCode::Constant || op.code == OpCode::Parameter) {
+            depth++;
+        } else if (op.code != OpCode::Negate && op.code != OpCode::Not) {
+            depth--;
+        }
+        if (depth > MAX_STACK_DEPTH) {
+            ok = parser.fail("expresion demasiado anidada");
+            break;
+        }
+    }
+
+    if (!ok) {
+        m_ops.clear();
+    }
+    return ok;
+}
+
+float ParametricExpression::evaluate(const float* values) const {
+    float stack[MAX_STACK_DEPTH];
+    int top = -1;
+
+    for (const Op& op : m_ops) {
+        switch (op.code) {
+            case OpCode::Constant:
+                stack[++top] = op.value;
+                break;
+            case OpCode::Parameter:
+                stack[++top] = values[op.index];
+                break;
+            case OpCode::Negate:
+                stack[top] = -stack[top];
+                break;
+            case OpCode::Not:
+                stack[top] = stack[top] == 0.0F ? 1.0F : 0.0F;
+                break;
+            default: {
+                // Operadores binarios: sacar b, reemplazar a por (a op b)
+                const float b = stack[top--];
+                float& a = stack[top];
+                switch (op.code) {
+                    case OpCode::Add:
+                        a += b;
+                        break;
+                    case OpCode::Subtract:
+                        a -= b;
+                        break;
+                    case OpCode::Multiply:
+                        a *= b;
+                        break;
+                    case OpCode::Divide:
+                        a /= b;
+                        break;
+                    case OpCode::Power:
+                        a = std::pow(a, b);
+                        break;
+                    case OpCode::Less:
+                        a = a < b ? 1.0F : 0.0F;
+                        break;
+                    case OpCode::LessEqual:
+                        a = a <= b ? 1.0F : 0.0F;
+                        break;
+                    case OpCode::Greater:
+                        a = a > b ? 1.0F : 0.0F;
+                        break;
+                    case OpCode::GreaterEqual:
+                        a = a >= b ? 1.0F : 0.0F;
+                        break;
+                    case OpCode::Equal:
+                        a = a == b ? 1.0F : 0.0F;
+                        break;
+                    case OpCode::NotEqual:
+                        a = a != b ? 1.0F : 0.0F;
+                        break;
+                    case OpCode::And:
+                        a = (a != 0.0F && b != 0.0F) ? 1.0F : 0.0F;
+                        break;
+                    case OpCode::Or:
+                        a = (a != 0.0F || b != 0.0F) ? 1.0F : 0.0F;
+                        break;
+                    default:
+                        break;
+                }
+                break;
+            }
+        }
+    }
+    return top < 0 ? 0.0F : stack[top];
+}
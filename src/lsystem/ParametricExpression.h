@@ -0,0 +1,98 @@
+/**
+ * @file ParametricExpression.h
+ * @brief Expresiones aritmeticas de los L-Systems parametricos.
+ *
+ * Argumentos y condiciones de las producciones parametricas, p. ej. "l*0.7" o
+ * "l > 0.25 && w < 1". Se compilan una vez a un programa en notacion polaca
+ * inversa que se evalua sin asignaciones de memoria durante la reescritura.
+ *
+ * Soporta numeros, parametros formales por nombre, + - * / ^ (potencia),
+ * menos unario, comparaciones (< <= > >= == !=, '=' equivale a '=='),
+ * ! && || y parentesis. Las comparaciones valen 1 o 0.
+ *
+ * @author Julian Parra
+ * @date 2025
+ * @course Graficacion
+ * @project Proyecto Final - "Arboles: La Belleza Algoritmica de las Plantas"
+ */
+
+#ifndef PARAMETRIC_EXPRESSION_H
+#define PARAMETRIC_EXPRESSION_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/**
+ * @class ParametricExpression
+ * @brief Expresion compilada sobre los parametros formales de una produccion.
+ */
+class ParametricExpression {
+public:
+    ParametricExpression() = default;
+
+    /**
+     * @brief Expresion que siempre vale 'value'.
+     */
+    static ParametricExpression constant(float value);
+
+    /**
+     * @brief Compila el texto de una expresion.
+     * @param text Expresion, p. ej. "l*0.7".
+     * @param formals Nombres de los parametros formales; el i-esimo se lee de values[i].
+     * @param error Recibe la descripcion del error si la compilacion falla.
+     * @return false si el texto no es una expresion valida.
+     */
+    bool compile(const std::string& text, const std::vector<std::string>& formals,
+                 std::string& error);
+
+    /**
+     * @brief Evalua la expresion.
+     * @param values Parametros actuales, en el orden de los formales de compile().
+     * @return Valor de la expresion; una expresion vacia vale 0.
+     */
+    float evaluate(const float* values) const;
+
+    /**
+     * @brief Indica si no se compilo nada (p. ej. una condicion ausente).
+     */
+    bool isEmpty() const {
+        return m_ops.empty();
+    }
+
+private:
+    // Profundidad maxima de la pila de evaluacion; compile() rechaza expresiones mas profundas
+    static constexpr int MAX_STACK_DEPTH = 32;
+
+    enum class OpCode : uint8_t {
+        Constant,   ///< Apila 'value'
+        Parameter,  ///< Apila values[index]
+        Negate,
+        Not,
+        Add,
+        Subtract,
+        Multiply,
+        Divide,
+        Power,
+        Less,
+        LessEqual,
+        Greater,
+        GreaterEqual,
+        Equal,
+        NotEqual,
+        And,
+        Or
+    };
+
+    struct Op {
+        OpCode code;
+        uint8_t index;  ///< Parametro de OpCode::Parameter
+        float value;    ///< Constante de OpCode::Constant
+    };
+
+    struct Parser;
+
+    std::vector<Op> m_ops;
+};
+
+#endif  // PARAMETRIC_EXPRESSION_H
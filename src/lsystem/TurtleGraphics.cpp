@@ -10,32 +10,169 @@
 
 #include "TurtleGraphics.h"
 
+#include <algorithm>
 #include <array>
+#include <atomic>
 #include <cmath>
-#include <glm/gtc/type_ptr.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <glm/gtc/packing.hpp>
+#include <glm/gtc/quaternion.hpp>
 #include <iostream>
+#include <thread>
+#include <utility>
+
+#include "LSystem.h"
+#include "core/Profiler.h"
+#include "rendering/CompactInstances.h"
 
 #ifndef M_PI
 #define M_PI 3.14159265358979323846
 #endif
 
+// =============================================================================
+// Shader Sources - Uniforms por cuadro
+// =============================================================================
+
+// Camara, luz y los parametros visuales en vivo que todos los programas comparten en
+// un uniform buffer; se inserta tras la linea #version de cada etapa (GLSL 3.30
+// no tiene #include). Las instancias se construyen en espacio unitario (paso 1, ancho
+// inicial 1, hoja 1) y llevan un indice de tono en vez de color, asi que paso, anchos,
+// tamano de hoja y colores se aplican aqui y cambian sin tocar la geometria.
+static const char* FRAME_UNIFORM_BLOCK = R"(
+layout (std140) uniform FrameData {
+    mat4 view;
+    mat4 projection;
+    vec3 lightPos;
+    vec3 viewPos;
+    vec3 branchColor;
+    vec3 leafColor;
+    vec3 flowerColor;
+    vec3 geometryScale;  // x: step size, y: initial width, z: leaf size
+    float growthTime;    // Instante de la animacion de crecimiento, en generaciones
+};
+
+// Color de rama tras 'shade' pasos de verdeo (')
+vec3 shadeColor(float shade) {
+    return vec3(max(branchColor.r - 0.02 * shade, 0.0), min(branchColor.g + 0.05 * shade, 1.0),
+                branchColor.b);
+}
+
+// Crecimiento de una instancia nacida en 'birth' (generacion + orden): 0 antes, 1 ya
+// crecida. Tarda TurtleGraphics::GROWTH_RAMP = 0.25 generaciones.
+float growth(float birth) {
+    return clamp((growthTime - birth) * 4.0, 0.0, 1.0);
+}
+)";
+
+// Espejo std140 de FrameData: cada vec3 ocupa una ranura completa de 16 bytes
+struct FrameUniforms {
+    glm::mat4 view;
+    glm::mat4 projection;
+    glm::vec4 lightPos;
+    glm::vec4 viewPos;
+    glm::vec4 branchColor;
+    glm::vec4 leafColor;
+    glm::vec4 flowerColor;
+    glm::vec4 geometryScale;  // w: growthTime
+};
+static_assert(sizeof(FrameUniforms) == 224, "FrameUniforms must match the std140 layout");
+
+// =============================================================================
+// Shader Sources - Copias del bosque (FOREST_PLACEMENTS)
+// =============================================================================
+
+// Se inserta en lugar del define COMPACT_INSTANCES en las variantes de copias. Un
+// dibujo instanciado repite cada instancia de la planta una vez por copia: los
+// atributos de la copia avanzan cada 'instancesPerPlant' instancias (divisor) y
+// la instancia propia de la planta se lee de un texture buffer sobre su buffer de
+// instancias (formato float completo), pues los atributos no pueden dar la vuelta.
+static const char* FOREST_PLACEMENT_BLOCK = R"(
+#define FOREST_PLACEMENTS
+layout (location = 9) in vec4 iPlacement;       // xyz: posicion, w: escala
+layout (location = 10) in vec4 iPlacementTint;  // rgb: tinte, a: giro (radianes)
+
+uniform samplerBuffer instanceData;  // R32F sobre el buffer de instancias de la planta
+uniform int instanceFloats;          // Floats por instancia (10 rama, 21 decoracion)
+uniform int instancesPerPlant;
+uniform int firstInstance;           // Las flores siguen a las hojas en el buffer
+
+float instanceFloat(int offset) {
+    int instance = firstInstance + gl_InstanceID % instancesPerPlant;
+    return texelFetch(instanceData, instance * instanceFloats + offset).r;
+}
+
+vec3 instanceVec3(int offset) {
+    return vec3(instanceFloat(offset), instanceFloat(offset + 1), instanceFloat(offset + 2));
+}
+
+vec4 instanceVec4(int offset) {
+    return vec4(instanceVec3(offset), instanceFloat(offset + 3));
+}
+
+// Giro sobre +Y: las plantas quedan derechas sobre el piso
+vec3 placeDirection(vec3 v) {
+    float c = cos(iPlacementTint.a);
+    float s = sin(iPlacementTint.a);
+    return vec3(c * v.x + s * v.z, v.y, c * v.z - s * v.x);
+}
+
+// Giro, escala uniforme y traslacion: una semejanza, asi que colocar los extremos de
+// una rama coloca el cilindro completo
+vec3 placePoint(vec3 p) {
+    return iPlacement.xyz + placeDirection(p) * iPlacement.w;
+}
+)";
+
 // =============================================================================
 // Shader Sources - Line Rendering
 // =============================================================================
 
+// Una linea instanciada por rama, leida del buffer de instancias de cilindros
 static const char* LINE_VERTEX_SHADER = R"(
 #version 330 core
-layout (location = 0) in vec3 aPos;
-layout (location = 1) in vec3 aColor;
+#if defined(FOREST_PLACEMENTS)
+// Las instancias vienen de instanceData (FOREST_PLACEMENT_BLOCK)
+#elif defined(COMPACT_INSTANCES)
+layout (location = 2) in vec4 iStartEndX;  // unorm16 en la caja: start.xyz, end.x
+layout (location = 3) in vec2 iEndYZ;      // unorm16 en la caja: end.yz
+layout (location = 7) in float iBirthUnorm;  // unorm16: nacimiento / birthScale
+
+uniform vec3 boundsMin;
+uniform vec3 boundsExtent;
+uniform float birthScale;  // Duracion del crecimiento (generaciones)
+#else
+layout (location = 2) in vec3 iStart;
+layout (location = 3) in vec3 iEnd;
+layout (location = 7) in float iBirth;
+#endif
+#ifndef FOREST_PLACEMENTS
+layout (location = 6) in float iShade;
+#endif
 
 out vec3 fragColor;
 
-uniform mat4 view;
-uniform mat4 projection;
-
 void main() {
-    gl_Position = projection * view * vec4(aPos, 1.0);
-    fragColor = aColor;
+#if defined(FOREST_PLACEMENTS)
+    vec3 iStart = instanceVec3(0);
+    vec3 iEnd = instanceVec3(3);
+    float iShade = instanceFloat(8);
+    float iBirth = instanceFloat(9);
+#elif defined(COMPACT_INSTANCES)
+    vec3 iStart = boundsMin + iStartEndX.xyz * boundsExtent;
+    vec3 iEnd = boundsMin + vec3(iStartEndX.w, iEndYZ) * boundsExtent;
+    float iBirth = iBirthUnorm * birthScale;
+#endif
+
+    vec3 position = ((gl_VertexID == 0) ? iStart : mix(iStart, iEnd, growth(iBirth))) *
+                    geometryScale.x;
+    fragColor = shadeColor(iShade);
+#ifdef FOREST_PLACEMENTS
+    position = placePoint(position);
+    fragColor *= iPlacementTint.rgb;
+#endif
+    gl_Position = projection * view * vec4(position, 1.0);
 }
 )";
 
@@ -44,8 +181,10 @@ static const char* LINE_FRAGMENT_SHADER = R"(
 in vec3 fragColor;
 out vec4 FragColor;
 
+uniform vec3 highlight;  // Rama seleccionada (renderHighlight), cero si no hay
+
 void main() {
-    FragColor = vec4(fragColor, 1.0);
+    FragColor = vec4(fragColor + highlight, 1.0);
 }
 )";
 
@@ -59,22 +198,82 @@ layout (location = 0) in vec3 aPos;
 layout (location = 1) in vec3 aNormal;
 
 // Instance data
+#if defined(FOREST_PLACEMENTS)
+// Las instancias vienen de instanceData (FOREST_PLACEMENT_BLOCK)
+#elif defined(COMPACT_INSTANCES)
+layout (location = 2) in vec4 iStartEndX;  // unorm16 en la caja: start.xyz, end.x
+layout (location = 3) in vec2 iEndYZ;      // unorm16 en la caja: end.yz
+layout (location = 4) in vec2 iRadii;      // half floats: inicio, fin
+layout (location = 7) in float iBirthUnorm;  // unorm16: nacimiento / birthScale
+
+uniform vec3 boundsMin;
+uniform vec3 boundsExtent;
+uniform float birthScale;  // Duracion del crecimiento (generaciones)
+#else
 layout (location = 2) in vec3 iStart;
 layout (location = 3) in vec3 iEnd;
 layout (location = 4) in float iRadiusStart;
 layout (location = 5) in float iRadiusEnd;
-layout (location = 6) in vec3 iColor;
+layout (location = 7) in float iBirth;
+#endif
+#ifndef FOREST_PLACEMENTS
+layout (location = 6) in float iShade;
+#endif
 
-uniform mat4 view;
-uniform mat4 projection;
+uniform bool jointSpheres;  // La malla es la esfera de union unitaria, colocada al final de la rama
 
 out vec3 FragPos;
 out vec3 Normal;
 out vec3 Color;
 
 void main() {
+#if defined(FOREST_PLACEMENTS)
+    vec3 iStart = instanceVec3(0);
+    vec3 iEnd = instanceVec3(3);
+    float iRadiusStart = instanceFloat(6);
+    float iRadiusEnd = instanceFloat(7);
+    float iShade = instanceFloat(8);
+    float iBirth = instanceFloat(9);
+#elif defined(COMPACT_INSTANCES)
+    vec3 iStart = boundsMin + iStartEndX.xyz * boundsExtent;
+    vec3 iEnd = boundsMin + vec3(iStartEndX.w, iEndYZ) * boundsExtent;
+    float iRadiusStart = iRadii.x;
+    float iRadiusEnd = iRadii.y;
+    float iBirth = iBirthUnorm * birthScale;
+#endif
+
+    // Instancia en espacio unitario: posiciones escalan con el paso, radios con el ancho inicial
+    vec3 start = iStart * geometryScale.x;
+    vec3 end = iEnd * geometryScale.x;
+    float radiusStart = iRadiusStart * geometryScale.y;
+    float radiusEnd = iRadiusEnd * geometryScale.y;
+    vec3 color = shadeColor(iShade);
+
+#ifdef FOREST_PLACEMENTS
+    start = placePoint(start);
+    end = placePoint(end);
+    radiusStart *= iPlacement.w;
+    radiusEnd *= iPlacement.w;
+    color *= iPlacementTint.rgb;
+#endif
+
+    // Crecimiento: la rama se extiende desde su inicio y engrosa al nacer
+    float grown = growth(iBirth);
+    end = mix(start, end, grown);
+    radiusStart *= grown;
+    radiusEnd *= grown;
+
+    if (jointSpheres) {
+        vec3 worldPos = end + aPos * radiusEnd;
+        FragPos = worldPos;
+        Normal = aNormal;
+        Color = color;
+        gl_Position = projection * view * vec4(worldPos, 1.0);
+        return;
+    }
+
     // Calculate branch direction and length
-    vec3 dir = iEnd - iStart;
+    vec3 dir = end - start;
     float len = length(dir);
     if (len < 0.0001) {
         dir = vec3(0.0, 1.0, 0.0);
@@ -100,15 +299,15 @@ void main() {
     }
 
     // Interpolate radius along the cylinder (aPos.y is 0 at bottom, 1 at top)
-    float radius = mix(iRadiusStart, iRadiusEnd, aPos.y);
+    float radius = mix(radiusStart, radiusEnd, aPos.y);
 
     // Transform vertex position
     vec3 localPos = vec3(aPos.x * radius, aPos.y * len, aPos.z * radius);
-    vec3 worldPos = rotMat * localPos + iStart;
+    vec3 worldPos = rotMat * localPos + start;
 
     FragPos = worldPos;
     Normal = rotMat * aNormal;
-    Color = iColor;
+    Color = color;
 
     gl_Position = projection * view * vec4(worldPos, 1.0);
 }
@@ -120,11 +319,10 @@ in vec3 FragPos;
 in vec3 Normal;
 in vec3 Color;
 
-uniform vec3 lightPos;
-uniform vec3 viewPos;
-
 out vec4 FragColor;
 
+uniform vec3 highlight;  // Rama seleccionada (renderHighlight), cero si no hay
+
 void main() {
     vec3 norm = normalize(Normal);
     vec3 lightDir = normalize(lightPos - FragPos);
@@ -160,7 +358,14 @@ void main() {
     // Tonemap simple para evitar sobre-exposicion
     result = result / (result + vec3(1.0));
 
-    FragColor = vec4(result, 1.0);
+    FragColor = vec4(result + highlight, 1.0);
+}
+)";
+
+// Pasada de sombra: la etapa de vertices del cilindro sin salida de color, solo profundidad
+static const char* DEPTH_FRAGMENT_SHADER = R"(
+#version 330 core
+void main() {
 }
 )";
 
@@ -174,29 +379,74 @@ layout (location = 0) in vec3 aPos;
 layout (location = 1) in vec3 aNormal;
 
 // Instance data
+#if defined(FOREST_PLACEMENTS)
+// Las instancias vienen de instanceData (FOREST_PLACEMENT_BLOCK)
+#elif defined(COMPACT_INSTANCES)
+layout (location = 2) in vec4 iPositionUnorm;  // unorm16 en la caja (w sin usar)
+layout (location = 3) in vec4 iRotation;       // snorm16 quaternion (x, y, z, w)
+layout (location = 7) in float iBirthUnorm;    // unorm16: nacimiento / birthScale
+layout (location = 8) in float iSizeHalf;      // half float
+
+uniform vec3 boundsMin;
+uniform vec3 boundsExtent;
+uniform float birthScale;  // Duracion del crecimiento (generaciones)
+
+mat3 quatToMat3(vec4 q) {
+    q = normalize(q);
+    vec3 q2 = q.xyz * q.xyz;
+    float xy = q.x * q.y, xz = q.x * q.z, yz = q.y * q.z;
+    float wx = q.w * q.x, wy = q.w * q.y, wz = q.w * q.z;
+    return mat3(1.0 - 2.0 * (q2.y + q2.z), 2.0 * (xy + wz), 2.0 * (xz - wy),
+                2.0 * (xy - wz), 1.0 - 2.0 * (q2.x + q2.z), 2.0 * (yz + wx),
+                2.0 * (xz + wy), 2.0 * (yz - wx), 1.0 - 2.0 * (q2.x + q2.y));
+}
+#else
 layout (location = 2) in vec3 iPosition;
 layout (location = 3) in mat4 iOrientation;  // Uses locations 3, 4, 5, 6
-layout (location = 7) in vec3 iColor;
+layout (location = 7) in float iBirth;
 layout (location = 8) in float iSize;
+#endif
 
-uniform mat4 view;
-uniform mat4 projection;
+uniform int decorationType;  // 0 = hoja, 1 = flor
 
 out vec3 FragPos;
 out vec3 Normal;
 out vec3 Color;
 out vec2 LocalPos;  // Para efectos en fragment shader
+out float Growth;   // Aparicion durante la animacion de crecimiento
 
 void main() {
-    vec3 scaledPos = aPos * iSize;
+#if defined(FOREST_PLACEMENTS)
+    vec3 iPosition = instanceVec3(0);
+    mat4 iOrientation = mat4(instanceVec4(3), instanceVec4(7), instanceVec4(11),
+                             instanceVec4(15));
+    float iSize = instanceFloat(19);
+    float iBirth = instanceFloat(20);
+#elif defined(COMPACT_INSTANCES)
+    vec3 iPosition = boundsMin + iPositionUnorm.xyz * boundsExtent;
+    mat4 iOrientation = mat4(quatToMat3(iRotation));
+    float iSize = iSizeHalf;
+    float iBirth = iBirthUnorm * birthScale;
+#endif
+
+    // Instancia en espacio unitario: el paso la coloca, el tamano de hoja (y crecimiento) la escala
+    Growth = growth(iBirth);
+    vec3 scaledPos = aPos * (iSize * geometryScale.z * Growth);
     vec4 worldPos4 = iOrientation * vec4(scaledPos, 1.0);
-    vec3 worldPos = worldPos4.xyz + iPosition;
+    vec3 worldPos = worldPos4.xyz + iPosition * geometryScale.x;
 
     FragPos = worldPos;
     Normal = mat3(iOrientation) * aNormal;
-    Color = iColor;
+    Color = (decorationType == 0) ? leafColor : flowerColor;
     LocalPos = aPos.xy;  // Coordenadas locales para efectos
 
+#ifdef FOREST_PLACEMENTS
+    worldPos = placePoint(worldPos);
+    FragPos = worldPos;
+    Normal = placeDirection(Normal);
+    Color *= iPlacementTint.rgb;
+#endif
+
     gl_Position = projection * view * vec4(worldPos, 1.0);
 }
 )";
@@ -207,9 +457,8 @@ in vec3 FragPos;
 in vec3 Normal;
 in vec3 Color;
 in vec2 LocalPos;
+in float Growth;
 
-uniform vec3 lightPos;
-uniform vec3 viewPos;
 uniform int decorationType;  // 0 = hoja, 1 = flor
 
 out vec4 FragColor;
@@ -339,7 +588,7 @@ void main() {
     vec3 subsurface = sss * finalColor;
 
     vec3 result = ambient * 0.35 + diffuse * 0.55 + specular + subsurface;
-    FragColor = vec4(result, alpha);
+    FragColor = vec4(result, alpha * Growth);  // Aparece gradualmente al crecer
 }
 )";
 
@@ -352,9 +601,6 @@ static const char* FLOOR_VERTEX_SHADER = R"(
 layout (location = 0) in vec3 aPos;
 layout (location = 1) in vec2 aTexCoord;
 
-uniform mat4 view;
-uniform mat4 projection;
-
 out vec2 TexCoord;
 out vec3 FragPos;
 
@@ -370,12 +616,32 @@ static const char* FLOOR_FRAGMENT_SHADER = R"(
 in vec2 TexCoord;
 in vec3 FragPos;
 
-uniform vec3 lightPos;
 uniform vec3 plantCenter;
 uniform float plantRadius;
+uniform bool hasShadowMap;
+uniform sampler2DShadow shadowMap;
+uniform mat4 lightSpace;  // Mundo -> clip de la luz (ShadowMap)
 
 out vec4 FragColor;
 
+// Fraccion iluminada: 3x3 consultas con comparacion (cada una ya filtra 2x2)
+float shadowMapLight(vec3 position) {
+    vec4 clip = lightSpace * vec4(position, 1.0);
+    vec3 coords = clip.xyz / clip.w * 0.5 + 0.5;
+    if (any(lessThan(coords.xy, vec2(0.0))) || any(greaterThan(coords.xy, vec2(1.0))))
+        return 1.0;  // Fuera del mapa: nada de la planta le hace sombra
+    coords.z = min(coords.z, 1.0) - 0.0005;
+
+    vec2 texel = 1.0 / vec2(textureSize(shadowMap, 0));
+    float light = 0.0;
+    for (int x = -1; x <= 1; ++x) {
+        for (int y = -1; y <= 1; ++y) {
+            light += texture(shadowMap, vec3(coords.xy + vec2(x, y) * texel, coords.z));
+        }
+    }
+    return light / 9.0;
+}
+
 void main() {
     // Color base del piso - degradado suave
     vec2 centered = TexCoord - vec2(0.5);
@@ -397,17 +663,24 @@ void main() {
     vec2 fragPos2D = vec2(FragPos.x, FragPos.z);
     float distToPlant = length(fragPos2D - plantPos2D);
 
-    // Sombra circular suave alrededor de la base de la planta
-    float shadowRadius = plantRadius * 1.5;
-    float shadow = 1.0 - smoothstep(shadowRadius * 0.3, shadowRadius, distToPlant) * 0.4;
-
-    // Sombra direccional basada en la luz
-    vec3 lightDir = normalize(lightPos);
-    vec2 shadowOffset = -lightDir.xz * plantRadius * 0.5;
-    float dirShadowDist = length(fragPos2D - plantPos2D - shadowOffset);
-    float dirShadow = 1.0 - smoothstep(shadowRadius * 0.2, shadowRadius * 0.8, dirShadowDist) * 0.3;
-
-    shadow = min(shadow, dirShadow);
+    float shadow;
+    if (hasShadowMap) {
+        // Sombra real: profundidad de la planta vista desde la luz
+        shadow = mix(0.55, 1.0, shadowMapLight(FragPos));
+    } else {
+        // Sombra circular suave alrededor de la base de la planta
+        float shadowRadius = plantRadius * 1.5;
+        shadow = 1.0 - smoothstep(shadowRadius * 0.3, shadowRadius, distToPlant) * 0.4;
+
+        // Sombra direccional basada en la luz
+        vec3 lightDir = normalize(lightPos);
+        vec2 shadowOffset = -lightDir.xz * plantRadius * 0.5;
+        float dirShadowDist = length(fragPos2D - plantPos2D - shadowOffset);
+        float dirShadow =
+            1.0 - smoothstep(shadowRadius * 0.2, shadowRadius * 0.8, dirShadowDist) * 0.3;
+
+        shadow = min(shadow, dirShadow);
+    }
 
     // Ambient occlusion cerca de la planta
     float ao = smoothstep(0.0, plantRadius * 0.5, distToPlant) * 0.3 + 0.7;
@@ -426,6 +699,54 @@ void main() {
 }
 )";
 
+// =============================================================================
+// Cuantizacion de instancias compactas (COMPACT_INSTANCES, ver CompactInstances.h)
+// =============================================================================
+
+static uint16_t quantizeUnorm16(float value) {
+    return static_cast<uint16_t>(std::lround(std::clamp(value, 0.0F, 1.0F) * 65535.0F));
+}
+
+static int16_t quantizeSnorm16(float value) {
+    return static_cast<int16_t>(std::lround(std::clamp(value, -1.0F, 1.0F) * 32767.0F));
+}
+
+// Nacimientos como fraccion del crecimiento: un half float solo avanza de 1/128 desde
+// la generacion 8, lo que mezclaria el orden dentro de una generacion
+static uint16_t quantizeBirth(float birth, float growthDuration) {
+    return growthDuration > 0.0F ? quantizeUnorm16(birth / growthDuration) : 0;
+}
+
+// =============================================================================
+// Dibujo por rangos de instancias (culling de BranchHierarchy)
+// =============================================================================
+
+// Se suma al color de la rama seleccionada (ver renderHighlight)
+static const glm::vec3 HIGHLIGHT_COLOR(0.45F, 0.35F, 0.05F);
+
+// Instancia base 0 se queda en GL 3.3; cualquier otra requiere GL 4.2
+static void drawArraysInstanced(GLenum mode, GLsizei vertices, GLsizei instances,
+                                GLuint baseInstance) {
+    if (baseInstance == 0) {
+        glDrawArraysInstanced(mode, 0, vertices, instances);
+    } else {
+        glDrawArraysInstancedBaseInstance(mode, 0, vertices, instances, baseInstance);
+    }
+}
+
+// Llama draw(first, count) por cada rango visible, o una vez para todas las instancias
+template <typename Draw>
+static void forEachInstanceRange(bool culled, const std::vector<InstanceRange>& visible,
+                                 size_t instances, const Draw& draw) {
+    if (!culled) {
+        draw(0, static_cast<GLsizei>(instances));
+        return;
+    }
+    for (const InstanceRange& range : visible) {
+        draw(range.begin, static_cast<GLsizei>(range.end - range.begin));
+    }
+}
+
 // =============================================================================
 // Constructor / Destructor
 // =============================================================================
@@ -433,41 +754,37 @@ void main() {
 TurtleGraphics::TurtleGraphics() = default;
 
 TurtleGraphics::~TurtleGraphics() {
-    // Clean up line resources
-    if (m_lineVAO != 0)
-        glDeleteVertexArrays(1, &m_lineVAO);
-    if (m_lineVBO != 0)
-        glDeleteBuffers(1, &m_lineVBO);
-    if (m_lineShader != 0)
-        glDeleteProgram(m_lineShader);
-
     // Clean up cylinder resources
     if (m_cylinderVAO != 0)
         glDeleteVertexArrays(1, &m_cylinderVAO);
-    if (m_cylinderVBO != 0)
-        glDeleteBuffers(1, &m_cylinderVBO);
-    if (m_cylinderInstanceVBO != 0)
-        glDeleteBuffers(1, &m_cylinderInstanceVBO);
-    if (m_cylinderShader != 0)
-        glDeleteProgram(m_cylinderShader);
 
     // Clean up decoration resources
-    if (m_decorationVAO != 0)
-        glDeleteVertexArrays(1, &m_decorationVAO);
+    if (m_leafVAO != 0)
+        glDeleteVertexArrays(1, &m_leafVAO);
+    if (m_flowerVAO != 0)
+        glDeleteVertexArrays(1, &m_flowerVAO);
     if (m_decorationVBO != 0)
         glDeleteBuffers(1, &m_decorationVBO);
-    if (m_decorationInstanceVBO != 0)
-        glDeleteBuffers(1, &m_decorationInstanceVBO);
-    if (m_decorationShader != 0)
-        glDeleteProgram(m_decorationShader);
+
+    // Liberar recursos de las copias
+    for (GLuint vao : {m_placementBranchVAO, m_placementLeafVAO, m_placementFlowerVAO}) {
+        if (vao != 0)
+            glDeleteVertexArrays(1, &vao);
+    }
+    for (GLuint texture : {m_branchTexture, m_decorationTexture}) {
+        if (texture != 0)
+            glDeleteTextures(1, &texture);
+    }
 
     // Clean up floor resources
     if (m_floorVAO != 0)
         glDeleteVertexArrays(1, &m_floorVAO);
     if (m_floorVBO != 0)
         glDeleteBuffers(1, &m_floorVBO);
-    if (m_floorShader != 0)
-        glDeleteProgram(m_floorShader);
+
+    // Liberar uniforms por cuadro
+    if (m_frameUBO != 0)
+        glDeleteBuffers(1, &m_frameUBO);
 }
 
 // =============================================================================
@@ -485,93 +802,25 @@ bool TurtleGraphics::initialize() {
     }
 
     // -------------------------------------------------------------------------
-    // Setup Line VAO/VBO
+    // Configurar VAO/VBO de cilindros para render instanciado (tambien sirve para lineas)
     // -------------------------------------------------------------------------
-    glGenVertexArrays(1, &m_lineVAO);
-    glGenBuffers(1, &m_lineVBO);
-
-    glBindVertexArray(m_lineVAO);
-    glBindBuffer(GL_ARRAY_BUFFER, m_lineVBO);
+    // Mallas LOD indexadas que comparten el VAO de cilindros y los grupos del culler
+    m_meshes.create();
 
-    // Position (3 floats) + Color (3 floats) = 6 floats per vertex
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), nullptr);
-    glEnableVertexAttribArray(0);
-    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float),
-                          reinterpret_cast<void*>(3 * sizeof(float)));
-    glEnableVertexAttribArray(1);
-
-    // -------------------------------------------------------------------------
-    // Setup Cylinder VAO/VBO for instanced rendering
-    // -------------------------------------------------------------------------
-    std::vector<float> cylinderVertices;
-    for (int i = 0; i <= CYLINDER_SEGMENTS; ++i) {
-        float theta = 2.0F * static_cast<float>(M_PI) * static_cast<float>(i) /
-                      static_cast<float>(CYLINDER_SEGMENTS);
-        float cosTheta = std::cos(theta);
-        float sinTheta = std::sin(theta);
-
-        // Bottom vertex: position + normal
-        cylinderVertices.push_back(cosTheta);  // x
-        cylinderVertices.push_back(0.0F);      // y (bottom)
-        cylinderVertices.push_back(sinTheta);  // z
-        cylinderVertices.push_back(cosTheta);  // normal x
-        cylinderVertices.push_back(0.0F);      // normal y
-        cylinderVertices.push_back(sinTheta);  // normal z
-
-        // Top vertex: position + normal
-        cylinderVertices.push_back(cosTheta);  // x
-        cylinderVertices.push_back(1.0F);      // y (top)
-        cylinderVertices.push_back(sinTheta);  // z
-        cylinderVertices.push_back(cosTheta);  // normal x
-        cylinderVertices.push_back(0.0F);      // normal y
-        cylinderVertices.push_back(sinTheta);  // normal z
-    }
+    // Buffers dinamicos: los punteros de atributos se fijan tras cada subida, pues el
+    // nombre del buffer puede cambiar al crecer o alternar (ver bind*Attributes)
 
     glGenVertexArrays(1, &m_cylinderVAO);
-    glGenBuffers(1, &m_cylinderVBO);
-    glGenBuffers(1, &m_cylinderInstanceVBO);
+    m_cylinderInstanceBuffer.create();
 
     glBindVertexArray(m_cylinderVAO);
+    m_meshes.bindVertexAttributes();
 
-    // Vertex data
-    glBindBuffer(GL_ARRAY_BUFFER, m_cylinderVBO);
-    glBufferData(GL_ARRAY_BUFFER, static_cast<GLsizeiptr>(cylinderVertices.size() * sizeof(float)),
-                 cylinderVertices.data(), GL_STATIC_DRAW);
-
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), nullptr);
-    glEnableVertexAttribArray(0);
-    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float),
-                          reinterpret_cast<void*>(3 * sizeof(float)));
-    glEnableVertexAttribArray(1);
-
-    // Instance data buffer setup
-    glBindBuffer(GL_ARRAY_BUFFER, m_cylinderInstanceVBO);
-    constexpr GLsizei instanceStride =
-        11 * sizeof(float);  // start(3) + end(3) + r1(1) + r2(1) + color(3)
-
-    glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, instanceStride, nullptr);  // iStart
-    glEnableVertexAttribArray(2);
-    glVertexAttribDivisor(2, 1);
-
-    glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE, instanceStride,
-                          reinterpret_cast<void*>(3 * sizeof(float)));  // iEnd
-    glEnableVertexAttribArray(3);
-    glVertexAttribDivisor(3, 1);
-
-    glVertexAttribPointer(4, 1, GL_FLOAT, GL_FALSE, instanceStride,
-                          reinterpret_cast<void*>(6 * sizeof(float)));  // iRadiusStart
-    glEnableVertexAttribArray(4);
-    glVertexAttribDivisor(4, 1);
-
-    glVertexAttribPointer(5, 1, GL_FLOAT, GL_FALSE, instanceStride,
-                          reinterpret_cast<void*>(7 * sizeof(float)));  // iRadiusEnd
-    glEnableVertexAttribArray(5);
-    glVertexAttribDivisor(5, 1);
-
-    glVertexAttribPointer(6, 3, GL_FLOAT, GL_FALSE, instanceStride,
-                          reinterpret_cast<void*>(8 * sizeof(float)));  // iColor
-    glEnableVertexAttribArray(6);
-    glVertexAttribDivisor(6, 1);
+    // Las copias dibujan las mismas mallas; sus atributos de instancia son las
+    // ubicaciones, fijadas en bindPlacementAttributes()
+    glGenVertexArrays(1, &m_placementBranchVAO);
+    glBindVertexArray(m_placementBranchVAO);
+    m_meshes.bindVertexAttributes();
 
     // -------------------------------------------------------------------------
     // Setup Decoration VAO/VBO (leaves/flowers as quads)
@@ -583,138 +832,127 @@ bool TurtleGraphics::initialize() {
         0.5F,  1.0F, 0.0F, 0.0F, 0.0F, 1.0F, -0.5F, 1.0F, 0.0F, 0.0F, 0.0F, 1.0F,
     };
 
-    glGenVertexArrays(1, &m_decorationVAO);
     glGenBuffers(1, &m_decorationVBO);
-    glGenBuffers(1, &m_decorationInstanceVBO);
-
-    glBindVertexArray(m_decorationVAO);
-
     glBindBuffer(GL_ARRAY_BUFFER, m_decorationVBO);
     glBufferData(GL_ARRAY_BUFFER, sizeof(decorationVertices), decorationVertices, GL_STATIC_DRAW);
+    m_decorationInstanceBuffer.create();
+
+    // Hojas y flores comparten el quad y el buffer de instancias, pero cada una tiene
+    // su VAO apuntando a su rango, asi los dibujos nunca vuelven a especificar atributos
+    glGenVertexArrays(1, &m_leafVAO);
+    glGenVertexArrays(1, &m_flowerVAO);
+    glGenVertexArrays(1, &m_placementLeafVAO);
+    glGenVertexArrays(1, &m_placementFlowerVAO);
+    for (GLuint vao : {m_leafVAO, m_flowerVAO, m_placementLeafVAO, m_placementFlowerVAO}) {
+        glBindVertexArray(vao);
+        glBindBuffer(GL_ARRAY_BUFFER, m_decorationVBO);
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), nullptr);
+        glEnableVertexAttribArray(0);
+        glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float),
+                              reinterpret_cast<void*>(3 * sizeof(float)));
+        glEnableVertexAttribArray(1);
+    }
 
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), nullptr);
-    glEnableVertexAttribArray(0);
-    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float),
-                          reinterpret_cast<void*>(3 * sizeof(float)));
-    glEnableVertexAttribArray(1);
+    glBindVertexArray(0);
 
-    // Instance data: position(3) + orientation(16) + color(3) + size(1) = 23 floats
-    glBindBuffer(GL_ARRAY_BUFFER, m_decorationInstanceVBO);
-    constexpr GLsizei decorInstanceStride = 23 * sizeof(float);
+    // -------------------------------------------------------------------------
+    // Configurar copias (texture buffers sobre las instancias)
+    // -------------------------------------------------------------------------
+    m_placementBuffer.create();
+    glGenTextures(1, &m_branchTexture);
+    glGenTextures(1, &m_decorationTexture);
 
-    glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, decorInstanceStride, nullptr);  // iPosition
-    glEnableVertexAttribArray(2);
-    glVertexAttribDivisor(2, 1);
+    // -------------------------------------------------------------------------
+    // Configurar el uniform buffer por cuadro (camara y luz)
+    // -------------------------------------------------------------------------
+    glGenBuffers(1, &m_frameUBO);
+    glBindBuffer(GL_UNIFORM_BUFFER, m_frameUBO);
+    glBufferData(GL_UNIFORM_BUFFER, sizeof(FrameUniforms), nullptr, GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
 
-    // iOrientation (mat4 = 4 vec4s at locations 3, 4, 5, 6)
-    for (int i = 0; i < 4; ++i) {
-        glVertexAttribPointer(3 + i, 4, GL_FLOAT, GL_FALSE, decorInstanceStride,
-                              reinterpret_cast<void*>((3 + i * 4) * sizeof(float)));
-        glEnableVertexAttribArray(3 + i);
-        glVertexAttribDivisor(3 + i, 1);
+    // -------------------------------------------------------------------------
+    // Configurar culling en GPU (GL 4.4; si no, se dibuja cada rama). Deshabilitado
+    // antes de initialize(), sus grupos nunca se reservan (p. ej. especies del bosque)
+    // -------------------------------------------------------------------------
+    if (m_gpuCulling) {
+        if (m_culler.initialize(m_meshes)) {
+            updateCullerMeshes();
+        } else {
+            std::cerr << "TurtleGraphics: GPU culling unavailable, drawing all branches\n";
+        }
     }
 
-    glVertexAttribPointer(7, 3, GL_FLOAT, GL_FALSE, decorInstanceStride,
-                          reinterpret_cast<void*>(19 * sizeof(float)));  // iColor
-    glEnableVertexAttribArray(7);
-    glVertexAttribDivisor(7, 1);
-
-    glVertexAttribPointer(8, 1, GL_FLOAT, GL_FALSE, decorInstanceStride,
-                          reinterpret_cast<void*>(22 * sizeof(float)));  // iSize
-    glEnableVertexAttribArray(8);
-    glVertexAttribDivisor(8, 1);
-
-    glBindVertexArray(0);
+    // GL 4.2: dibujos de un rango de instancias (culling en CPU y la rama resaltada)
+    m_baseInstance = GLAD_GL_VERSION_4_2 != 0;
 
     // -------------------------------------------------------------------------
     // Setup Floor
     // -------------------------------------------------------------------------
     setupFloor();
 
+    // -------------------------------------------------------------------------
+    // Configurar temporizadores de GPU (graficas de la ventana Debug)
+    // -------------------------------------------------------------------------
+    m_floorTimer.create();
+    m_branchTimer.create();
+    m_decorationTimer.create();
+
     m_initialized = true;
     std::cout << "TurtleGraphics: Initialized successfully\n";
     return true;
 }
 
 bool TurtleGraphics::compileShaders() {
-    auto compileShader = [](const char* source, GLenum type) -> GLuint {
-        GLuint shader = glCreateShader(type);
-        glShaderSource(shader, 1, &source, nullptr);
-        glCompileShader(shader);
-
-        GLint success = 0;
-        glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
-        if (success == 0) {
-            std::array<char, 512> infoLog{};
-            glGetShaderInfoLog(shader, 512, nullptr, infoLog.data());
-            std::cerr << "Shader compilation error:\n" << infoLog.data() << '\n';
-            glDeleteShader(shader);
-            return 0;
-        }
-        return shader;
+    // Insertar el bloque de uniforms por cuadro (y los #define de variante) tras #version
+    auto withPreamble = [](const char* source, const char* defines) {
+        std::string text(source);
+        size_t lineEnd = text.find('\n', text.find("#version"));
+        text.insert(lineEnd + 1, std::string(defines) + FRAME_UNIFORM_BLOCK);
+        return text;
     };
 
-    auto linkProgram = [](GLuint vertex, GLuint fragment) -> GLuint {
-        GLuint program = glCreateProgram();
-        glAttachShader(program, vertex);
-        glAttachShader(program, fragment);
-        glLinkProgram(program);
-
-        GLint success = 0;
-        glGetProgramiv(program, GL_LINK_STATUS, &success);
-        if (success == 0) {
-            std::array<char, 512> infoLog{};
-            glGetProgramInfoLog(program, 512, nullptr, infoLog.data());
-            std::cerr << "Shader linking error:\n" << infoLog.data() << '\n';
-            glDeleteProgram(program);
-            return 0;
-        }
-        return program;
+    auto build = [&withPreamble](const char* vertexSource, const char* fragmentSource,
+                                 const char* defines) -> std::unique_ptr<Shader> {
+        const std::string vertex = withPreamble(vertexSource, defines);
+        const std::string fragment = withPreamble(fragmentSource, "");
+        auto shader = std::make_unique<Shader>(vertex.c_str(), fragment.c_str());
+        if (!shader->isValid())
+            return nullptr;
+        shader->bindUniformBlock("FrameData", FRAME_UNIFORM_BINDING);
+        return shader;
     };
 
-    // Compile line shaders
-    GLuint lineVS = compileShader(LINE_VERTEX_SHADER, GL_VERTEX_SHADER);
-    GLuint lineFS = compileShader(LINE_FRAGMENT_SHADER, GL_FRAGMENT_SHADER);
-    if (lineVS == 0 || lineFS == 0)
-        return false;
-    m_lineShader = linkProgram(lineVS, lineFS);
-    glDeleteShader(lineVS);
-    glDeleteShader(lineFS);
-    if (m_lineShader == 0)
-        return false;
-
-    // Compile cylinder shaders
-    GLuint cylVS = compileShader(CYLINDER_VERTEX_SHADER, GL_VERTEX_SHADER);
-    GLuint cylFS = compileShader(CYLINDER_FRAGMENT_SHADER, GL_FRAGMENT_SHADER);
-    if (cylVS == 0 || cylFS == 0)
-        return false;
-    m_cylinderShader = linkProgram(cylVS, cylFS);
-    glDeleteShader(cylVS);
-    glDeleteShader(cylFS);
-    if (m_cylinderShader == 0)
-        return false;
-
-    // Compile decoration shaders
-    GLuint decVS = compileShader(DECORATION_VERTEX_SHADER, GL_VERTEX_SHADER);
-    GLuint decFS = compileShader(DECORATION_FRAGMENT_SHADER, GL_FRAGMENT_SHADER);
-    if (decVS == 0 || decFS == 0)
-        return false;
-    m_decorationShader = linkProgram(decVS, decFS);
-    glDeleteShader(decVS);
-    glDeleteShader(decFS);
-    if (m_decorationShader == 0)
-        return false;
-
-    // Compile floor shaders
-    GLuint floorVS = compileShader(FLOOR_VERTEX_SHADER, GL_VERTEX_SHADER);
-    GLuint floorFS = compileShader(FLOOR_FRAGMENT_SHADER, GL_FRAGMENT_SHADER);
-    if (floorVS == 0 || floorFS == 0)
-        return false;
-    m_floorShader = linkProgram(floorVS, floorFS);
-    glDeleteShader(floorVS);
-    glDeleteShader(floorFS);
-
-    return m_floorShader != 0;
+    constexpr const char* COMPACT = "#define COMPACT_INSTANCES\n";
+
+    // Variantes compactas (CompactInstances.h): posiciones unorm16 en la caja, radios y
+    // tamanos half, indice de tono uint16, cuaterniones snorm16 y nacimientos unorm16
+    m_lineShader = build(LINE_VERTEX_SHADER, LINE_FRAGMENT_SHADER, "");
+    m_lineCompactShader = build(LINE_VERTEX_SHADER, LINE_FRAGMENT_SHADER, COMPACT);
+    m_cylinderShader = build(CYLINDER_VERTEX_SHADER, CYLINDER_FRAGMENT_SHADER, "");
+    m_cylinderCompactShader = build(CYLINDER_VERTEX_SHADER, CYLINDER_FRAGMENT_SHADER, COMPACT);
+    m_decorationShader = build(DECORATION_VERTEX_SHADER, DECORATION_FRAGMENT_SHADER, "");
+    m_decorationCompactShader =
+        build(DECORATION_VERTEX_SHADER, DECORATION_FRAGMENT_SHADER, COMPACT);
+
+    // Variantes de copias: instancias completas desde un texture buffer, una vez por copia
+    m_linePlacementShader =
+        build(LINE_VERTEX_SHADER, LINE_FRAGMENT_SHADER, FOREST_PLACEMENT_BLOCK);
+    m_cylinderPlacementShader =
+        build(CYLINDER_VERTEX_SHADER, CYLINDER_FRAGMENT_SHADER, FOREST_PLACEMENT_BLOCK);
+    m_decorationPlacementShader =
+        build(DECORATION_VERTEX_SHADER, DECORATION_FRAGMENT_SHADER, FOREST_PLACEMENT_BLOCK);
+
+    m_floorShader = build(FLOOR_VERTEX_SHADER, FLOOR_FRAGMENT_SHADER, "");
+
+    // Pasada de sombra: las ramas no necesitan sombreado; las decoraciones usan sus shaders,
+    // cuyo discard recorta del quad el contorno de hojas y petalos
+    m_cylinderDepthShader = build(CYLINDER_VERTEX_SHADER, DEPTH_FRAGMENT_SHADER, "");
+    m_cylinderDepthCompactShader = build(CYLINDER_VERTEX_SHADER, DEPTH_FRAGMENT_SHADER, COMPACT);
+
+    return m_lineShader && m_lineCompactShader && m_cylinderShader && m_cylinderCompactShader &&
+           m_decorationShader && m_decorationCompactShader && m_linePlacementShader &&
+           m_cylinderPlacementShader && m_decorationPlacementShader && m_floorShader &&
+           m_cylinderDepthShader && m_cylinderDepthCompactShader;
 }
 
 // =============================================================================
@@ -722,137 +960,1149 @@ bool TurtleGraphics::compileShaders() {
 // =============================================================================
 
 void TurtleGraphics::interpret(const std::string& lsystemString, float angle) {
-    clear();
+    buildGeometry(lsystemString, angle);
+    finishInterpretation();
+}
 
-    // Reset turtle to initial state
-    m_currentState = TurtleState{};
-    m_currentState.width = m_initialWidth;
-    m_currentState.color = m_branchColor;
+void TurtleGraphics::interpret(const LSystem& lsystem, float angle) {
+    buildGeometry(lsystem, angle);
+    finishInterpretation();
+}
 
-    // Clear state stack
-    while (!m_stateStack.empty()) {
-        m_stateStack.pop();
-    }
+bool TurtleGraphics::buildGeometry(const std::string& lsystemString, float angle,
+                                   const ProgressCallback& progress) {
+    ProfileScope scope(ProfileStage::Interpret);
+    resetTurtle(angle);
 
-    // Process each command in the L-System string
-    for (char cmd : lsystemString) {
-        processCommand(cmd, angle);
+    // La ruta de referencia de Rodrigues interpreta la cadena simbolo por simbolo
+    if (!m_fastRotations) {
+        reserveGeometry(countGeometry(lsystemString));
+
+        // Procesar la cadena por bloques: el callback de progreso queda fuera del ciclo caliente
+        const size_t length = lsystemString.size();
+        for (size_t begin = 0; begin < length; begin += PROGRESS_INTERVAL) {
+            if (progress && !progress(static_cast<float>(begin) / static_cast<float>(length)))
+                return false;
+
+            const size_t end = std::min(length, begin + PROGRESS_INTERVAL);
+            for (size_t i = begin; i < end; ++i) {
+                processCommand(lsystemString[i], angle);
+            }
+        }
+        return true;
     }
 
-    // Upload geometry to GPU
-    uploadBranchData();
-    uploadDecorationData();
+    return runCompiledProgram(programFor(lsystemString, angle), lsystemString.size(), progress);
+}
 
-    std::cout << "TurtleGraphics: Generated " << m_branches.size() << " branches, "
-              << m_decorations.size() << " decorations\n";
+bool TurtleGraphics::buildGeometry(const PackedString& packed, float angle,
+                                   const ProgressCallback& progress) {
+    ProfileScope scope(ProfileStage::Interpret);
+    resetTurtle(angle);
+
+    if (!m_fastRotations) {
+        reserveGeometry(countGeometry(packed));
+
+        const size_t length = packed.size();
+        size_t done = 0;
+        size_t nextReport = 0;
+        PackedString::Reader reader(packed);
+        uint8_t code = 0;
+        size_t count = 0;
+        while (reader.next(code, count)) {
+            if (done >= nextReport) {
+                if (progress && !progress(static_cast<float>(done) / static_cast<float>(length)))
+                    return false;
+                nextReport = done + PROGRESS_INTERVAL;
+            }
+            const char cmd = packed.symbolOf(code);
+            for (size_t n = 0; n < count; ++n) {
+                processCommand(cmd, angle);
+            }
+            done += count;
+        }
+        return true;
+    }
+
+    return runCompiledProgram(programFor(packed, angle), packed.size(), progress);
 }
 
-void TurtleGraphics::processCommand(char cmd, float angle) {
-    switch (cmd) {
-        // ---------------------------------------------------------------------
-        // Movement Commands
-        // ---------------------------------------------------------------------
-        case 'F':
-        case 'G':
-        case 'A':
-        case 'B': {
-            // Move forward and draw a branch segment
-            glm::vec3 endPos = m_currentState.position + m_currentState.heading * m_stepSize;
+bool TurtleGraphics::buildGeometry(const LSystem& lsystem, float angle,
+                                   const ProgressCallback& progress) {
+    if (lsystem.isPacked())
+        return buildGeometry(lsystem.getPackedString(), angle, progress);
+    return buildGeometry(lsystem.getString(), lsystem.getParameters(), angle, progress);
+}
 
-            BranchData branch{};
-            branch.start = m_currentState.position;
-            branch.end = endPos;
-            branch.radiusStart = m_currentState.width;
-            branch.radiusEnd = m_currentState.width * m_widthDecay;
-            branch.color = m_currentState.color;
-            m_branches.push_back(branch);
+bool TurtleGraphics::runCompiledProgram(const TurtleProgram& program, size_t length,
+                                        const ProgressCallback& progress) {
+    reserveGeometry(program.counts);
 
-            m_currentState.position = endPos;
-            break;
+    if (m_parallelInterpretation && length >= PARALLEL_MIN_SYMBOLS) {
+        unsigned threads =
+            m_interpretThreads != 0 ? m_interpretThreads : std::thread::hardware_concurrency();
+        if (threads > 1) {
+            return buildGeometryParallel(program, threads, progress);
         }
+    }
+    return runProgram(program, 0, program.ops.size(), progress);
+}
 
-        case 'f': {
-            // Move forward without drawing
-            m_currentState.position += m_currentState.heading * m_stepSize;
-            break;
+bool TurtleGraphics::buildGeometry(const std::string& lsystemString,
+                                   const std::vector<float>& parameters, float angle,
+                                   const ProgressCallback& progress) {
+    if (parameters.empty())
+        return buildGeometry(lsystemString, angle, progress);
+
+    ProfileScope scope(ProfileStage::Interpret);
+    resetTurtle(angle);
+
+    // Los marcadores no son comandos, asi el histograma sigue contando la geometria exacta.
+    // El programa compilado no tiene argumentos: las cadenas parametricas van simbolo por simbolo.
+    reserveGeometry(countGeometry(lsystemString));
+
+    const size_t length = lsystemString.size();
+    const float* values = parameters.data();
+    size_t i = 0;
+    while (i < length) {
+        if (progress && !progress(static_cast<float>(i) / static_cast<float>(length)))
+            return false;
+
+        const size_t end = std::min(length, i + PROGRESS_INTERVAL);
+        while (i < end) {
+            const char cmd = lsystemString[i++];
+            int count = 0;
+            if (i < length && isParameterMarker(lsystemString[i])) {
+                count = lsystemString[i++];
+            }
+            processModule(cmd, values, count, angle);
+            values += count;
         }
+    }
+    return true;
+}
 
-        // ---------------------------------------------------------------------
-        // Rotation Commands
-        // ---------------------------------------------------------------------
-        case '+': {
-            // Turn left (yaw positive)
-            glm::vec3 axis = m_is3D ? m_currentState.up : glm::vec3(0.0F, 0.0F, 1.0F);
-            m_currentState.heading = rotateAroundAxis(m_currentState.heading, axis, angle);
-            m_currentState.left = rotateAroundAxis(m_currentState.left, axis, angle);
-            break;
+template <typename ForEachRun>
+void TurtleGraphics::compileProgram(ForEachRun&& forEachRun, float angle, size_t hash,
+                                    size_t length) {
+    TurtleProgram& program = m_program;
+    program.ops.clear();
+    program.rotations.clear();
+    program.counts = GeometryCounts{};
+
+    // Rotacion que aplica cada simbolo, igual que processCommand con la
+    // tabla de rotaciones: los giros tipo yaw son sobre Z del mundo en modo 2D
+    struct SymbolRotation {
+        const glm::mat3* matrix{nullptr};
+        bool world{false};
+    };
+    std::array<SymbolRotation, 256> rotationOf{};
+    auto setTurn = [&](char symbol, const glm::mat3& local, const glm::mat3& world) {
+        rotationOf[static_cast<unsigned char>(symbol)] =
+            m_is3D ? SymbolRotation{&local, false} : SymbolRotation{&world, true};
+    };
+    auto setLocal = [&](char symbol, const glm::mat3& local) {
+        rotationOf[static_cast<unsigned char>(symbol)] = SymbolRotation{&local, false};
+    };
+    setTurn('+', m_rotations.yawLeft, m_rotations.worldLeft);
+    setTurn('-', m_rotations.yawRight, m_rotations.worldRight);
+    setTurn('|', m_rotations.turnAround, m_rotations.worldTurn);
+    setLocal('&', m_rotations.pitchDown);
+    setLocal('^', m_rotations.pitchUp);
+    setLocal('\\', m_rotations.rollLeft);
+    setLocal('/', m_rotations.rollRight);
+
+    // El resto de comandos; los simbolos omitidos son variables y no generan nada
+    constexpr uint8_t NO_OP = 0xFF;
+    std::array<uint8_t, 256> opOf;
+    opOf.fill(NO_OP);
+    auto setOp = [&opOf](const char* symbols, TurtleOp op) {
+        for (const char* c = symbols; *c != '\0'; ++c) {
+            opOf[static_cast<unsigned char>(*c)] = static_cast<uint8_t>(op);
         }
-
-        case '-': {
-            // Turn right (yaw negative)
-            glm::vec3 axis = m_is3D ? m_currentState.up : glm::vec3(0.0F, 0.0F, 1.0F);
-            m_currentState.heading = rotateAroundAxis(m_currentState.heading, axis, -angle);
-            m_currentState.left = rotateAroundAxis(m_currentState.left, axis, -angle);
-            break;
+    };
+    setOp("FGAB", TurtleOp::Draw);
+    setOp("f", TurtleOp::Move);
+    setOp("[", TurtleOp::Push);
+    setOp("]", TurtleOp::Pop);
+    setOp("Ll", TurtleOp::Leaf);
+    setOp("Kk", TurtleOp::Flower);
+    setOp("!", TurtleOp::Thin);
+    setOp("'", TurtleOp::Shade);
+
+    // Cada racha distinta de giros se multiplica una vez. La clave de una racha son sus
+    // codigos de giro, 3 bits cada uno (1..7), asi caben hasta 21 giros; las rachas
+    // mas largas se dividen.
+    std::array<uint8_t, 256> turnCode{};
+    const char* turnSymbols = "+-|&^\\/";
+    for (uint8_t code = 1; code <= 7; ++code) {
+        turnCode[static_cast<unsigned char>(turnSymbols[code - 1])] = code;
+    }
+    constexpr int MAX_RUN = 21;
+
+    std::unordered_map<uint64_t, uint32_t> foldedIndex;
+    auto foldRun = [&](uint64_t key, int length, bool world) {
+        glm::mat3 folded(1.0F);
+        for (int i = 0; i < length; ++i) {
+            const auto code = static_cast<int>((key >> (3 * i)) & 7U);
+            const glm::mat3& rotation =
+                *rotationOf[static_cast<unsigned char>(turnSymbols[code - 1])].matrix;
+            // Los giros locales se componen a la derecha del marco, los del mundo a la izquierda
+            folded = world ? rotation * folded : folded * rotation;
         }
+        auto index = static_cast<uint32_t>(program.rotations.size());
+        program.rotations.push_back(folded);
+        foldedIndex.emplace(key, index);
+        return index;
+    };
 
-        case '&': {
-            // Pitch down
-            m_currentState.heading =
-                rotateAroundAxis(m_currentState.heading, m_currentState.left, angle);
-            m_currentState.up = rotateAroundAxis(m_currentState.up, m_currentState.left, angle);
-            break;
-        }
+    // Los giros sueltos van primero, asi una tabla llena puede recurrir a una op por giro
+    for (uint8_t code = 1; code <= 7; ++code) {
+        foldRun(code, 1, rotationOf[static_cast<unsigned char>(turnSymbols[code - 1])].world);
+    }
 
-        case '^': {
-            // Pitch up
-            m_currentState.heading =
-                rotateAroundAxis(m_currentState.heading, m_currentState.left, -angle);
-            m_currentState.up = rotateAroundAxis(m_currentState.up, m_currentState.left, -angle);
-            break;
+    uint64_t runKey = 0;
+    int runLength = 0;
+    bool runWorld = false;
+    auto flushRun = [&]() {
+        if (runLength == 0)
+            return;
+        const TurtleOp op = runWorld ? TurtleOp::RotateWorld : TurtleOp::RotateLocal;
+        auto found = foldedIndex.find(runKey);
+        if (found != foldedIndex.end()) {
+            program.ops.push_back(encodeOp(op, found->second));
+        } else if (program.rotations.size() < OP_ARG_LIMIT) {
+            program.ops.push_back(encodeOp(op, foldRun(runKey, runLength, runWorld)));
+        } else {
+            for (int i = 0; i < runLength; ++i) {
+                program.ops.push_back(encodeOp(op, foldedIndex.at((runKey >> (3 * i)) & 7U)));
+            }
         }
+        runKey = 0;
+        runLength = 0;
+    };
 
-        case '\\': {
-            // Roll left
-            m_currentState.left =
-                rotateAroundAxis(m_currentState.left, m_currentState.heading, angle);
-            m_currentState.up = rotateAroundAxis(m_currentState.up, m_currentState.heading, angle);
-            break;
+    // Une repeticiones en la ultima op (FF, !!, ]]...); las rachas de la fuente llegan completas
+    auto appendOp = [&program](TurtleOp op, size_t count) {
+        if (!program.ops.empty() && opCode(program.ops.back()) == op) {
+            const size_t room = OP_ARG_LIMIT - opArg(program.ops.back());
+            const size_t merged = std::min(room, count);
+            program.ops.back() += static_cast<uint32_t>(merged) << 8;
+            count -= merged;
         }
-
-        case '/': {
-            // Roll right
-            m_currentState.left =
-                rotateAroundAxis(m_currentState.left, m_currentState.heading, -angle);
-            m_currentState.up = rotateAroundAxis(m_currentState.up, m_currentState.heading, -angle);
-            break;
+        while (count > 0) {
+            const size_t taken = std::min<size_t>(OP_ARG_LIMIT, count);
+            program.ops.push_back(encodeOp(op, static_cast<uint32_t>(taken)));
+            count -= taken;
         }
+    };
 
-        case '|': {
-            // Turn around (180 degrees)
-            glm::vec3 axis = m_is3D ? m_currentState.up : glm::vec3(0.0F, 0.0F, 1.0F);
-            m_currentState.heading = rotateAroundAxis(m_currentState.heading, axis, 180.0F);
-            m_currentState.left = rotateAroundAxis(m_currentState.left, axis, 180.0F);
-            break;
+    size_t depth = 0;
+    forEachRun([&](char c, size_t count) {
+        const auto index = static_cast<unsigned char>(c);
+
+        if (rotationOf[index].matrix != nullptr) {
+            for (size_t n = 0; n < count; ++n) {
+                // Giros locales y del mundo no conmutan: solo se pliegan rachas de un tipo
+                if (runLength == MAX_RUN ||
+                    (runLength > 0 && rotationOf[index].world != runWorld)) {
+                    flushRun();
+                }
+                runWorld = rotationOf[index].world;
+                runKey |= static_cast<uint64_t>(turnCode[index]) << (3 * runLength++);
+            }
+            return;
         }
-
-        // ---------------------------------------------------------------------
-        // Branching Commands
-        // ---------------------------------------------------------------------
-        case '[': {
-            // Push current state (start branch)
-            m_stateStack.push(m_currentState);
-            m_currentState.depth++;
-            m_currentState.width *= m_widthDecay;
-            break;
+        if (opOf[index] == NO_OP)
+            return;
+
+        flushRun();
+        const auto op = static_cast<TurtleOp>(opOf[index]);
+        switch (op) {
+            case TurtleOp::Draw:
+                program.counts.branches += count;
+                break;
+            case TurtleOp::Leaf:
+                program.counts.leaves += count;
+                break;
+            case TurtleOp::Flower:
+                program.counts.flowers += count;
+                break;
+            case TurtleOp::Push:
+                depth += count;
+                program.counts.maxDepth = std::max(program.counts.maxDepth, depth);
+                break;
+            case TurtleOp::Pop:
+                depth -= std::min(depth, count);
+                break;
+            default:
+                break;
+        }
+        appendOp(op, count);
+    });
+    flushRun();
+
+    program.sourceHash = hash;
+    program.sourceLength = length;
+    program.angle = angle;
+    program.is3D = m_is3D;
+    program.valid = true;
+}
+
+bool TurtleGraphics::programMatches(size_t hash, size_t length, float angle) const {
+    if (m_program.valid && m_program.sourceHash == hash && m_program.sourceLength == length &&
+        m_program.angle == angle && m_program.is3D == m_is3D) {
+        std::cout << "TurtleGraphics: Reusing compiled program (" << m_program.ops.size()
+                  << " ops)\n";
+        return true;
+    }
+    return false;
+}
+
+const TurtleGraphics::TurtleProgram& TurtleGraphics::programFor(const std::string& lsystemString,
+                                                                float angle) {
+    const size_t hash = std::hash<std::string>{}(lsystemString);
+    if (programMatches(hash, lsystemString.size(), angle))
+        return m_program;
+
+    compileProgram(
+        [&lsystemString](auto&& emit) {
+            for (char c : lsystemString) {
+                emit(c, 1);
+            }
+        },
+        angle, hash, lsystemString.size());
+    std::cout << "TurtleGraphics: Compiled " << lsystemString.size() << " symbols into "
+              << m_program.ops.size() << " ops, " << m_program.rotations.size()
+              << " folded rotations\n";
+    return m_program;
+}
+
+const TurtleGraphics::TurtleProgram& TurtleGraphics::programFor(const PackedString& packed,
+                                                                float angle) {
+    const size_t hash = packed.hash();
+    if (programMatches(hash, packed.size(), angle))
+        return m_program;
+
+    // Las rachas completas van directo a las ops codificadas por longitud
+    compileProgram(
+        [&packed](auto&& emit) {
+            PackedString::Reader reader(packed);
+            uint8_t code = 0;
+            size_t count = 0;
+            while (reader.next(code, count)) {
+                emit(packed.symbolOf(code), count);
+            }
+        },
+        angle, hash, packed.size());
+    std::cout << "TurtleGraphics: Compiled " << packed.size() << " packed symbols ("
+              << packed.getNibbleCount() << " codes) into " << m_program.ops.size() << " ops, "
+              << m_program.rotations.size() << " folded rotations\n";
+    return m_program;
+}
+
+bool TurtleGraphics::runProgram(const TurtleProgram& program, size_t begin, size_t end,
+                                const ProgressCallback& progress) {
+    const uint32_t* ops = program.ops.data();
+
+    // Procesar por bloques para dejar el callback de progreso fuera del ciclo caliente
+    for (size_t chunk = begin; chunk < end; chunk += PROGRESS_INTERVAL) {
+        if (progress &&
+            !progress(static_cast<float>(chunk - begin) / static_cast<float>(end - begin)))
+            return false;
+
+        const size_t chunkEnd = std::min(end, chunk + PROGRESS_INTERVAL);
+        for (size_t i = chunk; i < chunkEnd; ++i) {
+            const uint32_t arg = opArg(ops[i]);
+            switch (opCode(ops[i])) {
+                case TurtleOp::Draw:
+                    for (uint32_t n = 0; n < arg; ++n) {
+                        drawSegment();
+                    }
+                    break;
+                case TurtleOp::Move:
+                    for (uint32_t n = 0; n < arg; ++n) {
+                        m_currentState.position += m_currentState.heading;
+                    }
+                    break;
+                case TurtleOp::RotateLocal:
+                    rotateFrame(program.rotations[arg]);
+                    break;
+                case TurtleOp::RotateWorld: {
+                    const glm::mat3& rotation = program.rotations[arg];
+                    m_currentState.heading = rotation * m_currentState.heading;
+                    m_currentState.left = rotation * m_currentState.left;
+                    break;
+                }
+                case TurtleOp::Push:
+                    for (uint32_t n = 0; n < arg; ++n) {
+                        pushState();
+                    }
+                    break;
+                case TurtleOp::Pop:
+                    for (uint32_t n = 0; n < arg; ++n) {
+                        popState();
+                    }
+                    break;
+                case TurtleOp::Leaf:
+                    for (uint32_t n = 0; n < arg; ++n) {
+                        emitDecoration(m_leaves, 1.0F);
+                    }
+                    break;
+                case TurtleOp::Flower:
+                    for (uint32_t n = 0; n < arg; ++n) {
+                        emitDecoration(m_flowers, 1.5F);
+                    }
+                    break;
+                case TurtleOp::Thin:
+                    for (uint32_t n = 0; n < arg; ++n) {
+                        m_currentState.width *= m_widthDecay;
+                    }
+                    break;
+                case TurtleOp::Shade:
+                    for (uint32_t n = 0; n < arg; ++n) {
+                        shadeGreener();
+                    }
+                    break;
+            }
+        }
+    }
+    return true;
+}
+
+bool TurtleGraphics::buildGeometryParallel(const TurtleProgram& program, unsigned threads,
+                                           const ProgressCallback& progress) {
+    // Geometria emitida por una pieza del programa, dentro de los buffers de alguna tortuga
+    struct PieceGeometry {
+        const TurtleGraphics* source{nullptr};
+        size_t branchBegin{0}, branchEnd{0};
+        size_t leafBegin{0}, leafEnd{0};
+        size_t flowerBegin{0}, flowerEnd{0};
+        size_t spanBegin{0}, spanEnd{0};
+    };
+    auto beginPiece = [](const TurtleGraphics& turtle) {
+        PieceGeometry piece;
+        piece.source = &turtle;
+        piece.branchBegin = turtle.m_branches.size();
+        piece.leafBegin = turtle.m_leaves.size();
+        piece.flowerBegin = turtle.m_flowers.size();
+        piece.spanBegin = turtle.m_spans.size();
+        return piece;
+    };
+    auto endPiece = [](PieceGeometry& piece) {
+        piece.branchEnd = piece.source->m_branches.size();
+        piece.leafEnd = piece.source->m_leaves.size();
+        piece.flowerEnd = piece.source->m_flowers.size();
+        piece.spanEnd = piece.source->m_spans.size();
+    };
+
+    // Subarbol de primer nivel: ops [begin, end) y el estado de la tortuga en su primer push
+    struct Subtree {
+        size_t begin;
+        size_t end;
+        TurtleState entry;
+        size_t piece;  ///< Index into 'pieces'
+    };
+
+    // La fusion depende de la rama emitida antes, asi que cada pieza se construye
+    // sin fusionar y los segmentos se fusionan en orden al concatenar
+    auto makeBuilder = [this, &program]() {
+        auto builder = std::make_unique<TurtleGraphics>();
+        builder->copySettings(*this);
+        builder->m_coalesceSegments = false;
+        builder->resetTurtle(program.angle);
+        return builder;
+    };
+
+    // Recorrido: ejecutar solo el primer nivel, saltando cada subarbol. Fuera de
+    // corchetes la pila de estados esta vacia, asi un pop sin pareja no hace nada aqui
+    // igual que en la ejecucion serial.
+    const uint32_t* ops = program.ops.data();
+    const size_t opCount = program.ops.size();
+    std::unique_ptr<TurtleGraphics> trunk = makeBuilder();
+    std::vector<PieceGeometry> pieces;
+    std::vector<Subtree> subtrees;
+    size_t subtreeOps = 0;
+
+    for (size_t i = 0; i < opCount;) {
+        PieceGeometry piece = beginPiece(*trunk);
+        const size_t trunkBegin = i;
+        while (i < opCount && opCode(ops[i]) != TurtleOp::Push) {
+            ++i;
+        }
+        trunk->runProgram(program, trunkBegin, i, nullptr);
+        endPiece(piece);
+        pieces.push_back(piece);
+        if (i == opCount)
+            break;
+
+        // Un corchete sin cerrar extiende su subarbol hasta el final del programa
+        size_t end = i;
+        int64_t depth = 0;
+        do {
+            const TurtleOp op = opCode(ops[end]);
+            depth += (op == TurtleOp::Push) ? opArg(ops[end]) : 0;
+            depth -= (op == TurtleOp::Pop) ? opArg(ops[end]) : 0;
+            ++end;
+        } while (end < opCount && depth > 0);
+
+        subtrees.push_back({i, end, trunk->m_currentState, pieces.size()});
+        pieces.emplace_back();
+        subtreeOps += end - i;
+        i = end;
+    }
+
+    // Grupos contiguos de subarboles con aproximadamente el mismo numero de ops
+    const size_t groups = std::max<size_t>(1, std::min<size_t>(threads, subtrees.size()));
+    std::vector<size_t> groupBegin(groups + 1, subtrees.size());
+    groupBegin[0] = 0;
+    for (size_t subtree = 0, group = 1, done = 0; subtree < subtrees.size(); ++subtree) {
+        while (group < groups && done >= subtreeOps * group / groups) {
+            groupBegin[group++] = subtree;
+        }
+        done += subtrees[subtree].end - subtrees[subtree].begin;
+    }
+
+    std::vector<std::unique_ptr<TurtleGraphics>> builders;
+    for (size_t group = 0; group < groups; ++group) {
+        builders.push_back(makeBuilder());
+    }
+
+    // Solo el hilo que llama reporta progreso, asi el callback no necesita candados
+    std::atomic<size_t> processed{opCount - subtreeOps};
+    std::atomic<bool> cancelled{false};
+
+    auto runGroup = [&](size_t group) {
+        TurtleGraphics& builder = *builders[group];
+        for (size_t subtree = groupBegin[group]; subtree < groupBegin[group + 1]; ++subtree) {
+            const Subtree& work = subtrees[subtree];
+            builder.m_currentState = work.entry;
+            builder.m_stateStack.clear();
+            builder.m_spanStack.clear();
+
+            PieceGeometry piece = beginPiece(builder);
+            for (size_t begin = work.begin; begin < work.end; begin += PROGRESS_INTERVAL) {
+                const size_t end = std::min(work.end, begin + PROGRESS_INTERVAL);
+                builder.runProgram(program, begin, end, nullptr);
+
+                const size_t total = processed.fetch_add(end - begin, std::memory_order_relaxed);
+                if (cancelled.load(std::memory_order_relaxed))
+                    return;
+                if (group == 0 && progress &&
+                    !progress(static_cast<float>(total) / static_cast<float>(opCount))) {
+                    cancelled.store(true, std::memory_order_relaxed);
+                    return;
+                }
+            }
+            endPiece(piece);
+            pieces[work.piece] = piece;
+        }
+    };
+
+    std::vector<std::thread> workers;
+    workers.reserve(groups - 1);
+    for (size_t group = 1; group < groups; ++group) {
+        workers.emplace_back(runGroup, group);
+    }
+    runGroup(0);
+    for (auto& worker : workers) {
+        worker.join();
+    }
+    if (cancelled.load())
+        return false;
+
+    // Concatenar en orden, fusionando segmentos como la ejecucion serial
+    std::vector<uint32_t> branchIndex;  // Indice final de cada rama origen (y de su fin)
+    std::vector<uint32_t> spanIndex;    // Indice final de cada tramo origen, o DROPPED_SPAN
+    constexpr uint32_t DROPPED_SPAN = UINT32_MAX;
+    for (const PieceGeometry& piece : pieces) {
+        const TurtleGraphics& source = *piece.source;
+        branchIndex.clear();
+        for (size_t i = piece.branchBegin; i < piece.branchEnd; ++i) {
+            branchIndex.push_back(static_cast<uint32_t>(m_branches.size()));
+            if (!coalesceInto(source.m_branches[i])) {
+                m_branches.push_back(source.m_branches[i]);
+            }
+        }
+        branchIndex.push_back(static_cast<uint32_t>(m_branches.size()));
+
+        // Los tramos de la pieza, movidos a los arreglos finales; una primera rama fusionada
+        // se queda con la rama que extiende. Las piezas se construyeron sin fusionar, asi un
+        // tramo cerrado puede quedar bajo MIN_SPAN_INSTANCES aqui: descartarlo junto con sus
+        // descendientes, como hace popState() en la ejecucion serial.
+        const auto leafOffset = static_cast<uint32_t>(m_leaves.size() - piece.leafBegin);
+        const auto flowerOffset = static_cast<uint32_t>(m_flowers.size() - piece.flowerBegin);
+        spanIndex.assign(piece.spanEnd - piece.spanBegin, DROPPED_SPAN);
+        for (size_t i = piece.spanBegin; i < piece.spanEnd; ++i) {
+            InstanceSpan span = source.m_spans[i];
+            auto remap = [](uint32_t index, uint32_t offset) {
+                return index == InstanceSpan::OPEN ? index : index + offset;
+            };
+            const bool nested = span.parent >= piece.spanBegin && span.parent < i;
+            if (nested && spanIndex[span.parent - piece.spanBegin] == DROPPED_SPAN)
+                continue;
+            span.parent = nested ? spanIndex[span.parent - piece.spanBegin]
+                                 : InstanceSpan::NO_PARENT;
+            span.branchBegin = branchIndex[span.branchBegin - piece.branchBegin];
+            if (span.branchEnd != InstanceSpan::OPEN) {
+                span.branchEnd = branchIndex[span.branchEnd - piece.branchBegin];
+            }
+            span.leafBegin += leafOffset;
+            span.leafEnd = remap(span.leafEnd, leafOffset);
+            span.flowerBegin += flowerOffset;
+            span.flowerEnd = remap(span.flowerEnd, flowerOffset);
+            if (span.branchEnd != InstanceSpan::OPEN &&
+                span.instanceCount() < BranchHierarchy::MIN_SPAN_INSTANCES)
+                continue;
+            spanIndex[i - piece.spanBegin] = static_cast<uint32_t>(m_spans.size());
+            m_spans.push_back(span);
+        }
+        auto range = [](const std::vector<DecorationData>& from, size_t begin, size_t end) {
+            return std::make_pair(from.begin() + static_cast<std::ptrdiff_t>(begin),
+                                  from.begin() + static_cast<std::ptrdiff_t>(end));
+        };
+        auto leaves = range(source.m_leaves, piece.leafBegin, piece.leafEnd);
+        m_leaves.insert(m_leaves.end(), leaves.first, leaves.second);
+        auto flowers = range(source.m_flowers, piece.flowerBegin, piece.flowerEnd);
+        m_flowers.insert(m_flowers.end(), flowers.first, flowers.second);
+    }
+
+    m_currentState = trunk->m_currentState;
+    return true;
+}
+
+void TurtleGraphics::interpret(SymbolStream& symbols, float angle) {
+    buildGeometry(symbols, angle);
+    finishInterpretation();
+}
+
+bool TurtleGraphics::buildGeometry(SymbolStream& symbols, float angle,
+                                   const ProgressCallback& progress) {
+    ProfileScope scope(ProfileStage::Interpret);
+    resetTurtle(angle);
+
+    // Consumir simbolos directo de la derivacion, uno a la vez. La longitud total
+    // no se conoce de antemano, asi que el progreso se reporta como indeterminado.
+    char cmd = 0;
+    size_t ticks = 0;
+    if (symbols.isExtended()) {
+        const float* values = nullptr;
+        int count = 0;
+        while (symbols.next(cmd, m_currentBirth, values, count)) {
+            processModule(cmd, values, count, angle);
+            if (++ticks == PROGRESS_INTERVAL) {
+                ticks = 0;
+                if (progress && !progress(-1.0F))
+                    return false;
+            }
+        }
+    } else {
+        while (symbols.next(cmd, m_currentBirth)) {
+            processCommand(cmd, angle);
+            if (++ticks == PROGRESS_INTERVAL) {
+                ticks = 0;
+                if (progress && !progress(-1.0F))
+                    return false;
+            }
+        }
+    }
+    finishGrowth();
+    return true;
+}
+
+void TurtleGraphics::finishGrowth() {
+    // El orden de emision reparte las instancias de cada generacion de nacimiento g en [g, g + 1)
+    size_t generations = 0;
+    auto spread = [&generations](auto& instances) {
+        std::vector<size_t> counts;
+        for (const auto& instance : instances) {
+            auto generation = static_cast<size_t>(instance.birth);
+            if (generation >= counts.size()) {
+                counts.resize(generation + 1, 0);
+            }
+            counts[generation]++;
+        }
+
+        std::vector<size_t> order(counts.size(), 0);
+        for (auto& instance : instances) {
+            auto generation = static_cast<size_t>(instance.birth);
+            instance.birth += static_cast<float>(order[generation]++) /
+                              static_cast<float>(counts[generation]);
+        }
+        generations = std::max(generations, counts.size());
+    };
+    spread(m_branches);
+    spread(m_leaves);
+    spread(m_flowers);
+
+    m_growthDuration = generations == 0 ? 0.0F : static_cast<float>(generations) + GROWTH_RAMP;
+}
+
+void TurtleGraphics::interpretMemoized(const LSystem& lsystem, int generations, float angle) {
+    buildGeometryMemoized(lsystem, generations, angle);
+
+    std::cout << "TurtleGraphics: " << m_subtreeCache.size() << " subtrees cached, "
+              << m_subtreeCacheHits << " reused\n";
+
+    finishInterpretation();
+}
+
+bool TurtleGraphics::buildGeometryMemoized(const LSystem& lsystem, int generations, float angle,
+                                           const ProgressCallback& progress) {
+    m_subtreeCache.clear();
+    m_subtreeCacheHits = 0;
+
+    // Las expansiones estocasticas o parametricas difieren entre apariciones de un simbolo,
+    // asi que no hay nada que reusar. stream() arma tablas de forma perezosa, de ahi la copia.
+    if (lsystem.isExtended()) {
+        LSystem derivation = lsystem;
+        SymbolStream symbols = derivation.stream(generations);
+        return buildGeometry(symbols, angle, progress);
+    }
+
+    ProfileScope scope(ProfileStage::Interpret);
+    resetTurtle(angle);
+
+    m_progress = progress ? &progress : nullptr;
+    m_progressTicks = 0;
+    m_cancelled = false;
+
+    // Busqueda plana de reglas para recorrer la derivacion
+    m_memoRules.fill(nullptr);
+    for (const auto& [symbol, replacement] : lsystem.getRules()) {
+        m_memoRules[static_cast<unsigned char>(symbol)] = &replacement;
+    }
+
+    // Un simbolo solo puede cachearse si toda su expansion mantiene la pila balanceada
+    // (nunca saca estado apilado fuera del subarbol). Partir de las reglas cuyo
+    // texto esta balanceado y descartar las que usan un simbolo no cacheable.
+    bool bracketsRewritten = m_memoRules['['] != nullptr || m_memoRules[']'] != nullptr;
+    for (int i = 0; i < 256; ++i) {
+        bool balanced = m_memoRules[i] != nullptr && m_is3D && !bracketsRewritten;
+        if (balanced) {
+            int depth = 0;
+            for (char c : *m_memoRules[i]) {
+                depth += (c == '[') ? 1 : (c == ']') ? -1 : 0;
+                if (depth < 0)
+                    break;
+            }
+            balanced = depth == 0;
+        }
+        m_memoCacheable[i] = balanced;
+    }
+    for (bool changed = true; changed;) {
+        changed = false;
+        for (int i = 0; i < 256; ++i) {
+            if (!m_memoCacheable[i])
+                continue;
+            for (char c : *m_memoRules[i]) {
+                auto index = static_cast<unsigned char>(c);
+                if (m_memoRules[index] != nullptr && !m_memoCacheable[index]) {
+                    m_memoCacheable[i] = false;
+                    changed = true;
+                    break;
+                }
+            }
+        }
+    }
+
+    for (char symbol : lsystem.getAxiom()) {
+        emitSubtree(symbol, generations, angle);
+    }
+
+    m_progress = nullptr;
+    return !m_cancelled;
+}
+
+bool TurtleGraphics::pollProgress() {
+    // Solo cada PROGRESS_INTERVAL simbolos emitidos llegan al callback
+    if (m_progress != nullptr && ++m_progressTicks == PROGRESS_INTERVAL) {
+        m_progressTicks = 0;
+        m_cancelled = !(*m_progress)(-1.0F);
+    }
+    return !m_cancelled;
+}
+
+void TurtleGraphics::emitSubtree(char symbol, int remaining, float angle) {
+    // Un trabajo cancelado se deshace sin emitir nada mas
+    if (m_cancelled)
+        return;
+
+    auto index = static_cast<unsigned char>(symbol);
+    const std::string* rule = m_memoRules[index];
+
+    // Simbolo terminal: interpretarlo directamente
+    if (remaining == 0 || rule == nullptr) {
+        processCommand(symbol, angle);
+        pollProgress();
+        return;
+    }
+
+    // Las expansiones no balanceadas deben ver la pila real: expandir sin cache
+    if (!m_memoCacheable[index]) {
+        for (char child : *rule) {
+            emitSubtree(child, remaining - 1, angle);
+        }
+        return;
+    }
+
+    uint32_t key = (static_cast<uint32_t>(index) << 16) | static_cast<uint32_t>(remaining);
+    auto it = m_subtreeCache.find(key);
+    if (it != m_subtreeCache.end()) {
+        m_subtreeCacheHits++;
+        applySubtree(it->second);
+        return;
+    }
+
+    SubtreeBlock& block = m_subtreeCache[key];
+    block = recordSubtree(*rule, remaining, angle);
+    applySubtree(block);
+}
+
+TurtleGraphics::SubtreeBlock TurtleGraphics::recordSubtree(const std::string& rule, int remaining,
+                                                           float angle) {
+    TurtleState entry = m_currentState;
+    size_t firstBranch = m_branches.size();
+    size_t firstLeaf = m_leaves.size();
+    size_t firstFlower = m_flowers.size();
+    size_t firstSpan = m_spans.size();
+
+    // El bloque no debe extender ramas registradas fuera de el
+    size_t outerFloor = m_coalesceFloor;
+    size_t outerCoalesced = m_coalescedSegments;
+    m_coalesceFloor = firstBranch;
+
+    // Expandir en espacio local: marco canonico en el origen, ancho unitario, sin tono
+    m_currentState = TurtleState{};
+
+    for (char child : rule) {
+        emitSubtree(child, remaining - 1, angle);
+    }
+
+    SubtreeBlock block;
+    block.branches.assign(m_branches.begin() + static_cast<std::ptrdiff_t>(firstBranch),
+                          m_branches.end());
+    block.leaves.assign(m_leaves.begin() + static_cast<std::ptrdiff_t>(firstLeaf), m_leaves.end());
+    block.flowers.assign(m_flowers.begin() + static_cast<std::ptrdiff_t>(firstFlower),
+                         m_flowers.end());
+    block.exit = m_currentState;
+    block.coalesced = m_coalescedSegments - outerCoalesced;
+
+    // La expansion esta balanceada: todos sus tramos estan cerrados
+    for (size_t i = firstSpan; i < m_spans.size(); ++i) {
+        InstanceSpan span = m_spans[i];
+        span.parent = span.parent != InstanceSpan::NO_PARENT && span.parent >= firstSpan
+                          ? static_cast<uint32_t>(span.parent - firstSpan)
+                          : InstanceSpan::NO_PARENT;
+        span.branchBegin -= static_cast<uint32_t>(firstBranch);
+        span.branchEnd -= static_cast<uint32_t>(firstBranch);
+        span.leafBegin -= static_cast<uint32_t>(firstLeaf);
+        span.leafEnd -= static_cast<uint32_t>(firstLeaf);
+        span.flowerBegin -= static_cast<uint32_t>(firstFlower);
+        span.flowerEnd -= static_cast<uint32_t>(firstFlower);
+        block.spans.push_back(span);
+    }
+
+    m_branches.resize(firstBranch);
+    m_leaves.resize(firstLeaf);
+    m_flowers.resize(firstFlower);
+    m_spans.resize(firstSpan);
+    m_currentState = entry;
+    m_coalesceFloor = outerFloor;
+    m_coalescedSegments = outerCoalesced;
+    return block;
+}
+
+void TurtleGraphics::applySubtree(const SubtreeBlock& block) {
+    // Local -> mundo: el marco canonico (H = +Y, L = -X, U = +Z) va al de la tortuga
+    const glm::mat3 frame(-m_currentState.left, m_currentState.heading, m_currentState.up);
+    const glm::mat4 frame4(frame);
+    const glm::vec3 origin = m_currentState.position;
+    const float scale = m_currentState.width;
+    const float shade = m_currentState.shade;
+    const auto firstBranch = static_cast<uint32_t>(m_branches.size());
+    const auto firstLeaf = static_cast<uint32_t>(m_leaves.size());
+    const auto firstFlower = static_cast<uint32_t>(m_flowers.size());
+
+    for (const auto& local : block.branches) {
+        BranchData branch = local;
+        branch.start = origin + frame * local.start;
+        branch.end = origin + frame * local.end;
+        branch.radiusStart *= scale;
+        branch.radiusEnd *= scale;
+        branch.shade += shade;
+        // Misma fusion que processCommand en el borde del bloque, asi el resultado
+        // coincide con interpretar la cadena expandida
+        if (&local == block.branches.data() && coalesceInto(branch)) {
+            continue;
+        }
+        m_branches.push_back(branch);
+    }
+
+    auto placeDecorations = [&](const std::vector<DecorationData>& locals,
+                                std::vector<DecorationData>& out) {
+        for (const auto& local : locals) {
+            DecorationData decoration = local;
+            decoration.position = origin + frame * local.position;
+            decoration.orientation = frame4 * local.orientation;
+            out.push_back(decoration);
+        }
+    };
+    placeDecorations(block.leaves, m_leaves);
+    placeDecorations(block.flowers, m_flowers);
+
+    // Los tramos del bloque cuelgan del '[' que lo encierra; una primera rama fusionada es suya
+    const auto emitted = static_cast<uint32_t>(m_branches.size()) - firstBranch;
+    const uint32_t merged = static_cast<uint32_t>(block.branches.size()) - emitted;
+    const uint32_t outer = m_spanStack.empty() ? InstanceSpan::NO_PARENT : m_spanStack.back();
+    const auto spanBase = static_cast<uint32_t>(m_spans.size());
+    for (InstanceSpan span : block.spans) {
+        span.parent = span.parent == InstanceSpan::NO_PARENT ? outer : spanBase + span.parent;
+        span.branchBegin = firstBranch + std::max(span.branchBegin, merged) - merged;
+        span.branchEnd = firstBranch + std::max(span.branchEnd, merged) - merged;
+        span.leafBegin += firstLeaf;
+        span.leafEnd += firstLeaf;
+        span.flowerBegin += firstFlower;
+        span.flowerEnd += firstFlower;
+        m_spans.push_back(span);
+    }
+
+    m_coalescedSegments += block.coalesced;
+
+    // Avanzar la tortuga al estado de salida del subarbol
+    m_currentState.position = origin + frame * block.exit.position;
+    m_currentState.heading = frame * block.exit.heading;
+    m_currentState.left = frame * block.exit.left;
+    m_currentState.up = frame * block.exit.up;
+    m_currentState.width = scale * block.exit.width;
+    m_currentState.shade = shade + block.exit.shade;
+    m_currentState.depth += block.exit.depth;
+}
+
+bool TurtleGraphics::coalesceInto(const BranchData& branch) {
+    if (!m_coalesceSegments || m_branches.size() <= m_coalesceFloor)
+        return false;
+
+    // Continuacion recta del segmento anterior: alargarlo en su lugar
+    BranchData& last = m_branches.back();
+    if (last.end != branch.start || last.shade != branch.shade ||
+        last.radiusStart != branch.radiusStart)
+        return false;
+    if (glm::dot(glm::normalize(last.end - last.start), glm::normalize(branch.end - branch.start)) <=
+        COALESCE_MIN_COS)
+        return false;
+
+    // El segmento fusionado crece completo desde su parte mas temprana
+    last.end = branch.end;
+    last.birth = std::min(last.birth, branch.birth);
+    m_coalescedSegments++;
+    return true;
+}
+
+void TurtleGraphics::resetTurtle(float angle) {
+    clear();
+    prepareRotations(angle);
+
+    m_coalescedSegments = 0;
+    m_coalesceFloor = 0;
+
+    // Reiniciar la tortuga al estado inicial, en espacio unitario: paso, ancho inicial y
+    // colores los aplican los shaders
+    m_currentState = TurtleState{};
+    m_currentBirth = 0;
+
+    // Limpiar la pila de estados (conserva su memoria para la siguiente cadena)
+    m_stateStack.clear();
+    m_spanStack.clear();
+}
+
+GeometryCounts TurtleGraphics::countGeometry(const std::string& lsystemString) {
+    // Un histograma simple; la profundidad de corchetes es lo unico que depende del orden
+    std::array<size_t, 256> histogram{};
+    size_t depth = 0;
+    size_t maxDepth = 0;
+    for (char c : lsystemString) {
+        histogram[static_cast<unsigned char>(c)]++;
+        if (c == '[') {
+            maxDepth = std::max(maxDepth, ++depth);
+        } else if (c == ']' && depth > 0) {
+            depth--;  // Un ']' sin pareja se ignora, como en processCommand
+        }
+    }
+
+    GeometryCounts counts;
+    counts.branches = histogram['F'] + histogram['G'] + histogram['A'] + histogram['B'];
+    counts.leaves = histogram['L'] + histogram['l'];
+    counts.flowers = histogram['K'] + histogram['k'];
+    counts.maxDepth = maxDepth;
+    return counts;
+}
+
+GeometryCounts TurtleGraphics::countGeometry(const PackedString& packed) {
+    // Por codigo, luego de vuelta a simbolos; un corchete ausente da 0xFF, nunca un codigo
+    std::array<size_t, PackedString::MAX_SYMBOLS> histogram{};
+    const auto push = static_cast<uint8_t>(packed.getAlphabet().find('['));
+    const auto pop = static_cast<uint8_t>(packed.getAlphabet().find(']'));
+    size_t depth = 0;
+    size_t maxDepth = 0;
+    PackedString::Reader reader(packed);
+    uint8_t code = 0;
+    size_t count = 0;
+    while (reader.next(code, count)) {
+        histogram[code] += count;
+        if (code == push) {
+            depth += count;
+            maxDepth = std::max(maxDepth, depth);
+        } else if (code == pop) {
+            depth -= std::min(depth, count);
+        }
+    }
+
+    GeometryCounts counts;
+    for (size_t code = 0; code < packed.getAlphabet().size(); ++code) {
+        switch (packed.symbolOf(static_cast<uint8_t>(code))) {
+            case 'F':
+            case 'G':
+            case 'A':
+            case 'B':
+                counts.branches += histogram[code];
+                break;
+            case 'L':
+            case 'l':
+                counts.leaves += histogram[code];
+                break;
+            case 'K':
+            case 'k':
+                counts.flowers += histogram[code];
+                break;
+            default:
+                break;
+        }
+    }
+    counts.maxDepth = maxDepth;
+    return counts;
+}
+
+void TurtleGraphics::reserveGeometry(const GeometryCounts& counts) {
+    // Una reserva cada uno en lugar de hacer crecer geometricamente vectores muy grandes
+    m_branches.reserve(counts.branches);
+    m_leaves.reserve(counts.leaves);
+    m_flowers.reserve(counts.flowers);
+    m_stateStack.reserve(counts.maxDepth);
+}
+
+void TurtleGraphics::finishInterpretation() {
+    upload();
+
+    std::cout << "TurtleGraphics: Generated " << m_branches.size() << " branches, "
+              << getDecorationCount() << " decorations\n";
+}
+
+void TurtleGraphics::processCommand(char cmd, float angle) {
+    switch (cmd) {
+        // ---------------------------------------------------------------------
+        // Movement Commands
+        // ---------------------------------------------------------------------
+        case 'F':
+        case 'G':
+        case 'A':
+        case 'B': {
+            // Move forward and draw a branch segment
+            drawSegment();
+            break;
+        }
+
+        case 'f': {
+            // Move forward without drawing
+            m_currentState.position += m_currentState.heading;
+            break;
+        }
+
+        // ---------------------------------------------------------------------
+        // Rotation Commands
+        // ---------------------------------------------------------------------
+        case '+': {
+            // Turn left (yaw positive)
+            if (m_fastRotations) {
+                turn(m_rotations.yawLeft, m_rotations.worldLeft);
+                break;
+            }
+            rotateBy(cmd, angle);
+            break;
+        }
+
+        case '-': {
+            // Turn right (yaw negative)
+            if (m_fastRotations) {
+                turn(m_rotations.yawRight, m_rotations.worldRight);
+                break;
+            }
+            rotateBy(cmd, angle);
+            break;
+        }
+
+        case '&': {
+            // Pitch down
+            if (m_fastRotations) {
+                rotateFrame(m_rotations.pitchDown);
+                break;
+            }
+            rotateBy(cmd, angle);
+            break;
+        }
+
+        case '^': {
+            // Pitch up
+            if (m_fastRotations) {
+                rotateFrame(m_rotations.pitchUp);
+                break;
+            }
+            rotateBy(cmd, angle);
+            break;
+        }
+
+        case '\\': {
+            // Roll left
+            if (m_fastRotations) {
+                rotateFrame(m_rotations.rollLeft);
+                break;
+            }
+            rotateBy(cmd, angle);
+            break;
+        }
+
+        case '/': {
+            // Roll right
+            if (m_fastRotations) {
+                rotateFrame(m_rotations.rollRight);
+                break;
+            }
+            rotateBy(cmd, angle);
+            break;
+        }
+
+        case '|': {
+            // Turn around (180 degrees)
+            if (m_fastRotations) {
+                turn(m_rotations.turnAround, m_rotations.worldTurn);
+                break;
+            }
+            rotateBy('+', 180.0F);
+            break;
+        }
+
+        // ---------------------------------------------------------------------
+        // Branching Commands
+        // ---------------------------------------------------------------------
+        case '[': {
+            // Push current state (start branch)
+            pushState();
+            break;
         }
 
         case ']': {
             // Pop state (end branch)
-            if (!m_stateStack.empty()) {
-                m_currentState = m_stateStack.top();
-                m_stateStack.pop();
-            }
+            popState();
             break;
         }
 
@@ -862,37 +2112,14 @@ void TurtleGraphics::processCommand(char cmd, float angle) {
         case 'L':
         case 'l': {
             // Create a leaf
-            DecorationData leaf{};
-            leaf.position = m_currentState.position;
-            leaf.color = m_leafColor;
-            leaf.size = m_leafSize;
-            leaf.type = 0;
-
-            // Build orientation matrix from turtle state vectors
-            glm::vec3 forward = glm::normalize(m_currentState.heading);
-            glm::vec3 right = glm::normalize(glm::cross(forward, m_currentState.up));
-            glm::vec3 up = glm::cross(right, forward);
-            leaf.orientation = glm::mat4(glm::vec4(right, 0.0F), glm::vec4(forward, 0.0F),
-                                         glm::vec4(up, 0.0F), glm::vec4(0.0F, 0.0F, 0.0F, 1.0F));
-            m_decorations.push_back(leaf);
+            emitDecoration(m_leaves, 1.0F);
             break;
         }
 
         case 'K':
         case 'k': {
             // Create a flower
-            DecorationData flower{};
-            flower.position = m_currentState.position;
-            flower.color = m_flowerColor;
-            flower.size = m_leafSize * 1.5F;
-            flower.type = 1;
-
-            glm::vec3 forward = glm::normalize(m_currentState.heading);
-            glm::vec3 right = glm::normalize(glm::cross(forward, m_currentState.up));
-            glm::vec3 up = glm::cross(right, forward);
-            flower.orientation = glm::mat4(glm::vec4(right, 0.0F), glm::vec4(forward, 0.0F),
-                                           glm::vec4(up, 0.0F), glm::vec4(0.0F, 0.0F, 0.0F, 1.0F));
-            m_decorations.push_back(flower);
+            emitDecoration(m_flowers, 1.5F);
             break;
         }
 
@@ -907,8 +2134,7 @@ void TurtleGraphics::processCommand(char cmd, float angle) {
 
         case '\'': {
             // Shift color toward green (for gradient effect on branches)
-            m_currentState.color.g = std::min(1.0F, m_currentState.color.g + 0.05F);
-            m_currentState.color.r = std::max(0.0F, m_currentState.color.r - 0.02F);
+            shadeGreener();
             break;
         }
 
@@ -918,6 +2144,206 @@ void TurtleGraphics::processCommand(char cmd, float angle) {
     }
 }
 
+void TurtleGraphics::processModule(char cmd, const float* values, int count, float angle) {
+    // Un modulo sin parametros es un comando simple
+    if (count == 0) {
+        processCommand(cmd, angle);
+        return;
+    }
+
+    // Los comandos leen su primer parametro; los simbolos sin parametros los ignoran
+    const float value = values[0];
+    switch (cmd) {
+        case 'F':
+        case 'G':
+        case 'A':
+        case 'B':
+            drawSegment(value);
+            break;
+        case 'f':
+            m_currentState.position += m_currentState.heading * value;
+            break;
+        case '+':
+        case '-':
+        case '&':
+        case '^':
+        case '\\':
+        case '/':
+            rotateBy(cmd, value);
+            break;
+        case '!':
+            m_currentState.width = value;
+            break;
+        case 'L':
+        case 'l':
+            emitDecoration(m_leaves, value);
+            break;
+        case 'K':
+        case 'k':
+            emitDecoration(m_flowers, value);
+            break;
+        default:
+            processCommand(cmd, angle);
+            break;
+    }
+}
+
+void TurtleGraphics::rotateBy(char cmd, float degrees) {
+    switch (cmd) {
+        case '+':
+        case '-': {
+            // Giro sobre up (3D) o +Z del mundo (2D)
+            const float yaw = cmd == '+' ? degrees : -degrees;
+            glm::vec3 axis = m_is3D ? m_currentState.up : glm::vec3(0.0F, 0.0F, 1.0F);
+            m_currentState.heading = rotateAroundAxis(m_currentState.heading, axis, yaw);
+            m_currentState.left = rotateAroundAxis(m_currentState.left, axis, yaw);
+            break;
+        }
+        case '&':
+        case '^': {
+            // Cabeceo sobre left
+            const float pitch = cmd == '&' ? degrees : -degrees;
+            m_currentState.heading =
+                rotateAroundAxis(m_currentState.heading, m_currentState.left, pitch);
+            m_currentState.up = rotateAroundAxis(m_currentState.up, m_currentState.left, pitch);
+            break;
+        }
+        case '\\':
+        case '/': {
+            // Alabeo sobre heading
+            const float roll = cmd == '\\' ? degrees : -degrees;
+            m_currentState.left =
+                rotateAroundAxis(m_currentState.left, m_currentState.heading, roll);
+            m_currentState.up = rotateAroundAxis(m_currentState.up, m_currentState.heading, roll);
+            break;
+        }
+        default:
+            break;
+    }
+}
+
+void TurtleGraphics::drawSegment(float length) {
+    glm::vec3 endPos = m_currentState.position + m_currentState.heading * length;
+
+    BranchData branch{};
+    branch.start = m_currentState.position;
+    branch.end = endPos;
+    branch.radiusStart = m_currentState.width;
+    branch.radiusEnd = m_currentState.width * m_widthDecay;
+    branch.shade = m_currentState.shade;
+    branch.birth = static_cast<float>(m_currentBirth);
+    if (!coalesceInto(branch)) {
+        m_branches.push_back(branch);
+    }
+
+    m_currentState.position = endPos;
+}
+
+void TurtleGraphics::pushState() {
+    m_stateStack.push_back(m_currentState);
+    m_currentState.depth++;
+    m_currentState.width *= m_widthDecay;
+
+    // Todo lo emitido hasta el ']' correspondiente es un rango contiguo de instancias
+    InstanceSpan span;
+    span.parent = m_spanStack.empty() ? InstanceSpan::NO_PARENT : m_spanStack.back();
+    span.branchBegin = static_cast<uint32_t>(m_branches.size());
+    span.leafBegin = static_cast<uint32_t>(m_leaves.size());
+    span.flowerBegin = static_cast<uint32_t>(m_flowers.size());
+    m_spanStack.push_back(static_cast<uint32_t>(m_spans.size()));
+    m_spans.push_back(span);
+}
+
+void TurtleGraphics::popState() {
+    // Un ']' sin pareja se ignora
+    if (!m_stateStack.empty()) {
+        m_currentState = m_stateStack.back();
+        m_stateStack.pop_back();
+
+        const uint32_t index = m_spanStack.back();
+        m_spanStack.pop_back();
+        InstanceSpan& span = m_spans[index];
+        span.branchEnd = static_cast<uint32_t>(m_branches.size());
+        span.leafEnd = static_cast<uint32_t>(m_leaves.size());
+        span.flowerEnd = static_cast<uint32_t>(m_flowers.size());
+        // Los subarboles pequenos quedan dentro del nodo de su padre: descartarlos (y sus
+        // descendientes, que los siguen en preorden) de inmediato
+        if (span.instanceCount() < BranchHierarchy::MIN_SPAN_INSTANCES) {
+            m_spans.resize(index);
+        }
+    }
+}
+
+void TurtleGraphics::emitDecoration(std::vector<DecorationData>& out, float size) {
+    DecorationData decoration{};
+    decoration.position = m_currentState.position;
+    decoration.size = size;
+    decoration.birth = static_cast<float>(m_currentBirth);
+
+    // Construir la matriz de orientacion con los vectores de estado de la tortuga
+    glm::vec3 forward = glm::normalize(m_currentState.heading);
+    glm::vec3 right = glm::normalize(glm::cross(forward, m_currentState.up));
+    glm::vec3 up = glm::cross(right, forward);
+    decoration.orientation = glm::mat4(glm::vec4(right, 0.0F), glm::vec4(forward, 0.0F),
+                                       glm::vec4(up, 0.0F), glm::vec4(0.0F, 0.0F, 0.0F, 1.0F));
+    out.push_back(decoration);
+}
+
+void TurtleGraphics::shadeGreener() {
+    // La paleta (shadeColor en los shaders) convierte la cuenta en color
+    m_currentState.shade += 1.0F;
+}
+
+void TurtleGraphics::prepareRotations(float angle) {
+    // Rotaciones en el marco local de la tortuga, derivadas de la formula de Rodrigues con
+    // H x L = U. Las columnas son H, L, U rotados expresados en (H, L, U).
+    auto yaw = [](float deg) {
+        float c = std::cos(glm::radians(deg));
+        float s = std::sin(glm::radians(deg));
+        return glm::mat3(glm::vec3(c, s, 0.0F), glm::vec3(-s, c, 0.0F), glm::vec3(0.0F, 0.0F, 1.0F));
+    };
+    auto pitch = [](float deg) {
+        float c = std::cos(glm::radians(deg));
+        float s = std::sin(glm::radians(deg));
+        return glm::mat3(glm::vec3(c, 0.0F, -s), glm::vec3(0.0F, 1.0F, 0.0F), glm::vec3(s, 0.0F, c));
+    };
+    auto roll = [](float deg) {
+        float c = std::cos(glm::radians(deg));
+        float s = std::sin(glm::radians(deg));
+        return glm::mat3(glm::vec3(1.0F, 0.0F, 0.0F), glm::vec3(0.0F, c, s), glm::vec3(0.0F, -s, c));
+    };
+    m_rotations.yawLeft = yaw(angle);
+    m_rotations.yawRight = yaw(-angle);
+    m_rotations.pitchDown = pitch(angle);
+    m_rotations.pitchUp = pitch(-angle);
+    m_rotations.rollLeft = roll(angle);
+    m_rotations.rollRight = roll(-angle);
+    m_rotations.turnAround = yaw(180.0F);
+
+    // El modo 2D gira sobre +Z del mundo; en coordenadas del mundo esa matriz tiene la
+    // misma forma que un giro local
+    m_rotations.worldLeft = yaw(angle);
+    m_rotations.worldRight = yaw(-angle);
+    m_rotations.worldTurn = yaw(180.0F);
+}
+
+void TurtleGraphics::rotateFrame(const glm::mat3& localRotation) {
+    glm::mat3 frame(m_currentState.heading, m_currentState.left, m_currentState.up);
+    frame = frame * localRotation;
+    m_currentState.heading = frame[0];
+    m_currentState.left = frame[1];
+    m_currentState.up = frame[2];
+}
+
+void TurtleGraphics::turn(const glm::mat3& localRotation, const glm::mat3& worldRotation) {
+    if (m_is3D) {
+        rotateFrame(localRotation);
+    } else {
+        m_currentState.heading = worldRotation * m_currentState.heading;
+        m_currentState.left = worldRotation * m_currentState.left;
+    }
+}
+
 glm::vec3 TurtleGraphics::rotateAroundAxis(const glm::vec3& vec, const glm::vec3& axis,
                                            float angleDeg) {
     // Rodrigues' rotation formula
@@ -933,252 +2359,837 @@ glm::vec3 TurtleGraphics::rotateAroundAxis(const glm::vec3& vec, const glm::vec3
 // Data Upload
 // =============================================================================
 
-void TurtleGraphics::uploadBranchData() {
-    if (m_branches.empty())
+void TurtleGraphics::upload() {
+    buildHierarchy();
+    m_shadowDirty = true;
+    m_uploadCount++;
+
+    m_uploadedCompact = m_compactInstances;
+    if (m_uploadedCompact) {
+        computeInstanceBounds();
+    }
+
+    uploadBranchData();
+    uploadDecorationData();
+
+    // Los divisores de las copias son los conteos de instancias por planta
+    bindPlacementAttributes();
+}
+
+void TurtleGraphics::setCompactInstances(bool enable) {
+    if (m_compactInstances == enable)
         return;
 
-    // For line mode: 2 vertices per branch, 6 floats each (pos + color)
-    std::vector<float> lineData;
-    lineData.reserve(m_branches.size() * 12);
+    m_compactInstances = enable;
+    if (m_initialized) {
+        upload();
+    }
+}
 
-    for (const auto& branch : m_branches) {
-        // Start vertex
-        lineData.push_back(branch.start.x);
-        lineData.push_back(branch.start.y);
-        lineData.push_back(branch.start.z);
-        lineData.push_back(branch.color.r);
-        lineData.push_back(branch.color.g);
-        lineData.push_back(branch.color.b);
-
-        // End vertex
-        lineData.push_back(branch.end.x);
-        lineData.push_back(branch.end.y);
-        lineData.push_back(branch.end.z);
-        lineData.push_back(branch.color.r);
-        lineData.push_back(branch.color.g);
-        lineData.push_back(branch.color.b);
-    }
-
-    glBindBuffer(GL_ARRAY_BUFFER, m_lineVBO);
-    glBufferData(GL_ARRAY_BUFFER, static_cast<GLsizeiptr>(lineData.size() * sizeof(float)),
-                 lineData.data(), GL_DYNAMIC_DRAW);
-
-    // For cylinder mode: instance data
-    std::vector<float> instanceData;
-    instanceData.reserve(m_branches.size() * 11);
+void TurtleGraphics::setCylinderCaps(bool enable) {
+    m_cylinderCaps = enable;
+    if (m_culler.isReady()) {
+        updateCullerMeshes();
+    }
+}
+
+void TurtleGraphics::updateCullerMeshes() {
+    std::array<MeshRange, BranchCuller::LOD_COUNT> cylinders;
+    std::array<MeshRange, BranchCuller::LOD_COUNT> joints;
+    for (int lod = 0; lod < BranchCuller::LOD_COUNT; ++lod) {
+        cylinders[lod] = m_meshes.cylinder(lod, m_cylinderCaps);
+        joints[lod] = m_meshes.jointSphere(lod);
+    }
+    m_culler.setMeshes(cylinders, joints);
+}
+
+void TurtleGraphics::computeInstanceBounds() {
+    glm::vec3 minPos(0.0F);
+    glm::vec3 maxPos(0.0F);
+    bool first = true;
+
+    auto include = [&](const glm::vec3& point) {
+        minPos = first ? point : glm::min(minPos, point);
+        maxPos = first ? point : glm::max(maxPos, point);
+        first = false;
+    };
 
     for (const auto& branch : m_branches) {
-        instanceData.push_back(branch.start.x);
-        instanceData.push_back(branch.start.y);
-        instanceData.push_back(branch.start.z);
-        instanceData.push_back(branch.end.x);
-        instanceData.push_back(branch.end.y);
-        instanceData.push_back(branch.end.z);
-        instanceData.push_back(branch.radiusStart);
-        instanceData.push_back(branch.radiusEnd);
-        instanceData.push_back(branch.color.r);
-        instanceData.push_back(branch.color.g);
-        instanceData.push_back(branch.color.b);
+        include(branch.start);
+        include(branch.end);
+    }
+    for (const auto& decor : m_leaves) {
+        include(decor.position);
+    }
+    for (const auto& decor : m_flowers) {
+        include(decor.position);
+    }
+
+    // Evitar dividir entre cero con cajas planas (2D) o vacias
+    m_boundsMin = minPos;
+    m_boundsExtent = glm::max(maxPos - minPos, glm::vec3(1e-6F));
+}
+
+void TurtleGraphics::packInstances(std::vector<unsigned char>& out, bool compact) {
+    if (compact) {
+        computeInstanceBounds();
     }
 
-    glBindBuffer(GL_ARRAY_BUFFER, m_cylinderInstanceVBO);
-    glBufferData(GL_ARRAY_BUFFER, static_cast<GLsizeiptr>(instanceData.size() * sizeof(float)),
-                 instanceData.data(), GL_DYNAMIC_DRAW);
+    const size_t branchBytes =
+        m_branches.size() * (compact ? sizeof(CompactBranchInstance) : sizeof(BranchData));
+    const size_t decorationBytes =
+        getDecorationCount() * (compact ? sizeof(CompactDecorationInstance) : sizeof(DecorationData));
+    out.resize(branchBytes + decorationBytes);
+    writeBranchInstances(out.data(), compact);
+    writeDecorationInstances(out.data() + branchBytes, compact);
+}
+
+void TurtleGraphics::estimateGeometryBytes(double branches, double decorations, bool compact,
+                                           double& cpuBytes, double& gpuBytes) const {
+    cpuBytes = branches * static_cast<double>(sizeof(BranchData)) +
+               decorations * static_cast<double>(sizeof(DecorationData));
+
+    const double branchInstance =
+        static_cast<double>(compact ? sizeof(CompactBranchInstance) : sizeof(BranchData));
+    const double decorationInstance =
+        static_cast<double>(compact ? sizeof(CompactDecorationInstance) : sizeof(DecorationData));
+    gpuBytes = branches * branchInstance + decorations * decorationInstance;
+
+    // Los buffers persistentes tienen una segunda ranura para no esperar al dibujo en curso
+    if (m_cylinderInstanceBuffer.isPersistent()) {
+        gpuBytes *= 2.0;
+    }
+}
+
+void TurtleGraphics::writeBranchInstances(void* out, bool compact) const {
+    if (compact) {
+        // Cuantizar requiere la caja, asi que el formato compacto se escribe en una pasada
+        auto* instances = static_cast<CompactBranchInstance*>(out);
+        const glm::vec3 invExtent = 1.0F / m_boundsExtent;
+        for (const auto& branch : m_branches) {
+            glm::vec3 start = (branch.start - m_boundsMin) * invExtent;
+            glm::vec3 end = (branch.end - m_boundsMin) * invExtent;
+
+            CompactBranchInstance instance{};
+            instance.startEndX[0] = quantizeUnorm16(start.x);
+            instance.startEndX[1] = quantizeUnorm16(start.y);
+            instance.startEndX[2] = quantizeUnorm16(start.z);
+            instance.startEndX[3] = quantizeUnorm16(end.x);
+            instance.endYZ[0] = quantizeUnorm16(end.y);
+            instance.endYZ[1] = quantizeUnorm16(end.z);
+            instance.radii[0] = glm::packHalf1x16(branch.radiusStart);
+            instance.radii[1] = glm::packHalf1x16(branch.radiusEnd);
+            instance.shade = static_cast<uint16_t>(std::min(branch.shade, 65535.0F));
+            instance.birth = quantizeBirth(branch.birth, m_growthDuration);
+            *instances++ = instance;
+        }
+    } else {
+        // BranchData es el formato completo de instancia: entregar el vector tal cual
+        std::memcpy(out, m_branches.data(), m_branches.size() * sizeof(BranchData));
+    }
+}
+
+void TurtleGraphics::writeDecorationInstances(void* out, bool compact) const {
+    if (compact) {
+        auto* instances = static_cast<CompactDecorationInstance*>(out);
+        const glm::vec3 invExtent = 1.0F / m_boundsExtent;
+        auto writeDecoration = [&](const DecorationData& decor) {
+            glm::vec3 position = (decor.position - m_boundsMin) * invExtent;
+            glm::quat rotation = glm::normalize(glm::quat_cast(glm::mat3(decor.orientation)));
+
+            CompactDecorationInstance instance{};
+            instance.position[0] = quantizeUnorm16(position.x);
+            instance.position[1] = quantizeUnorm16(position.y);
+            instance.position[2] = quantizeUnorm16(position.z);
+            instance.rotation[0] = quantizeSnorm16(rotation.x);
+            instance.rotation[1] = quantizeSnorm16(rotation.y);
+            instance.rotation[2] = quantizeSnorm16(rotation.z);
+            instance.rotation[3] = quantizeSnorm16(rotation.w);
+            instance.size = glm::packHalf1x16(decor.size);
+            instance.birth = quantizeBirth(decor.birth, m_growthDuration);
+            *instances++ = instance;
+        };
+
+        // Reorganizar: primero hojas, luego flores
+        for (const auto& decor : m_leaves) {
+            writeDecoration(decor);
+        }
+        for (const auto& decor : m_flowers) {
+            writeDecoration(decor);
+        }
+    } else {
+        // Hojas y luego flores, cada una ya en el formato completo de instancia
+        auto* instanceData = static_cast<DecorationData*>(out);
+        std::memcpy(instanceData, m_leaves.data(), m_leaves.size() * sizeof(DecorationData));
+        std::memcpy(instanceData + m_leaves.size(), m_flowers.data(),
+                    m_flowers.size() * sizeof(DecorationData));
+    }
+}
+
+void TurtleGraphics::uploadBranchData() {
+    if (m_branches.empty())
+        return;
+
+    ProfileScope scope(ProfileStage::UploadBranches);
+
+    // Un buffer de instancias sirve a cilindros, esferas de union y lineas instanciadas
+    const size_t stride = m_uploadedCompact ? sizeof(CompactBranchInstance) : sizeof(BranchData);
+    void* instances = m_cylinderInstanceBuffer.map(m_branches.size() * stride);
+    if (instances == nullptr)
+        return;
+    writeBranchInstances(instances, m_uploadedCompact);
+    m_cylinderInstanceBuffer.unmap();
+    bindCylinderInstanceAttributes();
+
+    // Las copias leen el formato completo un float por texel
+    if (!m_uploadedCompact) {
+        glBindTexture(GL_TEXTURE_BUFFER, m_branchTexture);
+        glTexBuffer(GL_TEXTURE_BUFFER, GL_R32F, m_cylinderInstanceBuffer.id());
+        glBindTexture(GL_TEXTURE_BUFFER, 0);
+    }
+
+    if (m_culler.isReady()) {
+        m_culler.setSource(m_cylinderInstanceBuffer.id(), m_uploadedCompact, m_branches.size());
+    }
 }
 
 void TurtleGraphics::uploadDecorationData() {
-    if (m_decorations.empty())
+    const size_t count = getDecorationCount();
+    if (count == 0)
         return;
 
-    // Separar hojas y flores para renderizar por grupos
-    m_leaves.clear();
-    m_flowers.clear();
+    ProfileScope scope(ProfileStage::UploadDecorations);
+    const size_t stride =
+        m_uploadedCompact ? sizeof(CompactDecorationInstance) : sizeof(DecorationData);
+    void* instances = m_decorationInstanceBuffer.map(count * stride);
+    if (instances == nullptr)
+        return;
+    writeDecorationInstances(instances, m_uploadedCompact);
+    m_decorationInstanceBuffer.unmap();
+    bindDecorationInstanceAttributes(m_leafVAO, 0);
+    bindDecorationInstanceAttributes(m_flowerVAO, m_leaves.size());
+    glBindVertexArray(0);
 
-    for (const auto& decor : m_decorations) {
-        if (decor.type == 0) {
-            m_leaves.push_back(decor);
-        } else {
-            m_flowers.push_back(decor);
+    if (!m_uploadedCompact) {
+        glBindTexture(GL_TEXTURE_BUFFER, m_decorationTexture);
+        glTexBuffer(GL_TEXTURE_BUFFER, GL_R32F, m_decorationInstanceBuffer.id());
+        glBindTexture(GL_TEXTURE_BUFFER, 0);
+    }
+}
+
+void TurtleGraphics::setCompactUniforms(const Shader& shader) const {
+    // Decuantizacion del formato compacto: posiciones en la caja, nacimientos en el crecimiento
+    shader.setVec3("boundsMin", m_boundsMin);
+    shader.setVec3("boundsExtent", m_boundsExtent);
+    shader.setFloat("birthScale", m_growthDuration);
+}
+
+void TurtleGraphics::bindCylinderInstanceAttributes() {
+    glBindVertexArray(m_cylinderVAO);
+    glBindBuffer(GL_ARRAY_BUFFER, m_cylinderInstanceBuffer.id());
+
+    if (m_uploadedCompact) {
+        constexpr GLsizei stride = sizeof(CompactBranchInstance);
+
+        glVertexAttribPointer(2, 4, GL_UNSIGNED_SHORT, GL_TRUE, stride,
+                              reinterpret_cast<void*>(offsetof(CompactBranchInstance, startEndX)));
+        glVertexAttribPointer(3, 2, GL_UNSIGNED_SHORT, GL_TRUE, stride,
+                              reinterpret_cast<void*>(offsetof(CompactBranchInstance, endYZ)));
+        glVertexAttribPointer(4, 2, GL_HALF_FLOAT, GL_FALSE, stride,
+                              reinterpret_cast<void*>(offsetof(CompactBranchInstance, radii)));
+        glVertexAttribPointer(6, 1, GL_UNSIGNED_SHORT, GL_FALSE, stride,
+                              reinterpret_cast<void*>(offsetof(CompactBranchInstance, shade)));
+        glVertexAttribPointer(7, 1, GL_UNSIGNED_SHORT, GL_TRUE, stride,
+                              reinterpret_cast<void*>(offsetof(CompactBranchInstance, birth)));
+        for (GLuint location : {2U, 3U, 4U, 6U, 7U}) {
+            glEnableVertexAttribArray(location);
+            glVertexAttribDivisor(location, 1);
         }
+        glDisableVertexAttribArray(5);  // Ambos radios viven en la ubicacion 4
+
+        glBindVertexArray(0);
+        return;
     }
 
-    // Reorganizar: primero hojas, luego flores
-    std::vector<float> instanceData;
-    instanceData.reserve(m_decorations.size() * 23);
+    constexpr GLsizei stride = sizeof(BranchData);
+
+    glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, stride,
+                          reinterpret_cast<void*>(offsetof(BranchData, start)));  // iStart
+    glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE, stride,
+                          reinterpret_cast<void*>(offsetof(BranchData, end)));  // iEnd
+    glVertexAttribPointer(4, 1, GL_FLOAT, GL_FALSE, stride,
+                          reinterpret_cast<void*>(offsetof(BranchData, radiusStart)));
+    glVertexAttribPointer(5, 1, GL_FLOAT, GL_FALSE, stride,
+                          reinterpret_cast<void*>(offsetof(BranchData, radiusEnd)));
+    glVertexAttribPointer(6, 1, GL_FLOAT, GL_FALSE, stride,
+                          reinterpret_cast<void*>(offsetof(BranchData, shade)));  // iShade
+    glVertexAttribPointer(7, 1, GL_FLOAT, GL_FALSE, stride,
+                          reinterpret_cast<void*>(offsetof(BranchData, birth)));  // iBirth
+    for (GLuint location = 2; location <= 7; ++location) {
+        glEnableVertexAttribArray(location);
+        glVertexAttribDivisor(location, 1);
+    }
 
-    // Subir hojas primero
-    for (const auto& decor : m_leaves) {
-        instanceData.push_back(decor.position.x);
-        instanceData.push_back(decor.position.y);
-        instanceData.push_back(decor.position.z);
+    glBindVertexArray(0);
+}
 
-        const float* matPtr = glm::value_ptr(decor.orientation);
-        for (int i = 0; i < 16; ++i) {
-            instanceData.push_back(matPtr[i]);
+void TurtleGraphics::bindDecorationInstanceAttributes(GLuint vao, size_t firstInstance) {
+    // Hojas y flores comparten un buffer; las flores empiezan tras las hojas
+    glBindVertexArray(vao);
+    glBindBuffer(GL_ARRAY_BUFFER, m_decorationInstanceBuffer.id());
+
+    if (m_uploadedCompact) {
+        constexpr GLsizei stride = sizeof(CompactDecorationInstance);
+        const size_t base = firstInstance * stride;
+
+        glVertexAttribPointer(
+            2, 4, GL_UNSIGNED_SHORT, GL_TRUE, stride,
+            reinterpret_cast<void*>(base + offsetof(CompactDecorationInstance, position)));
+        glVertexAttribPointer(
+            3, 4, GL_SHORT, GL_TRUE, stride,
+            reinterpret_cast<void*>(base + offsetof(CompactDecorationInstance, rotation)));
+        glVertexAttribPointer(
+            7, 1, GL_UNSIGNED_SHORT, GL_TRUE, stride,
+            reinterpret_cast<void*>(base + offsetof(CompactDecorationInstance, birth)));
+        glVertexAttribPointer(
+            8, 1, GL_HALF_FLOAT, GL_FALSE, stride,
+            reinterpret_cast<void*>(base + offsetof(CompactDecorationInstance, size)));
+        for (GLuint location : {2U, 3U, 7U, 8U}) {
+            glEnableVertexAttribArray(location);
+            glVertexAttribDivisor(location, 1);
         }
+        // El cuaternion reemplaza las columnas del mat4 en las ubicaciones 4-6
+        for (GLuint location : {4U, 5U, 6U}) {
+            glDisableVertexAttribArray(location);
+        }
+        return;
+    }
 
-        instanceData.push_back(decor.color.r);
-        instanceData.push_back(decor.color.g);
-        instanceData.push_back(decor.color.b);
-        instanceData.push_back(decor.size);
+    constexpr GLsizei stride = sizeof(DecorationData);
+    const size_t base = firstInstance * stride;
+
+    glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, stride,
+                          reinterpret_cast<void*>(base + offsetof(DecorationData, position)));
+    glEnableVertexAttribArray(2);
+    glVertexAttribDivisor(2, 1);
+
+    // iOrientation (mat4 = 4 vec4s at locations 3, 4, 5, 6)
+    for (int i = 0; i < 4; ++i) {
+        glVertexAttribPointer(3 + i, 4, GL_FLOAT, GL_FALSE, stride,
+                              reinterpret_cast<void*>(base + offsetof(DecorationData, orientation) +
+                                                      i * sizeof(glm::vec4)));
+        glEnableVertexAttribArray(3 + i);
+        glVertexAttribDivisor(3 + i, 1);
     }
 
-    // Luego subir flores
-    for (const auto& decor : m_flowers) {
-        instanceData.push_back(decor.position.x);
-        instanceData.push_back(decor.position.y);
-        instanceData.push_back(decor.position.z);
+    glVertexAttribPointer(7, 1, GL_FLOAT, GL_FALSE, stride,
+                          reinterpret_cast<void*>(base + offsetof(DecorationData, birth)));
+    glEnableVertexAttribArray(7);
+    glVertexAttribDivisor(7, 1);
 
-        const float* matPtr = glm::value_ptr(decor.orientation);
-        for (int i = 0; i < 16; ++i) {
-            instanceData.push_back(matPtr[i]);
-        }
+    glVertexAttribPointer(8, 1, GL_FLOAT, GL_FALSE, stride,
+                          reinterpret_cast<void*>(base + offsetof(DecorationData, size)));
+    glEnableVertexAttribArray(8);
+    glVertexAttribDivisor(8, 1);
+}
+
+void TurtleGraphics::bindPlacementAttributes() {
+    if (m_placementCount == 0)
+        return;
+
+    bindPlacementRange(m_placementBranchVAO, m_branches.size(), 0);
+    bindPlacementRange(m_placementLeafVAO, m_leaves.size(), 0);
+    bindPlacementRange(m_placementFlowerVAO, m_flowers.size(), 0);
+    glBindVertexArray(0);
+}
 
-        instanceData.push_back(decor.color.r);
-        instanceData.push_back(decor.color.g);
-        instanceData.push_back(decor.color.b);
-        instanceData.push_back(decor.size);
+void TurtleGraphics::bindPlacementRange(GLuint vao, size_t instancesPerPlant,
+                                        size_t firstPlacement) {
+    constexpr GLsizei stride = sizeof(PlantPlacement);
+    const size_t base = firstPlacement * stride;
+
+    // Una copia cubre una planta entera: avanza una vez por cada tanda de instancias de la planta
+    glBindVertexArray(vao);
+    glBindBuffer(GL_ARRAY_BUFFER, m_placementBuffer.id());
+    glVertexAttribPointer(9, 4, GL_FLOAT, GL_FALSE, stride,
+                          reinterpret_cast<void*>(base + offsetof(PlantPlacement, position)));
+    glVertexAttribPointer(10, 4, GL_FLOAT, GL_FALSE, stride,
+                          reinterpret_cast<void*>(base + offsetof(PlantPlacement, tint)));
+    for (GLuint location : {9U, 10U}) {
+        glEnableVertexAttribArray(location);
+        glVertexAttribDivisor(location,
+                              static_cast<GLuint>(std::max<size_t>(instancesPerPlant, 1)));
     }
+}
+
+void TurtleGraphics::setPlacements(const std::vector<PlantPlacement>& placements) {
+    m_placementCount = placements.size();
+    if (m_placementCount == 0 || !m_initialized)
+        return;
 
-    glBindBuffer(GL_ARRAY_BUFFER, m_decorationInstanceVBO);
-    glBufferData(GL_ARRAY_BUFFER, static_cast<GLsizeiptr>(instanceData.size() * sizeof(float)),
-                 instanceData.data(), GL_DYNAMIC_DRAW);
+    void* out = m_placementBuffer.map(m_placementCount * sizeof(PlantPlacement));
+    if (out == nullptr) {
+        m_placementCount = 0;
+        return;
+    }
+    std::memcpy(out, placements.data(), m_placementCount * sizeof(PlantPlacement));
+    m_placementBuffer.unmap();
+    bindPlacementAttributes();
 }
 
 // =============================================================================
 // Rendering
 // =============================================================================
 
+void TurtleGraphics::updateFrameUniforms(const glm::mat4& view, const glm::mat4& projection,
+                                         const glm::vec3& lightPos) {
+    // Camara, luz y parametros visuales para todos los programas, subidos una vez por cuadro
+    FrameUniforms frame{};
+    frame.view = view;
+    frame.projection = projection;
+    frame.lightPos = glm::vec4(lightPos, 1.0F);
+    frame.viewPos = glm::inverse(view)[3];
+    frame.branchColor = glm::vec4(m_branchColor, 1.0F);
+    frame.leafColor = glm::vec4(m_leafColor, 1.0F);
+    frame.flowerColor = glm::vec4(m_flowerColor, 1.0F);
+    frame.geometryScale = glm::vec4(m_stepSize, m_initialWidth, m_leafSize, m_growthTime);
+    glBindBuffer(GL_UNIFORM_BUFFER, m_frameUBO);
+    glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(FrameUniforms), &frame);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+    glBindBufferBase(GL_UNIFORM_BUFFER, FRAME_UNIFORM_BINDING, m_frameUBO);
+}
+
 void TurtleGraphics::render(const glm::mat4& view, const glm::mat4& projection,
                             const glm::vec3& lightPos) {
     if (!m_initialized)
         return;
 
+    collectGpuTimings();
+    if (m_is3D && m_showFloor && m_shadows) {
+        updateShadowMap(lightPos);
+    }
+    updateFrameUniforms(view, projection, lightPos);
+
+    // Los subarboles fuera del frustum se saltan como rangos completos de instancias
+    if (cpuCullingActive()) {
+        m_hierarchy.collectVisible(projection * view, instanceScale(), m_visible);
+    } else {
+        m_visible = {};
+    }
+
     // Renderizar piso primero (esta detras de todo)
     if (m_is3D) {
-        renderFloor(view, projection, lightPos);
+        m_floorTimer.begin();
+        renderFloor();
+        m_floorTimer.end();
     }
 
+    m_branchTimer.begin();
     if (m_renderMode == RenderMode::Lines) {
-        renderLines(view, projection);
+        renderLines();
     } else {
-        renderCylinders(view, projection, lightPos);
+        renderCylinders(view, projection);
     }
+    renderHighlight();
+    m_branchTimer.end();
 
-    renderDecorations(view, projection, lightPos);
+    m_decorationTimer.begin();
+    renderDecorations();
+    m_decorationTimer.end();
 }
 
-void TurtleGraphics::renderLines(const glm::mat4& view, const glm::mat4& projection) {
+void TurtleGraphics::collectGpuTimings() {
+    // Solo consultas que la GPU ya termino: esto nunca espera al cuadro actual
+    const std::pair<GpuTimer*, ProfileStage> timers[] = {
+        {&m_floorTimer, ProfileStage::GpuFloor},
+        {&m_branchTimer, ProfileStage::GpuBranches},
+        {&m_decorationTimer, ProfileStage::GpuDecorations},
+    };
+
+    double startUs = 0.0;
+    double durationUs = 0.0;
+    for (const auto& [timer, stage] : timers) {
+        while (timer->collect(startUs, durationUs)) {
+            Profiler::instance().addSample(stage, startUs, durationUs);
+        }
+    }
+}
+
+void TurtleGraphics::renderLines() {
     if (m_branches.empty())
         return;
 
-    glUseProgram(m_lineShader);
-    glUniformMatrix4fv(glGetUniformLocation(m_lineShader, "view"), 1, GL_FALSE,
-                       glm::value_ptr(view));
-    glUniformMatrix4fv(glGetUniformLocation(m_lineShader, "projection"), 1, GL_FALSE,
-                       glm::value_ptr(projection));
+    // La variante del shader debe coincidir con el formato de las instancias subidas
+    const Shader& shader = m_uploadedCompact ? *m_lineCompactShader : *m_lineShader;
+    shader.use();
+    if (m_uploadedCompact) {
+        setCompactUniforms(shader);
+    }
 
     glLineWidth(2.0F);  // May not work on all drivers
-    glBindVertexArray(m_lineVAO);
-    glDrawArrays(GL_LINES, 0, static_cast<GLsizei>(m_branches.size() * 2));
+    glBindVertexArray(m_cylinderVAO);
+    auto drawLines = [](GLuint first, GLsizei count) {
+        drawArraysInstanced(GL_LINES, 2, count, first);
+    };
+    forEachInstanceRange(cpuCullingActive(), m_visible.branches, m_branches.size(), drawLines);
     glBindVertexArray(0);
 }
 
-void TurtleGraphics::renderCylinders(const glm::mat4& view, const glm::mat4& projection,
-                                     const glm::vec3& lightPos) {
+void TurtleGraphics::renderCylinders(const glm::mat4& view, const glm::mat4& projection) {
     if (m_branches.empty())
         return;
 
-    glm::vec3 viewPos = glm::vec3(glm::inverse(view)[3]);
+    if (m_gpuCulling && m_culler.isReady()) {
+        renderCulledCylinders(view, projection);
+        return;
+    }
+
+    // La variante del shader debe coincidir con el formato de las instancias subidas
+    const Shader& shader = m_uploadedCompact ? *m_cylinderCompactShader : *m_cylinderShader;
+    shader.use();
+    if (m_uploadedCompact) {
+        setCompactUniforms(shader);
+    }
 
-    glUseProgram(m_cylinderShader);
-    glUniformMatrix4fv(glGetUniformLocation(m_cylinderShader, "view"), 1, GL_FALSE,
-                       glm::value_ptr(view));
-    glUniformMatrix4fv(glGetUniformLocation(m_cylinderShader, "projection"), 1, GL_FALSE,
-                       glm::value_ptr(projection));
-    glUniform3fv(glGetUniformLocation(m_cylinderShader, "lightPos"), 1, glm::value_ptr(lightPos));
-    glUniform3fv(glGetUniformLocation(m_cylinderShader, "viewPos"), 1, glm::value_ptr(viewPos));
+    const bool culled = cpuCullingActive();
+    auto drawMesh = [this, culled](const MeshRange& mesh) {
+        forEachInstanceRange(culled, m_visible.branches, m_branches.size(),
+                             [&mesh](GLuint first, GLsizei count) {
+                                 MeshLibrary::draw(mesh, count, first);
+                             });
+    };
 
     glBindVertexArray(m_cylinderVAO);
-    glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, CYLINDER_VERTEX_COUNT,
-                          static_cast<GLsizei>(m_branches.size()));
+    shader.setInt("jointSpheres", GL_FALSE);
+    drawMesh(m_meshes.cylinder(DEFAULT_CYLINDER_LOD, m_cylinderCaps));
+    if (m_jointSpheres) {
+        shader.setInt("jointSpheres", GL_TRUE);
+        drawMesh(m_meshes.jointSphere(DEFAULT_CYLINDER_LOD));
+    }
     glBindVertexArray(0);
 }
 
-void TurtleGraphics::renderDecorations(const glm::mat4& view, const glm::mat4& projection,
-                                       const glm::vec3& lightPos) {
-    if (m_decorations.empty())
-        return;
+void TurtleGraphics::renderCulledCylinders(const glm::mat4& view, const glm::mat4& projection) {
+    m_culler.cull(view, projection, m_boundsMin, m_boundsExtent, m_growthDuration,
+                  glm::vec2(m_stepSize, m_initialWidth));
+
+    // Las instancias filtradas se capturan en el formato float completo
+    m_cylinderShader->use();
+    m_cylinderShader->setInt("jointSpheres", GL_FALSE);
+    for (int lod = 0; lod < BranchCuller::LOD_COUNT; ++lod) {
+        m_culler.drawBucket(lod);
+    }
+    if (m_jointSpheres) {
+        m_cylinderShader->setInt("jointSpheres", GL_TRUE);
+        for (int lod = 0; lod < BranchCuller::LOD_COUNT; ++lod) {
+            m_culler.drawBucket(lod, true);
+        }
+    }
+
+    // Ramas de menos de un pixel: una linea por instancia
+    m_lineShader->use();
+    m_culler.drawBucket(BranchCuller::LINE_BUCKET);
+}
 
-    glm::vec3 viewPos = glm::vec3(glm::inverse(view)[3]);
+void TurtleGraphics::renderDecorations() {
+    if (getDecorationCount() == 0)
+        return;
 
     // Habilitar blending para transparencia
     glEnable(GL_BLEND);
     glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
 
-    glUseProgram(m_decorationShader);
-    glUniformMatrix4fv(glGetUniformLocation(m_decorationShader, "view"), 1, GL_FALSE,
-                       glm::value_ptr(view));
-    glUniformMatrix4fv(glGetUniformLocation(m_decorationShader, "projection"), 1, GL_FALSE,
-                       glm::value_ptr(projection));
-    glUniform3fv(glGetUniformLocation(m_decorationShader, "lightPos"), 1, glm::value_ptr(lightPos));
-    glUniform3fv(glGetUniformLocation(m_decorationShader, "viewPos"), 1, glm::value_ptr(viewPos));
+    const Shader& shader = m_uploadedCompact ? *m_decorationCompactShader : *m_decorationShader;
+    shader.use();
+    if (m_uploadedCompact) {
+        setCompactUniforms(shader);
+    }
 
-    glBindVertexArray(m_decorationVAO);
+    const bool culled = cpuCullingActive();
+    auto drawQuads = [](GLuint first, GLsizei count) {
+        drawArraysInstanced(GL_TRIANGLES, 6, count, first);
+    };
 
     // Renderizar hojas (tipo 0)
     if (!m_leaves.empty()) {
-        glUniform1i(glGetUniformLocation(m_decorationShader, "decorationType"), 0);
-        glDrawArraysInstanced(GL_TRIANGLES, 0, 6, static_cast<GLsizei>(m_leaves.size()));
+        shader.setInt("decorationType", 0);
+        glBindVertexArray(m_leafVAO);
+        forEachInstanceRange(culled, m_visible.leaves, m_leaves.size(), drawQuads);
     }
 
-    // Renderizar flores (tipo 1) - necesitamos reconfigurar el offset de instancias
+    // Renderizar flores (tipo 1): su VAO ya apunta al inicio de las flores
     if (!m_flowers.empty()) {
-        glUniform1i(glGetUniformLocation(m_decorationShader, "decorationType"), 1);
-
-        // Ajustar el offset del buffer de instancias para las flores
-        size_t leavesOffset = m_leaves.size() * 23 * sizeof(float);
-        glBindBuffer(GL_ARRAY_BUFFER, m_decorationInstanceVBO);
-
-        // Reconfiguramos los atributos de instancia con el offset correcto
-        // iPosition (location 2)
-        glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, 23 * sizeof(float),
-                              reinterpret_cast<void*>(leavesOffset));
-        // iOrientation (locations 3-6)
-        for (int i = 0; i < 4; ++i) {
-            glVertexAttribPointer(
-                3 + i, 4, GL_FLOAT, GL_FALSE, 23 * sizeof(float),
-                reinterpret_cast<void*>(leavesOffset + (3 + i * 4) * sizeof(float)));
-        }
-        // iColor (location 7)
-        glVertexAttribPointer(7, 3, GL_FLOAT, GL_FALSE, 23 * sizeof(float),
-                              reinterpret_cast<void*>(leavesOffset + 19 * sizeof(float)));
-        // iSize (location 8)
-        glVertexAttribPointer(8, 1, GL_FLOAT, GL_FALSE, 23 * sizeof(float),
-                              reinterpret_cast<void*>(leavesOffset + 22 * sizeof(float)));
-
-        glDrawArraysInstanced(GL_TRIANGLES, 0, 6, static_cast<GLsizei>(m_flowers.size()));
-
-        // Restaurar offset a 0 para la proxima vez
-        glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, 23 * sizeof(float),
-                              reinterpret_cast<void*>(0));
-        for (int i = 0; i < 4; ++i) {
-            glVertexAttribPointer(3 + i, 4, GL_FLOAT, GL_FALSE, 23 * sizeof(float),
-                                  reinterpret_cast<void*>((3 + i * 4) * sizeof(float)));
-        }
-        glVertexAttribPointer(7, 3, GL_FLOAT, GL_FALSE, 23 * sizeof(float),
-                              reinterpret_cast<void*>(19 * sizeof(float)));
-        glVertexAttribPointer(8, 1, GL_FLOAT, GL_FALSE, 23 * sizeof(float),
-                              reinterpret_cast<void*>(22 * sizeof(float)));
+        shader.setInt("decorationType", 1);
+        glBindVertexArray(m_flowerVAO);
+        forEachInstanceRange(culled, m_visible.flowers, m_flowers.size(), drawQuads);
     }
 
     glBindVertexArray(0);
     glDisable(GL_BLEND);
 }
 
+void TurtleGraphics::renderHighlight() {
+    if (m_highlightedBranch < 0 || !m_baseInstance ||
+        m_highlightedBranch >= static_cast<int64_t>(m_branches.size()))
+        return;
+
+    // Solo la rama seleccionada, dibujada otra vez sobre si misma con un tinte emisivo
+    const auto branch = static_cast<GLuint>(m_highlightedBranch);
+    const bool lines = m_renderMode == RenderMode::Lines;
+    const Shader& shader = lines ? (m_uploadedCompact ? *m_lineCompactShader : *m_lineShader)
+                                 : (m_uploadedCompact ? *m_cylinderCompactShader
+                                                      : *m_cylinderShader);
+    shader.use();
+    if (m_uploadedCompact) {
+        setCompactUniforms(shader);
+    }
+    shader.setVec3("highlight", HIGHLIGHT_COLOR);
+
+    // El culler de GPU pudo dibujarla con un LOD mas burdo: acercarla un poco
+    glDepthFunc(GL_LEQUAL);
+    glEnable(GL_POLYGON_OFFSET_FILL);
+    glPolygonOffset(-1.0F, -1.0F);
+    glBindVertexArray(m_cylinderVAO);
+    if (lines) {
+        drawArraysInstanced(GL_LINES, 2, 1, branch);
+    } else {
+        shader.setInt("jointSpheres", GL_FALSE);
+        MeshLibrary::draw(m_meshes.cylinder(DEFAULT_CYLINDER_LOD, m_cylinderCaps), 1, branch);
+    }
+    glBindVertexArray(0);
+    glDisable(GL_POLYGON_OFFSET_FILL);
+    glDepthFunc(GL_LESS);
+
+    shader.setVec3("highlight", glm::vec3(0.0F));
+}
+
+void TurtleGraphics::updateShadowMap(const glm::vec3& lightPos) {
+    // Todo lo que mueve la silueta de la planta: geometria, luz y los uniforms
+    // de escala y crecimiento
+    const glm::vec4 scale(m_stepSize, m_initialWidth, m_leafSize, m_growthTime);
+    if (!m_shadowDirty && lightPos == m_shadowLight && scale == m_shadowScale)
+        return;
+    m_shadowDirty = false;
+    m_shadowLight = lightPos;
+    m_shadowScale = scale;
+
+    glm::vec3 boundsMin;
+    glm::vec3 boundsMax;
+    m_shadowValid = false;
+    if (!getPlantBounds(boundsMin, boundsMax))
+        return;
+    if (!m_shadowMap.isReady() && !m_shadowMap.create()) {
+        m_shadows = false;  // Sin framebuffer de profundidad se conserva la sombra aproximada
+        return;
+    }
+
+    m_shadowMap.fit(lightPos, boundsMin, boundsMax);
+    updateFrameUniforms(m_shadowMap.getView(), m_shadowMap.getProjection(), lightPos);
+    m_shadowMap.begin();
+
+    // Cada rama con un LOD burdo: el mapa solo se redibuja al cambiar, nunca se filtra
+    if (!m_branches.empty()) {
+        const Shader& depth =
+            m_uploadedCompact ? *m_cylinderDepthCompactShader : *m_cylinderDepthShader;
+        depth.use();
+        if (m_uploadedCompact) {
+            setCompactUniforms(depth);
+        }
+        depth.setInt("jointSpheres", GL_FALSE);
+        glBindVertexArray(m_cylinderVAO);
+        MeshLibrary::draw(m_meshes.cylinder(SHADOW_CYLINDER_LOD, false),
+                          static_cast<GLsizei>(m_branches.size()));
+    }
+
+    // Hojas y flores con su propio programa (las escrituras de color no van a ningun lado)
+    if (getDecorationCount() > 0) {
+        const Shader& shader = m_uploadedCompact ? *m_decorationCompactShader : *m_decorationShader;
+        shader.use();
+        if (m_uploadedCompact) {
+            setCompactUniforms(shader);
+        }
+        const std::pair<GLuint, size_t> sets[] = {{m_leafVAO, m_leaves.size()},
+                                                  {m_flowerVAO, m_flowers.size()}};
+        for (int type = 0; type < 2; ++type) {
+            if (sets[type].second == 0)
+                continue;
+            shader.setInt("decorationType", type);
+            glBindVertexArray(sets[type].first);
+            glDrawArraysInstanced(GL_TRIANGLES, 0, 6, static_cast<GLsizei>(sets[type].second));
+        }
+    }
+
+    glBindVertexArray(0);
+    m_shadowMap.end();
+    m_shadowValid = true;
+    m_shadowUpdates++;
+}
+
+void TurtleGraphics::renderPlacements(const glm::mat4& view, const glm::mat4& projection,
+                                      const glm::vec3& lightPos) {
+    // Los shaders de copias leen el formato float completo (ver setPlacements)
+    if (!m_initialized || m_placementCount == 0 || m_uploadedCompact)
+        return;
+
+    updateFrameUniforms(view, projection, lightPos);
+    glActiveTexture(GL_TEXTURE0 + INSTANCE_TEXTURE_UNIT);
+
+    // La instancia n dibuja la instancia (n % perPlant) de la copia (n / perPlant)
+    auto useShader = [](const Shader& shader, int instanceFloats, size_t perPlant,
+                        size_t firstInstance) {
+        shader.use();
+        shader.setInt("instanceData", static_cast<int>(INSTANCE_TEXTURE_UNIT));
+        shader.setInt("instanceFloats", instanceFloats);
+        shader.setInt("instancesPerPlant", static_cast<int>(perPlant));
+        shader.setInt("firstInstance", static_cast<int>(firstInstance));
+    };
+
+    // perPlant * placements puede no caber en un GLsizei: dibujar copias completas en tandas,
+    // cada una con sus atributos de copia empezando en su primera copia
+    auto drawCopies = [this](GLuint vao, size_t perPlant, const auto& draw) {
+        const size_t batch = std::max<size_t>(size_t{INT32_MAX} / perPlant, 1);
+        const bool split = batch < m_placementCount;
+        glBindVertexArray(vao);
+        for (size_t first = 0; first < m_placementCount; first += batch) {
+            if (split) {
+                bindPlacementRange(vao, perPlant, first);
+            }
+            const size_t copies = std::min(batch, m_placementCount - first);
+            draw(static_cast<GLsizei>(perPlant * copies));
+        }
+        if (split) {
+            bindPlacementRange(vao, perPlant, 0);
+        }
+    };
+
+    constexpr int BRANCH_FLOATS = sizeof(BranchData) / sizeof(float);
+    constexpr int DECORATION_FLOATS = sizeof(DecorationData) / sizeof(float);
+
+    if (!m_branches.empty()) {
+        glBindTexture(GL_TEXTURE_BUFFER, m_branchTexture);
+        if (m_renderMode == RenderMode::Lines) {
+            useShader(*m_linePlacementShader, BRANCH_FLOATS, m_branches.size(), 0);
+            drawCopies(m_placementBranchVAO, m_branches.size(), [](GLsizei instances) {
+                glDrawArraysInstanced(GL_LINES, 0, 2, instances);
+            });
+        } else {
+            const Shader& shader = *m_cylinderPlacementShader;
+            useShader(shader, BRANCH_FLOATS, m_branches.size(), 0);
+            drawCopies(m_placementBranchVAO, m_branches.size(), [&](GLsizei instances) {
+                shader.setInt("jointSpheres", GL_FALSE);
+                MeshLibrary::draw(m_meshes.cylinder(PLACEMENT_CYLINDER_LOD, m_cylinderCaps),
+                                  instances);
+                if (m_jointSpheres) {
+                    shader.setInt("jointSpheres", GL_TRUE);
+                    MeshLibrary::draw(m_meshes.jointSphere(PLACEMENT_CYLINDER_LOD), instances);
+                }
+            });
+        }
+    }
+
+    if (getDecorationCount() != 0) {
+        glEnable(GL_BLEND);
+        glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+        glBindTexture(GL_TEXTURE_BUFFER, m_decorationTexture);
+
+        const Shader& shader = *m_decorationPlacementShader;
+        auto drawQuads = [](GLsizei instances) {
+            glDrawArraysInstanced(GL_TRIANGLES, 0, 6, instances);
+        };
+        if (!m_leaves.empty()) {
+            useShader(shader, DECORATION_FLOATS, m_leaves.size(), 0);
+            shader.setInt("decorationType", 0);
+            drawCopies(m_placementLeafVAO, m_leaves.size(), drawQuads);
+        }
+        if (!m_flowers.empty()) {
+            useShader(shader, DECORATION_FLOATS, m_flowers.size(), m_leaves.size());
+            shader.setInt("decorationType", 1);
+            drawCopies(m_placementFlowerVAO, m_flowers.size(), drawQuads);
+        }
+        glDisable(GL_BLEND);
+    }
+
+    glBindVertexArray(0);
+    glBindTexture(GL_TEXTURE_BUFFER, 0);
+}
+
 void TurtleGraphics::clear() {
     m_branches.clear();
-    m_decorations.clear();
+    m_leaves.clear();
+    m_flowers.clear();
+    m_spans.clear();
+    m_hierarchyDirty = true;
+    m_growthDuration = 0.0F;
+}
+
+void TurtleGraphics::copySettings(const TurtleGraphics& other) {
+    m_is3D = other.m_is3D;
+    m_fastRotations = other.m_fastRotations;
+    m_coalesceSegments = other.m_coalesceSegments;
+    m_parallelInterpretation = other.m_parallelInterpretation;
+    m_interpretThreads = other.m_interpretThreads;
+    m_stepSize = other.m_stepSize;
+    m_initialWidth = other.m_initialWidth;
+    m_widthDecay = other.m_widthDecay;
+    m_leafSize = other.m_leafSize;
+    m_branchColor = other.m_branchColor;
+    m_leafColor = other.m_leafColor;
+    m_flowerColor = other.m_flowerColor;
+}
+
+void TurtleGraphics::swapGeometry(TurtleGraphics& other) {
+    m_branches.swap(other.m_branches);
+    m_leaves.swap(other.m_leaves);
+    m_flowers.swap(other.m_flowers);
+    m_spans.swap(other.m_spans);
+    std::swap(m_hierarchy, other.m_hierarchy);
+    std::swap(m_hierarchyDirty, other.m_hierarchyDirty);
+    m_highlightedBranch = -1;
+    other.m_highlightedBranch = -1;
+    m_subtreeCache.swap(other.m_subtreeCache);
+    std::swap(m_subtreeCacheHits, other.m_subtreeCacheHits);
+    std::swap(m_coalescedSegments, other.m_coalescedSegments);
+    std::swap(m_growthDuration, other.m_growthDuration);
+}
+
+void TurtleGraphics::assignGeometry(const BranchData* branches, size_t branchCount,
+                                    const DecorationData* leaves, size_t leafCount,
+                                    const DecorationData* flowers, size_t flowerCount,
+                                    const InstanceSpan* spans, size_t spanCount,
+                                    float growthDuration) {
+    m_branches.assign(branches, branches + branchCount);
+    m_leaves.assign(leaves, leaves + leafCount);
+    m_flowers.assign(flowers, flowers + flowerCount);
+    m_growthDuration = growthDuration;
+
+    // Mismos subarboles que el arbol interpretado; build() recorta rangos no confiables
+    m_spans.assign(spans, spans + spanCount);
+    m_spanStack.clear();
+    m_hierarchyDirty = true;
+
+    // No se interpreto nada: descartar las estadisticas del arbol anterior
+    m_subtreeCache.clear();
+    m_subtreeCacheHits = 0;
+    m_coalescedSegments = 0;
+}
+
+void TurtleGraphics::buildHierarchy() {
+    if (!m_hierarchyDirty)
+        return;
+
+    ProfileScope scope(ProfileStage::Hierarchy);
+    m_hierarchy.build(m_branches, m_leaves, m_flowers, m_spans);
+    m_hierarchyDirty = false;
+    m_highlightedBranch = -1;  // Indices del arbol anterior
+}
+
+bool TurtleGraphics::getPlantBounds(glm::vec3& boundsMin, glm::vec3& boundsMax) const {
+    return m_hierarchy.getBounds(instanceScale(), boundsMin, boundsMax);
+}
+
+int64_t TurtleGraphics::pickBranch(const glm::vec3& origin, const glm::vec3& direction) const {
+    float distance = 0.0F;
+    return m_hierarchy.pick(origin, direction, instanceScale(), m_branches, distance);
 }
 
 // =============================================================================
@@ -1220,9 +3231,8 @@ void TurtleGraphics::setupFloor() {
     glBindVertexArray(0);
 }
 
-void TurtleGraphics::renderFloor(const glm::mat4& view, const glm::mat4& projection,
-                                 const glm::vec3& lightPos) {
-    if (!m_showFloor || m_floorShader == 0) {
+void TurtleGraphics::renderFloor() {
+    if (!m_showFloor || !m_floorShader) {
         return;
     }
 
@@ -1230,20 +3240,29 @@ void TurtleGraphics::renderFloor(const glm::mat4& view, const glm::mat4& project
     glEnable(GL_BLEND);
     glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
 
-    glUseProgram(m_floorShader);
-    glUniformMatrix4fv(glGetUniformLocation(m_floorShader, "view"), 1, GL_FALSE,
-                       glm::value_ptr(view));
-    glUniformMatrix4fv(glGetUniformLocation(m_floorShader, "projection"), 1, GL_FALSE,
-                       glm::value_ptr(projection));
-    glUniform3fv(glGetUniformLocation(m_floorShader, "lightPos"), 1, glm::value_ptr(lightPos));
+    m_floorShader->use();
 
-    // Calcular centro y radio de la planta para sombras
+    // Centro y radio de la planta para sombras: la huella de su caja envolvente
     glm::vec3 plantCenter(0.0f, 0.0f, 0.0f);
-    float plantRadius = 0.5f;  // Radio estimado de la planta
-
-    glUniform3fv(glGetUniformLocation(m_floorShader, "plantCenter"), 1,
-                 glm::value_ptr(plantCenter));
-    glUniform1f(glGetUniformLocation(m_floorShader, "plantRadius"), plantRadius);
+    float plantRadius = 0.5f;  // Sin jerarquia (sin geometria)
+    glm::vec3 boundsMin;
+    glm::vec3 boundsMax;
+    if (getPlantBounds(boundsMin, boundsMax)) {
+        plantCenter = glm::vec3(0.5F * (boundsMin.x + boundsMax.x), 0.0F,
+                                0.5F * (boundsMin.z + boundsMax.z));
+        plantRadius = 0.5F * glm::length(glm::vec2(boundsMax.x - boundsMin.x,
+                                                   boundsMax.z - boundsMin.z));
+    }
+    m_floorShader->setVec3("plantCenter", plantCenter);
+    m_floorShader->setFloat("plantRadius", plantRadius);
+
+    const bool shadowMap = m_shadows && m_shadowValid;
+    m_floorShader->setInt("hasShadowMap", shadowMap ? GL_TRUE : GL_FALSE);
+    m_floorShader->setInt("shadowMap", static_cast<int>(SHADOW_TEXTURE_UNIT));
+    if (shadowMap) {
+        m_floorShader->setMat4("lightSpace", m_shadowMap.getLightSpace());
+        m_shadowMap.bindTexture(SHADOW_TEXTURE_UNIT);
+    }
 
     glBindVertexArray(m_floorVAO);
     glDrawArrays(GL_TRIANGLES, 0, 6);
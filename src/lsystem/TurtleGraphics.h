@@ -49,12 +49,24 @@
 
 #include <glad/glad.h>
 
+#include <array>
+#include <cstdint>
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
-#include <stack>
+#include <memory>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
+#include "BranchHierarchy.h"
+#include "LSystem.h"
+#include "rendering/BranchCuller.h"
+#include "rendering/GpuBuffer.h"
+#include "rendering/GpuTimer.h"
+#include "rendering/MeshLibrary.h"
+#include "rendering/Shader.h"
+#include "rendering/ShadowMap.h"
+
 /**
  * @brief Modo de renderizado para graficos de tortuga.
  */
@@ -67,38 +79,78 @@ enum class RenderMode {
  * @brief Estado completo de la tortuga para interpretacion de L-System.
  *
  * Almacena posicion, orientacion (como tres vectores ortonormales), y
- * propiedades visuales como ancho de linea y color.
+ * propiedades visuales como ancho de linea y tono. La tortuga avanza en
+ * unidades de paso y con ancho inicial 1; paso, ancho y colores los aplica la GPU.
  */
 struct TurtleState {
     glm::vec3 position{0.0f, 0.0f, 0.0f};  ///< Posicion actual en espacio mundial
     glm::vec3 heading{0.0f, 1.0f, 0.0f};   ///< Vector H: direccion de movimiento
     glm::vec3 left{-1.0f, 0.0f, 0.0f};     ///< Vector L: perpendicular izquierda
     glm::vec3 up{0.0f, 0.0f, 1.0f};        ///< Vector U: perpendicular arriba
-    float width{0.02f};                    ///< Ancho actual de linea/rama
-    glm::vec3 color{0.45f, 0.30f, 0.15f};  ///< Color actual de dibujo (cafe)
+    float width{1.0f};                     ///< Ancho actual relativo al inicial
+    float shade{0.0f};                     ///< Pasos ' acumulados (indice de la paleta)
     int depth{0};                          ///< Profundidad de ramificacion para decaimiento
 };
 
 /**
  * @brief Datos para un solo segmento de rama.
+ *
+ * Es tambien el formato completo de instancia de cilindro (10 floats, sin
+ * relleno): el vector de ramas se sube a la GPU con un solo memcpy. Las
+ * posiciones estan en unidades de paso y los radios en unidades del ancho
+ * inicial; el shader aplica paso, ancho y color en cada cuadro.
  */
 struct BranchData {
     glm::vec3 start;    ///< Posicion inicial
     glm::vec3 end;      ///< Posicion final
     float radiusStart;  ///< Radio al inicio
     float radiusEnd;    ///< Radio al final
-    glm::vec3 color;    ///< Color de rama
+    float shade;        ///< Indice de la paleta de ramas (ver TurtleState::shade)
+    float birth;        ///< Generacion de nacimiento + orden dentro de ella, en [g, g + 1)
 };
+static_assert(sizeof(BranchData) == 10 * sizeof(float), "BranchData must match the GPU layout");
 
 /**
  * @brief Datos para decoracion de hoja o flor.
+ *
+ * Es tambien el formato completo de instancia de decoracion (21 floats). El tipo
+ * no se guarda: hojas y flores viven en vectores separados, y el color de cada
+ * uno es un uniform.
  */
 struct DecorationData {
-    glm::vec3 position;     ///< Posicion en espacio mundial
+    glm::vec3 position;     ///< Posicion en unidades de paso
     glm::mat4 orientation;  ///< Matriz de orientacion
-    glm::vec3 color;        ///< Color
-    float size;             ///< Factor de escala
-    int type;               ///< 0 = hoja, 1 = flor
+    float size;             ///< Escala relativa al tamano de hoja (1 hoja, 1.5 flor)
+    float birth;            ///< Igual que BranchData::birth
+};
+static_assert(sizeof(DecorationData) == 21 * sizeof(float),
+              "DecorationData must match the GPU layout");
+
+/**
+ * @brief Ubicacion de una copia de la planta en un bosque (ver setPlacements()).
+ *
+ * Es tambien el formato de instancia de la ubicacion (8 floats): dos vec4 que la
+ * GPU lee una vez por copia.
+ */
+struct PlantPlacement {
+    glm::vec3 position;  ///< Base de la planta en el mundo
+    float scale;         ///< Escala uniforme
+    glm::vec3 tint;      ///< Multiplica los colores de ramas, hojas y flores
+    float yaw;           ///< Giro alrededor de +Y, en radianes
+};
+static_assert(sizeof(PlantPlacement) == 8 * sizeof(float),
+              "PlantPlacement must match the GPU layout");
+
+/**
+ * @brief Conteo previo de una cadena: geometria maxima y profundidad de la pila.
+ *
+ * Los segmentos fusionados hacen que el numero real de ramas pueda ser menor.
+ */
+struct GeometryCounts {
+    size_t branches{0};  ///< Simbolos de dibujo (F, G, A, B)
+    size_t leaves{0};    ///< Simbolos L y l
+    size_t flowers{0};   ///< Simbolos K y k
+    size_t maxDepth{0};  ///< Maximo anidamiento de corchetes
 };
 
 /**
@@ -143,6 +195,181 @@ public:
      */
     void interpret(const std::string& lsystemString, float angle);
 
+    /**
+     * @brief Interpreta la cadena actual de un L-System (de bytes o empaquetada).
+     */
+    void interpret(const LSystem& lsystem, float angle);
+
+    /**
+     * @brief Interpreta una cadena generando solo la geometria en CPU (sin OpenGL).
+     * @param lsystemString La cadena producida por generacion de L-System.
+     * @param angle El angulo delta en grados para comandos de rotacion.
+     * @param progress Callback opcional de progreso/cancelacion.
+     * @return true si se completo, false si el callback cancelo la interpretacion.
+     * @note Util para herramientas sin contexto grafico y para hilos de trabajo;
+     *       usar upload() despues desde el hilo con el contexto OpenGL.
+     */
+    bool buildGeometry(const std::string& lsystemString, float angle,
+                       const ProgressCallback& progress = nullptr);
+
+    /**
+     * @brief Variante de buildGeometry() para cadenas con modulos parametricos.
+     * @param parameters Buffer lateral de parametros (LSystem::getParameters()); vacio
+     *        equivale a buildGeometry(lsystemString, angle, progress).
+     * @note Con parametros la cadena se interpreta simbolo a simbolo: F(l) avanza l,
+     *       f(l) se mueve l, +(a) y demas giros rotan a grados, !(w) fija el ancho y
+     *       L(s)/K(s) fijan el tamano de la decoracion.
+     */
+    bool buildGeometry(const std::string& lsystemString, const std::vector<float>& parameters,
+                       float angle, const ProgressCallback& progress = nullptr);
+
+    /**
+     * @brief Cuenta en una sola pasada la geometria y la profundidad de pila de una cadena.
+     */
+    static GeometryCounts countGeometry(const std::string& lsystemString);
+    static GeometryCounts countGeometry(const PackedString& packed);
+
+    /**
+     * @brief Variante de buildGeometry() para una cadena empaquetada (PackedString).
+     * @note Se compila racha por racha sin desempaquetarla: una racha de F entra
+     *       completa en una operacion Draw.
+     */
+    bool buildGeometry(const PackedString& packed, float angle,
+                       const ProgressCallback& progress = nullptr);
+
+    /**
+     * @brief Interpreta la cadena actual de un L-System en su representacion.
+     * @note Equivale a buildGeometry(getPackedString(), ...) si lsystem.isPacked(), y si
+     *       no a buildGeometry(getString(), getParameters(), ...).
+     */
+    bool buildGeometry(const LSystem& lsystem, float angle,
+                       const ProgressCallback& progress = nullptr);
+
+    /**
+     * @brief Variante de buildGeometry() que consume un flujo perezoso de simbolos.
+     * @note El progreso se reporta como indeterminado (valor negativo).
+     * @note Es la unica interpretacion que registra el nacimiento de cada instancia
+     *       (ver setGrowthTime()): el flujo conoce la derivacion de cada simbolo.
+     */
+    bool buildGeometry(SymbolStream& symbols, float angle,
+                       const ProgressCallback& progress = nullptr);
+
+    /**
+     * @brief Variante de buildGeometry() con la expansion memoizada de interpretMemoized().
+     * @note El progreso se reporta como indeterminado (valor negativo).
+     * @note Con producciones estocasticas o parametricas un mismo simbolo se expande
+     *       distinto en cada aparicion: se interpreta el flujo de simbolos sin cache.
+     */
+    bool buildGeometryMemoized(const LSystem& lsystem, int generations, float angle,
+                               const ProgressCallback& progress = nullptr);
+
+    /**
+     * @brief Copia los parametros de interpretacion (modo, tamanos y colores) de otra tortuga.
+     * @note No copia geometria ni recursos OpenGL.
+     */
+    void copySettings(const TurtleGraphics& other);
+
+    /**
+     * @brief Intercambia la geometria en CPU con otra tortuga (sin subirla a GPU).
+     */
+    void swapGeometry(TurtleGraphics& other);
+
+    /**
+     * @brief Reemplaza la geometria en CPU por instancias ya interpretadas.
+     *
+     * Para geometria guardada (GeometryCache): los arreglos estan en el formato
+     * completo de instancia y se copian (pueden apuntar a un mapeo que se libera
+     * al volver). No usa OpenGL; subir despues con upload().
+     * @param spans Rangos de los corchetes (ver getSpans()); la jerarquia se
+     *        reconstruye con ellos como si se hubiera interpretado la cadena.
+     * @param growthDuration Ver getGrowthDuration().
+     */
+    void assignGeometry(const BranchData* branches, size_t branchCount,
+                        const DecorationData* leaves, size_t leafCount,
+                        const DecorationData* flowers, size_t flowerCount,
+                        const InstanceSpan* spans, size_t spanCount, float growthDuration);
+
+    /**
+     * @brief Geometria en CPU en el formato completo de instancia.
+     */
+    const std::vector<BranchData>& getBranches() const {
+        return m_branches;
+    }
+    const std::vector<DecorationData>& getLeaves() const {
+        return m_leaves;
+    }
+    const std::vector<DecorationData>& getFlowers() const {
+        return m_flowers;
+    }
+
+    /**
+     * @brief Rangos de instancias de cada '[' en preorden (entrada de la jerarquia).
+     */
+    const std::vector<InstanceSpan>& getSpans() const {
+        return m_spans;
+    }
+
+    /**
+     * @brief Sube la geometria generada en CPU a los buffers de GPU.
+     */
+    void upload();
+
+    /**
+     * @brief Escribe en memoria las instancias que upload() copia a la GPU.
+     * @param out Destino: ramas y luego decoraciones; se redimensiona a los bytes escritos.
+     * @param compact true para el formato compacto (ver setCompactInstances()).
+     * @note No usa OpenGL: mide la preparacion de la subida en herramientas sin ventana.
+     */
+    void packInstances(std::vector<unsigned char>& out, bool compact);
+
+    /**
+     * @brief Construye la jerarquia de subarboles (BranchHierarchy) de la geometria
+     *        actual si cambio desde la ultima vez.
+     * @note No usa OpenGL: los hilos de trabajo la construyen antes de entregar la
+     *       geometria; upload() la construye si falta.
+     */
+    void buildHierarchy();
+
+    const BranchHierarchy& getHierarchy() const {
+        return m_hierarchy;
+    }
+
+    /**
+     * @brief Caja envolvente de la planta en espacio de mundo (con paso y anchos actuales).
+     * @return false si no hay geometria o la jerarquia no se ha construido.
+     */
+    bool getPlantBounds(glm::vec3& boundsMin, glm::vec3& boundsMax) const;
+
+    /**
+     * @brief Rama mas cercana que atraviesa un rayo en espacio de mundo.
+     * @param direction Normalizada.
+     * @return Indice en getBranches(), o -1 si el rayo no toca ninguna.
+     */
+    int64_t pickBranch(const glm::vec3& origin, const glm::vec3& direction) const;
+
+    /**
+     * @brief Interpreta un flujo perezoso de simbolos sin materializar la cadena.
+     * @param symbols Flujo creado por LSystem::stream(); se consume por completo.
+     * @param angle El angulo delta en grados para comandos de rotacion.
+     */
+    void interpret(SymbolStream& symbols, float angle);
+
+    /**
+     * @brief Interpreta la derivacion de un L-System reutilizando subarboles repetidos.
+     *
+     * Recorre la derivacion desde el axioma. La primera vez que expande un simbolo
+     * con cierta profundidad restante guarda su geometria en el espacio local de la
+     * tortuga; las repeticiones se emiten transformando ese bloque en lugar de volver
+     * a interpretar cada simbolo.
+     *
+     * @param lsystem L-System con axioma y reglas (no requiere generate()).
+     * @param generations Numero de generaciones a expandir.
+     * @param angle El angulo delta en grados para comandos de rotacion.
+     * @note Solo se memoiza en modo 3D, donde todas las rotaciones son relativas al
+     *       marco de la tortuga; en 2D se expande sin cache.
+     */
+    void interpretMemoized(const LSystem& lsystem, int generations, float angle);
+
     /**
      * @brief Renderiza la geometria generada.
      * @param view Matriz de vista desde la camara.
@@ -152,6 +379,25 @@ public:
     void render(const glm::mat4& view, const glm::mat4& projection,
                 const glm::vec3& lightPos = glm::vec3(5.0f, 10.0f, 5.0f));
 
+    /**
+     * @brief Sube las ubicaciones con que renderPlacements() repite la geometria.
+     * @param placements Copias de la planta; una lista vacia no dibuja ninguna.
+     * @note Las copias leen las instancias en formato completo desde un texture
+     *       buffer: requiere setCompactInstances(false) antes de subir la geometria.
+     */
+    void setPlacements(const std::vector<PlantPlacement>& placements);
+
+    /**
+     * @brief Dibuja la geometria subida una vez por ubicacion (sin piso ni culling).
+     *
+     * Cada malla (cilindro, esfera de union, linea, hoja o flor) es una sola llamada
+     * instanciada para todas las copias: los buffers de la planta se comparten y
+     * cada copia solo agrega sus 32 bytes de ubicacion. Si las instancias de todas
+     * las copias no caben en un GLsizei, las copias se dibujan en varias llamadas.
+     */
+    void renderPlacements(const glm::mat4& view, const glm::mat4& projection,
+                          const glm::vec3& lightPos);
+
     /**
      * @brief Limpia toda la geometria generada.
      */
@@ -167,15 +413,16 @@ public:
     void setRenderMode(RenderMode mode) {
         m_renderMode = mode;
     }
+    /**
+     * @brief Paso, ancho inicial, colores y tamano de hoja son uniforms sobre la
+     *        geometria en espacio unitario: se aplican de inmediato, sin reinterpretar.
+     */
     void setStepSize(float step) {
         m_stepSize = step;
     }
     void setInitialWidth(float width) {
         m_initialWidth = width;
     }
-    void setWidthDecay(float decay) {
-        m_widthDecay = decay;
-    }
     void setBranchColor(const glm::vec3& color) {
         m_branchColor = color;
     }
@@ -189,6 +436,84 @@ public:
         m_leafSize = size;
     }
 
+    /**
+     * @brief El decaimiento depende de la profundidad de cada rama y queda en la
+     *        geometria.
+     * @note Se aplica en la proxima interpretacion (la cadena no cambia, ver programFor()).
+     */
+    void setWidthDecay(float decay) {
+        m_widthDecay = decay;
+    }
+    void setFastRotations(bool enable) {
+        m_fastRotations = enable;
+    }
+
+    /**
+     * @brief Fusiona segmentos consecutivos colineales (p. ej. cadenas FF) en una
+     *        sola rama que va del radio inicial del primero al final del ultimo.
+     * @note Se aplica en la proxima interpretacion.
+     */
+    void setCoalesceSegments(bool enable) {
+        m_coalesceSegments = enable;
+    }
+
+    /**
+     * @brief Interpreta cadenas grandes en paralelo, repartiendo los subarboles de
+     *        primer nivel ([...]) entre hilos. El resultado es identico al serie.
+     * @param enable true para interpretar en paralelo (solo buildGeometry con cadena).
+     * @param threads Numero de hilos; 0 usa std::thread::hardware_concurrency().
+     */
+    void setParallelInterpretation(bool enable, unsigned threads = 0) {
+        m_parallelInterpretation = enable;
+        m_interpretThreads = threads;
+    }
+
+    /**
+     * @brief Usa el formato compacto de instancias (posiciones cuantizadas a 16 bits
+     *        dentro de la caja envolvente, radios half-float, tono de 16 bits y
+     *        orientacion como cuaternion). Vuelve a subir la geometria actual.
+     */
+    void setCompactInstances(bool enable);
+
+    /**
+     * @brief Culling por frustum y LOD de cilindros en GPU (ver BranchCuller).
+     * @note Sin efecto si el culling no pudo inicializarse.
+     */
+    void setGpuCulling(bool enable) {
+        m_gpuCulling = enable;
+    }
+
+    /**
+     * @brief Cierra ambos extremos de cada cilindro con una tapa plana.
+     */
+    void setCylinderCaps(bool enable);
+
+    /**
+     * @brief Dibuja una esfera en el extremo de cada rama para cubrir los huecos
+     *        entre segmentos que cambian de direccion.
+     */
+    void setJointSpheres(bool enable) {
+        m_jointSpheres = enable;
+    }
+
+    /**
+     * @brief Culling por frustum en CPU con la jerarquia de subarboles: dibuja solo
+     *        los rangos de instancias visibles (lineas, cilindros sin culling en GPU,
+     *        hojas y flores).
+     * @note Requiere GL 4.2 (glDraw*BaseInstance); sin el se dibuja todo.
+     */
+    void setCpuCulling(bool enable) {
+        m_cpuCulling = enable;
+    }
+
+    /**
+     * @brief Resalta una rama (p. ej. la de pickBranch()); -1 para ninguna.
+     * @note Requiere GL 4.2, como setCpuCulling().
+     */
+    void setHighlightedBranch(int64_t branch) {
+        m_highlightedBranch = branch;
+    }
+
     // =========================================================================
     // Getters de Configuracion
     // =========================================================================
@@ -220,6 +545,39 @@ public:
     float getLeafSize() const {
         return m_leafSize;
     }
+    bool getFastRotations() const {
+        return m_fastRotations;
+    }
+    bool getCoalesceSegments() const {
+        return m_coalesceSegments;
+    }
+    bool getParallelInterpretation() const {
+        return m_parallelInterpretation;
+    }
+    bool getCompactInstances() const {
+        return m_compactInstances;
+    }
+    bool getGpuCulling() const {
+        return m_gpuCulling;
+    }
+    bool isGpuCullingAvailable() const {
+        return m_culler.isReady();
+    }
+    bool getCylinderCaps() const {
+        return m_cylinderCaps;
+    }
+    bool getJointSpheres() const {
+        return m_jointSpheres;
+    }
+    bool getCpuCulling() const {
+        return m_cpuCulling;
+    }
+    bool isCpuCullingAvailable() const {
+        return m_baseInstance;
+    }
+    int64_t getHighlightedBranch() const {
+        return m_highlightedBranch;
+    }
 
     // =========================================================================
     // Estadisticas
@@ -228,10 +586,82 @@ public:
     size_t getBranchCount() const {
         return m_branches.size();
     }
+    /**
+     * @brief Llamadas a upload(): cambia con cada arbol nuevo en GPU.
+     */
+    size_t getUploadCount() const {
+        return m_uploadCount;
+    }
     size_t getDecorationCount() const {
-        return m_decorations.size();
+        return m_leaves.size() + m_flowers.size();
+    }
+    size_t getSubtreeCacheSize() const {
+        return m_subtreeCache.size();
+    }
+    size_t getSubtreeCacheHits() const {
+        return m_subtreeCacheHits;
+    }
+
+    /**
+     * @brief Segmentos absorbidos por la rama anterior en la ultima interpretacion.
+     */
+    size_t getCoalescedSegmentCount() const {
+        return m_coalescedSegments;
+    }
+
+    /**
+     * @brief Copias subidas por el ultimo setPlacements().
+     */
+    size_t getPlacementCount() const {
+        return m_placementCount;
+    }
+
+    /**
+     * @brief Ramas visibles por grupo de LOD en el ultimo culling en GPU.
+     * @param bucket 0..BranchCuller::LOD_COUNT-1 (cilindros) o BranchCuller::LINE_BUCKET.
+     */
+    size_t getVisibleBranchCount(int bucket) const {
+        return m_culler.getVisibleCount(bucket);
+    }
+
+    /**
+     * @brief Resultado del ultimo culling en CPU (rangos dibujados y nodos visitados).
+     */
+    const BranchHierarchy::VisibleRanges& getVisibleRanges() const {
+        return m_visible;
+    }
+
+    /**
+     * @brief Memoria reservada por la geometria en CPU (ramas, hojas y flores).
+     */
+    size_t getGeometryBytes() const {
+        return m_branches.capacity() * sizeof(BranchData) +
+               (m_leaves.capacity() + m_flowers.capacity()) * sizeof(DecorationData);
+    }
+
+    /**
+     * @brief Memoria reservada en GPU: instancias, mallas, salida del culling y mapa de sombras.
+     */
+    size_t getGpuBytes() const {
+        return m_cylinderInstanceBuffer.allocatedBytes() +
+               m_decorationInstanceBuffer.allocatedBytes() + m_meshes.bufferBytes() +
+               m_culler.getBufferBytes() + m_placementBuffer.allocatedBytes() +
+               m_shadowMap.getBytes();
     }
 
+    /**
+     * @brief Estima la memoria de una geometria antes de construirla.
+     * @param branches Ramas, p. ej. de LSystem::predictGrowth() (sin fusionar segmentos,
+     *        asi que es una cota superior).
+     * @param decorations Hojas mas flores.
+     * @param compact Formato de las instancias en GPU (ver setCompactInstances()).
+     * @param cpuBytes Recibe los bytes de ramas y decoraciones en CPU.
+     * @param gpuBytes Recibe los bytes de los buffers de instancias (dos copias en
+     *        modo persistente); no incluye mallas ni la salida del culling.
+     */
+    void estimateGeometryBytes(double branches, double decorations, bool compact,
+                               double& cpuBytes, double& gpuBytes) const;
+
     // =========================================================================
     // Control del Piso
     // =========================================================================
@@ -243,28 +673,308 @@ public:
         return m_showFloor;
     }
 
+    /**
+     * @brief Sombra de la planta en el piso con un mapa de sombras desde la luz.
+     *
+     * La pasada de profundidad solo se repite cuando cambia la geometria, la luz,
+     * las escalas (paso, ancho, hoja) o el instante de crecimiento. Sin mapa el
+     * piso usa la sombra aproximada alrededor de la caja de la planta.
+     */
+    void setShadows(bool enable) {
+        m_shadows = enable;
+    }
+    bool getShadows() const {
+        return m_shadows;
+    }
+
+    /**
+     * @brief Veces que se ha dibujado el mapa de sombras.
+     */
+    size_t getShadowMapUpdates() const {
+        return m_shadowUpdates;
+    }
+
+    // =========================================================================
+    // Animacion de Crecimiento
+    // =========================================================================
+
+    /**
+     * @brief Instante de la animacion de crecimiento, en generaciones.
+     *
+     * Cada instancia crece (las ramas se alargan y engrosan, las decoraciones
+     * escalan y aparecen) durante GROWTH_RAMP generaciones a partir de su
+     * nacimiento. Toda la animacion es un uniform por cuadro sobre la geometria
+     * ya subida. Por defecto el arbol esta completo.
+     */
+    void setGrowthTime(float time) {
+        m_growthTime = time;
+    }
+    float getGrowthTime() const {
+        return m_growthTime;
+    }
+
+    /**
+     * @brief Instante en que termina de crecer la ultima instancia (0 si la ultima
+     *        interpretacion no registro nacimientos).
+     *
+     * Solo buildGeometry(SymbolStream&) registra nacimientos: la cadena completa,
+     * empaquetada o memoizada no dice en que generacion nacio cada simbolo, asi que
+     * esos arboles nacen enteros en 0 y no se animan. El formato compacto guarda
+     * cada nacimiento en unorm16 como fraccion de esta duracion.
+     */
+    float getGrowthDuration() const {
+        return m_growthDuration;
+    }
+
+    static constexpr float GROWTH_RAMP = 0.25F;        ///< Ver growth() en los shaders
+    static constexpr float GROWTH_COMPLETE = 1.0e6F;  ///< Instante con todo crecido
+
 private:
     // =========================================================================
     // Metodos Internos
     // =========================================================================
 
     void setupFloor();
-    void renderFloor(const glm::mat4& view, const glm::mat4& projection, const glm::vec3& lightPos);
+    void renderFloor();
+
+    /**
+     * @brief Pasa a Profiler las mediciones de GPU de cuadros anteriores ya resueltas.
+     */
+    void collectGpuTimings();
+    void resetTurtle(float angle);
+    void reserveGeometry(const GeometryCounts& counts);
+
+    // Efectos de los comandos, compartidos por processCommand() y runProgram()
+    void drawSegment(float length = 1.0F);
+    void pushState();
+    void popState();
+    void emitDecoration(std::vector<DecorationData>& out, float size);
+    void shadeGreener();
+
+    /**
+     * @brief Convierte la generacion de nacimiento de cada instancia en
+     *        generacion + orden de emision dentro de ella y calcula la duracion.
+     */
+    void finishGrowth();
+
+    void finishInterpretation();
     void processCommand(char cmd, float angle);
+
+    /**
+     * @brief processCommand() para un modulo con 'count' parametros en 'values'.
+     */
+    void processModule(char cmd, const float* values, int count, float angle);
+
+    /**
+     * @brief Gira la tortuga 'degrees' grados con un comando de rotacion (+ - & ^ \ /),
+     *        usando la formula de Rodrigues.
+     */
+    void rotateBy(char cmd, float degrees);
+
+    /**
+     * @brief Extiende la ultima rama con 'branch' si es su continuacion recta
+     *        (mismo tono y radio inicial). Devuelve true si la absorbio.
+     */
+    bool coalesceInto(const BranchData& branch);
+    bool pollProgress();
+    void emitSubtree(char symbol, int remaining, float angle);
     bool compileShaders();
     void uploadBranchData();
     void uploadDecorationData();
-    void renderLines(const glm::mat4& view, const glm::mat4& projection);
-    void renderCylinders(const glm::mat4& view, const glm::mat4& projection,
-                         const glm::vec3& lightPos);
-    void renderDecorations(const glm::mat4& view, const glm::mat4& projection,
-                           const glm::vec3& lightPos);
+    void writeBranchInstances(void* out, bool compact) const;
+    void writeDecorationInstances(void* out, bool compact) const;
+    void computeInstanceBounds();
+    void setCompactUniforms(const Shader& shader) const;
+    void bindCylinderInstanceAttributes();
+    void bindDecorationInstanceAttributes(GLuint vao, size_t firstInstance);
+    void bindPlacementAttributes();
+    void bindPlacementRange(GLuint vao, size_t instancesPerPlant, size_t firstPlacement);
+    void updateFrameUniforms(const glm::mat4& view, const glm::mat4& projection,
+                             const glm::vec3& lightPos);
+    void updateCullerMeshes();
+
+    // Camara y luz vienen del uniform buffer por cuadro que llena render()
+    void renderLines();
+    void renderCylinders(const glm::mat4& view, const glm::mat4& projection);
+    void renderCulledCylinders(const glm::mat4& view, const glm::mat4& projection);
+    void renderDecorations();
+    void renderHighlight();
+
+    /**
+     * @brief Dibuja la pasada de profundidad desde la luz si algo cambio.
+     * @note Usa el bloque FrameData con la camara de la luz: llamar antes de
+     *       updateFrameUniforms() con la camara del cuadro.
+     */
+    void updateShadowMap(const glm::vec3& lightPos);
+
+    /**
+     * @brief true si este cuadro dibuja los rangos de m_visible en lugar de todo.
+     */
+    bool cpuCullingActive() const {
+        return m_cpuCulling && m_baseInstance && !m_hierarchy.isEmpty();
+    }
+    InstanceScale instanceScale() const {
+        return {m_stepSize, m_initialWidth, m_leafSize};
+    }
 
     /**
      * @brief Rota un vector alrededor de un eje usando la formula de Rodrigues.
      */
     static glm::vec3 rotateAroundAxis(const glm::vec3& vec, const glm::vec3& axis, float angleDeg);
 
+    /**
+     * @brief Rotaciones precalculadas para el angulo delta de una interpretacion.
+     *
+     * Las rotaciones locales se expresan en el marco (H, L, U) de la tortuga y se
+     * aplican como un solo producto de matrices: [H L U]' = [H L U] * R.
+     */
+    struct RotationTable {
+        glm::mat3 yawLeft{1.0F};     ///< '+' alrededor de U
+        glm::mat3 yawRight{1.0F};    ///< '-' alrededor de U
+        glm::mat3 pitchDown{1.0F};   ///< '&' alrededor de L
+        glm::mat3 pitchUp{1.0F};     ///< '^' alrededor de L
+        glm::mat3 rollLeft{1.0F};    ///< '\\' alrededor de H
+        glm::mat3 rollRight{1.0F};   ///< '/' alrededor de H
+        glm::mat3 turnAround{1.0F};  ///< '|' 180 grados alrededor de U
+        glm::mat3 worldLeft{1.0F};   ///< '+' en modo 2D (eje Z mundial)
+        glm::mat3 worldRight{1.0F};  ///< '-' en modo 2D (eje Z mundial)
+        glm::mat3 worldTurn{1.0F};   ///< '|' en modo 2D (eje Z mundial)
+    };
+
+    /**
+     * @brief Calcula la tabla de rotaciones para el angulo dado.
+     */
+    void prepareRotations(float angle);
+
+    /**
+     * @brief Aplica una rotacion local precalculada al marco (H, L, U).
+     */
+    void rotateFrame(const glm::mat3& localRotation);
+
+    /**
+     * @brief Gira H y L: rotacion local en 3D o sobre el eje Z mundial en 2D.
+     */
+    void turn(const glm::mat3& localRotation, const glm::mat3& worldRotation);
+
+    /**
+     * @brief Operaciones del programa compilado de una cadena (ver compileProgram()).
+     */
+    enum class TurtleOp : uint8_t {
+        Draw,         ///< F, G, A, B: avanzar dibujando
+        Move,         ///< f: avanzar sin dibujar
+        RotateLocal,  ///< Racha de giros plegada: marco * R
+        RotateWorld,  ///< Racha de giros sobre Z mundial (2D): R * (H, L)
+        Push,         ///< [
+        Pop,          ///< ]
+        Leaf,         ///< L, l
+        Flower,       ///< K, k
+        Thin,         ///< !
+        Shade         ///< '
+    };
+
+    /**
+     * @brief Cadena compilada a un flujo compacto de operaciones de tortuga.
+     *
+     * Cada operacion ocupa 32 bits: el codigo en los 8 bits bajos y en los 24 altos
+     * el numero de repeticiones o, en los giros, el indice de la matriz plegada.
+     * Los simbolos sin efecto (variables) se descartan. Solo depende de la cadena,
+     * el angulo y el modo 2D/3D, asi que se reutiliza si cambian paso, anchos o colores.
+     */
+    struct TurtleProgram {
+        std::vector<uint32_t> ops;
+        std::vector<glm::mat3> rotations;  ///< Rachas de giros distintas, ya multiplicadas
+        GeometryCounts counts;             ///< Para reservar la geometria sin recontar
+        size_t sourceHash{0};
+        size_t sourceLength{0};
+        float angle{0.0F};
+        bool is3D{false};
+        bool valid{false};
+    };
+
+    static constexpr uint32_t OP_ARG_LIMIT = (uint32_t{1} << 24) - 1;
+
+    static uint32_t encodeOp(TurtleOp op, uint32_t arg) {
+        return static_cast<uint32_t>(op) | (arg << 8);
+    }
+    static TurtleOp opCode(uint32_t word) {
+        return static_cast<TurtleOp>(word & 0xFFU);
+    }
+    static uint32_t opArg(uint32_t word) {
+        return word >> 8;
+    }
+
+    /**
+     * @brief Devuelve el programa de la cadena, compilandolo solo si cambio la
+     *        cadena (hash y longitud), el angulo o el modo 2D/3D.
+     * @pre prepareRotations(angle) ya fue llamado.
+     */
+    const TurtleProgram& programFor(const std::string& lsystemString, float angle);
+    const TurtleProgram& programFor(const PackedString& packed, float angle);
+
+    /**
+     * @brief Indica si m_program ya es el de una cadena con ese hash y esa longitud.
+     */
+    bool programMatches(size_t hash, size_t length, float angle) const;
+
+    /**
+     * @brief Compila una cadena en m_program.
+     * @param forEachRun Recorre la cadena llamando a emit(simbolo, repeticiones).
+     * @param length Simbolos de la cadena.
+     */
+    template <typename ForEachRun>
+    void compileProgram(ForEachRun&& forEachRun, float angle, size_t hash, size_t length);
+
+    /**
+     * @brief Reserva la geometria del programa y lo ejecuta, en paralelo si conviene.
+     * @param length Simbolos de la cadena compilada.
+     */
+    bool runCompiledProgram(const TurtleProgram& program, size_t length,
+                            const ProgressCallback& progress);
+
+    /**
+     * @brief Ejecuta las operaciones [begin, end) del programa sobre el estado actual.
+     * @return false si el callback de progreso cancelo la ejecucion.
+     */
+    bool runProgram(const TurtleProgram& program, size_t begin, size_t end,
+                    const ProgressCallback& progress);
+
+    /**
+     * @brief Ejecuta el programa repartiendo sus subarboles de primer nivel entre hilos.
+     *
+     * Una pasada serie ejecuta solo el nivel superior y guarda el estado en cada
+     * apertura de corchete de primer nivel; los hilos ejecutan esos subarboles desde
+     * su estado de entrada sin fusionar segmentos, y la geometria se concatena en
+     * orden aplicando la fusion como lo haria la ejecucion serie.
+     */
+    bool buildGeometryParallel(const TurtleProgram& program, unsigned threads,
+                               const ProgressCallback& progress);
+
+    /**
+     * @brief Geometria de un subarbol expandido, en el espacio local de la tortuga.
+     *
+     * El espacio local es el estado inicial de TurtleState (origen, H = +Y, ancho 1,
+     * tono 0): los radios escalan con el ancho de entrada y los tonos se suman al suyo.
+     */
+    struct SubtreeBlock {
+        std::vector<BranchData> branches;
+        std::vector<DecorationData> leaves;
+        std::vector<DecorationData> flowers;
+        TurtleState exit;       ///< Estado de salida relativo al de entrada
+        size_t coalesced{0};    ///< Segmentos fusionados dentro del bloque
+        /// Corchetes del bloque con indices relativos a el; sin padre: el '[' que lo contiene
+        std::vector<InstanceSpan> spans;
+    };
+
+    /**
+     * @brief Expande 'rule' en espacio local y devuelve su geometria sin emitirla.
+     */
+    SubtreeBlock recordSubtree(const std::string& rule, int remaining, float angle);
+
+    /**
+     * @brief Emite un bloque memoizado bajo el estado actual y avanza la tortuga.
+     */
+    void applySubtree(const SubtreeBlock& block);
+
     // =========================================================================
     // Estado
     // =========================================================================
@@ -274,16 +984,56 @@ private:
     RenderMode m_renderMode{RenderMode::Lines};
 
     TurtleState m_currentState;
-    std::stack<TurtleState> m_stateStack;
+    std::vector<TurtleState> m_stateStack;  ///< Contiguo; conserva su capacidad entre cadenas
+
+    bool m_fastRotations{true};  ///< Usar RotationTable en lugar de Rodrigues por comando
+    RotationTable m_rotations;
+
+    bool m_coalesceSegments{true};
+    bool m_parallelInterpretation{true};
+    unsigned m_interpretThreads{0};  ///< 0 = hardware_concurrency
+    size_t m_coalescedSegments{0};
+    size_t m_coalesceFloor{0};  ///< Ramas anteriores a este indice no se extienden
+
+    // =========================================================================
+    // Cache de Subarboles (interpretMemoized)
+    // =========================================================================
+
+    TurtleProgram m_program;  ///< Ultima cadena compilada (buildGeometry con cadena)
+
+    std::array<const std::string*, 256> m_memoRules{};  ///< Reemplazo por simbolo (o nullptr)
+    std::array<bool, 256> m_memoCacheable{};  ///< Expansion con corchetes balanceados
+    std::unordered_map<uint32_t, SubtreeBlock> m_subtreeCache;  ///< Clave: (simbolo, profundidad)
+    size_t m_subtreeCacheHits{0};
+
+    // =========================================================================
+    // Progreso (buildGeometry con callback)
+    // =========================================================================
+
+    const ProgressCallback* m_progress{nullptr};  ///< Callback del trabajo en curso
+    size_t m_progressTicks{0};
+    bool m_cancelled{false};
 
     // =========================================================================
-    // Geometria Generada
+    // Geometria Generada (en formato de instancia de GPU)
     // =========================================================================
 
     std::vector<BranchData> m_branches;
-    std::vector<DecorationData> m_decorations;
-    std::vector<DecorationData> m_leaves;   ///< Hojas separadas para render
-    std::vector<DecorationData> m_flowers;  ///< Flores separadas para render
+    std::vector<DecorationData> m_leaves;   ///< En el buffer de instancias van primero
+    std::vector<DecorationData> m_flowers;  ///< A continuacion de las hojas
+
+    // =========================================================================
+    // Jerarquia de Subarboles
+    // =========================================================================
+
+    std::vector<InstanceSpan> m_spans;     ///< Un '[' por entrada, en preorden (ver pushState())
+    std::vector<uint32_t> m_spanStack;     ///< Indice en m_spans de cada '[' abierto
+    BranchHierarchy m_hierarchy;
+    bool m_hierarchyDirty{false};          ///< La geometria cambio desde buildHierarchy()
+    bool m_baseInstance{false};            ///< GL 4.2: dibujos por rango de instancias
+    bool m_cpuCulling{true};
+    BranchHierarchy::VisibleRanges m_visible;
+    int64_t m_highlightedBranch{-1};
 
     // =========================================================================
     // Parametros de Renderizado
@@ -301,27 +1051,70 @@ private:
     // Recursos OpenGL - Modo Lineas
     // =========================================================================
 
-    GLuint m_lineVAO{0};
-    GLuint m_lineVBO{0};
-    GLuint m_lineShader{0};
+    // Una linea instanciada por rama, leida del buffer de instancias de cilindros
+    std::unique_ptr<Shader> m_lineShader;
+    std::unique_ptr<Shader> m_lineCompactShader;  ///< Variante COMPACT_INSTANCES
 
     // =========================================================================
     // Recursos OpenGL - Modo Cilindros
     // =========================================================================
 
     GLuint m_cylinderVAO{0};
-    GLuint m_cylinderVBO{0};
-    GLuint m_cylinderInstanceVBO{0};
-    GLuint m_cylinderShader{0};
+    MeshLibrary m_meshes;  ///< Cilindros por LOD, tapas y esferas de union (VBO/IBO)
+    GpuBuffer m_cylinderInstanceBuffer;
+    std::unique_ptr<Shader> m_cylinderShader;
+    std::unique_ptr<Shader> m_cylinderCompactShader;  ///< Variante COMPACT_INSTANCES
+    bool m_cylinderCaps{false};  ///< Casi siempre ocultas por las esferas de union
+    bool m_jointSpheres{true};
+
+    // =========================================================================
+    // Culling en GPU
+    // =========================================================================
+
+    BranchCuller m_culler;
+    bool m_gpuCulling{true};
 
     // =========================================================================
     // Recursos OpenGL - Decoraciones (hojas/flores)
     // =========================================================================
 
-    GLuint m_decorationVAO{0};
+    GLuint m_leafVAO{0};    ///< Instancias desde el inicio del buffer
+    GLuint m_flowerVAO{0};  ///< Instancias desde la primera flor
     GLuint m_decorationVBO{0};
-    GLuint m_decorationInstanceVBO{0};
-    GLuint m_decorationShader{0};
+    GpuBuffer m_decorationInstanceBuffer;
+    std::unique_ptr<Shader> m_decorationShader;
+    std::unique_ptr<Shader> m_decorationCompactShader;  ///< Variante COMPACT_INSTANCES
+
+    // =========================================================================
+    // Recursos OpenGL - Ubicaciones (bosque)
+    // =========================================================================
+
+    GLuint m_placementBranchVAO{0};  ///< Mallas de cilindro + ubicaciones (tambien lineas)
+    GLuint m_placementLeafVAO{0};    ///< Quad de decoracion + ubicaciones
+    GLuint m_placementFlowerVAO{0};
+    GLuint m_branchTexture{0};      ///< Texture buffer R32F sobre las instancias de rama
+    GLuint m_decorationTexture{0};  ///< Texture buffer R32F sobre hojas y flores
+    GpuBuffer m_placementBuffer;
+    size_t m_placementCount{0};
+    std::unique_ptr<Shader> m_linePlacementShader;  ///< Variantes FOREST_PLACEMENTS
+    std::unique_ptr<Shader> m_cylinderPlacementShader;
+    std::unique_ptr<Shader> m_decorationPlacementShader;
+
+    // =========================================================================
+    // Formato de Instancias
+    // =========================================================================
+
+    bool m_compactInstances{true};   ///< Formato pedido para la proxima subida
+    bool m_uploadedCompact{false};   ///< Formato de los datos actualmente en GPU
+    size_t m_uploadCount{0};         ///< Llamadas a upload()
+    glm::vec3 m_boundsMin{0.0F};     ///< Caja envolvente para posiciones cuantizadas
+    glm::vec3 m_boundsExtent{1.0F};
+
+    // =========================================================================
+    // Uniforms por Frame
+    // =========================================================================
+
+    GLuint m_frameUBO{0};  ///< FrameData: view, projection, lightPos, viewPos (std140)
 
     // =========================================================================
     // Recursos OpenGL - Piso con sombras
@@ -329,15 +1122,49 @@ private:
 
     GLuint m_floorVAO{0};
     GLuint m_floorVBO{0};
-    GLuint m_floorShader{0};
+    std::unique_ptr<Shader> m_floorShader;
     bool m_showFloor{true};
 
+    // Mapa de sombras: se crea en el primer render() con sombras
+    ShadowMap m_shadowMap;
+    std::unique_ptr<Shader> m_cylinderDepthShader;  ///< Vertices de cilindro, sin color
+    std::unique_ptr<Shader> m_cylinderDepthCompactShader;
+    bool m_shadows{true};
+    bool m_shadowDirty{true};    ///< Geometria subida despues del ultimo mapa
+    bool m_shadowValid{false};   ///< El mapa tiene la planta actual
+    glm::vec3 m_shadowLight{0.0F};  ///< Luz y escalas con que se dibujo el mapa
+    glm::vec4 m_shadowScale{0.0F};
+    size_t m_shadowUpdates{0};
+
+    // =========================================================================
+    // Perfilado en GPU (GL_TIME_ELAPSED)
+    // =========================================================================
+
+    GpuTimer m_floorTimer;
+    GpuTimer m_branchTimer;  ///< Culling y dibujo de ramas
+    GpuTimer m_decorationTimer;
+
+    // =========================================================================
+    // Animacion de Crecimiento
+    // =========================================================================
+
+    int m_currentBirth{0};               ///< Nacimiento del simbolo en interpretacion
+    float m_growthTime{GROWTH_COMPLETE};
+    float m_growthDuration{0.0F};
+
     // =========================================================================
     // Constantes
     // =========================================================================
 
-    static constexpr int CYLINDER_SEGMENTS = 8;
-    static constexpr int CYLINDER_VERTEX_COUNT = (CYLINDER_SEGMENTS + 1) * 2;
+    static constexpr GLuint FRAME_UNIFORM_BINDING = 0;  ///< Bloque FrameData (camara y luz)
+    static constexpr int DEFAULT_CYLINDER_LOD = 2;  ///< 8 segmentos cuando no hay culling
+    static constexpr int PLACEMENT_CYLINDER_LOD = 1;  ///< 6 segmentos: miles de copias lejanas
+    static constexpr GLuint INSTANCE_TEXTURE_UNIT = 0;  ///< Unidad del texture buffer de copias
+    static constexpr GLuint SHADOW_TEXTURE_UNIT = 1;  ///< Unidad del mapa de sombras del piso
+    static constexpr int SHADOW_CYLINDER_LOD = 1;  ///< 6 segmentos bastan para la silueta
+    static constexpr float COALESCE_MIN_COS = 0.999999F;  ///< Direcciones a menos de ~0.08 grados
+    static constexpr size_t PROGRESS_INTERVAL = size_t{1} << 16;  ///< Simbolos entre sondeos
+    static constexpr size_t PARALLEL_MIN_SYMBOLS = size_t{1} << 16;  ///< Cadenas menores: en serie
 };
 
 #endif  // TURTLE_GRAPHICS_H
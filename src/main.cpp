@@ -6,6 +6,13 @@
  * Proporciona visualizacion interactiva 3D de plantas generadas por L-System con
  * controles de camara orbital.
  *
+ * La escena se dibuja en un framebuffer fuera de pantalla con MSAA y se copia a
+ * la ventana; FramePacer decide cuando volver a dibujarla (bajo demanda, la
+ * interfaz se compone sobre el ultimo cuadro guardado) y aplica el limite de FPS.
+ *
+ * Con --batch <trabajos> no hay bucle interactivo: la ventana queda oculta y
+ * BatchRenderer exporta los trabajos a PNG desde un framebuffer fuera de pantalla.
+ *
  * @author Julian Parra
  * @date 2025
  * @course Graficacion
@@ -20,11 +27,23 @@
 
 #include <algorithm>
 #include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
 #include <iostream>
+#include <string>
+#include <vector>
 
+#include "core/FramePacer.h"
+#include "core/Profiler.h"
+#include "lsystem/GenerationWorker.h"
 #include "lsystem/LSystem.h"
 #include "lsystem/TurtleGraphics.h"
 #include "rendering/Camera.h"
+#include "rendering/GpuTimer.h"
+#include "rendering/OffscreenTarget.h"
+#include "scene/BatchRenderer.h"
+#include "scene/Forest.h"
 #include "ui/UI.h"
 
 // =============================================================================
@@ -35,6 +54,8 @@ constexpr int WINDOW_WIDTH = 1280;
 constexpr int WINDOW_HEIGHT = 720;
 constexpr float INITIAL_CAMERA_DISTANCE = 3.5F;
 constexpr float INITIAL_CAMERA_ANGLE_Y = 20.0F;
+constexpr float MAX_CAMERA_DISTANCE = 30.0F;  // Alcanza el borde de un bosque grande
+constexpr int SCENE_SAMPLES = 4;              // MSAA del framebuffer de la escena
 
 // =============================================================================
 // Estado Global para Manejo de Entrada
@@ -46,6 +67,10 @@ static double g_lastMouseY = 0.0;
 static float g_cameraDistance = INITIAL_CAMERA_DISTANCE;
 static float g_cameraAngleX = 0.0F;
 static float g_cameraAngleY = INITIAL_CAMERA_ANGLE_Y;
+static bool g_pickRequested = false;  // Clic derecho pendiente de resolver en el bucle
+static double g_pickX = 0.0;
+static double g_pickY = 0.0;
+static bool g_inputReceived = false;  // Algun evento desde el cuadro anterior (FramePacer)
 
 // =============================================================================
 // Callbacks de GLFW
@@ -53,14 +78,17 @@ static float g_cameraAngleY = INITIAL_CAMERA_ANGLE_Y;
 
 void framebufferSizeCallback(GLFWwindow* /*window*/, int width, int height) {
     glViewport(0, 0, width, height);
+    g_inputReceived = true;
 }
 
 void scrollCallback(GLFWwindow* /*window*/, double /*xoffset*/, double yoffset) {
+    g_inputReceived = true;
     g_cameraDistance -= static_cast<float>(yoffset) * 0.2F;
-    g_cameraDistance = std::clamp(g_cameraDistance, 0.3F, 10.0F);
+    g_cameraDistance = std::clamp(g_cameraDistance, 0.3F, MAX_CAMERA_DISTANCE);
 }
 
 void mouseButtonCallback(GLFWwindow* window, int button, int action, int /*mods*/) {
+    g_inputReceived = true;
     if (button == GLFW_MOUSE_BUTTON_LEFT) {
         ImGuiIO& io = ImGui::GetIO();
         if (action == GLFW_PRESS && !io.WantCaptureMouse) {
@@ -69,10 +97,17 @@ void mouseButtonCallback(GLFWwindow* window, int button, int action, int /*mods*
         } else if (action == GLFW_RELEASE) {
             g_mousePressed = false;
         }
+    } else if (button == GLFW_MOUSE_BUTTON_RIGHT && action == GLFW_PRESS) {
+        // Seleccion de rama: necesita la camara del cuadro, se resuelve en el bucle
+        if (!ImGui::GetIO().WantCaptureMouse) {
+            g_pickRequested = true;
+            glfwGetCursorPos(window, &g_pickX, &g_pickY);
+        }
     }
 }
 
 void cursorPositionCallback(GLFWwindow* /*window*/, double xpos, double ypos) {
+    g_inputReceived = true;
     if (g_mousePressed) {
         float deltaX = static_cast<float>(xpos - g_lastMouseX);
         float deltaY = static_cast<float>(ypos - g_lastMouseY);
@@ -87,16 +122,123 @@ void cursorPositionCallback(GLFWwindow* /*window*/, double xpos, double ypos) {
 }
 
 void keyCallback(GLFWwindow* window, int key, int /*scancode*/, int action, int /*mods*/) {
+    g_inputReceived = true;
     if (key == GLFW_KEY_ESCAPE && action == GLFW_PRESS) {
         glfwSetWindowShouldClose(window, GLFW_TRUE);
     }
 }
 
+/**
+ * @brief Rayo en espacio de mundo bajo un punto de la ventana.
+ * @param x, y Posicion del cursor en coordenadas de ventana (origen arriba a la izquierda).
+ */
+void cursorRay(GLFWwindow* window, const Camera& camera, double x, double y, glm::vec3& origin,
+               glm::vec3& direction) {
+    int width = 0, height = 0;
+    glfwGetWindowSize(window, &width, &height);
+    const float ndcX = 2.0F * static_cast<float>(x) / static_cast<float>(std::max(width, 1)) - 1.0F;
+    const float ndcY = 1.0F - 2.0F * static_cast<float>(y) / static_cast<float>(std::max(height, 1));
+
+    const glm::mat4 inverse = glm::inverse(camera.getProjectionMatrix() * camera.getViewMatrix());
+    glm::vec4 nearPoint = inverse * glm::vec4(ndcX, ndcY, -1.0F, 1.0F);
+    glm::vec4 farPoint = inverse * glm::vec4(ndcX, ndcY, 1.0F, 1.0F);
+    nearPoint /= nearPoint.w;
+    farPoint /= farPoint.w;
+
+    origin = glm::vec3(nearPoint);
+    direction = glm::normalize(glm::vec3(farPoint - nearPoint));
+}
+
+// =============================================================================
+// Linea de Comandos
+// =============================================================================
+
+void printUsage(const char* program) {
+    std::cout << "Uso: " << program << " [--batch TRABAJOS] [--output DIR] [--size ANCHOxALTO]\n"
+              << "       [--samples N] [--encoders N] [--no-cache]\n\n"
+              << "Sin --batch abre el visualizador interactivo. Con --batch renderiza cada\n"
+              << "linea de TRABAJOS (preset; generaciones; distancia; anguloX; anguloY;\n"
+              << "cuadros; nombre) a PNG en una ventana oculta.\n";
+}
+
+/**
+ * @brief Lee los argumentos del modo sin interfaz.
+ * @return false si un argumento es invalido (ya reportado).
+ */
+bool parseArguments(int argc, char** argv, std::string& jobsPath, BatchOptions& options) {
+    for (int i = 1; i < argc; ++i) {
+        const char* arg = argv[i];
+        const char* value = (i + 1 < argc) ? argv[i + 1] : nullptr;
+        if (std::strcmp(arg, "--no-cache") == 0) {
+            options.useGeometryCache = false;
+            continue;
+        }
+        if (std::strcmp(arg, "--help") == 0) {
+            printUsage(argv[0]);
+            std::exit(0);
+        }
+        if (value == nullptr) {
+            std::cerr << "ERROR: argumento desconocido o sin valor: " << arg << '\n';
+            return false;
+        }
+        i++;
+        if (std::strcmp(arg, "--batch") == 0) {
+            jobsPath = value;
+        } else if (std::strcmp(arg, "--output") == 0) {
+            options.outputDirectory = value;
+        } else if (std::strcmp(arg, "--size") == 0) {
+            if (std::sscanf(value, "%dx%d", &options.width, &options.height) != 2 ||
+                options.width <= 0 || options.height <= 0) {
+                std::cerr << "ERROR: tamano invalido (ANCHOxALTO): " << value << '\n';
+                return false;
+            }
+        } else if (std::strcmp(arg, "--samples") == 0) {
+            options.samples = std::max(std::atoi(value), 0);
+        } else if (std::strcmp(arg, "--encoders") == 0) {
+            options.encoderThreads = static_cast<unsigned>(std::max(std::atoi(value), 0));
+        } else {
+            std::cerr << "ERROR: argumento desconocido: " << arg << '\n';
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief Modo sin interfaz: renderiza la lista de trabajos y termina.
+ * @pre Contexto OpenGL activo (de una ventana oculta).
+ */
+int runBatch(const std::string& jobsPath, const BatchOptions& options) {
+    std::vector<RenderJob> jobs;
+    if (!loadRenderJobs(jobsPath, jobs))
+        return -1;
+
+    // El renderizador es dueno de objetos GL: debe destruirse antes de glfwTerminate()
+    BatchRenderer renderer(options);
+    if (!renderer.initialize()) {
+        std::cerr << "ERROR: Fallo al inicializar el render por lotes\n";
+        return -1;
+    }
+    size_t expected = 0;
+    for (const RenderJob& job : jobs) {
+        expected += static_cast<size_t>(job.frames);
+    }
+    return renderer.run(jobs) == expected ? 0 : 1;
+}
+
 // =============================================================================
 // Punto de Entrada Principal
 // =============================================================================
 
-int main() {
+int main(int argc, char** argv) {
+    std::string jobsPath;
+    BatchOptions batchOptions;
+    if (!parseArguments(argc, argv, jobsPath, batchOptions)) {
+        printUsage(argv[0]);
+        return -1;
+    }
+    const bool batch = !jobsPath.empty();
+
     // -------------------------------------------------------------------------
     // Inicializar GLFW
     // -------------------------------------------------------------------------
@@ -108,7 +250,13 @@ int main() {
     glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
     glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
     glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
-    glfwWindowHint(GLFW_SAMPLES, 4);  // Habilitar MSAA
+    // Sin MSAA en la ventana: la escena se dibuja multimuestreada fuera de pantalla
+    // y glBlitFramebuffer no puede copiar a un destino multimuestreado
+    glfwWindowHint(GLFW_SAMPLES, 0);
+    if (batch) {
+        // Solo se necesita el contexto: los cuadros van a un framebuffer fuera de pantalla
+        glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+    }
 
 #ifdef __APPLE__
     glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
@@ -146,6 +294,12 @@ int main() {
     std::cout << "Renderer: " << glGetString(GL_RENDERER) << '\n';
     std::cout << "=============================\n\n";
 
+    if (batch) {
+        const int status = runBatch(jobsPath, batchOptions);
+        glfwTerminate();
+        return status;
+    }
+
     // Habilitar caracteristicas de OpenGL
     glEnable(GL_DEPTH_TEST);
     glEnable(GL_MULTISAMPLE);
@@ -171,16 +325,45 @@ int main() {
     // -------------------------------------------------------------------------
     // Generar Planta Inicial (primer preset: Pino 3D)
     // -------------------------------------------------------------------------
-    lsystem.setAxiom("A");
-    lsystem.addRule('A', "F[&FL!A]/////[&FL!A]///////[&FL!A]");
-    lsystem.setAngle(22.5F);
-    lsystem.generate(6);
+    GenerationRequest initial;
+    initial.axiom = "A";
+    initial.rules = "A->F[&FL!A]/////[&FL!A]///////[&FL!A]";
+    initial.angle = 22.5F;
+    initial.generations = 6;
+
+    lsystem.setAxiom(initial.axiom);
+    lsystem.addRulesFromString(initial.rules);
+    lsystem.setAngle(initial.angle);
     turtle.set3DMode(true);
     turtle.setRenderMode(RenderMode::Cylinders);
-    turtle.interpret(lsystem.getString(), lsystem.getAngle());
+
+    // Con la geometria en disco no se reescribe ni se interpreta nada
+    const GeometryCache geometryCache;
+    const uint64_t initialKey = makeCacheKey(initial).hash(turtle);
+    GeometryCacheInfo cached;
+    if (geometryCache.load(initialKey, turtle, &cached)) {
+        turtle.upload();
+        userInterface.setCachedTree(initial, cached.stringLength);
+        std::cout << "Planta inicial cargada de " << geometryCache.getDirectory() << "/\n";
+    } else {
+        lsystem.generate(initial.generations);
+        turtle.interpret(lsystem, lsystem.getAngle());
+        geometryCache.store(initialKey, turtle, lsystem.getLength());
+    }
 
     std::cout << "Planta inicial generada: " << turtle.getBranchCount() << " ramas\n\n";
 
+    // Escena guardada entre cuadros y ritmo del bucle
+    OffscreenTarget sceneTarget;
+    FramePacer pacer;
+    GpuTimer frameTimer;
+    frameTimer.create(true);  // Marcas de tiempo: encierra los temporizadores de la tortuga
+    size_t sceneUploads = 0;
+    glm::vec3 sceneCamera(-1.0F);  // Distancia y angulos de la escena guardada
+
+    // Bosque alrededor de la planta (vacio hasta plantarlo desde la interfaz)
+    Forest forest;
+
     // Posicion de luz para renderizado 3D
     glm::vec3 lightPos(5.0F, 8.0F, 5.0F);
 
@@ -188,13 +371,47 @@ int main() {
     // Bucle Principal de Renderizado
     // -------------------------------------------------------------------------
     while (glfwWindowShouldClose(window) == GLFW_FALSE) {
-        // Obtener tamano de framebuffer para camara
+        // Obtener tamano de framebuffer para camara (minimizada: nada que dibujar)
         int fbWidth = 0, fbHeight = 0;
         glfwGetFramebufferSize(window, &fbWidth, &fbHeight);
+        if (fbWidth <= 0 || fbHeight <= 0) {
+            glfwWaitEvents();
+            continue;
+        }
+        const double frameStart = Profiler::nowMicroseconds();
+        if (g_inputReceived) {
+            g_inputReceived = false;
+            pacer.notifyInput();
+        }
+
+        // La escena guardada sigue al tamano de la ventana
+        if (sceneTarget.getWidth() != fbWidth || sceneTarget.getHeight() != fbHeight) {
+            if (!sceneTarget.create(fbWidth, fbHeight, SCENE_SAMPLES) &&
+                !sceneTarget.create(fbWidth, fbHeight, 0)) {
+                std::cerr << "ERROR: Fallo al crear el framebuffer de la escena\n";
+                break;
+            }
+            pacer.invalidateScene();
+        }
 
         // Actualizar camara
         camera.updatePerspective(fbWidth, fbHeight);
         camera.updateView(g_cameraDistance, g_cameraAngleX, g_cameraAngleY);
+        const glm::vec3 cameraState(g_cameraDistance, g_cameraAngleX, g_cameraAngleY);
+        if (cameraState != sceneCamera) {
+            sceneCamera = cameraState;
+            pacer.invalidateScene();
+        }
+
+        // Seleccionar la rama bajo el cursor (clic en el vacio la deselecciona)
+        if (g_pickRequested) {
+            g_pickRequested = false;
+            glm::vec3 rayOrigin;
+            glm::vec3 rayDirection;
+            cursorRay(window, camera, g_pickX, g_pickY, rayOrigin, rayDirection);
+            turtle.setHighlightedBranch(turtle.pickBranch(rayOrigin, rayDirection));
+            pacer.invalidateScene();
+        }
 
         // Iniciar frame de UI
         userInterface.beginFrame();
@@ -204,27 +421,63 @@ int main() {
             std::cout << "Planta regenerada: " << turtle.getBranchCount() << " ramas, "
                       << turtle.getDecorationCount() << " decoraciones\n";
         });
+        userInterface.renderForestWindow(forest, turtle);
         userInterface.renderCameraWindow(g_cameraDistance, g_cameraAngleX, g_cameraAngleY);
-        userInterface.renderDebugWindow(window);
+        userInterface.renderDebugWindow(window, turtle, lsystem, pacer);
+
+        // Controles en uso, animacion o un arbol nuevo en GPU
+        if (userInterface.pollSceneChanges() || turtle.getUploadCount() != sceneUploads) {
+            sceneUploads = turtle.getUploadCount();
+            pacer.invalidateScene();
+        }
+
+        frameTimer.begin();
+        if (pacer.needsSceneRender()) {
+            sceneTarget.bind();
 
-        // Limpiar pantalla
-        const float* bgColor = userInterface.getBackgroundColor();
-        glClearColor(bgColor[0], bgColor[1], bgColor[2], bgColor[3]);
-        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+            // Limpiar pantalla
+            const float* bgColor = userInterface.getBackgroundColor();
+            glClearColor(bgColor[0], bgColor[1], bgColor[2], bgColor[3]);
+            glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-        // Renderizar la planta
-        turtle.render(camera.getViewMatrix(), camera.getProjectionMatrix(), lightPos);
+            // Renderizar la planta
+            turtle.render(camera.getViewMatrix(), camera.getProjectionMatrix(), lightPos);
+            forest.render(camera.getViewMatrix(), camera.getProjectionMatrix(), lightPos, turtle);
+
+            sceneTarget.resolve();
+            pacer.sceneRendered();
+        }
+        sceneTarget.present();
 
         // Finalizar frame de UI (renderiza ImGui encima)
         userInterface.endFrame();
+        frameTimer.end();
+
+        double gpuStart = 0.0;
+        double gpuDuration = 0.0;
+        while (frameTimer.collect(gpuStart, gpuDuration)) {
+            Profiler::instance().addSample(ProfileStage::GpuFrame, gpuStart, gpuDuration);
+        }
+        Profiler::instance().addSample(ProfileStage::Frame, frameStart,
+                                       Profiler::nowMicroseconds() - frameStart);
 
         glfwSwapBuffers(window);
-        glfwPollEvents();
+        pacer.endFrame();
+
+        // Escena quieta: dormir hasta el proximo evento
+        const double idleWait = pacer.getIdleWait(userInterface.isBusy());
+        if (idleWait > 0.0) {
+            glfwWaitEventsTimeout(idleWait);
+        } else {
+            glfwPollEvents();
+        }
     }
 
     // -------------------------------------------------------------------------
     // Limpieza
     // -------------------------------------------------------------------------
+    sceneTarget.destroy();
+    frameTimer.destroy();
     glfwTerminate();
     std::cout << "\nAplicacion terminada exitosamente.\n";
     return 0;
@@ -0,0 +1,597 @@
+/**
+ * @file BranchCuller.cpp
+ * @brief Implementacion del culling y seleccion de LOD de ramas en GPU.
+ *
+ * @author Julian Parra
+ * @date 2025
+ * @course Graficacion
+ * @project Proyecto Final - "Arboles: La Belleza Algoritmica de las Plantas"
+ */
+
+#include "BranchCuller.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <glm/gtc/type_ptr.hpp>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "CompactInstances.h"
+
+// =============================================================================
+// Shader Sources - Pasada de culling
+// =============================================================================
+
+// Cada rama es un punto: probarla contra el frustum y estimar su
+// diametro proyectado en pixeles para elegir un grupo (-1 = descartada). Las instancias
+// estan en espacio unitario; las pruebas las escalan pero la copia capturada no.
+static const char* CULL_VERTEX_SHADER = R"(
+#version 330 core
+#ifdef COMPACT_INSTANCES
+layout (location = 2) in vec4 iStartEndX;
+layout (location = 3) in vec2 iEndYZ;
+layout (location = 4) in vec2 iRadii;
+layout (location = 7) in float iBirthUnorm;  // unorm16: nacimiento / birthScale
+
+uniform vec3 boundsMin;
+uniform vec3 boundsExtent;
+uniform float birthScale;
+#else
+layout (location = 2) in vec3 iStart;
+layout (location = 3) in vec3 iEnd;
+layout (location = 4) in float iRadiusStart;
+layout (location = 5) in float iRadiusEnd;
+layout (location = 7) in float iBirth;
+#endif
+layout (location = 6) in float iShade;
+
+uniform mat4 view;
+uniform vec2 geometryScale;  // x: step size (positions), y: initial width (radii)
+uniform vec4 frustumPlanes[6];
+uniform float pixelScale;  // projection[1][1] * viewportHeight / 2
+uniform vec4 lodPixels;    // Umbrales de diametro: lineas | 3 | 6 | 8 | 16 segmentos
+
+out vec3 vStart;
+out vec3 vEnd;
+out vec2 vRadii;
+out float vShade;
+out float vBirth;
+flat out int vBucket;
+
+void main() {
+#ifdef COMPACT_INSTANCES
+    vStart = boundsMin + iStartEndX.xyz * boundsExtent;
+    vEnd = boundsMin + vec3(iStartEndX.w, iEndYZ) * boundsExtent;
+    vRadii = iRadii;
+    vBirth = iBirthUnorm * birthScale;
+#else
+    vStart = iStart;
+    vEnd = iEnd;
+    vRadii = vec2(iRadiusStart, iRadiusEnd);
+    vBirth = iBirth;
+#endif
+    vShade = iShade;
+
+    // Esfera envolvente del segmento en espacio del mundo
+    vec3 center = 0.5 * (vStart + vEnd) * geometryScale.x;
+    float radius = max(vRadii.x, vRadii.y) * geometryScale.y;
+    float bound = 0.5 * length(vEnd - vStart) * geometryScale.x + radius;
+
+    vBucket = -1;
+    for (int i = 0; i < 6; ++i) {
+        if (dot(frustumPlanes[i].xyz, center) + frustumPlanes[i].w < -bound) {
+            return;
+        }
+    }
+
+    float depth = max(-(view * vec4(center, 1.0)).z, 1e-4);
+    float pixels = 2.0 * radius * pixelScale / depth;
+    if (pixels < lodPixels.x) {
+        vBucket = 4;  // BranchCuller::LINE_BUCKET
+    } else if (pixels < lodPixels.y) {
+        vBucket = 0;
+    } else if (pixels < lodPixels.z) {
+        vBucket = 1;
+    } else if (pixels < lodPixels.w) {
+        vBucket = 2;
+    } else {
+        vBucket = 3;
+    }
+}
+)";
+
+// Envia cada rama al flujo de vertices de su grupo: los grupos firstBucket ..
+// firstBucket + streams - 1 se capturan en una pasada, un buffer por flujo.
+// El formato capturado es la instancia completa de cilindro (start, end, radios,
+// shade, birth = 10 floats). Las salidas por flujo se generan, porque
+// EmitStreamVertex() recibe una constante y cada flujo tiene sus propias salidas.
+static const char* CULL_GEOMETRY_HEADER = R"(
+layout (points) in;
+layout (points, max_vertices = 1) out;
+
+in vec3 vStart[];
+in vec3 vEnd[];
+in vec2 vRadii[];
+in float vShade[];
+in float vBirth[];
+flat in int vBucket[];
+
+uniform int firstBucket;
+)";
+
+static std::string cullGeometrySource(int streams) {
+    // Varios flujos requieren GLSL 4.00 (ARB_transform_feedback3 / gpu_shader5)
+    std::string source = streams > 1 ? "#version 400 core\n" : "#version 330 core\n";
+    source += CULL_GEOMETRY_HEADER;
+    for (int s = 0; s < streams; ++s) {
+        const std::string n = std::to_string(s);
+        const std::string out = (streams > 1 ? "layout (stream = " + n + ") out " : "out ");
+        source += out + "vec3 tfStart" + n + ";\n" + out + "vec3 tfEnd" + n + ";\n" + out +
+                  "vec2 tfRadii" + n + ";\n" + out + "float tfShade" + n + ";\n" + out +
+                  "float tfBirth" + n + ";\n";
+    }
+
+    source += "\nvoid main() {\n    int stream = vBucket[0] - firstBucket;\n";
+    for (int s = 0; s < streams; ++s) {
+        const std::string n = std::to_string(s);
+        const std::string emit = streams > 1 ? "        EmitStreamVertex(" + n +
+                                                   ");\n        EndStreamPrimitive(" + n + ");\n"
+                                             : "        EmitVertex();\n        EndPrimitive();\n";
+        source += std::string(s == 0 ? "    if" : "    else if") + " (stream == " + n + ") {\n" +
+                  "        tfStart" + n + " = vStart[0];\n        tfEnd" + n + " = vEnd[0];\n" +
+                  "        tfRadii" + n + " = vRadii[0];\n        tfShade" + n +
+                  " = vShade[0];\n        tfBirth" + n + " = vBirth[0];\n" + emit + "    }\n";
+    }
+    source += "}\n";
+    return source;
+}
+
+/**
+ * @brief Layout de glDrawArraysIndirect (GL 4.0).
+ */
+struct DrawArraysIndirectCommand {
+    GLuint count;
+    GLuint instanceCount;
+    GLuint first;
+    GLuint baseInstance;  ///< Debe ser 0 antes de GL 4.2
+};
+
+/**
+ * @brief Layout de glDrawElementsIndirect (GL 4.0).
+ */
+struct DrawElementsIndirectCommand {
+    GLuint count;
+    GLuint instanceCount;
+    GLuint firstIndex;
+    GLint baseVertex;
+    GLuint baseInstance;  ///< Debe ser 0 antes de GL 4.2
+};
+
+/**
+ * @brief Contenido del buffer indirecto: cilindro y esfera comparten el conteo de su LOD.
+ */
+struct IndirectCommands {
+    std::array<DrawElementsIndirectCommand, BranchCuller::LOD_COUNT> cylinders;
+    std::array<DrawElementsIndirectCommand, BranchCuller::LOD_COUNT> joints;
+    DrawArraysIndirectCommand lines;
+};
+
+// Umbrales de diametro proyectado en pixeles para cada limite entre grupos
+static const glm::vec4 LOD_PIXEL_THRESHOLDS(1.0F, 4.0F, 16.0F, 48.0F);
+
+// =============================================================================
+// Constructor / Destructor
+// =============================================================================
+
+BranchCuller::~BranchCuller() {
+    if (m_cullProgram != 0)
+        glDeleteProgram(m_cullProgram);
+    if (m_cullCompactProgram != 0)
+        glDeleteProgram(m_cullCompactProgram);
+    if (m_sourceVAO != 0)
+        glDeleteVertexArrays(1, &m_sourceVAO);
+    if (m_indirectBuffer != 0)
+        glDeleteBuffers(1, &m_indirectBuffer);
+
+    for (int bucket = 0; bucket < BUCKET_COUNT; ++bucket) {
+        if (m_bucketVAO[bucket] != 0)
+            glDeleteVertexArrays(1, &m_bucketVAO[bucket]);
+        if (m_bucketBuffer[bucket] != 0)
+            glDeleteBuffers(1, &m_bucketBuffer[bucket]);
+        if (m_writtenQuery[bucket] != 0)
+            glDeleteQueries(1, &m_writtenQuery[bucket]);
+        if (m_generatedQuery[bucket] != 0)
+            glDeleteQueries(1, &m_generatedQuery[bucket]);
+    }
+}
+
+// =============================================================================
+// Inicializacion
+// =============================================================================
+
+bool BranchCuller::initialize(const MeshLibrary& meshes) {
+    // Sin query buffers los conteos requeririan una lectura bloqueante en CPU cada cuadro
+    if (GLAD_GL_VERSION_4_4 == 0) {
+        std::cerr << "BranchCuller: requires OpenGL 4.4 (query buffer objects)\n";
+        return false;
+    }
+
+    auto compileShader = [](const std::string& source, GLenum type) -> GLuint {
+        const char* text = source.c_str();
+        GLuint shader = glCreateShader(type);
+        glShaderSource(shader, 1, &text, nullptr);
+        glCompileShader(shader);
+
+        GLint success = 0;
+        glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
+        if (success == 0) {
+            std::array<char, 512> infoLog{};
+            glGetShaderInfoLog(shader, 512, nullptr, infoLog.data());
+            std::cerr << "BranchCuller: shader compilation error:\n" << infoLog.data() << '\n';
+            glDeleteShader(shader);
+            return 0;
+        }
+        return shader;
+    };
+
+    // Programa de captura: vertices + geometria, sin etapa de fragmentos (rasterizer discard)
+    auto buildProgram = [&compileShader](const char* defines, int streams) -> GLuint {
+        std::string vertexSource(CULL_VERTEX_SHADER);
+        size_t lineEnd = vertexSource.find('\n', vertexSource.find("#version"));
+        vertexSource.insert(lineEnd + 1, defines);
+
+        GLuint vertex = compileShader(vertexSource, GL_VERTEX_SHADER);
+        GLuint geometry = compileShader(cullGeometrySource(streams), GL_GEOMETRY_SHADER);
+        if (vertex == 0 || geometry == 0) {
+            glDeleteShader(vertex);
+            glDeleteShader(geometry);
+            return 0;
+        }
+
+        GLuint program = glCreateProgram();
+        glAttachShader(program, vertex);
+        glAttachShader(program, geometry);
+
+        // Las salidas de cada flujo van al siguiente punto de enlace de buffer
+        std::vector<std::string> names;
+        for (int s = 0; s < streams; ++s) {
+            if (s > 0) {
+                names.emplace_back("gl_NextBuffer");
+            }
+            for (const char* output : {"tfStart", "tfEnd", "tfRadii", "tfShade", "tfBirth"}) {
+                names.push_back(output + std::to_string(s));
+            }
+        }
+        std::vector<const char*> varyings;
+        for (const std::string& name : names) {
+            varyings.push_back(name.c_str());
+        }
+        glTransformFeedbackVaryings(program, static_cast<GLsizei>(varyings.size()),
+                                    varyings.data(), GL_INTERLEAVED_ATTRIBS);
+        glLinkProgram(program);
+        glDeleteShader(vertex);
+        glDeleteShader(geometry);
+
+        GLint success = 0;
+        glGetProgramiv(program, GL_LINK_STATUS, &success);
+        if (success == 0) {
+            std::array<char, 512> infoLog{};
+            glGetProgramInfoLog(program, 512, nullptr, infoLog.data());
+            std::cerr << "BranchCuller: shader linking error:\n" << infoLog.data() << '\n';
+            glDeleteProgram(program);
+            return 0;
+        }
+        return program;
+    };
+
+    // Tantos grupos por pasada como flujos de vertices y buffers de captura haya (GL 4.0
+    // garantiza 4); si ese programa no compila, una pasada por grupo
+    GLint maxStreams = 1;
+    GLint maxBuffers = 1;
+    glGetIntegerv(GL_MAX_VERTEX_STREAMS, &maxStreams);
+    glGetIntegerv(GL_MAX_TRANSFORM_FEEDBACK_BUFFERS, &maxBuffers);
+    m_streams = std::clamp(std::min(maxStreams, maxBuffers), 1, BUCKET_COUNT);
+    for (;;) {
+        m_cullProgram = buildProgram("", m_streams);
+        m_cullCompactProgram = buildProgram("#define COMPACT_INSTANCES\n", m_streams);
+        if ((m_cullProgram != 0 && m_cullCompactProgram != 0) || m_streams == 1)
+            break;
+        glDeleteProgram(m_cullProgram);
+        glDeleteProgram(m_cullCompactProgram);
+        m_streams = 1;
+    }
+    if (m_cullProgram == 0 || m_cullCompactProgram == 0)
+        return false;
+
+    // Las ubicaciones de uniforms se buscan una vez, no en cada cull()
+    auto lookUp = [](GLuint program) {
+        CullUniforms uniforms;
+        uniforms.view = glGetUniformLocation(program, "view");
+        uniforms.frustumPlanes = glGetUniformLocation(program, "frustumPlanes");
+        uniforms.pixelScale = glGetUniformLocation(program, "pixelScale");
+        uniforms.lodPixels = glGetUniformLocation(program, "lodPixels");
+        uniforms.boundsMin = glGetUniformLocation(program, "boundsMin");
+        uniforms.boundsExtent = glGetUniformLocation(program, "boundsExtent");
+        uniforms.birthScale = glGetUniformLocation(program, "birthScale");
+        uniforms.geometryScale = glGetUniformLocation(program, "geometryScale");
+        uniforms.firstBucket = glGetUniformLocation(program, "firstBucket");
+        return uniforms;
+    };
+    m_cullUniforms = lookUp(m_cullProgram);
+    m_cullCompactUniforms = lookUp(m_cullCompactProgram);
+
+    glGenVertexArrays(1, &m_sourceVAO);
+    glGenVertexArrays(BUCKET_COUNT, m_bucketVAO.data());
+    glGenBuffers(BUCKET_COUNT, m_bucketBuffer.data());
+    glGenQueries(BUCKET_COUNT, m_writtenQuery.data());
+    glGenQueries(BUCKET_COUNT, m_generatedQuery.data());
+
+    for (int bucket = 0; bucket < BUCKET_COUNT; ++bucket) {
+        growBucket(bucket, INITIAL_BUCKET_INSTANCES);
+        bindBucketAttributes(bucket, meshes);
+    }
+
+    // Los resultados de las consultas van directo a los comandos de dibujo indirecto
+    glGenBuffers(1, &m_indirectBuffer);
+    for (int lod = 0; lod < LOD_COUNT; ++lod) {
+        m_cylinders[lod] = meshes.cylinder(lod, false);
+        m_joints[lod] = meshes.jointSphere(lod);
+    }
+    writeCommands();
+
+    m_ready = true;
+    std::cout << "BranchCuller: Initialized (indirect draws, " << getPassCount()
+              << " capture passes)\n";
+    return true;
+}
+
+void BranchCuller::growBucket(int bucket, size_t instances) {
+    // Mismo nombre de buffer, mas memoria: el VAO del grupo sigue valido
+    m_bucketCapacity[bucket] = instances;
+    glBindBuffer(GL_ARRAY_BUFFER, m_bucketBuffer[bucket]);
+    glBufferData(GL_ARRAY_BUFFER,
+                 static_cast<GLsizeiptr>(instances * INSTANCE_FLOATS * sizeof(float)), nullptr,
+                 GL_DYNAMIC_COPY);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+void BranchCuller::setMeshes(const std::array<MeshRange, LOD_COUNT>& cylinders,
+                             const std::array<MeshRange, LOD_COUNT>& joints) {
+    m_cylinders = cylinders;
+    m_joints = joints;
+    if (m_ready) {
+        writeCommands();
+    }
+}
+
+void BranchCuller::writeCommands() {
+    // Los conteos de instancias los llenan las consultas de cada pasada de cull()
+    IndirectCommands commands{};
+    for (int lod = 0; lod < LOD_COUNT; ++lod) {
+        commands.cylinders[lod].count = static_cast<GLuint>(m_cylinders[lod].indexCount);
+        commands.cylinders[lod].firstIndex = m_cylinders[lod].firstIndex;
+        commands.cylinders[lod].baseVertex = m_cylinders[lod].baseVertex;
+        commands.joints[lod].count = static_cast<GLuint>(m_joints[lod].indexCount);
+        commands.joints[lod].firstIndex = m_joints[lod].firstIndex;
+        commands.joints[lod].baseVertex = m_joints[lod].baseVertex;
+    }
+    commands.lines.count = 2;
+
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, m_indirectBuffer);
+    glBufferData(GL_DRAW_INDIRECT_BUFFER, sizeof(commands), &commands, GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+}
+
+void BranchCuller::bindBucketAttributes(int bucket, const MeshLibrary& meshes) {
+    glBindVertexArray(m_bucketVAO[bucket]);
+
+    // Los LOD de cilindro leen la malla compartida; el grupo de lineas solo usa gl_VertexID
+    if (bucket != LINE_BUCKET) {
+        meshes.bindVertexAttributes();
+    }
+
+    // Instancias capturadas: start(3) + end(3) + r1(1) + r2(1) + shade(1) + birth(1)
+    glBindBuffer(GL_ARRAY_BUFFER, m_bucketBuffer[bucket]);
+    constexpr GLsizei stride = INSTANCE_FLOATS * sizeof(float);
+    const std::array<GLint, 6> sizes = {3, 3, 1, 1, 1, 1};
+    size_t offset = 0;
+    for (GLuint i = 0; i < sizes.size(); ++i) {
+        GLuint location = 2 + i;
+        glVertexAttribPointer(location, sizes[i], GL_FLOAT, GL_FALSE, stride,
+                              reinterpret_cast<void*>(offset * sizeof(float)));
+        glEnableVertexAttribArray(location);
+        glVertexAttribDivisor(location, 1);
+        offset += static_cast<size_t>(sizes[i]);
+    }
+
+    glBindVertexArray(0);
+}
+
+// =============================================================================
+// Culling
+// =============================================================================
+
+void BranchCuller::setSource(GLuint instanceBuffer, bool compact, size_t count) {
+    m_sourceCompact = compact;
+    m_sourceCount = count;
+
+    // Mismos atributos que el VAO de cilindros, pero una rama por vertice (sin divisor)
+    glBindVertexArray(m_sourceVAO);
+    glBindBuffer(GL_ARRAY_BUFFER, instanceBuffer);
+    for (GLuint location = 2; location <= 7; ++location) {
+        glDisableVertexAttribArray(location);
+    }
+
+    if (compact) {
+        constexpr GLsizei stride = sizeof(CompactBranchInstance);
+        glVertexAttribPointer(2, 4, GL_UNSIGNED_SHORT, GL_TRUE, stride,
+                              reinterpret_cast<void*>(offsetof(CompactBranchInstance, startEndX)));
+        glVertexAttribPointer(3, 2, GL_UNSIGNED_SHORT, GL_TRUE, stride,
+                              reinterpret_cast<void*>(offsetof(CompactBranchInstance, endYZ)));
+        glVertexAttribPointer(4, 2, GL_HALF_FLOAT, GL_FALSE, stride,
+                              reinterpret_cast<void*>(offsetof(CompactBranchInstance, radii)));
+        glVertexAttribPointer(6, 1, GL_UNSIGNED_SHORT, GL_FALSE, stride,
+                              reinterpret_cast<void*>(offsetof(CompactBranchInstance, shade)));
+        glVertexAttribPointer(7, 1, GL_UNSIGNED_SHORT, GL_TRUE, stride,
+                              reinterpret_cast<void*>(offsetof(CompactBranchInstance, birth)));
+        for (GLuint location : {2U, 3U, 4U, 6U, 7U}) {
+            glEnableVertexAttribArray(location);
+        }
+    } else {
+        constexpr GLsizei stride = INSTANCE_FLOATS * sizeof(float);
+        const std::array<GLint, 6> sizes = {3, 3, 1, 1, 1, 1};
+        size_t offset = 0;
+        for (GLuint i = 0; i < sizes.size(); ++i) {
+            glVertexAttribPointer(2 + i, sizes[i], GL_FLOAT, GL_FALSE, stride,
+                                  reinterpret_cast<void*>(offset * sizeof(float)));
+            glEnableVertexAttribArray(2 + i);
+            offset += static_cast<size_t>(sizes[i]);
+        }
+    }
+
+    glBindVertexArray(0);
+}
+
+void BranchCuller::cull(const glm::mat4& view, const glm::mat4& projection,
+                        const glm::vec3& boundsMin, const glm::vec3& boundsExtent,
+                        float birthScale, const glm::vec2& geometryScale) {
+    if (!m_ready || m_sourceCount == 0)
+        return;
+
+    // Resultados de un cuadro anterior, solo si estan listos: estadisticas y crecimiento
+    if (m_queriesPending) {
+        readBackCounts();
+    }
+
+    // Planos del frustum a partir de las filas de la matriz vista-proyeccion (Gribb-Hartmann)
+    const glm::mat4 viewProjection = projection * view;
+    std::array<glm::vec4, 6> planes;
+    for (int axis = 0; axis < 3; ++axis) {
+        glm::vec4 row(viewProjection[0][axis], viewProjection[1][axis], viewProjection[2][axis],
+                      viewProjection[3][axis]);
+        glm::vec4 w(viewProjection[0][3], viewProjection[1][3], viewProjection[2][3],
+                    viewProjection[3][3]);
+        planes[axis * 2] = w + row;
+        planes[axis * 2 + 1] = w - row;
+    }
+    for (auto& plane : planes) {
+        plane /= glm::length(glm::vec3(plane));
+    }
+
+    std::array<GLint, 4> viewport{};
+    glGetIntegerv(GL_VIEWPORT, viewport.data());
+    const float pixelScale = projection[1][1] * 0.5F * static_cast<float>(viewport[3]);
+
+    const CullUniforms& uniforms = m_sourceCompact ? m_cullCompactUniforms : m_cullUniforms;
+    glUseProgram(m_sourceCompact ? m_cullCompactProgram : m_cullProgram);
+    glUniformMatrix4fv(uniforms.view, 1, GL_FALSE, glm::value_ptr(view));
+    glUniform4fv(uniforms.frustumPlanes, 6, glm::value_ptr(planes[0]));
+    glUniform1f(uniforms.pixelScale, pixelScale);
+    glUniform4fv(uniforms.lodPixels, 1, glm::value_ptr(LOD_PIXEL_THRESHOLDS));
+    glUniform2fv(uniforms.geometryScale, 1, glm::value_ptr(geometryScale));
+    if (m_sourceCompact) {
+        glUniform3fv(uniforms.boundsMin, 1, glm::value_ptr(boundsMin));
+        glUniform3fv(uniforms.boundsExtent, 1, glm::value_ptr(boundsExtent));
+        glUniform1f(uniforms.birthScale, birthScale);
+    }
+    // Cada pasada lee todas las ramas, asi que menos pasadas es todo el ahorro: una con
+    // 5+ flujos, dos con el limite usual de 4, una por grupo con un solo flujo
+    glEnable(GL_RASTERIZER_DISCARD);
+    glBindVertexArray(m_sourceVAO);
+    for (int first = 0; first < BUCKET_COUNT; first += m_streams) {
+        const int last = std::min(first + m_streams, BUCKET_COUNT);
+        glUniform1i(uniforms.firstBucket, first);
+
+        // Una ultima pasada corta aun necesita un buffer en cada flujo: reusar los de la
+        // pasada anterior, no se emite nada en ellos
+        for (int stream = 0; stream < m_streams; ++stream) {
+            const int bucket =
+                first + stream < BUCKET_COUNT ? first + stream : first + stream - m_streams;
+            glBindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, static_cast<GLuint>(stream),
+                             m_bucketBuffer[bucket]);
+        }
+
+        for (int bucket = first; bucket < last; ++bucket) {
+            const auto stream = static_cast<GLuint>(bucket - first);
+            glBeginQueryIndexed(GL_TRANSFORM_FEEDBACK_PRIMITIVES_WRITTEN, stream,
+                                m_writtenQuery[bucket]);
+            glBeginQueryIndexed(GL_PRIMITIVES_GENERATED, stream, m_generatedQuery[bucket]);
+        }
+        glBeginTransformFeedback(GL_POINTS);
+        glDrawArrays(GL_POINTS, 0, static_cast<GLsizei>(m_sourceCount));
+        glEndTransformFeedback();
+        for (int bucket = first; bucket < last; ++bucket) {
+            const auto stream = static_cast<GLuint>(bucket - first);
+            glEndQueryIndexed(GL_TRANSFORM_FEEDBACK_PRIMITIVES_WRITTEN, stream);
+            glEndQueryIndexed(GL_PRIMITIVES_GENERATED, stream);
+        }
+    }
+    for (int stream = 0; stream < m_streams; ++stream) {
+        glBindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, static_cast<GLuint>(stream), 0);
+    }
+    glBindVertexArray(0);
+    glDisable(GL_RASTERIZER_DISCARD);
+
+    // La GPU escribe cada conteo en el instanceCount de sus comandos; la CPU nunca espera
+    auto writeCount = [](GLuint query, size_t offset) {
+        glGetQueryObjectuiv(query, GL_QUERY_RESULT, reinterpret_cast<GLuint*>(offset));
+    };
+    glBindBuffer(GL_QUERY_BUFFER, m_indirectBuffer);
+    for (int lod = 0; lod < LOD_COUNT; ++lod) {
+        const size_t command = lod * sizeof(DrawElementsIndirectCommand) +
+                               offsetof(DrawElementsIndirectCommand, instanceCount);
+        writeCount(m_writtenQuery[lod], offsetof(IndirectCommands, cylinders) + command);
+        writeCount(m_writtenQuery[lod], offsetof(IndirectCommands, joints) + command);
+    }
+    writeCount(m_writtenQuery[LINE_BUCKET],
+               offsetof(IndirectCommands, lines) + offsetof(DrawArraysIndirectCommand, instanceCount));
+    glBindBuffer(GL_QUERY_BUFFER, 0);
+    m_queriesPending = true;
+}
+
+void BranchCuller::readBackCounts() {
+    // La ultima consulta termina al final; cuando esta disponible, lo estan todas
+    GLuint available = 0;
+    glGetQueryObjectuiv(m_generatedQuery[BUCKET_COUNT - 1], GL_QUERY_RESULT_AVAILABLE,
+                        &available);
+    if (available == 0)
+        return;
+
+    for (int bucket = 0; bucket < BUCKET_COUNT; ++bucket) {
+        GLuint generated = 0;
+        glGetQueryObjectuiv(m_writtenQuery[bucket], GL_QUERY_RESULT, &m_visible[bucket]);
+        glGetQueryObjectuiv(m_generatedQuery[bucket], GL_QUERY_RESULT, &generated);
+
+        // El transform feedback se detiene al final del buffer: crecer para el proximo cuadro
+        if (generated > m_bucketCapacity[bucket]) {
+            size_t capacity = m_bucketCapacity[bucket];
+            while (capacity < generated) {
+                capacity *= 2;
+            }
+            growBucket(bucket, capacity);
+        }
+    }
+    m_queriesPending = false;
+}
+
+void BranchCuller::drawBucket(int bucket, bool joints) {
+    if (!m_ready)
+        return;
+
+    glBindVertexArray(m_bucketVAO[bucket]);
+
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, m_indirectBuffer);
+    if (bucket == LINE_BUCKET) {
+        glDrawArraysIndirect(GL_LINES, reinterpret_cast<void*>(offsetof(IndirectCommands, lines)));
+    } else {
+        const size_t commands = joints ? offsetof(IndirectCommands, joints)
+                                       : offsetof(IndirectCommands, cylinders);
+        glDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_SHORT,
+                               reinterpret_cast<void*>(commands + bucket *
+                                                       sizeof(DrawElementsIndirectCommand)));
+    }
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+
+    glBindVertexArray(0);
+}
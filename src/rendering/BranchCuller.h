@@ -0,0 +1,185 @@
+/**
+ * @file BranchCuller.h
+ * @brief Culling por frustum y seleccion de LOD de ramas en GPU (transform feedback).
+ *
+ * Cada rama se procesa como un punto: el vertex shader la prueba contra los
+ * planos del frustum y estima su diametro proyectado en pixeles; el geometry
+ * shader la emite al flujo de vertices (vertex stream) de su grupo (bucket), que
+ * se captura con transform feedback en un buffer por grupo. Los grupos son los
+ * niveles de detalle del cilindro (3, 6, 8 y 16 segmentos) y un grupo de lineas
+ * para ramas de menos de un pixel.
+ *
+ * Cada pasada lee todas las ramas, asi que se capturan tantos grupos por pasada
+ * como flujos haya (GL_MAX_VERTEX_STREAMS, al menos 4 desde GL 4.0): una pasada
+ * con 5 o mas, dos con el limite habitual de 4. Si el programa de varios flujos
+ * no compila, queda el respaldo de un flujo: una pasada completa por grupo (5).
+ *
+ * El numero de instancias visibles de cada grupo se obtiene con consultas
+ * GL_TRANSFORM_FEEDBACK_PRIMITIVES_WRITTEN que la GPU escribe directamente en un
+ * buffer de comandos indirectos (GL_QUERY_BUFFER), y se dibuja con
+ * glDrawElementsIndirect sin leer nada en CPU. En CPU solo se leen, sin esperar
+ * y un cuadro despues, las estadisticas y el desborde de los buffers.
+ *
+ * Requiere GL 4.4 (query buffer objects). Antes, el conteo tendria que leerse en
+ * CPU justo despues de las pasadas, deteniendo la CPU hasta que la GPU termine en
+ * cada cuadro, y glDrawTransformFeedback no sirve para dibujos instanciados de
+ * una malla indexada: initialize() falla y se dibujan todas las ramas.
+ *
+ * @author Julian Parra
+ * @date 2025
+ * @course Graficacion
+ * @project Proyecto Final - "Arboles: La Belleza Algoritmica de las Plantas"
+ */
+
+#ifndef BRANCH_CULLER_H
+#define BRANCH_CULLER_H
+
+#include <glad/glad.h>
+
+#include <array>
+#include <glm/glm.hpp>
+
+#include "MeshLibrary.h"
+
+/**
+ * @class BranchCuller
+ * @brief Reparte las ramas visibles en grupos de LOD usando la GPU.
+ *
+ * La salida de cada grupo usa el formato completo de instancia de cilindro
+ * (10 floats: inicio, fin, radios, tono y nacimiento), asi que se dibuja con el shader de
+ * cilindros normal aunque la entrada este en formato compacto. Las instancias
+ * siguen en espacio unitario: la escala solo se aplica a las pruebas.
+ */
+class BranchCuller {
+public:
+    static constexpr int LOD_COUNT = MeshLibrary::LOD_COUNT;  ///< Cilindros de 3, 6, 8 y 16 segmentos
+    static constexpr int LINE_BUCKET = LOD_COUNT;       ///< Ramas de menos de un pixel
+    static constexpr int BUCKET_COUNT = LOD_COUNT + 1;
+
+    BranchCuller() = default;
+    ~BranchCuller();
+
+    // No copiable
+    BranchCuller(const BranchCuller&) = delete;
+    BranchCuller& operator=(const BranchCuller&) = delete;
+
+    /**
+     * @brief Compila los shaders de culling y crea buffers, VAOs y consultas.
+     * @param meshes Mallas compartidas; sus buffers se enlazan a los VAOs de cada grupo.
+     * @return false sin GL 4.4 o si falla la compilacion.
+     */
+    bool initialize(const MeshLibrary& meshes);
+
+    /**
+     * @brief Elige las submallas que dibuja cada LOD.
+     * @param cylinders Cilindro por LOD (con o sin tapas).
+     * @param joints Esfera de union por LOD.
+     */
+    void setMeshes(const std::array<MeshRange, LOD_COUNT>& cylinders,
+                   const std::array<MeshRange, LOD_COUNT>& joints);
+
+    /**
+     * @brief Indica si initialize() tuvo exito.
+     */
+    bool isReady() const {
+        return m_ready;
+    }
+
+    /**
+     * @brief Apunta la entrada del culling al buffer de instancias de cilindro.
+     * @param instanceBuffer Buffer de instancias (formato completo o compacto).
+     * @param compact true si el buffer usa el formato compacto (COMPACT_INSTANCES).
+     * @param count Numero de ramas en el buffer.
+     */
+    void setSource(GLuint instanceBuffer, bool compact, size_t count);
+
+    /**
+     * @brief Ejecuta las pasadas de culling para la camara actual.
+     * @param boundsMin Caja envolvente de las posiciones compactas (ignorada si no compacto).
+     * @param boundsExtent Tamano de la caja envolvente.
+     * @param birthScale Duracion del crecimiento: escala de los nacimientos compactos.
+     * @param geometryScale Paso (posiciones) y ancho inicial (radios) que aplica el dibujo.
+     */
+    void cull(const glm::mat4& view, const glm::mat4& projection, const glm::vec3& boundsMin,
+              const glm::vec3& boundsExtent, float birthScale, const glm::vec2& geometryScale);
+
+    /**
+     * @brief Dibuja las instancias visibles de un grupo con el programa activo.
+     * @param bucket Indice de LOD (0..LOD_COUNT-1) o LINE_BUCKET (GL_LINES, 2 vertices).
+     * @param joints true para dibujar la esfera de union del LOD en lugar del cilindro.
+     */
+    void drawBucket(int bucket, bool joints = false);
+
+    /**
+     * @brief Instancias visibles en la ultima pasada cuyo resultado ya estaba disponible
+     *        (solo estadisticas: los dibujos usan el conteo en GPU).
+     */
+    GLuint getVisibleCount(int bucket) const {
+        return m_visible[bucket];
+    }
+
+    /**
+     * @brief Pasadas de captura por cuadro (cada una lee todas las ramas).
+     */
+    int getPassCount() const {
+        return (BUCKET_COUNT + m_streams - 1) / m_streams;
+    }
+
+    /**
+     * @brief Bytes reservados por los buffers de salida de los grupos.
+     */
+    size_t getBufferBytes() const {
+        size_t instances = 0;
+        for (size_t capacity : m_bucketCapacity) {
+            instances += capacity;
+        }
+        return instances * INSTANCE_FLOATS * sizeof(float);
+    }
+
+private:
+    void growBucket(int bucket, size_t instances);
+    void bindBucketAttributes(int bucket, const MeshLibrary& meshes);
+    void writeCommands();
+    void readBackCounts();
+
+    bool m_ready{false};
+
+    struct CullUniforms {
+        GLint view{-1};
+        GLint frustumPlanes{-1};
+        GLint pixelScale{-1};
+        GLint lodPixels{-1};
+        GLint boundsMin{-1};
+        GLint boundsExtent{-1};
+        GLint birthScale{-1};
+        GLint geometryScale{-1};
+        GLint firstBucket{-1};
+    };
+
+    GLuint m_cullProgram{0};         ///< Entrada en formato completo
+    GLuint m_cullCompactProgram{0};  ///< Entrada en formato compacto
+    CullUniforms m_cullUniforms;
+    CullUniforms m_cullCompactUniforms;
+    GLuint m_sourceVAO{0};
+    bool m_sourceCompact{false};
+    size_t m_sourceCount{0};
+    int m_streams{1};  ///< Grupos capturados por pasada
+
+    std::array<MeshRange, LOD_COUNT> m_cylinders{};
+    std::array<MeshRange, LOD_COUNT> m_joints{};
+
+    std::array<GLuint, BUCKET_COUNT> m_bucketVAO{};
+    std::array<GLuint, BUCKET_COUNT> m_bucketBuffer{};
+    std::array<size_t, BUCKET_COUNT> m_bucketCapacity{};  ///< En instancias
+    std::array<GLuint, BUCKET_COUNT> m_writtenQuery{};    ///< Instancias capturadas
+    std::array<GLuint, BUCKET_COUNT> m_generatedQuery{};  ///< Instancias emitidas (desborde)
+    std::array<GLuint, BUCKET_COUNT> m_visible{};
+    bool m_queriesPending{false};
+
+    GLuint m_indirectBuffer{0};  ///< Comandos de cilindros, esferas y lineas (ver IndirectCommands)
+
+    static constexpr size_t INSTANCE_FLOATS = 10;
+    static constexpr size_t INITIAL_BUCKET_INSTANCES = size_t{1} << 16;
+};
+
+#endif  // BRANCH_CULLER_H
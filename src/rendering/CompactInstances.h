@@ -0,0 +1,47 @@
+/**
+ * @file CompactInstances.h
+ * @brief Formatos compactos de instancia (COMPACT_INSTANCES) compartidos con la GPU.
+ *
+ * La tortuga empaqueta las ramas y decoraciones en estos formatos y tanto sus
+ * VAOs como el culling en GPU (BranchCuller) describen los atributos con
+ * sizeof y offsetof de estas estructuras: cambiar un campo aqui cambia todos.
+ *
+ * Posiciones en unorm16 dentro de la caja de la planta, radios y tamanos en
+ * half float, cuaterniones en snorm16 y nacimientos en unorm16 como fraccion de
+ * la duracion del crecimiento (uniform birthScale).
+ *
+ * @author Julian Parra
+ * @date 2025
+ * @course Graficacion
+ * @project Proyecto Final - "Arboles: La Belleza Algoritmica de las Plantas"
+ */
+
+#ifndef COMPACT_INSTANCES_H
+#define COMPACT_INSTANCES_H
+
+#include <cstdint>
+
+/**
+ * @brief Instancia de cilindro: 20 bytes en lugar de 10 floats (40 bytes).
+ */
+struct CompactBranchInstance {
+    uint16_t startEndX[4];  ///< unorm16 en la caja: start.xyz, end.x
+    uint16_t endYZ[2];      ///< unorm16 en la caja: end.yz
+    uint16_t radii[2];      ///< half float: radiusStart, radiusEnd
+    uint16_t shade;         ///< Indice de la paleta (cuenta de ')
+    uint16_t birth;         ///< unorm16: nacimiento / duracion del crecimiento
+};
+static_assert(sizeof(CompactBranchInstance) == 20, "Unexpected compact branch layout");
+
+/**
+ * @brief Instancia de decoracion: 20 bytes en lugar de 21 floats (84 bytes).
+ */
+struct CompactDecorationInstance {
+    uint16_t position[4];  ///< unorm16 en la caja: xyz (w sin usar)
+    int16_t rotation[4];   ///< Cuaternion snorm16: x, y, z, w
+    uint16_t size;         ///< half float: tamano
+    uint16_t birth;        ///< unorm16: nacimiento / duracion del crecimiento
+};
+static_assert(sizeof(CompactDecorationInstance) == 20, "Unexpected compact decoration layout");
+
+#endif  // COMPACT_INSTANCES_H
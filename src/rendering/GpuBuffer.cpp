@@ -0,0 +1,132 @@
+/**
+ * @file GpuBuffer.cpp
+ * @brief Implementacion del buffer dinamico mapeado.
+ *
+ * @author Julian Parra
+ * @date 2025
+ * @course Graficacion
+ * @project Proyecto Final - "Arboles: La Belleza Algoritmica de las Plantas"
+ */
+
+#include "GpuBuffer.h"
+
+#include <algorithm>
+#include <iostream>
+
+GpuBuffer::~GpuBuffer() {
+    destroy();
+}
+
+void GpuBuffer::create(GLenum target) {
+    destroy();
+
+    m_target = target;
+    m_persistent = GLAD_GL_VERSION_4_4 != 0;
+
+    // Las ranuras persistentes las reserva map() bajo demanda; ahi la memoria es inmutable
+    if (!m_persistent) {
+        glGenBuffers(1, &m_slots[0].id);
+    }
+}
+
+void GpuBuffer::destroy() {
+    for (Slot& slot : m_slots) {
+        if (slot.fence != nullptr)
+            glDeleteSync(slot.fence);
+        // Borrar un buffer lo desmapea implicitamente
+        if (slot.id != 0)
+            glDeleteBuffers(1, &slot.id);
+        slot = Slot{};
+    }
+    m_front = 0;
+    m_writing = 0;
+    m_size = 0;
+    m_pendingSize = 0;
+}
+
+void* GpuBuffer::map(size_t bytes) {
+    m_pendingSize = bytes;
+
+    if (m_persistent) {
+        // Escribir en la ranura que la GPU no esta leyendo; antes de la primera subida
+        // ambas estan libres, asi que empezar por la actual
+        m_writing = (m_slots[m_front].id == 0) ? m_front : 1U - m_front;
+        Slot& slot = m_slots[m_writing];
+        waitFence(slot);
+        if (slot.capacity < bytes) {
+            allocatePersistent(slot, grownCapacity(slot.capacity, bytes));
+        }
+        return slot.mapped;
+    }
+
+    Slot& slot = m_slots[0];
+    glBindBuffer(m_target, slot.id);
+    if (slot.capacity < bytes) {
+        // Mismo nombre de buffer, mas memoria: los enlaces de VAO siguen validos
+        slot.capacity = grownCapacity(slot.capacity, bytes);
+        glBufferData(m_target, static_cast<GLsizeiptr>(slot.capacity), nullptr, GL_DYNAMIC_DRAW);
+    }
+
+    // Invalidar abandona el contenido viejo en lugar de esperar a los dibujos pendientes
+    return glMapBufferRange(m_target, 0, static_cast<GLsizeiptr>(bytes),
+                            GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+}
+
+bool GpuBuffer::unmap() {
+    if (m_persistent) {
+        // Mapeo coherente: las escrituras son visibles a dibujos posteriores sin flush.
+        // Poner un fence a la ranura anterior para que el siguiente map() espere sus dibujos.
+        if (m_writing != m_front) {
+            Slot& previous = m_slots[m_front];
+            if (previous.fence != nullptr)
+                glDeleteSync(previous.fence);
+            previous.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+            m_front = m_writing;
+        }
+        m_size = m_pendingSize;
+        return true;
+    }
+
+    glBindBuffer(m_target, m_slots[0].id);
+    if (glUnmapBuffer(m_target) == GL_FALSE) {
+        std::cerr << "GpuBuffer: buffer contents lost during upload\n";
+        m_size = 0;
+        return false;
+    }
+    m_size = m_pendingSize;
+    return true;
+}
+
+void GpuBuffer::allocatePersistent(Slot& slot, size_t bytes) {
+    // La memoria inmutable no puede cambiar de tamano: reemplazar el buffer
+    if (slot.id != 0)
+        glDeleteBuffers(1, &slot.id);
+
+    constexpr GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+    glGenBuffers(1, &slot.id);
+    glBindBuffer(m_target, slot.id);
+    glBufferStorage(m_target, static_cast<GLsizeiptr>(bytes), nullptr, flags);
+    slot.mapped = glMapBufferRange(m_target, 0, static_cast<GLsizeiptr>(bytes), flags);
+    slot.capacity = (slot.mapped != nullptr) ? bytes : 0;
+}
+
+size_t GpuBuffer::grownCapacity(size_t current, size_t required) {
+    size_t capacity = std::max(current, MIN_CAPACITY);
+    while (capacity < required) {
+        capacity *= 2;
+    }
+    return capacity;
+}
+
+void GpuBuffer::waitFence(Slot& slot) {
+    if (slot.fence == nullptr)
+        return;
+
+    constexpr GLuint64 timeoutNs = 1000000000;
+    GLenum status = glClientWaitSync(slot.fence, GL_SYNC_FLUSH_COMMANDS_BIT, timeoutNs);
+    while (status == GL_TIMEOUT_EXPIRED) {
+        status = glClientWaitSync(slot.fence, 0, timeoutNs);
+    }
+    glDeleteSync(slot.fence);
+    slot.fence = nullptr;
+}
@@ -0,0 +1,131 @@
+/**
+ * @file GpuBuffer.h
+ * @brief Buffer de OpenGL para datos que se reescriben completos (instancias, lineas).
+ *
+ * Evita reasignar el almacenamiento con glBufferData en cada regeneracion: la
+ * capacidad crece de forma geometrica y los datos se escriben directamente en
+ * memoria mapeada, sin vectores intermedios en CPU.
+ *
+ * - GL 4.4+: dos buffers inmutables (glBufferStorage) con mapeo persistente y
+ *   coherente. Cada escritura usa el buffer que la GPU no esta leyendo; una
+ *   cerca (fence) protege al buffer anterior hasta que terminen sus draws.
+ * - GL 3.3: un solo buffer; glMapBufferRange con GL_MAP_INVALIDATE_BUFFER_BIT
+ *   huerfana (orphaning) el contenido anterior en lugar de esperar a la GPU.
+ *
+ * @author Julian Parra
+ * @date 2025
+ * @course Graficacion
+ * @project Proyecto Final - "Arboles: La Belleza Algoritmica de las Plantas"
+ */
+
+#ifndef GPU_BUFFER_H
+#define GPU_BUFFER_H
+
+#include <glad/glad.h>
+
+#include <array>
+#include <cstddef>
+
+/**
+ * @class GpuBuffer
+ * @brief Buffer dinamico con crecimiento geometrico y escritura mapeada.
+ *
+ * Uso: map() devuelve un puntero de solo escritura con espacio para los bytes
+ * pedidos, se llena secuencialmente y unmap() publica los datos. Despues de
+ * unmap(), id() puede cambiar (modo persistente o crecimiento), por lo que los
+ * VAOs deben volver a apuntar sus atributos al buffer actual.
+ */
+class GpuBuffer {
+public:
+    GpuBuffer() = default;
+    ~GpuBuffer();
+
+    // No copiable
+    GpuBuffer(const GpuBuffer&) = delete;
+    GpuBuffer& operator=(const GpuBuffer&) = delete;
+
+    /**
+     * @brief Crea el buffer y elige el modo segun la version de OpenGL.
+     * @param target Destino de enlace (normalmente GL_ARRAY_BUFFER).
+     * @pre Requiere un contexto OpenGL activo con glad cargado.
+     */
+    void create(GLenum target = GL_ARRAY_BUFFER);
+
+    /**
+     * @brief Libera los buffers y cercas de OpenGL.
+     */
+    void destroy();
+
+    /**
+     * @brief Obtiene memoria mapeada para escribir 'bytes' bytes desde el inicio.
+     * @param bytes Tamano de los datos a escribir (mayor que 0).
+     * @return Puntero de solo escritura, o nullptr si el mapeo fallo.
+     * @note No leer de la memoria devuelta: puede ser write-combined.
+     */
+    void* map(size_t bytes);
+
+    /**
+     * @brief Publica los datos escritos desde el ultimo map().
+     * @return false si el contenido se perdio y hay que volver a subirlo.
+     */
+    bool unmap();
+
+    /**
+     * @brief Buffer con los datos publicados mas recientes (para los VAOs).
+     */
+    GLuint id() const {
+        return m_slots[m_front].id;
+    }
+
+    /**
+     * @brief Bytes validos publicados por el ultimo unmap().
+     */
+    size_t size() const {
+        return m_size;
+    }
+
+    /**
+     * @brief Capacidad reservada del buffer actual, en bytes.
+     */
+    size_t capacity() const {
+        return m_slots[m_front].capacity;
+    }
+
+    /**
+     * @brief Bytes reservados en total (ambos buffers en modo persistente).
+     */
+    size_t allocatedBytes() const {
+        return m_slots[0].capacity + m_slots[1].capacity;
+    }
+
+    /**
+     * @brief Indica si se usa mapeo persistente (GL 4.4+).
+     */
+    bool isPersistent() const {
+        return m_persistent;
+    }
+
+private:
+    struct Slot {
+        GLuint id{0};
+        size_t capacity{0};
+        void* mapped{nullptr};  ///< Mapeo persistente (solo en modo persistente)
+        GLsync fence{nullptr};  ///< Ultimo uso por la GPU antes de dejar de ser el frente
+    };
+
+    void allocatePersistent(Slot& slot, size_t bytes);
+    static size_t grownCapacity(size_t current, size_t required);
+    static void waitFence(Slot& slot);
+
+    GLenum m_target{GL_ARRAY_BUFFER};
+    bool m_persistent{false};
+    std::array<Slot, 2> m_slots{};
+    unsigned m_front{0};    ///< Slot que leen los draws
+    unsigned m_writing{0};  ///< Slot mapeado por el map() en curso
+    size_t m_size{0};
+    size_t m_pendingSize{0};
+
+    static constexpr size_t MIN_CAPACITY = size_t{64} << 10;
+};
+
+#endif  // GPU_BUFFER_H
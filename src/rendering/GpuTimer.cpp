@@ -0,0 +1,95 @@
+/**
+ * @file GpuTimer.cpp
+ * @brief Implementacion del anillo de consultas GL_TIME_ELAPSED.
+ *
+ * @author Julian Parra
+ * @date 2025
+ * @course Graficacion
+ * @project Proyecto Final - "Arboles: La Belleza Algoritmica de las Plantas"
+ */
+
+#include "GpuTimer.h"
+
+#include "core/Profiler.h"
+
+GpuTimer::~GpuTimer() {
+    destroy();
+}
+
+void GpuTimer::create(bool timestamps) {
+    destroy();
+    glGenQueries(LATENCY, m_queries.data());
+    if (timestamps) {
+        glGenQueries(LATENCY, m_endQueries.data());
+    }
+}
+
+void GpuTimer::destroy() {
+    if (m_queries[0] != 0)
+        glDeleteQueries(LATENCY, m_queries.data());
+    if (m_endQueries[0] != 0)
+        glDeleteQueries(LATENCY, m_endQueries.data());
+    m_queries.fill(0);
+    m_endQueries.fill(0);
+    m_oldest = 0;
+    m_pending = 0;
+    m_active = false;
+}
+
+void GpuTimer::begin() {
+    // Todas las consultas siguen en curso: saltar este cuadro en lugar de esperar
+    if (m_queries[0] == 0 || m_pending == LATENCY)
+        return;
+
+    const int slot = (m_oldest + m_pending) % LATENCY;
+    m_issuedAt[slot] = Profiler::nowMicroseconds();
+    if (m_endQueries[0] != 0) {
+        glQueryCounter(m_queries[slot], GL_TIMESTAMP);
+    } else {
+        glBeginQuery(GL_TIME_ELAPSED, m_queries[slot]);
+    }
+    m_active = true;
+}
+
+void GpuTimer::end() {
+    if (!m_active)
+        return;
+
+    if (m_endQueries[0] != 0) {
+        glQueryCounter(m_endQueries[(m_oldest + m_pending) % LATENCY], GL_TIMESTAMP);
+    } else {
+        glEndQuery(GL_TIME_ELAPSED);
+    }
+    m_pending++;
+    m_active = false;
+}
+
+bool GpuTimer::collect(double& startUs, double& durationUs) {
+    if (m_pending == 0)
+        return false;
+
+    // La marca de tiempo final se resuelve al ultimo
+    const bool timestamps = m_endQueries[0] != 0;
+    const GLuint last = timestamps ? m_endQueries[m_oldest] : m_queries[m_oldest];
+    GLint available = 0;
+    glGetQueryObjectiv(last, GL_QUERY_RESULT_AVAILABLE, &available);
+    if (available == 0)
+        return false;
+
+    GLuint64 elapsedNs = 0;
+    if (timestamps) {
+        GLuint64 beginNs = 0;
+        GLuint64 endNs = 0;
+        glGetQueryObjectui64v(m_queries[m_oldest], GL_QUERY_RESULT, &beginNs);
+        glGetQueryObjectui64v(last, GL_QUERY_RESULT, &endNs);
+        elapsedNs = endNs > beginNs ? endNs - beginNs : 0;
+    } else {
+        glGetQueryObjectui64v(last, GL_QUERY_RESULT, &elapsedNs);
+    }
+    startUs = m_issuedAt[m_oldest];
+    durationUs = static_cast<double>(elapsedNs) / 1000.0;
+
+    m_oldest = (m_oldest + 1) % LATENCY;
+    m_pending--;
+    return true;
+}
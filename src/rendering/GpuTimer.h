@@ -0,0 +1,77 @@
+/**
+ * @file GpuTimer.h
+ * @brief Medicion del tiempo de GPU de una region del cuadro con GL_TIME_ELAPSED.
+ *
+ * Usa un anillo de consultas para no esperar a la GPU: el resultado de un cuadro
+ * se lee varios cuadros despues, cuando ya esta disponible. Si todas las consultas
+ * siguen pendientes, la region de ese cuadro simplemente no se mide.
+ *
+ * Con marcas de tiempo (glQueryCounter con GL_TIMESTAMP) la region puede
+ * contener regiones de otros temporizadores; asi se mide el cuadro completo.
+ *
+ * @author Julian Parra
+ * @date 2025
+ * @course Graficacion
+ * @project Proyecto Final - "Arboles: La Belleza Algoritmica de las Plantas"
+ */
+
+#ifndef GPU_TIMER_H
+#define GPU_TIMER_H
+
+#include <glad/glad.h>
+
+#include <array>
+
+/**
+ * @class GpuTimer
+ * @brief Anillo de consultas GL_TIME_ELAPSED para una region del cuadro.
+ *
+ * Uso por cuadro: begin() y end() alrededor de los draws; despues collect()
+ * devuelve en orden las mediciones de cuadros anteriores que ya terminaron.
+ * @note Las consultas GL_TIME_ELAPSED no se anidan: las regiones no deben solaparse,
+ *       salvo las de un temporizador creado con marcas de tiempo.
+ */
+class GpuTimer {
+public:
+    GpuTimer() = default;
+    ~GpuTimer();
+
+    // No copiable
+    GpuTimer(const GpuTimer&) = delete;
+    GpuTimer& operator=(const GpuTimer&) = delete;
+
+    /**
+     * @brief Crea las consultas.
+     * @param timestamps Medir con dos marcas GL_TIMESTAMP en lugar de GL_TIME_ELAPSED.
+     * @pre Requiere un contexto OpenGL activo con glad cargado.
+     */
+    void create(bool timestamps = false);
+
+    /**
+     * @brief Libera las consultas.
+     */
+    void destroy();
+
+    void begin();
+    void end();
+
+    /**
+     * @brief Lee la medicion pendiente mas antigua si la GPU ya la resolvio.
+     * @param startUs Momento de begin() segun Profiler::nowMicroseconds().
+     * @param durationUs Tiempo de GPU de la region.
+     * @return false si no hay medicion disponible.
+     */
+    bool collect(double& startUs, double& durationUs);
+
+private:
+    static constexpr int LATENCY = 4;  ///< Cuadros en vuelo antes de descartar una medicion
+
+    std::array<GLuint, LATENCY> m_queries{};  ///< Con marcas: la del inicio
+    std::array<GLuint, LATENCY> m_endQueries{};  ///< Solo con marcas de tiempo
+    std::array<double, LATENCY> m_issuedAt{};
+    int m_oldest{0};   ///< Consulta pendiente mas antigua
+    int m_pending{0};  ///< Consultas emitidas sin leer
+    bool m_active{false};
+};
+
+#endif  // GPU_TIMER_H
@@ -0,0 +1,201 @@
+/**
+ * @file MeshLibrary.cpp
+ * @brief Implementacion de la biblioteca de mallas de ramas.
+ *
+ * @author Julian Parra
+ * @date 2025
+ * @course Graficacion
+ * @project Proyecto Final - "Arboles: La Belleza Algoritmica de las Plantas"
+ */
+
+#include "MeshLibrary.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+MeshLibrary::~MeshLibrary() {
+    destroy();
+}
+
+void MeshLibrary::create() {
+    destroy();
+
+    for (int lod = 0; lod < LOD_COUNT; ++lod) {
+        const int segments = CYLINDER_SEGMENTS[lod];
+        m_cylinder[lod] = appendCylinder(segments, m_cylinderCapped[lod]);
+        // La mitad de anillos que sectores mantiene los quads casi cuadrados
+        m_jointSphere[lod] = appendSphere(segments, std::max(2, segments / 2));
+    }
+
+    glGenBuffers(1, &m_vbo);
+    glBindBuffer(GL_ARRAY_BUFFER, m_vbo);
+    glBufferData(GL_ARRAY_BUFFER, static_cast<GLsizeiptr>(m_vertices.size() * sizeof(float)),
+                 m_vertices.data(), GL_STATIC_DRAW);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    glGenBuffers(1, &m_ibo);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, m_ibo);
+    glBufferData(GL_COPY_WRITE_BUFFER, static_cast<GLsizeiptr>(m_indices.size() * sizeof(GLushort)),
+                 m_indices.data(), GL_STATIC_DRAW);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+    m_bufferBytes = m_vertices.size() * sizeof(float) + m_indices.size() * sizeof(GLushort);
+    m_vertices.clear();
+    m_vertices.shrink_to_fit();
+    m_indices.clear();
+    m_indices.shrink_to_fit();
+}
+
+void MeshLibrary::destroy() {
+    if (m_vbo != 0)
+        glDeleteBuffers(1, &m_vbo);
+    if (m_ibo != 0)
+        glDeleteBuffers(1, &m_ibo);
+    m_vbo = 0;
+    m_ibo = 0;
+    m_bufferBytes = 0;
+}
+
+void MeshLibrary::bindVertexAttributes() const {
+    // El enlace del element buffer es estado del VAO
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_ibo);
+
+    glBindBuffer(GL_ARRAY_BUFFER, m_vbo);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), nullptr);
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float),
+                          reinterpret_cast<void*>(3 * sizeof(float)));
+    glEnableVertexAttribArray(1);
+}
+
+void MeshLibrary::draw(const MeshRange& range, GLsizei instances, GLuint baseInstance) {
+    if (range.indexCount == 0 || instances == 0)
+        return;
+
+    void* firstIndex =
+        reinterpret_cast<void*>(static_cast<uintptr_t>(range.firstIndex) * sizeof(GLushort));
+    if (baseInstance == 0) {
+        glDrawElementsInstancedBaseVertex(GL_TRIANGLES, range.indexCount, GL_UNSIGNED_SHORT,
+                                          firstIndex, instances, range.baseVertex);
+        return;
+    }
+    // Un rango de instancias de los buffers enlazados (culling de BranchHierarchy)
+    glDrawElementsInstancedBaseVertexBaseInstance(GL_TRIANGLES, range.indexCount,
+                                                  GL_UNSIGNED_SHORT, firstIndex, instances,
+                                                  range.baseVertex, baseInstance);
+}
+
+// =============================================================================
+// Generacion de mallas
+// =============================================================================
+
+void MeshLibrary::appendVertex(float x, float y, float z, float nx, float ny, float nz) {
+    m_vertices.insert(m_vertices.end(), {x, y, z, nx, ny, nz});
+}
+
+MeshRange MeshLibrary::appendCylinder(int segments, MeshRange& capped) {
+    MeshRange sides;
+    sides.baseVertex = static_cast<GLint>(m_vertices.size() / 6);
+    sides.firstIndex = static_cast<GLuint>(m_indices.size());
+
+    // Lado: un vertice compartido por posicion del anillo (sin duplicar la costura)
+    for (int i = 0; i < segments; ++i) {
+        float theta = 2.0F * static_cast<float>(M_PI) * static_cast<float>(i) /
+                      static_cast<float>(segments);
+        float cosTheta = std::cos(theta);
+        float sinTheta = std::sin(theta);
+        appendVertex(cosTheta, 0.0F, sinTheta, cosTheta, 0.0F, sinTheta);  // abajo
+        appendVertex(cosTheta, 1.0F, sinTheta, cosTheta, 0.0F, sinTheta);  // arriba
+    }
+    for (int i = 0; i < segments; ++i) {
+        auto bottom = static_cast<GLushort>(2 * i);
+        auto top = static_cast<GLushort>(2 * i + 1);
+        auto nextBottom = static_cast<GLushort>(2 * ((i + 1) % segments));
+        auto nextTop = static_cast<GLushort>(nextBottom + 1);
+        m_indices.insert(m_indices.end(), {bottom, top, nextTop, bottom, nextTop, nextBottom});
+    }
+    sides.indexCount = static_cast<GLsizei>(m_indices.size() - sides.firstIndex);
+
+    // Tapas: las normales planas requieren vertices propios; un centro mas un anillo por extremo
+    const auto capBase = static_cast<GLushort>(m_vertices.size() / 6 - sides.baseVertex);
+    for (int end = 0; end < 2; ++end) {
+        const float y = static_cast<float>(end);
+        const float normalY = (end == 0) ? -1.0F : 1.0F;
+        appendVertex(0.0F, y, 0.0F, 0.0F, normalY, 0.0F);
+        for (int i = 0; i < segments; ++i) {
+            float theta = 2.0F * static_cast<float>(M_PI) * static_cast<float>(i) /
+                          static_cast<float>(segments);
+            appendVertex(std::cos(theta), y, std::sin(theta), 0.0F, normalY, 0.0F);
+        }
+    }
+    for (int end = 0; end < 2; ++end) {
+        const auto center = static_cast<GLushort>(capBase + end * (segments + 1));
+        for (int i = 0; i < segments; ++i) {
+            auto current = static_cast<GLushort>(center + 1 + i);
+            auto next = static_cast<GLushort>(center + 1 + (i + 1) % segments);
+            // Antihorario visto desde afuera: -Y para la base, +Y para la tapa
+            if (end == 0) {
+                m_indices.insert(m_indices.end(), {center, current, next});
+            } else {
+                m_indices.insert(m_indices.end(), {center, next, current});
+            }
+        }
+    }
+
+    capped = sides;
+    capped.indexCount = static_cast<GLsizei>(m_indices.size() - sides.firstIndex);
+    return sides;
+}
+
+MeshRange MeshLibrary::appendSphere(int sectors, int rings) {
+    MeshRange sphere;
+    sphere.baseVertex = static_cast<GLint>(m_vertices.size() / 6);
+    sphere.firstIndex = static_cast<GLuint>(m_indices.size());
+
+    // Los polos son vertices unicos; los anillos 1..rings-1 tienen 'sectors' vertices cada uno
+    appendVertex(0.0F, 1.0F, 0.0F, 0.0F, 1.0F, 0.0F);
+    for (int ring = 1; ring < rings; ++ring) {
+        float phi = static_cast<float>(M_PI) * static_cast<float>(ring) / static_cast<float>(rings);
+        float y = std::cos(phi);
+        float r = std::sin(phi);
+        for (int i = 0; i < sectors; ++i) {
+            float theta = 2.0F * static_cast<float>(M_PI) * static_cast<float>(i) /
+                          static_cast<float>(sectors);
+            float x = r * std::cos(theta);
+            float z = r * std::sin(theta);
+            appendVertex(x, y, z, x, y, z);
+        }
+    }
+    appendVertex(0.0F, -1.0F, 0.0F, 0.0F, -1.0F, 0.0F);
+
+    auto ringVertex = [sectors](int ring, int i) {
+        return static_cast<GLushort>(1 + (ring - 1) * sectors + i % sectors);
+    };
+    const auto bottomPole = static_cast<GLushort>(1 + (rings - 1) * sectors);
+
+    for (int i = 0; i < sectors; ++i) {
+        m_indices.insert(m_indices.end(), {0, ringVertex(1, i + 1), ringVertex(1, i)});
+    }
+    for (int ring = 1; ring + 1 < rings; ++ring) {
+        for (int i = 0; i < sectors; ++i) {
+            GLushort upper = ringVertex(ring, i);
+            GLushort upperNext = ringVertex(ring, i + 1);
+            GLushort lower = ringVertex(ring + 1, i);
+            GLushort lowerNext = ringVertex(ring + 1, i + 1);
+            m_indices.insert(m_indices.end(),
+                             {lower, upper, upperNext, lower, upperNext, lowerNext});
+        }
+    }
+    for (int i = 0; i < sectors; ++i) {
+        m_indices.insert(m_indices.end(),
+                         {bottomPole, ringVertex(rings - 1, i), ringVertex(rings - 1, i + 1)});
+    }
+
+    sphere.indexCount = static_cast<GLsizei>(m_indices.size() - sphere.firstIndex);
+    return sphere;
+}
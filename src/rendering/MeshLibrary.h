@@ -0,0 +1,119 @@
+/**
+ * @file MeshLibrary.h
+ * @brief Mallas indexadas compartidas para ramas: cilindros por LOD, tapas y esferas de union.
+ *
+ * Todas las mallas viven en un solo VBO (posicion + normal) y un solo IBO de
+ * indices de 16 bits. Cada submalla usa indices locales desde 0 y se dibuja
+ * con glDrawElementsInstancedBaseVertex, asi que un VAO configurado una vez
+ * sirve para cualquier LOD.
+ *
+ * Convenciones del espacio local (las interpreta el shader de cilindros):
+ * - Cilindro: radio 1, y de 0 (inicio) a 1 (fin). Las tapas son los indices que
+ *   siguen a los del costado, de modo que la variante con tapas solo cuenta mas
+ *   indices desde el mismo inicio.
+ * - Esfera de union: radio 1 centrada en el origen; se coloca en el extremo de
+ *   la rama para cubrir el hueco entre segmentos consecutivos.
+ *
+ * @author Julian Parra
+ * @date 2025
+ * @course Graficacion
+ * @project Proyecto Final - "Arboles: La Belleza Algoritmica de las Plantas"
+ */
+
+#ifndef MESH_LIBRARY_H
+#define MESH_LIBRARY_H
+
+#include <glad/glad.h>
+
+#include <array>
+#include <cstddef>
+#include <vector>
+
+/**
+ * @struct MeshRange
+ * @brief Submalla dentro del IBO compartido.
+ */
+struct MeshRange {
+    GLsizei indexCount{0};  ///< Indices a dibujar (GL_TRIANGLES)
+    GLuint firstIndex{0};   ///< Primer indice dentro del IBO
+    GLint baseVertex{0};    ///< Se suma a cada indice
+};
+
+/**
+ * @class MeshLibrary
+ * @brief Genera y sube las mallas de ramas a la GPU.
+ */
+class MeshLibrary {
+public:
+    static constexpr int LOD_COUNT = 4;
+    static constexpr std::array<int, LOD_COUNT> CYLINDER_SEGMENTS = {3, 6, 8, 16};
+
+    MeshLibrary() = default;
+    ~MeshLibrary();
+
+    // No copiable
+    MeshLibrary(const MeshLibrary&) = delete;
+    MeshLibrary& operator=(const MeshLibrary&) = delete;
+
+    /**
+     * @brief Genera todas las mallas y las sube a un VBO/IBO estatico.
+     * @pre Requiere un contexto OpenGL activo con glad cargado.
+     */
+    void create();
+
+    /**
+     * @brief Libera el VBO y el IBO.
+     */
+    void destroy();
+
+    /**
+     * @brief Enlaza el IBO y los atributos 0 (posicion) y 1 (normal) al VAO activo.
+     */
+    void bindVertexAttributes() const;
+
+    /**
+     * @brief Cilindro del LOD indicado.
+     * @param lod 0..LOD_COUNT-1 (3, 6, 8 y 16 segmentos).
+     * @param caps true para incluir las tapas de ambos extremos.
+     */
+    const MeshRange& cylinder(int lod, bool caps) const {
+        return caps ? m_cylinderCapped[lod] : m_cylinder[lod];
+    }
+
+    /**
+     * @brief Esfera de union con la misma resolucion angular que el cilindro del LOD.
+     */
+    const MeshRange& jointSphere(int lod) const {
+        return m_jointSphere[lod];
+    }
+
+    /**
+     * @brief Dibuja instancias de una submalla con el VAO y programa activos.
+     * @param baseInstance Primera instancia; distinta de 0 requiere GL 4.2.
+     */
+    static void draw(const MeshRange& range, GLsizei instances, GLuint baseInstance = 0);
+
+    /**
+     * @brief Bytes subidos al VBO y al IBO.
+     */
+    size_t bufferBytes() const {
+        return m_bufferBytes;
+    }
+
+private:
+    MeshRange appendCylinder(int segments, MeshRange& capped);
+    MeshRange appendSphere(int sectors, int rings);
+    void appendVertex(float x, float y, float z, float nx, float ny, float nz);
+
+    std::vector<float> m_vertices;    ///< Solo durante create()
+    std::vector<GLushort> m_indices;  ///< Solo durante create()
+
+    GLuint m_vbo{0};
+    GLuint m_ibo{0};
+    size_t m_bufferBytes{0};
+    std::array<MeshRange, LOD_COUNT> m_cylinder{};
+    std::array<MeshRange, LOD_COUNT> m_cylinderCapped{};
+    std::array<MeshRange, LOD_COUNT> m_jointSphere{};
+};
+
+#endif  // MESH_LIBRARY_H
@@ -0,0 +1,112 @@
+/**
+ * @file OffscreenTarget.cpp
+ * @brief Implementacion del framebuffer fuera de pantalla.
+ *
+ * @author Julian Parra
+ * @date 2025
+ * @course Graficacion
+ * @project Proyecto Final - "Arboles: La Belleza Algoritmica de las Plantas"
+ */
+
+#include "OffscreenTarget.h"
+
+#include <iostream>
+
+OffscreenTarget::~OffscreenTarget() {
+    destroy();
+}
+
+bool OffscreenTarget::create(int width, int height, int samples) {
+    destroy();
+
+    m_width = width;
+    m_height = height;
+    m_multisampled = samples > 1;
+
+    glGenRenderbuffers(4, m_renderbuffers);
+    auto storage = [width, height](GLuint renderbuffer, int count, GLenum format) {
+        glBindRenderbuffer(GL_RENDERBUFFER, renderbuffer);
+        if (count > 1) {
+            glRenderbufferStorageMultisample(GL_RENDERBUFFER, count, format, width, height);
+        } else {
+            glRenderbufferStorage(GL_RENDERBUFFER, format, width, height);
+        }
+    };
+
+    // Sin MSAA el framebuffer resuelto es tambien el destino de dibujo: lleva profundidad
+    storage(m_renderbuffers[0], 1, GL_RGBA8);
+    storage(m_renderbuffers[1], 1, GL_DEPTH24_STENCIL8);
+    m_resolveFbo = createFramebuffer(m_renderbuffers[0], m_renderbuffers[1]);
+    m_drawFbo = m_resolveFbo;
+    if (m_multisampled) {
+        storage(m_renderbuffers[2], samples, GL_RGBA8);
+        storage(m_renderbuffers[3], samples, GL_DEPTH24_STENCIL8);
+        m_drawFbo = createFramebuffer(m_renderbuffers[2], m_renderbuffers[3]);
+    }
+    glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+    if (m_resolveFbo == 0 || m_drawFbo == 0) {
+        std::cerr << "OffscreenTarget: framebuffer " << width << "x" << height << " con "
+                  << samples << " muestras incompleto\n";
+        destroy();
+        return false;
+    }
+    return true;
+}
+
+void OffscreenTarget::destroy() {
+    if (m_drawFbo != 0 && m_drawFbo != m_resolveFbo)
+        glDeleteFramebuffers(1, &m_drawFbo);
+    if (m_resolveFbo != 0)
+        glDeleteFramebuffers(1, &m_resolveFbo);
+    if (m_renderbuffers[0] != 0)
+        glDeleteRenderbuffers(4, m_renderbuffers);
+    m_drawFbo = 0;
+    m_resolveFbo = 0;
+    for (GLuint& renderbuffer : m_renderbuffers) {
+        renderbuffer = 0;
+    }
+    m_width = 0;
+    m_height = 0;
+    m_multisampled = false;
+}
+
+void OffscreenTarget::bind() const {
+    glBindFramebuffer(GL_FRAMEBUFFER, m_drawFbo);
+    glViewport(0, 0, m_width, m_height);
+}
+
+void OffscreenTarget::resolve() const {
+    if (m_multisampled) {
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, m_drawFbo);
+        glBindFramebuffer(GL_DRAW_FRAMEBUFFER, m_resolveFbo);
+        glBlitFramebuffer(0, 0, m_width, m_height, 0, 0, m_width, m_height,
+                          GL_COLOR_BUFFER_BIT, GL_NEAREST);
+    }
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, m_resolveFbo);
+}
+
+void OffscreenTarget::present() const {
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, m_resolveFbo);
+    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+    glBlitFramebuffer(0, 0, m_width, m_height, 0, 0, m_width, m_height, GL_COLOR_BUFFER_BIT,
+                      GL_NEAREST);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    glViewport(0, 0, m_width, m_height);
+}
+
+GLuint OffscreenTarget::createFramebuffer(GLuint color, GLuint depth) {
+    GLuint framebuffer = 0;
+    glGenFramebuffers(1, &framebuffer);
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, color);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER,
+                              depth);
+    const bool complete = glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    if (!complete) {
+        glDeleteFramebuffers(1, &framebuffer);
+        return 0;
+    }
+    return framebuffer;
+}
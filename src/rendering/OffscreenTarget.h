@@ -0,0 +1,82 @@
+/**
+ * @file OffscreenTarget.h
+ * @brief Framebuffer fuera de pantalla con MSAA para renderizar sin ventana visible.
+ *
+ * Los draws van a un framebuffer multimuestreado (color y profundidad en
+ * renderbuffers); resolve() lo copia con glBlitFramebuffer a uno de una muestra,
+ * que queda enlazado como GL_READ_FRAMEBUFFER para leer los pixeles o para
+ * copiarlo a la ventana con present().
+ *
+ * @author Julian Parra
+ * @date 2025
+ * @course Graficacion
+ * @project Proyecto Final - "Arboles: La Belleza Algoritmica de las Plantas"
+ */
+
+#ifndef OFFSCREEN_TARGET_H
+#define OFFSCREEN_TARGET_H
+
+#include <glad/glad.h>
+
+/**
+ * @class OffscreenTarget
+ * @brief Par de framebuffers (multimuestreado y resuelto) de tamano fijo.
+ */
+class OffscreenTarget {
+public:
+    OffscreenTarget() = default;
+    ~OffscreenTarget();
+
+    // No copiable
+    OffscreenTarget(const OffscreenTarget&) = delete;
+    OffscreenTarget& operator=(const OffscreenTarget&) = delete;
+
+    /**
+     * @brief Crea los framebuffers.
+     * @param samples Muestras de MSAA; 0 o 1 dibuja directamente en el resuelto.
+     * @return false si algun framebuffer queda incompleto.
+     * @pre Requiere un contexto OpenGL activo con glad cargado.
+     */
+    bool create(int width, int height, int samples = 4);
+
+    /**
+     * @brief Libera framebuffers y renderbuffers.
+     */
+    void destroy();
+
+    /**
+     * @brief Enlaza el framebuffer de dibujo y ajusta el viewport a su tamano.
+     */
+    void bind() const;
+
+    /**
+     * @brief Resuelve el MSAA y deja el resultado enlazado como GL_READ_FRAMEBUFFER.
+     */
+    void resolve() const;
+
+    /**
+     * @brief Copia el color resuelto a la ventana (framebuffer por defecto) y la deja enlazada.
+     * @pre resolve() ya se llamo despues del ultimo dibujo.
+     * @note La ventana no debe ser multimuestreada: glBlitFramebuffer no escribe en ella.
+     */
+    void present() const;
+
+    int getWidth() const {
+        return m_width;
+    }
+    int getHeight() const {
+        return m_height;
+    }
+
+private:
+    static GLuint createFramebuffer(GLuint color, GLuint depth);
+
+    GLuint m_drawFbo{0};     ///< Multimuestreado (o el mismo que m_resolveFbo sin MSAA)
+    GLuint m_resolveFbo{0};  ///< Una muestra, se lee con glReadPixels
+    GLuint m_renderbuffers[4]{};  ///< Color y profundidad de cada framebuffer
+    int m_width{0};
+    int m_height{0};
+    bool m_multisampled{false};
+};
+
+#endif  // OFFSCREEN_TARGET_H
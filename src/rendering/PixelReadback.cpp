@@ -0,0 +1,97 @@
+/**
+ * @file PixelReadback.cpp
+ * @brief Implementacion del anillo de PBOs de lectura.
+ *
+ * @author Julian Parra
+ * @date 2025
+ * @course Graficacion
+ * @project Proyecto Final - "Arboles: La Belleza Algoritmica de las Plantas"
+ */
+
+#include "PixelReadback.h"
+
+#include <cstring>
+
+PixelReadback::~PixelReadback() {
+    destroy();
+}
+
+void PixelReadback::create(int width, int height) {
+    destroy();
+
+    m_width = width;
+    m_height = height;
+    m_imageBytes = static_cast<size_t>(width) * static_cast<size_t>(height) * 4;
+
+    // GL_STREAM_READ: la GPU escribe una vez, la CPU lee una vez
+    glGenBuffers(LATENCY, m_buffers.data());
+    for (GLuint buffer : m_buffers) {
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, buffer);
+        glBufferData(GL_PIXEL_PACK_BUFFER, static_cast<GLsizeiptr>(m_imageBytes), nullptr,
+                     GL_STREAM_READ);
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+}
+
+void PixelReadback::destroy() {
+    for (GLsync& fence : m_fences) {
+        if (fence != nullptr)
+            glDeleteSync(fence);
+        fence = nullptr;
+    }
+    if (m_buffers[0] != 0)
+        glDeleteBuffers(LATENCY, m_buffers.data());
+    m_buffers.fill(0);
+    m_oldest = 0;
+    m_pending = 0;
+    m_imageBytes = 0;
+}
+
+bool PixelReadback::begin(uint64_t tag) {
+    if (m_buffers[0] == 0 || m_pending == LATENCY)
+        return false;
+
+    const int slot = (m_oldest + m_pending) % LATENCY;
+    m_tags[slot] = tag;
+
+    // Las filas RGBA siempre estan alineadas a 4 bytes, la ruta rapida del driver
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, m_buffers[slot]);
+    glPixelStorei(GL_PACK_ALIGNMENT, 4);
+    glReadPixels(0, 0, m_width, m_height, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    m_fences[slot] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+
+    m_pending++;
+    return true;
+}
+
+bool PixelReadback::collect(std::vector<uint8_t>& pixels, uint64_t& tag, bool wait) {
+    if (m_pending == 0)
+        return false;
+
+    GLsync& fence = m_fences[m_oldest];
+    if (fence != nullptr) {
+        // La primera espera hace flush para garantizar que el fence se senale
+        const GLenum status =
+            glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, wait ? GL_TIMEOUT_IGNORED : 0);
+        if (status == GL_TIMEOUT_EXPIRED)
+            return false;
+        glDeleteSync(fence);
+        fence = nullptr;
+    }
+
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, m_buffers[m_oldest]);
+    const void* mapped = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0,
+                                          static_cast<GLsizeiptr>(m_imageBytes), GL_MAP_READ_BIT);
+    if (mapped != nullptr) {
+        pixels.resize(m_imageBytes);
+        std::memcpy(pixels.data(), mapped, m_imageBytes);
+        glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    tag = m_tags[m_oldest];
+
+    m_oldest = (m_oldest + 1) % LATENCY;
+    m_pending--;
+    return mapped != nullptr;
+}
@@ -0,0 +1,89 @@
+/**
+ * @file PixelReadback.h
+ * @brief Lectura asincrona de pixeles con un anillo de pixel buffer objects (PBO).
+ *
+ * glReadPixels hacia un PBO solo encola la copia: la CPU sigue con el siguiente
+ * cuadro y, varios cuadros despues, mapea el buffer cuando su cerca (fence) ya
+ * se cumplio. Asi la lectura no espera a que la GPU termine de dibujar.
+ *
+ * @author Julian Parra
+ * @date 2025
+ * @course Graficacion
+ * @project Proyecto Final - "Arboles: La Belleza Algoritmica de las Plantas"
+ */
+
+#ifndef PIXEL_READBACK_H
+#define PIXEL_READBACK_H
+
+#include <glad/glad.h>
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/**
+ * @class PixelReadback
+ * @brief Anillo de PBOs de un tamano de imagen fijo (RGBA de 8 bits).
+ *
+ * Uso por cuadro: con el framebuffer a leer enlazado como GL_READ_FRAMEBUFFER,
+ * begin() encola la copia; collect() devuelve en orden las imagenes cuyas copias
+ * ya terminaron. Si el anillo esta lleno, begin() falla hasta que collect() libere
+ * una ranura (con wait = true si no se puede seguir sin ella).
+ */
+class PixelReadback {
+public:
+    static constexpr int LATENCY = 3;  ///< Lecturas en vuelo
+
+    PixelReadback() = default;
+    ~PixelReadback();
+
+    // No copiable
+    PixelReadback(const PixelReadback&) = delete;
+    PixelReadback& operator=(const PixelReadback&) = delete;
+
+    /**
+     * @brief Crea los PBOs para imagenes de width x height.
+     * @pre Requiere un contexto OpenGL activo con glad cargado.
+     */
+    void create(int width, int height);
+
+    /**
+     * @brief Libera los PBOs y sus cercas; las lecturas pendientes se pierden.
+     */
+    void destroy();
+
+    /**
+     * @brief Encola la lectura del framebuffer de lectura actual.
+     * @param tag Valor que collect() devuelve con esta imagen.
+     * @return false si todas las ranuras siguen en vuelo.
+     */
+    bool begin(uint64_t tag);
+
+    /**
+     * @brief Copia a 'pixels' la lectura pendiente mas antigua si ya termino.
+     * @param wait Esperar a la GPU en lugar de devolver false.
+     * @return false si no hay lecturas pendientes (o, sin wait, ninguna termino).
+     * @note Las filas quedan de abajo hacia arriba, como las entrega OpenGL.
+     */
+    bool collect(std::vector<uint8_t>& pixels, uint64_t& tag, bool wait);
+
+    int getPending() const {
+        return m_pending;
+    }
+    size_t getImageBytes() const {
+        return m_imageBytes;
+    }
+
+private:
+    std::array<GLuint, LATENCY> m_buffers{};
+    std::array<GLsync, LATENCY> m_fences{};
+    std::array<uint64_t, LATENCY> m_tags{};
+    int m_oldest{0};   ///< Lectura pendiente mas antigua
+    int m_pending{0};  ///< Lecturas encoladas sin recoger
+    int m_width{0};
+    int m_height{0};
+    size_t m_imageBytes{0};
+};
+
+#endif  // PIXEL_READBACK_H
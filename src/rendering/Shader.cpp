@@ -15,6 +15,7 @@
 
 #include <glm/gtc/type_ptr.hpp>
 #include <iostream>
+#include <vector>
 
 /*
  * @brief Constructor que compila y enlaza shaders
@@ -38,7 +39,10 @@ Shader::Shader(const char* vertexSource, const char* fragmentSource) {
 
     if (m_program == 0) {
         std::cerr << "Error: Failed to link shader program\n";
+        return;
     }
+
+    cacheUniformLocations();
 }
 
 /*
@@ -57,11 +61,29 @@ void Shader::use() const {
     glUseProgram(m_program);
 }
 
+/*
+ * @brief Busca la ubicacion de un uniform en la tabla
+ */
+GLint Shader::getUniformLocation(const char* name) const {
+    auto it = m_uniformLocations.find(name);
+    return (it != m_uniformLocations.end()) ? it->second : -1;
+}
+
+/*
+ * @brief Asocia un bloque uniform a un punto de enlace
+ */
+void Shader::bindUniformBlock(const char* blockName, GLuint binding) const {
+    GLuint index = glGetUniformBlockIndex(m_program, blockName);
+    if (index != GL_INVALID_INDEX) {
+        glUniformBlockBinding(m_program, index, binding);
+    }
+}
+
 /*
  * @brief Establece un uniform mat4
  */
 void Shader::setMat4(const char* name, const glm::mat4& value) const {
-    GLint location = glGetUniformLocation(m_program, name);
+    GLint location = getUniformLocation(name);
     if (location != -1) {
         glUniformMatrix4fv(location, 1, GL_FALSE, glm::value_ptr(value));
     }
@@ -71,7 +93,7 @@ void Shader::setMat4(const char* name, const glm::mat4& value) const {
  * @brief Establece un uniform vec3
  */
 void Shader::setVec3(const char* name, const glm::vec3& value) const {
-    GLint location = glGetUniformLocation(m_program, name);
+    GLint location = getUniformLocation(name);
     if (location != -1) {
         glUniform3fv(location, 1, glm::value_ptr(value));
     }
@@ -81,7 +103,7 @@ void Shader::setVec3(const char* name, const glm::vec3& value) const {
  * @brief Establece un uniform vec4
  */
 void Shader::setVec4(const char* name, const glm::vec4& value) const {
-    GLint location = glGetUniformLocation(m_program, name);
+    GLint location = getUniformLocation(name);
     if (location != -1) {
         glUniform4fv(location, 1, glm::value_ptr(value));
     }
@@ -91,7 +113,7 @@ void Shader::setVec4(const char* name, const glm::vec4& value) const {
  * @brief Establece un uniform float
  */
 void Shader::setFloat(const char* name, float value) const {
-    GLint location = glGetUniformLocation(m_program, name);
+    GLint location = getUniformLocation(name);
     if (location != -1) {
         glUniform1f(location, value);
     }
@@ -101,7 +123,7 @@ void Shader::setFloat(const char* name, float value) const {
  * @brief Establece un uniform int
  */
 void Shader::setInt(const char* name, int value) const {
-    GLint location = glGetUniformLocation(m_program, name);
+    GLint location = getUniformLocation(name);
     if (location != -1) {
         glUniform1i(location, value);
     }
@@ -153,3 +175,34 @@ GLuint Shader::linkProgram(GLuint vertexShader, GLuint fragmentShader) {
 
     return program;
 }
+
+/*
+ * @brief Construye la tabla de ubicaciones de uniforms
+ */
+void Shader::cacheUniformLocations() {
+    GLint count = 0;
+    GLint maxLength = 0;
+    glGetProgramiv(m_program, GL_ACTIVE_UNIFORMS, &count);
+    glGetProgramiv(m_program, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxLength);
+
+    std::vector<GLchar> name(static_cast<size_t>(maxLength) + 1);
+    for (GLint i = 0; i < count; ++i) {
+        GLsizei length = 0;
+        GLint size = 0;
+        GLenum type = 0;
+        glGetActiveUniform(m_program, static_cast<GLuint>(i), static_cast<GLsizei>(name.size()),
+                           &length, &size, &type, name.data());
+
+        // Los miembros de bloques uniform no tienen ubicacion (-1)
+        std::string uniformName(name.data(), static_cast<size_t>(length));
+        GLint location = glGetUniformLocation(m_program, uniformName.c_str());
+        if (location == -1)
+            continue;
+
+        // Los arreglos se reportan como "nombre[0]": guardar tambien el nombre base
+        if (uniformName.size() > 3 && uniformName.compare(uniformName.size() - 3, 3, "[0]") == 0) {
+            m_uniformLocations[uniformName.substr(0, uniformName.size() - 3)] = location;
+        }
+        m_uniformLocations[uniformName] = location;
+    }
+}
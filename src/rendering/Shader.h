@@ -4,7 +4,8 @@
  *
  * Maneja compilacion, enlazado y uso de shaders GLSL. Proporciona
  * una interfaz simple para crear programas de shaders y establecer
- * variables uniform.
+ * variables uniform. Las ubicaciones de los uniforms se consultan una sola
+ * vez al enlazar, en lugar de llamar a glGetUniformLocation en cada frame.
  *
  * @author Julian Parra
  * @date 2025
@@ -17,7 +18,9 @@
 
 #include <glad/glad.h>
 
+#include <functional>
 #include <glm/glm.hpp>
+#include <map>
 #include <string>
 
 /**
@@ -27,7 +30,8 @@
  * Encapsula toda la funcionalidad relacionada con shaders:
  * - Compilacion de vertex y fragment shaders
  * - Enlazado de programas
- * - Establecimiento de uniformes
+ * - Establecimiento de uniformes (con tabla de ubicaciones)
+ * - Enlace de bloques uniform a puntos de enlace
  * - Manejo de errores
  */
 class Shader {
@@ -61,6 +65,20 @@ public:
         return m_program;
     }
 
+    /**
+     * @brief Ubicacion de un uniform desde la tabla construida al enlazar
+     * @param name Nombre del uniform (sin sufijo [0] para arreglos)
+     * @return Ubicacion, o -1 si no existe o fue eliminado por el compilador
+     */
+    GLint getUniformLocation(const char* name) const;
+
+    /**
+     * @brief Asocia un bloque uniform del programa a un punto de enlace
+     * @param blockName Nombre del bloque en GLSL
+     * @param binding Punto de enlace (glBindBufferBase con GL_UNIFORM_BUFFER)
+     */
+    void bindUniformBlock(const char* blockName, GLuint binding) const;
+
     /**
      * @brief Establece un uniform mat4
      * @param name Nombre del uniform
@@ -121,7 +139,17 @@ private:
      */
     static GLuint linkProgram(GLuint vertexShader, GLuint fragmentShader);
 
+    /**
+     * @brief Llena la tabla de ubicaciones con los uniforms activos del programa
+     */
+    void cacheUniformLocations();
+
     GLuint m_program{0};  ///< ID del programa de shader
+
+    /// Nombre -> ubicacion. Comparador transparente (std::less<>): find() con un
+    /// const char* compara sin construir un std::string, asi que las consultas de
+    /// cada cuadro no reservan memoria (unordered_map solo lo permite en C++20).
+    std::map<std::string, GLint, std::less<>> m_uniformLocations;
 };
 
 #endif  // SHADER_H
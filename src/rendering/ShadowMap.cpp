@@ -0,0 +1,133 @@
+/**
+ * @file ShadowMap.cpp
+ * @brief Implementacion del mapa de sombras.
+ *
+ * @author Julian Parra
+ * @date 2025
+ * @course Graficacion
+ * @project Proyecto Final - "Arboles: La Belleza Algoritmica de las Plantas"
+ */
+
+#include "ShadowMap.h"
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <limits>
+
+ShadowMap::~ShadowMap() {
+    destroy();
+}
+
+bool ShadowMap::create(int size) {
+    destroy();
+
+    glGenTextures(1, &m_texture);
+    glBindTexture(GL_TEXTURE_2D, m_texture);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT24, size, size, 0, GL_DEPTH_COMPONENT,
+                 GL_UNSIGNED_INT, nullptr);
+    // Comparacion en hardware con filtrado bilineal: PCF 2x2 por consulta
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_COMPARE_MODE, GL_COMPARE_REF_TO_TEXTURE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_COMPARE_FUNC, GL_LEQUAL);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    glGenFramebuffers(1, &m_framebuffer);
+    glBindFramebuffer(GL_FRAMEBUFFER, m_framebuffer);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, m_texture, 0);
+    glDrawBuffer(GL_NONE);
+    glReadBuffer(GL_NONE);
+    const bool complete = glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+    if (!complete) {
+        std::cerr << "ShadowMap: framebuffer de profundidad " << size << "x" << size
+                  << " incompleto\n";
+        destroy();
+        return false;
+    }
+    m_size = size;
+    return true;
+}
+
+void ShadowMap::destroy() {
+    if (m_framebuffer != 0)
+        glDeleteFramebuffers(1, &m_framebuffer);
+    if (m_texture != 0)
+        glDeleteTextures(1, &m_texture);
+    m_framebuffer = 0;
+    m_texture = 0;
+    m_size = 0;
+}
+
+void ShadowMap::fit(const glm::vec3& lightPos, const glm::vec3& boundsMin,
+                    const glm::vec3& boundsMax) {
+    const glm::vec3 center = 0.5F * (boundsMin + boundsMax);
+    glm::vec3 direction = center - lightPos;
+    if (glm::dot(direction, direction) < 1e-8F) {
+        direction = glm::vec3(0.0F, -1.0F, 0.0F);  // Luz dentro de la planta: directo hacia abajo
+    }
+    direction = glm::normalize(direction);
+    const glm::vec3 up =
+        std::abs(direction.y) > 0.99F ? glm::vec3(0.0F, 0.0F, 1.0F) : glm::vec3(0.0F, 1.0F, 0.0F);
+    m_view = glm::lookAt(center - direction, center, up);
+
+    // Esquinas de la caja, y donde cae su sombra en el piso (mismo xy en espacio de luz,
+    // mayor profundidad)
+    glm::vec3 lightMin(std::numeric_limits<float>::max());
+    glm::vec3 lightMax(std::numeric_limits<float>::lowest());
+    auto include = [&](const glm::vec3& point) {
+        const glm::vec3 local(m_view * glm::vec4(point, 1.0F));
+        lightMin = glm::min(lightMin, local);
+        lightMax = glm::max(lightMax, local);
+    };
+    for (int corner = 0; corner < 8; ++corner) {
+        const glm::vec3 point((corner & 1) != 0 ? boundsMax.x : boundsMin.x,
+                              (corner & 2) != 0 ? boundsMax.y : boundsMin.y,
+                              (corner & 4) != 0 ? boundsMax.z : boundsMin.z);
+        include(point);
+        if (direction.y < -1e-3F && point.y > 0.0F) {
+            include(point + direction * (point.y / -direction.y));
+        }
+    }
+
+    // El espacio de vista mira hacia -z: near y far son los extremos de z negados. Un
+    // texel de margen mantiene el contorno lejos del borde.
+    const float margin = std::max(lightMax.x - lightMin.x, lightMax.y - lightMin.y) /
+                         static_cast<float>(std::max(m_size, 1));
+    const float depthMargin = 0.01F * (lightMax.z - lightMin.z) + 1e-3F;
+    m_projection = glm::ortho(lightMin.x - margin, lightMax.x + margin, lightMin.y - margin,
+                              lightMax.y + margin, -lightMax.z - depthMargin,
+                              -lightMin.z + depthMargin);
+}
+
+void ShadowMap::begin() {
+    glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &m_previousFramebuffer);
+    glGetIntegerv(GL_VIEWPORT, m_previousViewport);
+
+    glBindFramebuffer(GL_FRAMEBUFFER, m_framebuffer);
+    glViewport(0, 0, m_size, m_size);
+    glClear(GL_DEPTH_BUFFER_BIT);
+
+    // Sesgo escalado por pendiente contra el acne en superficies rasantes a la luz
+    glEnable(GL_POLYGON_OFFSET_FILL);
+    glPolygonOffset(2.0F, 4.0F);
+}
+
+void ShadowMap::end() {
+    glDisable(GL_POLYGON_OFFSET_FILL);
+    glBindFramebuffer(GL_FRAMEBUFFER, static_cast<GLuint>(m_previousFramebuffer));
+    glViewport(m_previousViewport[0], m_previousViewport[1], m_previousViewport[2],
+               m_previousViewport[3]);
+}
+
+void ShadowMap::bindTexture(GLuint unit) const {
+    glActiveTexture(GL_TEXTURE0 + unit);
+    glBindTexture(GL_TEXTURE_2D, m_texture);
+    glActiveTexture(GL_TEXTURE0);
+}
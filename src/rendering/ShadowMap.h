@@ -0,0 +1,118 @@
+/**
+ * @file ShadowMap.h
+ * @brief Mapa de sombras: textura de profundidad vista desde la luz.
+ *
+ * La luz se trata como direccional (de lightPos hacia la planta) con una
+ * proyeccion ortografica ajustada a la caja envolvente de la planta: todo el
+ * mapa cubre la planta, y su profundidad llega hasta donde la sombra cae en el
+ * piso. La textura se lee con comparacion de profundidad (sampler2DShadow).
+ *
+ * Solo administra la textura, el framebuffer y las matrices; quien dibuja la
+ * pasada de profundidad es TurtleGraphics (ver TurtleGraphics::updateShadowMap()).
+ *
+ * @author Julian Parra
+ * @date 2025
+ * @course Graficacion
+ * @project Proyecto Final - "Arboles: La Belleza Algoritmica de las Plantas"
+ */
+
+#ifndef SHADOW_MAP_H
+#define SHADOW_MAP_H
+
+#include <glad/glad.h>
+
+#include <cstddef>
+#include <glm/glm.hpp>
+
+/**
+ * @class ShadowMap
+ * @brief Textura de profundidad cuadrada con su framebuffer y la camara de la luz.
+ */
+class ShadowMap {
+public:
+    static constexpr int DEFAULT_SIZE = 2048;  ///< Texeles por lado (16 MiB)
+
+    ShadowMap() = default;
+    ~ShadowMap();
+
+    // No copiable
+    ShadowMap(const ShadowMap&) = delete;
+    ShadowMap& operator=(const ShadowMap&) = delete;
+
+    /**
+     * @brief Crea la textura de profundidad y el framebuffer.
+     * @return false si el framebuffer queda incompleto.
+     * @pre Requiere un contexto OpenGL activo con glad cargado.
+     */
+    bool create(int size = DEFAULT_SIZE);
+
+    void destroy();
+
+    bool isReady() const {
+        return m_framebuffer != 0;
+    }
+
+    /**
+     * @brief Ajusta la camara de la luz a una caja en espacio de mundo.
+     *
+     * La direccion va de lightPos al centro de la caja. El volumen ortografico
+     * envuelve la caja y se alarga hasta el piso (y = 0) para incluir su sombra.
+     */
+    void fit(const glm::vec3& lightPos, const glm::vec3& boundsMin, const glm::vec3& boundsMax);
+
+    /**
+     * @brief Enlaza el framebuffer de profundidad, ajusta el viewport y lo limpia.
+     * @note Guarda el framebuffer y el viewport actuales para end() (p. ej. el de
+     *       OffscreenTarget en el render por lotes).
+     */
+    void begin();
+
+    /**
+     * @brief Restaura el framebuffer y el viewport de antes de begin().
+     */
+    void end();
+
+    /**
+     * @brief Enlaza la textura en una unidad para leerla como sampler2DShadow.
+     */
+    void bindTexture(GLuint unit) const;
+
+    const glm::mat4& getView() const {
+        return m_view;
+    }
+    const glm::mat4& getProjection() const {
+        return m_projection;
+    }
+
+    /**
+     * @brief Mundo -> clip de la luz (projection * view).
+     */
+    glm::mat4 getLightSpace() const {
+        return m_projection * m_view;
+    }
+
+    int getSize() const {
+        return m_size;
+    }
+
+    /**
+     * @brief Bytes de la textura de profundidad (4 por texel).
+     */
+    size_t getBytes() const {
+        return isReady() ? static_cast<size_t>(m_size) * static_cast<size_t>(m_size) * 4 : 0;
+    }
+
+private:
+    GLuint m_framebuffer{0};
+    GLuint m_texture{0};
+    int m_size{0};
+
+    glm::mat4 m_view{1.0F};
+    glm::mat4 m_projection{1.0F};
+
+    // Se restaura en end()
+    GLint m_previousFramebuffer{0};
+    GLint m_previousViewport[4]{};
+};
+
+#endif  // SHADOW_MAP_H
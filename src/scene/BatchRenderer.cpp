@@ -0,0 +1,331 @@
+/**
+ * @file BatchRenderer.cpp
+ * @brief Implementacion del render por lotes fuera de pantalla.
+ *
+ * @author Julian Parra
+ * @date 2025
+ * @course Graficacion
+ * @project Proyecto Final - "Arboles: La Belleza Algoritmica de las Plantas"
+ */
+
+#include "BatchRenderer.h"
+
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+#include "Colors.h"
+#include "core/PngWriter.h"
+#include "lsystem/GenerationWorker.h"
+#include "ui/Presets.h"
+
+namespace {
+
+const glm::vec3 LIGHT_POSITION(5.0F, 8.0F, 5.0F);  // La misma luz que la vista interactiva
+
+std::string trim(const std::string& text) {
+    const size_t begin = text.find_first_not_of(" \t\r");
+    if (begin == std::string::npos)
+        return "";
+    const size_t end = text.find_last_not_of(" \t\r");
+    return text.substr(begin, end - begin + 1);
+}
+
+int findPreset(const std::string& field) {
+    for (int i = 0; i < NUM_PRESETS; ++i) {
+        if (field == PRESETS[i].name)
+            return i;
+    }
+    char* end = nullptr;
+    const long index = std::strtol(field.c_str(), &end, 10);
+    if (end == field.c_str() || *end != '\0' || index < 0 || index >= NUM_PRESETS)
+        return -1;
+    return static_cast<int>(index);
+}
+
+// Letras y digitos del nombre de un preset, el resto como '_' ("Pino 3D" -> "Pino_3D")
+std::string fileStem(const std::string& name) {
+    std::string stem = name;
+    for (char& c : stem) {
+        if (std::isalnum(static_cast<unsigned char>(c)) == 0) {
+            c = '_';
+        }
+    }
+    return stem;
+}
+
+}  // namespace
+
+// =============================================================================
+// Archivo de trabajos
+// =============================================================================
+
+bool loadRenderJobs(const std::string& path, std::vector<RenderJob>& jobs) {
+    std::ifstream file(path);
+    if (!file.is_open()) {
+        std::cerr << "Batch: no se pudo abrir " << path << '\n';
+        return false;
+    }
+
+    std::string line;
+    int lineNumber = 0;
+    while (std::getline(file, line)) {
+        lineNumber++;
+        const size_t comment = line.find('#');
+        if (comment != std::string::npos) {
+            line.erase(comment);
+        }
+        if (trim(line).empty())
+            continue;
+
+        std::vector<std::string> fields;
+        std::stringstream stream(line);
+        std::string field;
+        while (std::getline(stream, field, ';')) {
+            fields.push_back(trim(field));
+        }
+
+        RenderJob job;
+        job.preset = findPreset(fields[0]);
+        bool valid = job.preset >= 0 && fields.size() <= 7;
+        auto number = [&fields, &valid](size_t index, auto& value) {
+            if (index >= fields.size() || fields[index].empty())
+                return;
+            std::stringstream parse(fields[index]);
+            parse >> value;
+            valid = valid && !parse.fail() && parse.eof();
+        };
+        number(1, job.generations);
+        number(2, job.distance);
+        number(3, job.angleX);
+        number(4, job.angleY);
+        number(5, job.frames);
+        if (fields.size() > 6) {
+            job.name = fields[6];
+        }
+
+        if (!valid || job.frames < 1) {
+            std::cerr << "Batch: " << path << ':' << lineNumber << ": trabajo invalido: " << line
+                      << '\n';
+            continue;
+        }
+        jobs.push_back(job);
+    }
+    return true;
+}
+
+// =============================================================================
+// BatchRenderer
+// =============================================================================
+
+BatchRenderer::BatchRenderer(BatchOptions options) : m_options(std::move(options)) {}
+
+BatchRenderer::~BatchRenderer() {
+    stopEncoders();
+}
+
+bool BatchRenderer::initialize() {
+    if (!m_turtle.initialize())
+        return false;
+    if (!m_target.create(m_options.width, m_options.height, m_options.samples))
+        return false;
+    m_readback.create(m_options.width, m_options.height);
+    m_camera.updatePerspective(m_options.width, m_options.height);
+
+    glEnable(GL_DEPTH_TEST);
+    glEnable(GL_MULTISAMPLE);
+
+    std::error_code error;
+    std::filesystem::create_directories(m_options.outputDirectory, error);
+    return true;
+}
+
+size_t BatchRenderer::run(const std::vector<RenderJob>& jobs) {
+    const auto start = std::chrono::steady_clock::now();
+    size_t frames = 0;
+    m_written = 0;
+    m_failed = 0;
+
+    unsigned threads = m_options.encoderThreads;
+    if (threads == 0) {
+        threads = std::max(std::thread::hardware_concurrency(), 2U) - 1;
+    }
+    m_stopping = false;
+    for (unsigned i = 0; i < threads; ++i) {
+        m_encoders.emplace_back(&BatchRenderer::encodeLoop, this);
+    }
+
+    for (size_t index = 0; index < jobs.size(); ++index) {
+        const RenderJob& job = jobs[index];
+        const LSystemPreset& preset = PRESETS[job.preset];
+        const int generations = job.generations >= 0 ? job.generations : preset.generations;
+        if (!prepareTree(job, generations))
+            continue;
+
+        char suffix[32];
+        std::snprintf(suffix, sizeof(suffix), "_g%d", generations);
+        std::string stem = job.name;
+        if (stem.empty()) {
+            char number[16];
+            std::snprintf(number, sizeof(number), "%03zu_", index);
+            stem = number + fileStem(preset.name) + suffix;
+        }
+        const std::string base = m_options.outputDirectory + "/" + stem;
+
+        for (int frame = 0; frame < job.frames; ++frame) {
+            std::string path = base;
+            if (job.frames > 1) {
+                std::snprintf(suffix, sizeof(suffix), "_%03d", frame);
+                path += suffix;
+            }
+            renderFrame(job, frame, path + ".png");
+            frames++;
+        }
+    }
+
+    // Lecturas aun en curso, y luego lo que tengan en cola los codificadores
+    while (m_readback.getPending() > 0) {
+        collectFrame(true);
+    }
+    stopEncoders();
+
+    const double seconds =
+        std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    const size_t written = m_written.load();
+    std::cout << "Batch: " << written << " de " << frames << " imagenes en " << seconds << " s ("
+              << (seconds > 0.0 ? static_cast<double>(written) / seconds : 0.0)
+              << " imagenes/s) en " << m_options.outputDirectory << "/\n";
+    if (m_failed.load() > 0) {
+        std::cerr << "Batch: " << m_failed.load() << " imagenes no se pudieron escribir\n";
+    }
+    return written;
+}
+
+bool BatchRenderer::prepareTree(const RenderJob& job, int generations) {
+    if (job.preset == m_treePreset && generations == m_treeGenerations)
+        return true;
+
+    const LSystemPreset& preset = PRESETS[job.preset];
+    m_turtle.set3DMode(preset.is3D);
+    m_turtle.setRenderMode(preset.useCylinders ? RenderMode::Cylinders : RenderMode::Lines);
+
+    GenerationRequest request;
+    request.axiom = preset.axiom;
+    request.rules = preset.rules;
+    request.angle = preset.angle;
+    request.generations = generations;
+    const uint64_t key = makeCacheKey(request).hash(m_turtle);
+
+    if (!m_options.useGeometryCache || !m_cache.load(key, m_turtle)) {
+        // Un preset nuevo empieza de cero; el mismo continua desde sus generaciones cacheadas
+        if (job.preset != m_lsystemPreset) {
+            m_lsystem = LSystem();
+            m_lsystem.setAxiom(preset.axiom);
+            m_lsystem.addRulesFromString(preset.rules);
+            m_lsystem.setAngle(preset.angle);
+            m_lsystemPreset = job.preset;
+        }
+        if (!m_lsystem.generate(generations) || !m_turtle.buildGeometry(m_lsystem, preset.angle))
+            return false;
+        if (m_options.useGeometryCache) {
+            m_cache.store(key, m_turtle, m_lsystem.getLength());
+        }
+    }
+
+    // Los mismos buffers de instancias que el arbol anterior: solo crecen
+    m_turtle.upload();
+    m_treePreset = job.preset;
+    m_treeGenerations = generations;
+    return true;
+}
+
+void BatchRenderer::renderFrame(const RenderJob& job, int frame, const std::string& path) {
+    const float turn = 360.0F * static_cast<float>(frame) / static_cast<float>(job.frames);
+    m_camera.updateView(job.distance, job.angleX + turn, job.angleY);
+
+    constexpr auto background = Colors::Nord::POLAR_NIGHT_0;
+    m_target.bind();
+    glClearColor(background.r, background.g, background.b, background.a);
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    m_turtle.render(m_camera.getViewMatrix(), m_camera.getProjectionMatrix(), LIGHT_POSITION);
+    m_target.resolve();
+
+    // Anillo lleno: la copia mas vieja debe llegar antes de iniciar esta
+    const auto tag = static_cast<uint64_t>(m_framePaths.size());
+    m_framePaths.push_back(path);
+    while (!m_readback.begin(tag)) {
+        collectFrame(true);
+    }
+    while (collectFrame(false)) {
+    }
+}
+
+bool BatchRenderer::collectFrame(bool wait) {
+    std::vector<uint8_t> pixels = takeBuffer();
+    uint64_t tag = 0;
+    const bool collected = m_readback.collect(pixels, tag, wait);
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    if (!collected) {
+        m_freeBuffers.push_back(std::move(pixels));
+        return false;
+    }
+
+    // Cola acotada: pocas imagenes por codificador, asi un disco lento no acumula memoria
+    m_taskTaken.wait(lock, [this]() { return m_tasks.size() < m_encoders.size() * 2; });
+    m_tasks.push_back({std::move(m_framePaths[tag]), std::move(pixels)});
+    m_taskReady.notify_one();
+    return true;
+}
+
+void BatchRenderer::encodeLoop() {
+    for (;;) {
+        EncodeTask task;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_taskReady.wait(lock, [this]() { return m_stopping || !m_tasks.empty(); });
+            if (m_tasks.empty())
+                return;
+            task = std::move(m_tasks.front());
+            m_tasks.pop_front();
+            m_taskTaken.notify_one();
+        }
+
+        if (writePng(task.path, task.pixels.data(), m_options.width, m_options.height, true)) {
+            m_written++;
+        } else {
+            std::cerr << "Batch: no se pudo escribir " << task.path << '\n';
+            m_failed++;
+        }
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_freeBuffers.push_back(std::move(task.pixels));
+    }
+}
+
+void BatchRenderer::stopEncoders() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stopping = true;
+    }
+    m_taskReady.notify_all();
+    for (std::thread& encoder : m_encoders) {
+        encoder.join();
+    }
+    m_encoders.clear();
+}
+
+std::vector<uint8_t> BatchRenderer::takeBuffer() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_freeBuffers.empty())
+        return {};
+    std::vector<uint8_t> buffer = std::move(m_freeBuffers.back());
+    m_freeBuffers.pop_back();
+    return buffer;
+}
@@ -0,0 +1,145 @@
+/**
+ * @file BatchRenderer.h
+ * @brief Modo sin interfaz: renderiza listas de trabajos a PNG fuera de pantalla.
+ *
+ * Cada trabajo es un (preset, generacion, camara), opcionalmente una vuelta
+ * completa de varios cuadros. Los trabajos corren uno tras otro sobre una sola
+ * tortuga, un framebuffer fuera de pantalla y un anillo de PBOs:
+ *
+ * - Los buffers de instancias se reutilizan entre trabajos (upload() solo crece),
+ *   y un trabajo con el mismo preset y generacion que el anterior no regenera nada.
+ * - Un preset repetido continua desde las generaciones ya calculadas de su
+ *   LSystem, y la geometria se busca primero en GeometryCache.
+ * - La lectura de cada cuadro es asincrona (PixelReadback): el cuadro siguiente se
+ *   dibuja mientras la copia anterior termina, y la codificacion PNG corre en hilos
+ *   aparte, en paralelo con el render.
+ *
+ * Formato del archivo de trabajos, una linea por trabajo (# comenta):
+ * @code
+ *   preset; generaciones; distancia; anguloX; anguloY; cuadros; nombre
+ * @endcode
+ * El preset es un indice o el nombre exacto de PRESETS; los campos finales o
+ * vacios toman los valores por defecto de RenderJob.
+ *
+ * @author Julian Parra
+ * @date 2025
+ * @course Graficacion
+ * @project Proyecto Final - "Arboles: La Belleza Algoritmica de las Plantas"
+ */
+
+#ifndef BATCH_RENDERER_H
+#define BATCH_RENDERER_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "lsystem/GeometryCache.h"
+#include "lsystem/LSystem.h"
+#include "lsystem/TurtleGraphics.h"
+#include "rendering/Camera.h"
+#include "rendering/OffscreenTarget.h"
+#include "rendering/PixelReadback.h"
+
+/**
+ * @brief Un trabajo de la lista: una imagen, o una vuelta de 'frames' imagenes.
+ */
+struct RenderJob {
+    int preset{0};            ///< Indice en PRESETS
+    int generations{-1};      ///< -1: las del preset
+    float distance{3.5F};     ///< Como en la ventana de camara
+    float angleX{0.0F};       ///< Giro horizontal del primer cuadro (grados)
+    float angleY{20.0F};      ///< Elevacion (grados)
+    int frames{1};            ///< Mas de 1: vuelta completa alrededor de la planta
+    std::string name;         ///< Prefijo de los archivos; vacio: indice y preset
+};
+
+/**
+ * @brief Ajustes del modo sin interfaz (linea de comandos).
+ */
+struct BatchOptions {
+    std::string outputDirectory{"renders"};
+    int width{512};
+    int height{512};
+    int samples{4};               ///< MSAA del framebuffer fuera de pantalla
+    unsigned encoderThreads{0};   ///< 0: un hilo menos que nucleos (al menos 1)
+    bool useGeometryCache{true};  ///< Buscar y guardar geometria en GeometryCache
+};
+
+/**
+ * @brief Lee un archivo de trabajos.
+ * @return false si no se pudo abrir; las lineas invalidas se reportan y se omiten.
+ */
+bool loadRenderJobs(const std::string& path, std::vector<RenderJob>& jobs);
+
+/**
+ * @class BatchRenderer
+ * @brief Renderiza trabajos uno tras otro y escribe sus cuadros como PNG.
+ */
+class BatchRenderer {
+public:
+    explicit BatchRenderer(BatchOptions options);
+    ~BatchRenderer();
+
+    // No copiable
+    BatchRenderer(const BatchRenderer&) = delete;
+    BatchRenderer& operator=(const BatchRenderer&) = delete;
+
+    /**
+     * @brief Crea la tortuga, el framebuffer y los PBOs.
+     * @pre Requiere un contexto OpenGL activo con glad cargado (puede ser de una
+     *      ventana oculta).
+     */
+    bool initialize();
+
+    /**
+     * @brief Renderiza todos los trabajos y espera a que sus archivos se escriban.
+     * @note Los hilos de codificacion viven solo durante la llamada.
+     * @return Imagenes escritas.
+     */
+    size_t run(const std::vector<RenderJob>& jobs);
+
+private:
+    struct EncodeTask {
+        std::string path;
+        std::vector<uint8_t> pixels;
+    };
+
+    bool prepareTree(const RenderJob& job, int generations);
+    void renderFrame(const RenderJob& job, int frame, const std::string& path);
+    bool collectFrame(bool wait);
+    void encodeLoop();
+    void stopEncoders();
+    std::vector<uint8_t> takeBuffer();
+
+    BatchOptions m_options;
+    TurtleGraphics m_turtle;
+    LSystem m_lsystem;
+    Camera m_camera;
+    OffscreenTarget m_target;
+    PixelReadback m_readback;
+    const GeometryCache m_cache;
+    int m_lsystemPreset{-1};  ///< Preset cargado en m_lsystem
+    int m_treePreset{-1};     ///< Preset y generacion de la geometria subida
+    int m_treeGenerations{-1};
+
+    std::vector<std::string> m_framePaths;  ///< Archivo de cada cuadro (tag del PBO)
+
+    // Cola acotada de imagenes leidas hacia los hilos de codificacion
+    std::vector<std::thread> m_encoders;
+    std::mutex m_mutex;
+    std::condition_variable m_taskReady;
+    std::condition_variable m_taskTaken;
+    std::deque<EncodeTask> m_tasks;
+    std::vector<std::vector<uint8_t>> m_freeBuffers;  ///< Buffers de pixeles ya codificados
+    bool m_stopping{false};
+    std::atomic<size_t> m_written{0};
+    std::atomic<size_t> m_failed{0};
+};
+
+#endif  // BATCH_RENDERER_H
@@ -0,0 +1,200 @@
+/**
+ * @file Forest.cpp
+ * @brief Implementacion del cache de especies y la distribucion del bosque.
+ *
+ * @author Julian Parra
+ * @date 2025
+ * @course Graficacion
+ * @project Proyecto Final - "Arboles: La Belleza Algoritmica de las Plantas"
+ */
+
+#include "Forest.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+
+#include "lsystem/LSystem.h"
+#include "ui/Presets.h"
+
+namespace {
+
+constexpr float GOLDEN_ANGLE = 2.39996323F;  // pi * (3 - sqrt(5))
+
+// Paso de splitmix64: una secuencia bien mezclada que solo depende de la semilla
+uint64_t nextRandom(uint64_t& state) {
+    uint64_t z = (state += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+// Uniforme en [0, 1)
+float nextUnit(uint64_t& state) {
+    return static_cast<float>(nextRandom(state) >> 40) * (1.0F / 16777216.0F);
+}
+
+// Clave exacta de una especie: el preset, las generaciones y los ajustes de 'style'
+// que copySettings() deja en las instancias (los mismos que GeometryCacheKey).
+// Bits: preset 63..50, fusion 49, rotaciones rapidas 48, generaciones 47..32,
+// decaimiento de ancho 31..0.
+uint64_t speciesKey(int preset, int generations, const TurtleGraphics& style) {
+    const float widthDecay = style.getWidthDecay();
+    uint32_t decayBits = 0;
+    std::memcpy(&decayBits, &widthDecay, sizeof(decayBits));
+    return (static_cast<uint64_t>(preset & 0x3FFF) << 50) |
+           (static_cast<uint64_t>(style.getCoalesceSegments()) << 49) |
+           (static_cast<uint64_t>(style.getFastRotations()) << 48) |
+           (static_cast<uint64_t>(generations & 0xFFFF) << 32) | decayBits;
+}
+
+}  // namespace
+
+TurtleGraphics* Forest::findSpecies(int preset, int generations, const TurtleGraphics& style) {
+    const uint64_t key = speciesKey(preset, generations, style);
+    auto found = m_species.find(key);
+    if (found != m_species.end())
+        return found->second.get();
+
+    const LSystemPreset& source = PRESETS[preset];
+
+    // Las copias nunca se filtran: omitir los grupos del culler
+    auto species = std::make_unique<TurtleGraphics>();
+    species->setGpuCulling(false);
+    if (!species->initialize())
+        return nullptr;
+
+    // Los shaders de copias leen el formato completo de instancia
+    species->copySettings(style);
+    species->set3DMode(source.is3D);
+    species->setRenderMode(source.useCylinders ? RenderMode::Cylinders : RenderMode::Lines);
+    species->setCompactInstances(false);
+
+    LSystem lsystem;
+    lsystem.setAxiom(source.axiom);
+    lsystem.addRulesFromString(source.rules);
+    lsystem.setAngle(source.angle);
+    lsystem.generate(generations);
+    species->buildGeometry(lsystem, source.angle);
+    species->upload();
+
+    std::cout << "Forest: especie '" << source.name << "' (" << generations
+              << " generaciones): " << species->getBranchCount() << " ramas, "
+              << species->getDecorationCount() << " decoraciones\n";
+
+    TurtleGraphics* result = species.get();
+    m_species.emplace(key, std::move(species));
+    return result;
+}
+
+bool Forest::plant(const std::vector<int>& presets, const ForestLayout& layout,
+                   const TurtleGraphics& style) {
+    clear();
+
+    std::vector<TurtleGraphics*> species;
+    for (int preset : presets) {
+        if (preset < 0 || preset >= NUM_PRESETS)
+            continue;
+        const int generations =
+            layout.generations > 0 ? layout.generations : PRESETS[preset].generations;
+        TurtleGraphics* turtle = findSpecies(preset, generations, style);
+        if (turtle == nullptr)
+            return false;
+        if (std::find(species.begin(), species.end(), turtle) == species.end()) {
+            species.push_back(turtle);
+        }
+    }
+    if (species.empty() || layout.treeCount <= 0)
+        return true;
+
+    // Espiral de Vogel: el arbol i queda en la fraccion de area (i + 0.5) / n del anillo,
+    // girado por el angulo aureo; el ruido rompe los brazos de la espiral sin amontonar arboles
+    std::vector<std::vector<PlantPlacement>> placements(species.size());
+    uint64_t state = layout.seed;
+    const auto count = static_cast<size_t>(layout.treeCount);
+    const float inner2 = layout.innerRadius * layout.innerRadius;
+    const float outer2 = std::max(layout.outerRadius * layout.outerRadius, inner2);
+    for (size_t i = 0; i < count; ++i) {
+        const float area = (static_cast<float>(i) + nextUnit(state)) / static_cast<float>(count);
+        const float radius = std::sqrt(inner2 + (outer2 - inner2) * area);
+        const float theta = static_cast<float>(i) * GOLDEN_ANGLE + (nextUnit(state) - 0.5F);
+
+        PlantPlacement placement{};
+        placement.position = glm::vec3(radius * std::cos(theta), 0.0F, radius * std::sin(theta));
+        placement.scale = layout.minScale + (layout.maxScale - layout.minScale) * nextUnit(state);
+        placement.yaw = nextUnit(state) * 6.28318531F;
+
+        // Un brillo comun mas un cambio menor por canal
+        const float brightness = 1.0F + (nextUnit(state) * 2.0F - 1.0F) * layout.tintVariation;
+        for (int channel = 0; channel < 3; ++channel) {
+            const float shift = (nextUnit(state) * 2.0F - 1.0F) * layout.tintVariation * 0.5F;
+            placement.tint[channel] = std::max(brightness + shift, 0.0F);
+        }
+
+        placements[nextRandom(state) % species.size()].push_back(placement);
+    }
+
+    for (size_t s = 0; s < species.size(); ++s) {
+        species[s]->setPlacements(placements[s]);
+    }
+    m_treeCount = count;
+
+    // Mantener la cache acotada: descartar las especies que este bosque no usa
+    if (m_species.size() > MAX_CACHED_SPECIES) {
+        for (auto it = m_species.begin(); it != m_species.end();) {
+            if (it->second->getPlacementCount() == 0) {
+                it = m_species.erase(it);
+            } else {
+                ++it;
+            }
+        }
+    }
+    return true;
+}
+
+void Forest::clear() {
+    for (auto& entry : m_species) {
+        entry.second->setPlacements({});
+    }
+    m_treeCount = 0;
+}
+
+void Forest::render(const glm::mat4& view, const glm::mat4& projection, const glm::vec3& lightPos,
+                    const TurtleGraphics& style) {
+    for (auto& entry : m_species) {
+        TurtleGraphics& species = *entry.second;
+        if (species.getPlacementCount() == 0)
+            continue;
+
+        species.setStepSize(style.getStepSize());
+        species.setInitialWidth(style.getInitialWidth());
+        species.setLeafSize(style.getLeafSize());
+        species.setBranchColor(style.getBranchColor());
+        species.setLeafColor(style.getLeafColor());
+        species.setFlowerColor(style.getFlowerColor());
+        species.setJointSpheres(style.getJointSpheres());
+        if (species.getCylinderCaps() != style.getCylinderCaps()) {
+            species.setCylinderCaps(style.getCylinderCaps());
+        }
+        species.renderPlacements(view, projection, lightPos);
+    }
+}
+
+size_t Forest::getInstanceCount() const {
+    size_t instances = 0;
+    for (const auto& entry : m_species) {
+        const TurtleGraphics& species = *entry.second;
+        instances += (species.getBranchCount() + species.getDecorationCount()) *
+                     species.getPlacementCount();
+    }
+    return instances;
+}
+
+size_t Forest::getGpuBytes() const {
+    size_t bytes = 0;
+    for (const auto& entry : m_species) {
+        bytes += entry.second->getGpuBytes();
+    }
+    return bytes;
+}
@@ -0,0 +1,109 @@
+/**
+ * @file Forest.h
+ * @brief Bosque: miles de copias de unas pocas plantas generadas.
+ *
+ * Cada especie (preset, generaciones) se genera, interpreta y sube a la GPU una
+ * sola vez y queda en cache. Sus arboles comparten los buffers de instancias y
+ * solo agregan una ubicacion de 32 bytes (posicion, giro, escala y tinte); cada
+ * malla de la especie se dibuja con una llamada instanciada para todos ellos
+ * (ver TurtleGraphics::renderPlacements()). La memoria de GPU crece con el
+ * numero de especies, no con el de arboles.
+ *
+ * @author Julian Parra
+ * @date 2025
+ * @course Graficacion
+ * @project Proyecto Final - "Arboles: La Belleza Algoritmica de las Plantas"
+ */
+
+#ifndef FOREST_H
+#define FOREST_H
+
+#include <cstdint>
+#include <glm/glm.hpp>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#include "lsystem/TurtleGraphics.h"
+
+/**
+ * @brief Distribucion de los arboles de un bosque.
+ */
+struct ForestLayout {
+    int treeCount{500};
+    int generations{0};           ///< 0 = las generaciones de cada preset
+    float innerRadius{1.0F};      ///< Claro alrededor de la planta principal
+    float outerRadius{8.0F};
+    float minScale{0.7F};
+    float maxScale{1.3F};
+    float tintVariation{0.15F};  ///< Desviacion maxima del tinte por canal
+    uint64_t seed{1};             ///< La misma semilla repite el mismo bosque
+};
+
+/**
+ * @class Forest
+ * @brief Cache de especies y ubicaciones de sus arboles.
+ */
+class Forest {
+public:
+    Forest() = default;
+
+    // No copiable
+    Forest(const Forest&) = delete;
+    Forest& operator=(const Forest&) = delete;
+
+    /**
+     * @brief Reparte los arboles entre las especies indicadas.
+     *
+     * En una espiral de Vogel con ruido entre innerRadius y outerRadius: cubre el
+     * anillo de forma pareja sin arboles encimados. Las especies que no estan en
+     * cache se generan aqui (en el hilo con el contexto OpenGL).
+     * @param presets Indices en PRESETS; una lista vacia quita todos los arboles.
+     * @param layout Distribucion de los arboles.
+     * @param style Tortuga de la que se copian los ajustes de interpretacion.
+     * @return false si alguna especie no pudo crear sus recursos OpenGL.
+     */
+    bool plant(const std::vector<int>& presets, const ForestLayout& layout,
+               const TurtleGraphics& style);
+
+    /**
+     * @brief Quita todos los arboles; las especies quedan en cache.
+     */
+    void clear();
+
+    /**
+     * @brief Dibuja los arboles de cada especie.
+     * @param style Tortuga de la que se toman paso, anchos, tamano de hoja, colores,
+     *        uniones y tapas (uniforms: cambian sin regenerar las especies).
+     */
+    void render(const glm::mat4& view, const glm::mat4& projection, const glm::vec3& lightPos,
+                const TurtleGraphics& style);
+
+    size_t getTreeCount() const {
+        return m_treeCount;
+    }
+    size_t getSpeciesCount() const {
+        return m_species.size();
+    }
+
+    /**
+     * @brief Ramas y decoraciones dibujadas por cuadro (todas las copias).
+     */
+    size_t getInstanceCount() const;
+
+    /**
+     * @brief Memoria reservada en GPU por las especies en cache y sus ubicaciones.
+     */
+    size_t getGpuBytes() const;
+
+private:
+    TurtleGraphics* findSpecies(int preset, int generations, const TurtleGraphics& style);
+
+    // Clave: preset, generaciones y ajustes de la tortuga que quedan en las instancias
+    std::unordered_map<uint64_t, std::unique_ptr<TurtleGraphics>> m_species;
+    size_t m_treeCount{0};
+
+    static constexpr size_t MAX_CACHED_SPECIES = 16;  ///< Las que no se usan se eliminan
+};
+
+#endif  // FOREST_H
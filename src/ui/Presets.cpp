@@ -0,0 +1,118 @@
+/**
+ * @file Presets.cpp
+ * @brief Tabla de presets curados de L-System.
+ *
+ * @author Julian Parra
+ * @date 2025
+ * @course Graficacion
+ * @project Proyecto Final - "Arboles: La Belleza Algoritmica de las Plantas"
+ */
+
+#include "Presets.h"
+
+// =============================================================================
+// Presets de L-System - Basados en "The Algorithmic Beauty of Plants"
+// =============================================================================
+// Reglas probadas y verificadas del libro de Prusinkiewicz & Lindenmayer.
+// Cada preset produce resultados visualmente atractivos.
+// Incluye arboles 3D, flores, helechos, y fractales 2D clasicos.
+
+const LSystemPreset PRESETS[] = {
+    // =========================================================================
+    // ARBOLES 3D REALISTAS - Del libro ABOP (Algorithmic Beauty of Plants)
+    // =========================================================================
+
+    // Figura 1.24(d) del libro - Arbol tipo Honda con hojas
+    {"Pino 3D", "Arbol conifero con hojas verdes", "A", "A->F[&FLL!A]/////[&FLL!A]///////[&FLL!A]",
+     22.5F, 6, true, true},
+
+    // Variacion del arbol Honda - mas denso con hojas
+    {"Abeto 3D", "Arbol conifero denso con follaje", "A", "A->F[&FLLA]////[&FLLA]////[&FLLA]",
+     25.7F, 7, true, true},
+
+    // Arbol con estructura tipo roble con muchas hojas
+    {"Roble 3D", "Arbol robusto con copa frondosa", "A", "A->F[^FLLA]//[^FLLA]//[^FLLA]//[^FLLA]",
+     30.0F, 6, true, true},
+
+    // Arbol con ramas alternadas y hojas colgantes
+    {"Sauce 3D", "Arbol con hojas caidas elegantes", "A",
+     "A->F[&F[&FLLA]//[&FLLA]]////F[&F[&FLLA]//[&FLLA]]", 22.5F, 5, true, true},
+
+    // Magnolia - arbol con flores grandes en estructura 3D
+    {"Magnolia 3D", "Arbol con flores grandes", "A", "A->FF[&FKK!A]////[&FKK!A]////[&FKK!A]", 28.0F,
+     5, true, true},
+
+    // Cerezo japones - estructura 3D ramificada con muchas flores
+    {"Cerezo 3D", "Arbol japones con flores rosadas", "A", "A->F[&FKK!A]////[&FKK!A]////[&FKK!A]",
+     30.0F, 5, true, true},
+
+    // =========================================================================
+    // PLANTAS 2D CLASICAS - Wikipedia/ABOP Examples
+    // =========================================================================
+
+    // Helecho fractal - Figura clasica del libro ABOP (Example 7 Wikipedia)
+    {"Helecho 2D", "Planta fractal clasica estilo Barnsley", "X", "X->F+[[X]-X]-F[-FX]+X,F->FF",
+     25.0F, 6, false, false},
+
+    // Arbol binario simetrico
+    {"Arbol Binario 2D", "Bifurcacion perfecta", "F", "F->FF+[+F-F-F]-[-F+F+F]", 22.5F, 4, false,
+     false},
+
+    // Arbusto denso 2D
+    {"Arbusto 2D", "Arbusto ramificado natural", "F", "F->F[+F]F[-F][F]", 20.0F, 5, false, false},
+
+    // Arbusto estocastico 2D - ABOP figura 1.27: cada F elige una de tres reglas
+    {"Arbusto Estocastico 2D", "Cada semilla da un arbusto distinto", "F",
+     "F-(0.33)->F[+F]F[-F]F\nF-(0.33)->F[+F]F\nF-(0.34)->F[-F]F", 25.7F, 5, false, false},
+
+    // Planta con flores 2D
+    {"Flor 2D", "Planta con flores en las puntas", "X", "X->F[+XK][-XK]FXK,F->FF", 25.7F, 5, false,
+     false},
+
+    // =========================================================================
+    // FRACTALES GEOMETRICOS 2D
+    // =========================================================================
+
+    // Curva de Koch
+    {"Curva Koch 2D", "Copo de nieve fractal", "F", "F->F+F--F+F", 60.0F, 4, false, false},
+
+    // Triangulo de Sierpinski
+    {"Sierpinski 2D", "Triangulo fractal clasico", "F-G-G", "F->F-G+F+G-F,G->GG", 120.0F, 5, false,
+     false},
+
+    // Curva del Dragon
+    {"Dragon 2D", "Curva del dragon fractal", "FX", "X->X+YF+,Y->-FX-Y", 90.0F, 12, false, false},
+
+    // Curva de Hilbert
+    {"Hilbert 2D", "Curva que llena el espacio", "X", "X->-YF+XFX+FY-,Y->+XF-YFY-FX+", 90.0F, 5,
+     false, false},
+
+    // =========================================================================
+    // ARBOLES 3D CON FLORES
+    // =========================================================================
+
+    // Manzano en flor - estructura frutal 3D con ramas y flores
+    {"Manzano 3D", "Arbol frutal con flores y hojas", "A",
+     "A->F[&FLLKK!A]////[&FLLKK!A]////[&FLLKK!A]", 25.0F, 5, true, true},
+
+    // Arbol primaveral completo
+    {"Primavera 3D", "Arbol con hojas y flores mezcladas", "A",
+     "A->F[&FLLK!A]////[&FKLL!A]////[&FLKL!A]", 25.0F, 5, true, true},
+
+    // Bonsai - arbol pequeno y artistico
+    {"Bonsai 3D", "Arbol pequeno estilo japones", "A", "A->F[&^FLL!A]//[&&FLL!A]////[&^FLL!A]",
+     35.0F, 5, true, true},
+
+    // Arbol parametrico - cada rama mide 3/4 de su madre y termina en hoja
+    {"Parametrico 3D", "Ramas que se acortan y adelgazan con parametros", "X(1,1)",
+     "X(l,w) : l > 0.3 -> !(w)F(l)[&(35)X(l*0.75,w*0.7)]"
+     "/(120)[&(35)X(l*0.75,w*0.7)]/(120)[&(35)X(l*0.75,w*0.7)]\n"
+     "X(l,w) : l <= 0.3 -> L(1.5)",
+     35.0F, 6, true, true},
+
+    // Arbol de navidad con decoraciones
+    {"Navidad 3D", "Pino decorado con ornamentos", "A",
+     "A->F[&FKKLL!A]/////[&FLLKK!A]///////[&FKKLK!A]", 20.0F, 6, true, true},
+};
+
+const int NUM_PRESETS = sizeof(PRESETS) / sizeof(PRESETS[0]);
@@ -0,0 +1,37 @@
+/**
+ * @file Presets.h
+ * @brief Presets curados de L-System con ajustes visuales.
+ *
+ * Tabla compartida entre la interfaz y las herramientas sin ventana (benchmarks).
+ * No tiene dependencias de OpenGL ni de ImGui.
+ *
+ * @author Julian Parra
+ * @date 2025
+ * @course Graficacion
+ * @project Proyecto Final - "Arboles: La Belleza Algoritmica de las Plantas"
+ */
+
+#ifndef PRESETS_H
+#define PRESETS_H
+
+/**
+ * @brief Preset completo de L-System con ajustes visuales.
+ */
+struct LSystemPreset {
+    const char* name;         ///< Nombre a mostrar
+    const char* description;  ///< Descripcion breve
+    const char* axiom;        ///< Cadena inicial
+    const char* rules;        ///< Reglas de produccion (separadas por salto de linea)
+    float angle;              ///< Angulo de rotacion en grados
+    int generations;          ///< Numero de iteraciones
+    bool is3D;                ///< Usar modo de rotacion 3D
+    bool useCylinders;        ///< Usar renderizado de cilindros (vs lineas)
+};
+
+/// Presets incluidos, basados en "The Algorithmic Beauty of Plants"
+extern const LSystemPreset PRESETS[];
+
+/// Numero de elementos en PRESETS
+extern const int NUM_PRESETS;
+
+#endif  // PRESETS_H
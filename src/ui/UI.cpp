@@ -10,110 +10,18 @@
 
 #include "UI.h"
 
+#include <algorithm>
+#include <cstdio>
 #include <cstring>
+#include <utility>
 
 #include "Colors.h"
+#include "core/Profiler.h"
 #include "imgui_impl_glfw.h"
 #include "imgui_impl_opengl3.h"
 #include "lsystem/LSystem.h"
 #include "lsystem/TurtleGraphics.h"
 
-// =============================================================================
-// Presets de L-System - Basados en "The Algorithmic Beauty of Plants"
-// =============================================================================
-// Reglas probadas y verificadas del libro de Prusinkiewicz & Lindenmayer.
-// Cada preset produce resultados visualmente atractivos.
-// Incluye arboles 3D, flores, helechos, y fractales 2D clasicos.
-
-static const LSystemPreset PRESETS[] = {
-    // =========================================================================
-    // ARBOLES 3D REALISTAS - Del libro ABOP (Algorithmic Beauty of Plants)
-    // =========================================================================
-
-    // Figura 1.24(d) del libro - Arbol tipo Honda con hojas
-    {"Pino 3D", "Arbol conifero con hojas verdes", "A", "A->F[&FLL!A]/////[&FLL!A]///////[&FLL!A]",
-     22.5F, 6, true, true},
-
-    // Variacion del arbol Honda - mas denso con hojas
-    {"Abeto 3D", "Arbol conifero denso con follaje", "A", "A->F[&FLLA]////[&FLLA]////[&FLLA]",
-     25.7F, 7, true, true},
-
-    // Arbol con estructura tipo roble con muchas hojas
-    {"Roble 3D", "Arbol robusto con copa frondosa", "A", "A->F[^FLLA]//[^FLLA]//[^FLLA]//[^FLLA]",
-     30.0F, 6, true, true},
-
-    // Arbol con ramas alternadas y hojas colgantes
-    {"Sauce 3D", "Arbol con hojas caidas elegantes", "A",
-     "A->F[&F[&FLLA]//[&FLLA]]////F[&F[&FLLA]//[&FLLA]]", 22.5F, 5, true, true},
-
-    // Magnolia - arbol con flores grandes en estructura 3D
-    {"Magnolia 3D", "Arbol con flores grandes", "A", "A->FF[&FKK!A]////[&FKK!A]////[&FKK!A]", 28.0F,
-     5, true, true},
-
-    // Cerezo japones - estructura 3D ramificada con muchas flores
-    {"Cerezo 3D", "Arbol japones con flores rosadas", "A", "A->F[&FKK!A]////[&FKK!A]////[&FKK!A]",
-     30.0F, 5, true, true},
-
-    // =========================================================================
-    // PLANTAS 2D CLASICAS - Wikipedia/ABOP Examples
-    // =========================================================================
-
-    // Helecho fractal - Figura clasica del libro ABOP (Example 7 Wikipedia)
-    {"Helecho 2D", "Planta fractal clasica estilo Barnsley", "X", "X->F+[[X]-X]-F[-FX]+X,F->FF",
-     25.0F, 6, false, false},
-
-    // Arbol binario simetrico
-    {"Arbol Binario 2D", "Bifurcacion perfecta", "F", "F->FF+[+F-F-F]-[-F+F+F]", 22.5F, 4, false,
-     false},
-
-    // Arbusto denso 2D
-    {"Arbusto 2D", "Arbusto ramificado natural", "F", "F->F[+F]F[-F][F]", 20.0F, 5, false, false},
-
-    // Planta con flores 2D
-    {"Flor 2D", "Planta con flores en las puntas", "X", "X->F[+XK][-XK]FXK,F->FF", 25.7F, 5, false,
-     false},
-
-    // =========================================================================
-    // FRACTALES GEOMETRICOS 2D
-    // =========================================================================
-
-    // Curva de Koch
-    {"Curva Koch 2D", "Copo de nieve fractal", "F", "F->F+F--F+F", 60.0F, 4, false, false},
-
-    // Triangulo de Sierpinski
-    {"Sierpinski 2D", "Triangulo fractal clasico", "F-G-G", "F->F-G+F+G-F,G->GG", 120.0F, 5, false,
-     false},
-
-    // Curva del Dragon
-    {"Dragon 2D", "Curva del dragon fractal", "FX", "X->X+YF+,Y->-FX-Y", 90.0F, 12, false, false},
-
-    // Curva de Hilbert
-    {"Hilbert 2D", "Curva que llena el espacio", "X", "X->-YF+XFX+FY-,Y->+XF-YFY-FX+", 90.0F, 5,
-     false, false},
-
-    // =========================================================================
-    // ARBOLES 3D CON FLORES
-    // =========================================================================
-
-    // Manzano en flor - estructura frutal 3D con ramas y flores
-    {"Manzano 3D", "Arbol frutal con flores y hojas", "A",
-     "A->F[&FLLKK!A]////[&FLLKK!A]////[&FLLKK!A]", 25.0F, 5, true, true},
-
-    // Arbol primaveral completo
-    {"Primavera 3D", "Arbol con hojas y flores mezcladas", "A",
-     "A->F[&FLLK!A]////[&FKLL!A]////[&FLKL!A]", 25.0F, 5, true, true},
-
-    // Bonsai - arbol pequeno y artistico
-    {"Bonsai 3D", "Arbol pequeno estilo japones", "A", "A->F[&^FLL!A]//[&&FLL!A]////[&^FLL!A]",
-     35.0F, 5, true, true},
-
-    // Arbol de navidad con decoraciones
-    {"Navidad 3D", "Pino decorado con ornamentos", "A",
-     "A->F[&FKKLL!A]/////[&FLLKK!A]///////[&FKKLK!A]", 20.0F, 6, true, true},
-};
-
-static constexpr int NUM_PRESETS = sizeof(PRESETS) / sizeof(PRESETS[0]);
-
 // =============================================================================
 // Constructor / Destructor
 // =============================================================================
@@ -144,6 +52,13 @@ UI::UI(GLFWwindow* window, const char* glslVersion) {
 
     // Cargar primer preset
     loadPreset(0);
+    m_cacheDiskBytes = m_geometryCache.diskBytes();
+
+    // Bosque inicial: los tres primeros arboles 3D
+    m_forestSpecies.assign(static_cast<size_t>(NUM_PRESETS), 0);
+    for (int i = 0; i < NUM_PRESETS && i < 3; ++i) {
+        m_forestSpecies[static_cast<size_t>(i)] = PRESETS[i].is3D ? 1 : 0;
+    }
 }
 
 UI::~UI() {
@@ -167,17 +82,50 @@ void UI::endFrame() {
     ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
 }
 
+bool UI::pollSceneChanges() {
+    // El cuadro en que se suelta un boton ya no tiene item activo: ver un cuadro atras
+    const bool active = ImGui::IsAnyItemActive();
+    const bool changed = active || m_itemWasActive || m_growthPlaying;
+    m_itemWasActive = active;
+    return changed;
+}
+
 // =============================================================================
 // Ventana de Depuracion
 // =============================================================================
 
-void UI::renderDebugWindow(GLFWwindow* window) {
+// Cantidad de bytes legible para la seccion de memoria
+static void textBytes(const char* label, size_t bytes) {
+    if (bytes >= (size_t{1} << 20)) {
+        ImGui::Text("%s: %.2f MiB", label, static_cast<double>(bytes) / (1024.0 * 1024.0));
+    } else {
+        ImGui::Text("%s: %.1f KiB", label, static_cast<double>(bytes) / 1024.0);
+    }
+}
+
+// Conteos grandes con sufijo K/M/G (las predicciones llegan a miles de millones de simbolos)
+static std::string formatCount(double count) {
+    static const char* SUFFIXES[] = {"", "K", "M", "G", "T"};
+    int suffix = 0;
+    while (count >= 1000.0 && suffix < 4) {
+        count /= 1000.0;
+        suffix++;
+    }
+    char text[32];
+    std::snprintf(text, sizeof(text), suffix == 0 ? "%.0f%s" : "%.1f%s", count, SUFFIXES[suffix]);
+    return text;
+}
+
+void UI::renderDebugWindow(GLFWwindow* window, const TurtleGraphics& turtle,
+                           const LSystem& lsystem, FramePacer& pacer) {
     ImGui::Begin("Info de Depuracion");
 
     // Seccion de rendimiento
     ImGui::SeparatorText("Rendimiento");
     ImGui::Text("FPS: %.1f", m_io->Framerate);
     ImGui::Text("Frame Time: %.3f ms", 1000.0F / m_io->Framerate);
+    renderPacingSection(pacer);
+    renderProfilerSection();
 
     // Window info
     ImGui::SeparatorText("Pantalla");
@@ -192,6 +140,23 @@ void UI::renderDebugWindow(GLFWwindow* window) {
     ImGui::Text("Version: %s", glGetString(GL_VERSION));
     ImGui::Text("Renderer: %s", glGetString(GL_RENDERER));
 
+    // Geometria de la ultima generacion
+    ImGui::SeparatorText("Geometria");
+    const size_t branches = turtle.getBranchCount();
+    const size_t coalesced = turtle.getCoalescedSegmentCount();
+    ImGui::Text("Instancias de rama: %zu", branches);
+    ImGui::Text("Segmentos fusionados: %zu", coalesced);
+    if (branches > 0 && coalesced > 0) {
+        ImGui::Text("Reduccion: %.2fx",
+                    static_cast<double>(branches + coalesced) / static_cast<double>(branches));
+    }
+
+    // Memoria reservada (capacidad, no solo lo usado)
+    ImGui::SeparatorText("Memoria");
+    textBytes("Cadenas", lsystem.getStringBytes());
+    textBytes("Geometria (CPU)", turtle.getGeometryBytes());
+    textBytes("Buffers (GPU)", turtle.getGpuBytes());
+
     // Color de fondo
     ImGui::SeparatorText("Ajustes");
     ImGui::ColorEdit4("Fondo", m_backgroundColor);
@@ -199,6 +164,84 @@ void UI::renderDebugWindow(GLFWwindow* window) {
     ImGui::End();
 }
 
+void UI::renderPacingSection(FramePacer& pacer) {
+    bool onDemand = pacer.isOnDemand();
+    if (ImGui::Checkbox("Redibujar solo con cambios", &onDemand)) {
+        pacer.setOnDemand(onDemand);
+    }
+    if (ImGui::IsItemHovered()) {
+        ImGui::BeginTooltip();
+        ImGui::Text("Sin entrada, cambios de camara ni regeneraciones se reusa el ultimo");
+        ImGui::Text("cuadro de la escena y solo se dibuja la interfaz encima");
+        ImGui::EndTooltip();
+    }
+
+    int frameCap = pacer.getFrameCap();
+    if (ImGui::SliderInt("Limite FPS", &frameCap, 0, FramePacer::MAX_FRAME_CAP,
+                         frameCap == 0 ? "sin limite" : "%d")) {
+        pacer.setFrameCap(frameCap);
+    }
+
+    // Costo del cuadro contra el periodo del limite (60 Hz sin limite)
+    const double budget = pacer.getBudgetMs();
+    Profiler& profiler = Profiler::instance();
+    const std::pair<const char*, ProfileStage> frameStages[] = {{"CPU", ProfileStage::Frame},
+                                                                {"GPU", ProfileStage::GpuFrame}};
+    for (const auto& [label, stage] : frameStages) {
+        const Profiler::StageHistory history = profiler.getHistory(stage);
+        char overlay[64];
+        std::snprintf(overlay, sizeof(overlay), "%s %.2f / %.1f ms", label, history.average,
+                      budget);
+        ImGui::ProgressBar(static_cast<float>(history.average / budget), ImVec2(-1.0F, 0.0F),
+                           overlay);
+    }
+    ImGui::Text("Cuadros de escena: %zu, reusados: %zu", pacer.getSceneFrames(),
+                pacer.getCachedFrames());
+}
+
+void UI::renderProfilerSection() {
+    Profiler& profiler = Profiler::instance();
+
+    // Las etapas de CPU reciben una muestra por generacion o subida; las de GPU una por cuadro
+    for (int i = 0; i < Profiler::STAGE_COUNT; ++i) {
+        const auto stage = static_cast<ProfileStage>(i);
+        const Profiler::StageHistory history = profiler.getHistory(stage);
+        if (history.count == 0) {
+            ImGui::TextDisabled("%s: sin muestras", Profiler::stageName(stage));
+            continue;
+        }
+
+        char overlay[64];
+        std::snprintf(overlay, sizeof(overlay), "%.3f ms (prom. %.3f)", history.last,
+                      history.average);
+        ImGui::PlotLines(Profiler::stageName(stage), history.samples.data(), history.count, 0,
+                         overlay, 0.0F, std::max(history.peak, 1e-3F), ImVec2(0.0F, 36.0F));
+    }
+
+    bool tracing = profiler.isTracing();
+    if (ImGui::Checkbox("Grabar traza", &tracing)) {
+        profiler.setTracing(tracing);
+        m_traceStatus.clear();
+    }
+    if (ImGui::IsItemHovered()) {
+        ImGui::SetTooltip("Guarda cada medicion para abrirla en chrome://tracing o Perfetto");
+    }
+
+    const size_t events = profiler.getTraceEventCount();
+    if (events > 0) {
+        ImGui::SameLine();
+        ImGui::Text("%zu eventos", events);
+        if (ImGui::Button("Guardar traza")) {
+            m_traceStatus = profiler.writeChromeTrace(TRACE_FILE)
+                                ? std::string("Guardada en ") + TRACE_FILE
+                                : std::string("No se pudo escribir ") + TRACE_FILE;
+        }
+    }
+    if (!m_traceStatus.empty()) {
+        ImGui::TextUnformatted(m_traceStatus.c_str());
+    }
+}
+
 // =============================================================================
 // Ventana de Control de L-System
 // =============================================================================
@@ -247,16 +290,142 @@ void UI::renderLSystemWindow(TurtleGraphics& turtle, LSystem& lsystem,
     ImGui::InputText("##axiom", m_axiom, sizeof(m_axiom));
 
     ImGui::Text("Reglas de Produccion (formato: X->reemplazo):");
+    ImGui::SameLine();
+    ImGui::TextDisabled("(?)");
+    if (ImGui::IsItemHovered()) {
+        ImGui::BeginTooltip();
+        ImGui::Text("Estocastica: F-(0.3)->F[+F]F (pesos relativos por simbolo)");
+        ImGui::Text("Parametrica: X(l,w) : l > 0.2 -> !(w)F(l)[+X(l*0.7,w*0.7)]");
+        ImGui::Text("Con parametro: F(l) avanza l, +(a) gira a grados, !(w) fija el ancho,");
+        ImGui::Text("               L(s) y K(s) fijan el tamano de hoja y flor");
+        ImGui::EndTooltip();
+    }
     ImGui::SetNextItemWidth(-1);
     ImGui::InputTextMultiline("##rules", m_rules, sizeof(m_rules), ImVec2(-1, 100));
 
+    // Errores de sintaxis del ultimo arbol generado: esas reglas se descartaron
+    const ImVec4 errorColor(1.0F, 0.35F, 0.35F, 1.0F);
+    if (!lsystem.getAxiomError().empty()) {
+        ImGui::TextColored(errorColor, "Axioma: %s", lsystem.getAxiomError().c_str());
+    }
+    for (const std::string& error : lsystem.getRuleErrors()) {
+        ImGui::PushStyleColor(ImGuiCol_Text, errorColor);
+        ImGui::TextWrapped("%s", error.c_str());
+        ImGui::PopStyleColor();
+    }
+
     ImGui::SliderFloat("Angulo", &m_angle, 1.0F, 120.0F, "%.1f grados");
-    ImGui::SliderInt("Generaciones", &m_generations, 1, 10);
+    ImGui::SliderInt("Generaciones", &m_generations, 1, MAX_GENERATIONS);
+
+    // Prevision del tamano con la matriz de crecimiento, antes de generar nada
+    const std::vector<GrowthPrediction>& growth = getGrowthPrediction();
+    const GrowthPrediction& predicted =
+        growth[static_cast<size_t>(std::clamp(m_generations, 0, MAX_GENERATIONS))];
+    const bool materialized = m_expansionMode == EXPANSION_STRING;
+    const double predictedBytes =
+        estimateMemory(turtle, m_generations, materialized, turtle.getCompactInstances());
+    ImGui::TextDisabled("Prevision%s: %s simbolos, %s ramas, %.1f MiB",
+                        predicted.exact ? "" : " (aprox.)", formatCount(predicted.symbols).c_str(),
+                        formatCount(predicted.branches).c_str(), predictedBytes / 1048576.0);
+    if (ImGui::IsItemHovered()) {
+        ImGui::BeginTooltip();
+        ImGui::Text("Gen  Simbolos  Ramas  Decoraciones  Memoria");
+        for (int g = 1; g <= MAX_GENERATIONS; ++g) {
+            const GrowthPrediction& row = growth[static_cast<size_t>(g)];
+            ImGui::Text("%3d  %8s  %5s  %12s  %.1f MiB", g, formatCount(row.symbols).c_str(),
+                        formatCount(row.branches).c_str(),
+                        formatCount(row.leaves + row.flowers).c_str(),
+                        estimateMemory(turtle, g, materialized, turtle.getCompactInstances()) /
+                            1048576.0);
+        }
+        if (!predicted.exact) {
+            ImGui::Text("Estocasticas: valor esperado; con condiciones: cota superior");
+        }
+        ImGui::Text("Memoria: cadenas (cadena completa), geometria en CPU e instancias en GPU");
+        ImGui::EndTooltip();
+    }
+
+    ImGui::InputInt("Semilla", &m_seed);
+    if (ImGui::IsItemHovered()) {
+        ImGui::SetTooltip("Reglas estocasticas: la misma semilla repite el mismo arbol");
+    }
+
+    ImGui::SetNextItemWidth(ImGui::GetContentRegionAvail().x * 0.35F);
+    ImGui::InputInt("MiB", &m_memoryBudgetMb, 256, 1024);
+    m_memoryBudgetMb = std::max(m_memoryBudgetMb, 64);
+    ImGui::SameLine();
+    static const char* BUDGET_POLICIES[] = {"Rechazar", "Adaptar"};
+    ImGui::SetNextItemWidth(-1);
+    ImGui::Combo("##presupuesto", &m_budgetPolicy, BUDGET_POLICIES,
+                 IM_ARRAYSIZE(BUDGET_POLICIES));
+    if (ImGui::IsItemHovered()) {
+        ImGui::BeginTooltip();
+        ImGui::Text("Presupuesto de memoria de un arbol, segun la prevision");
+        ImGui::Text("Rechazar: no genera si no cabe");
+        ImGui::Text("Adaptar: pasa a streaming y luego a instancias compactas");
+        ImGui::EndTooltip();
+    }
+    if (predictedBytes > static_cast<double>(m_memoryBudgetMb) * 1048576.0) {
+        ImGui::TextColored(ImVec4(1.0F, 0.6F, 0.0F, 1.0F),
+                           "Advertencia: supera el presupuesto de memoria!");
+    }
 
-    if (m_generations > 7) {
-        ImGui::TextColored(ImVec4(1.0F, 0.6F, 0.0F, 1.0F), "Advertencia: Puede ser lento!");
+    ImGui::Checkbox("Reescritura paralela", &m_parallelRewrite);
+    if (ImGui::IsItemHovered()) {
+        ImGui::SetTooltip("Reparte la reescritura de cadenas grandes entre todos los nucleos");
     }
 
+    static const char* EXPANSION_MODES[] = {"Cadena completa", "Streaming",
+                                             "Cache de subarboles (3D)"};
+    ImGui::Combo("Expansion", &m_expansionMode, EXPANSION_MODES, IM_ARRAYSIZE(EXPANSION_MODES));
+    if (ImGui::IsItemHovered()) {
+        ImGui::BeginTooltip();
+        ImGui::Text("Cadena completa: genera la cadena y la interpreta");
+        ImGui::Text("Streaming: alimenta la tortuga desde la derivacion, sin guardar la cadena");
+        ImGui::Text("           y registra cuando nace cada rama (animacion de crecimiento)");
+        ImGui::Text("Cache de subarboles: reutiliza la geometria de expansiones repetidas");
+        ImGui::EndTooltip();
+    }
+
+    static const char* PACKINGS[] = {"1 byte por simbolo", "4 bits", "4 bits + rachas"};
+    ImGui::Combo("Cadena", &m_stringPacking, PACKINGS, IM_ARRAYSIZE(PACKINGS));
+    if (ImGui::IsItemHovered()) {
+        ImGui::BeginTooltip();
+        ImGui::Text("Representacion de la cadena completa (reescritura e interpretacion)");
+        ImGui::Text("4 bits: medio byte por simbolo, hasta 15 simbolos distintos");
+        ImGui::Text("Rachas: 4 o mas simbolos iguales seguidos ocupan unos pocos codigos");
+        ImGui::Text("Reglas estocasticas o parametricas: siempre 1 byte por simbolo");
+        ImGui::EndTooltip();
+    }
+
+    bool coalesce = turtle.getCoalesceSegments();
+    if (ImGui::Checkbox("Fusionar segmentos colineales", &coalesce)) {
+        turtle.setCoalesceSegments(coalesce);
+    }
+    if (ImGui::IsItemHovered()) {
+        ImGui::SetTooltip("Une avances consecutivos sin giro (p. ej. FF) en una sola rama");
+    }
+
+    bool parallelInterpretation = turtle.getParallelInterpretation();
+    if (ImGui::Checkbox("Interpretacion paralela", &parallelInterpretation)) {
+        turtle.setParallelInterpretation(parallelInterpretation);
+    }
+    if (ImGui::IsItemHovered()) {
+        ImGui::SetTooltip("Reparte los subarboles [...] de primer nivel entre hilos (cadena completa)");
+    }
+
+    ImGui::Checkbox("Cache de geometria en disco", &m_useGeometryCache);
+    if (ImGui::IsItemHovered()) {
+        ImGui::SetTooltip("Guarda cada arbol interpretado en %s/ y lo carga sin regenerarlo",
+                          m_geometryCache.getDirectory().c_str());
+    }
+    ImGui::SameLine();
+    if (ImGui::SmallButton("Vaciar")) {
+        m_geometryCache.clear();
+        m_cacheDiskBytes = m_geometryCache.diskBytes();
+    }
+    ImGui::TextDisabled("En disco: %.2f MB", static_cast<double>(m_cacheDiskBytes) / 1048576.0);
+
     // -------------------------------------------------------------------------
     // Modo de Renderizado
     // -------------------------------------------------------------------------
@@ -286,46 +455,123 @@ void UI::renderLSystemWindow(TurtleGraphics& turtle, LSystem& lsystem,
         ImGui::EndTooltip();
     }
 
+    bool compact = turtle.getCompactInstances();
+    if (ImGui::Checkbox("Instancias compactas", &compact)) {
+        turtle.setCompactInstances(compact);
+    }
+    ImGui::SameLine();
+    ImGui::TextDisabled("(?)");
+    if (ImGui::IsItemHovered()) {
+        ImGui::BeginTooltip();
+        ImGui::Text("Rama: 20 bytes (vs 44), decoracion: 24 bytes (vs 92)");
+        ImGui::Text("Posiciones de 16 bits en la caja envolvente, radios half-float");
+        ImGui::EndTooltip();
+    }
+
+    if (turtle.isGpuCullingAvailable()) {
+        bool culling = turtle.getGpuCulling();
+        if (ImGui::Checkbox("Culling en GPU", &culling)) {
+            turtle.setGpuCulling(culling);
+        }
+        ImGui::SameLine();
+        ImGui::TextDisabled("(?)");
+        if (ImGui::IsItemHovered()) {
+            ImGui::BeginTooltip();
+            ImGui::Text("Descarta ramas fuera de camara y elige 3/6/8/16 segmentos");
+            ImGui::Text("segun su tamano en pantalla; menos de un pixel: lineas");
+            ImGui::EndTooltip();
+        }
+    }
+
+    if (turtle.isCpuCullingAvailable()) {
+        bool hierarchy = turtle.getCpuCulling();
+        if (ImGui::Checkbox("Culling por subarboles", &hierarchy)) {
+            turtle.setCpuCulling(hierarchy);
+        }
+        ImGui::SameLine();
+        ImGui::TextDisabled("(?)");
+        if (ImGui::IsItemHovered()) {
+            ImGui::BeginTooltip();
+            ImGui::Text("Descarta en CPU cada subarbol [...] fuera de camara con su caja");
+            ImGui::Text("envolvente y dibuja solo los rangos de instancias visibles");
+            ImGui::EndTooltip();
+        }
+    }
+
+    if (m_useCylinders) {
+        bool joints = turtle.getJointSpheres();
+        if (ImGui::Checkbox("Uniones", &joints)) {
+            turtle.setJointSpheres(joints);
+        }
+        ImGui::SameLine();
+        bool caps = turtle.getCylinderCaps();
+        if (ImGui::Checkbox("Tapas", &caps)) {
+            turtle.setCylinderCaps(caps);
+        }
+        ImGui::SameLine();
+        ImGui::TextDisabled("(?)");
+        if (ImGui::IsItemHovered()) {
+            ImGui::BeginTooltip();
+            ImGui::Text("Uniones: esfera al final de cada rama, cubre los huecos");
+            ImGui::Text("entre segmentos sin subir el numero de lados del cilindro");
+            ImGui::Text("Tapas: cierra los extremos de cada cilindro");
+            ImGui::EndTooltip();
+        }
+    }
+
     // -------------------------------------------------------------------------
     // Boton de Generar
     // -------------------------------------------------------------------------
     ImGui::Spacing();
+    ImGui::BeginDisabled(m_worker.isRunning());
     if (ImGui::Button("Generar", ImVec2(-1, 35))) {
-        // Parsear y aplicar reglas de L-System
-        lsystem.setAxiom(m_axiom);
-        lsystem.clearRules();
-
-        std::string rulesStr(m_rules);
-        size_t pos = 0;
-        while (pos < rulesStr.size()) {
-            // Buscar fin de linea (soporta \n y , como separadores)
-            size_t lineEndNewline = rulesStr.find('\n', pos);
-            size_t lineEndComma = rulesStr.find(',', pos);
-            size_t lineEnd = std::min(lineEndNewline, lineEndComma);
-            if (lineEnd == std::string::npos) {
-                lineEnd = rulesStr.size();
-            }
-
-            std::string line = rulesStr.substr(pos, lineEnd - pos);
-            pos = lineEnd + 1;
-
-            // Remover espacios al inicio y final
-            size_t start = line.find_first_not_of(" \t");
-            if (start != std::string::npos) {
-                line = line.substr(start);
-            }
+        // La reescritura y la geometria se construyen en el hilo de trabajo
+        GenerationRequest request;
+        request.axiom = m_axiom;
+        request.rules = m_rules;
+        request.angle = m_angle;
+        request.generations = m_generations;
+        request.seed = static_cast<uint64_t>(static_cast<uint32_t>(m_seed));
+        request.mode = static_cast<ExpansionMode>(m_expansionMode);
+        request.parallelRewrite = m_parallelRewrite;
+        request.packing = static_cast<SymbolPacking>(m_stringPacking);
+        request.base = &lsystem;
+        request.cache = m_useGeometryCache ? &m_geometryCache : nullptr;
+        if (applyMemoryBudget(request, turtle)) {
+            m_lastRequest = request;
+            m_worker.start(request, turtle);
+        }
+    }
+    ImGui::EndDisabled();
+    if (!m_budgetStatus.empty()) {
+        ImGui::TextWrapped("%s", m_budgetStatus.c_str());
+    }
 
-            size_t arrowPos = line.find("->");
-            if (arrowPos != std::string::npos && arrowPos > 0) {
-                char symbol = line[0];
-                std::string replacement = line.substr(arrowPos + 2);
-                lsystem.addRule(symbol, replacement);
-            }
+    if (m_worker.isRunning()) {
+        // Progreso negativo: barra indeterminada (flujo y memoizacion no conocen el total)
+        float progress = m_worker.getProgress();
+        float buttonWidth = 90.0F;
+        ImGui::ProgressBar(progress < 0.0F ? -1.0F * static_cast<float>(ImGui::GetTime()) : progress,
+                           ImVec2(-buttonWidth - ImGui::GetStyle().ItemSpacing.x, 0),
+                           progress < 0.0F ? "Generando..." : nullptr);
+        ImGui::SameLine();
+        if (ImGui::Button("Cancelar", ImVec2(-1, 0))) {
+            m_worker.cancel();
         }
+    }
 
-        lsystem.setAngle(m_angle);
-        lsystem.generate(m_generations);
-        turtle.interpret(lsystem.getString(), m_angle);
+    // Solo la subida a GPU ocurre en este hilo, una vez terminado el trabajo
+    if (m_worker.collect(lsystem, turtle)) {
+        m_lastExpansionMode = static_cast<int>(m_worker.getMode());
+        m_streamedLength = m_worker.getStreamedLength();
+        m_treeFromCache = m_worker.wasCacheHit();
+        m_cachedLength = m_worker.getCachedLength();
+        m_cacheDiskBytes = m_geometryCache.diskBytes();
+
+        // Un arbol nuevo empieza completamente crecido
+        m_growthTime = turtle.getGrowthDuration();
+        m_growthPlaying = false;
+        turtle.setGrowthTime(m_growthTime > 0.0F ? m_growthTime : TurtleGraphics::GROWTH_COMPLETE);
 
         if (onGenerate) {
             onGenerate();
@@ -337,6 +583,7 @@ void UI::renderLSystemWindow(TurtleGraphics& turtle, LSystem& lsystem,
     // -------------------------------------------------------------------------
     ImGui::SeparatorText("Apariencia");
 
+    // Largo, ancho, tamano de hoja y colores son uniforms: cambian sin reconstruir
     float stepSize = turtle.getStepSize();
     if (ImGui::SliderFloat("Largo de Rama", &stepSize, 0.01F, 0.3F)) {
         turtle.setStepSize(stepSize);
@@ -351,6 +598,10 @@ void UI::renderLSystemWindow(TurtleGraphics& turtle, LSystem& lsystem,
     if (ImGui::SliderFloat("Decaimiento de Ancho", &decay, 0.5F, 1.0F)) {
         turtle.setWidthDecay(decay);
     }
+    // El decaimiento queda en la geometria: se reinterpreta al soltar el control
+    if (ImGui::IsItemDeactivatedAfterEdit()) {
+        reinterpret(turtle, lsystem);
+    }
 
     float leafSize = turtle.getLeafSize();
     if (ImGui::SliderFloat("Tamano de Hoja", &leafSize, 0.01F, 0.2F)) {
@@ -398,14 +649,167 @@ void UI::renderLSystemWindow(TurtleGraphics& turtle, LSystem& lsystem,
     if (ImGui::IsItemHovered()) {
         ImGui::SetTooltip("Muestra un piso verde con sombra suave");
     }
+    if (showFloor) {
+        ImGui::SameLine();
+        bool shadows = turtle.getShadows();
+        if (ImGui::Checkbox("Sombras", &shadows)) {
+            turtle.setShadows(shadows);
+        }
+        if (ImGui::IsItemHovered()) {
+            ImGui::SetTooltip("Mapa de sombras desde la luz; se redibuja solo al cambiar "
+                              "la planta o la luz");
+        }
+    }
 
     // -------------------------------------------------------------------------
     // Estadisticas
+    // -------------------------------------------------------------------------
+    // Animacion de crecimiento: un uniform por cuadro sobre la geometria subida
+    // -------------------------------------------------------------------------
+    ImGui::SeparatorText("Crecimiento");
+    const float growthDuration = turtle.getGrowthDuration();
+    if (growthDuration <= 0.0F) {
+        ImGui::TextDisabled("Genera con expansion \"Streaming\" para animarlo");
+    } else {
+        if (ImGui::Button(m_growthPlaying ? "Pausar" : "Reproducir", ImVec2(90.0F, 0))) {
+            if (!m_growthPlaying && m_growthTime >= growthDuration) {
+                m_growthTime = 0.0F;
+            }
+            m_growthPlaying = !m_growthPlaying;
+        }
+        ImGui::SameLine();
+        if (ImGui::SliderFloat("Tiempo", &m_growthTime, 0.0F, growthDuration, "%.2f gen")) {
+            m_growthPlaying = false;
+        }
+
+        if (m_growthPlaying) {
+            m_growthTime += ImGui::GetIO().DeltaTime * GROWTH_SPEED;
+            if (m_growthTime >= growthDuration) {
+                m_growthTime = growthDuration;
+                m_growthPlaying = false;
+            }
+        }
+        turtle.setGrowthTime(m_growthTime);
+    }
+
     // -------------------------------------------------------------------------
     ImGui::SeparatorText("Estadisticas");
-    ImGui::Text("Longitud de Cadena: %zu", lsystem.getString().size());
+    if (m_treeFromCache) {
+        ImGui::Text("Longitud de Cadena: %zu (cache en disco)", m_cachedLength);
+    } else if (m_lastExpansionMode == EXPANSION_MEMOIZED) {
+        ImGui::Text("Longitud de Cadena: (no materializada)");
+        ImGui::Text("Subarboles en Cache: %zu (%zu reutilizados)", turtle.getSubtreeCacheSize(),
+                    turtle.getSubtreeCacheHits());
+    } else {
+        ImGui::Text("Longitud de Cadena: %zu", m_lastExpansionMode == EXPANSION_STREAMING
+                                                   ? m_streamedLength
+                                                   : lsystem.getLength());
+    }
+    if (lsystem.isPacked() && !lsystem.getPackedString().empty()) {
+        const PackedString& packed = lsystem.getPackedString();
+        ImGui::Text("Empaquetada: %.2f bits por simbolo",
+                    4.0 * static_cast<double>(packed.getNibbleCount()) /
+                        static_cast<double>(packed.size()));
+    } else if (m_lastRequest.packing != SymbolPacking::None && !m_treeFromCache &&
+               m_lastExpansionMode == EXPANSION_STRING) {
+        ImGui::TextDisabled("Sin empaquetar: reglas extendidas o mas de 15 simbolos");
+    }
     ImGui::Text("Ramas: %zu", turtle.getBranchCount());
     ImGui::Text("Decoraciones: %zu", turtle.getDecorationCount());
+    if (m_useCylinders && turtle.getGpuCulling() && turtle.isGpuCullingAvailable()) {
+        ImGui::Text("Visibles (3/6/8/16 seg, lineas): %zu / %zu / %zu / %zu, %zu",
+                    turtle.getVisibleBranchCount(0), turtle.getVisibleBranchCount(1),
+                    turtle.getVisibleBranchCount(2), turtle.getVisibleBranchCount(3),
+                    turtle.getVisibleBranchCount(BranchCuller::LINE_BUCKET));
+    }
+    const BranchHierarchy::VisibleRanges& visible = turtle.getVisibleRanges();
+    if (visible.visitedNodes > 0) {
+        ImGui::Text("Jerarquia: %zu nodos, %zu visitados, %zu descartados",
+                    turtle.getHierarchy().getNodeCount(), visible.visitedNodes,
+                    visible.culledNodes);
+        ImGui::Text("Rangos (ramas/hojas/flores): %zu / %zu / %zu", visible.branches.size(),
+                    visible.leaves.size(), visible.flowers.size());
+    }
+    if (turtle.getShadows() && turtle.getShadowMapUpdates() > 0) {
+        ImGui::Text("Mapa de sombras: %zu actualizaciones", turtle.getShadowMapUpdates());
+    }
+
+    const int64_t selected = turtle.getHighlightedBranch();
+    if (selected >= 0) {
+        const BranchData& branch = turtle.getBranches()[static_cast<size_t>(selected)];
+        ImGui::Text("Rama #%lld: largo %.3f, radio %.4f", static_cast<long long>(selected),
+                    glm::length(branch.end - branch.start) * turtle.getStepSize(),
+                    branch.radiusStart * turtle.getInitialWidth());
+    } else if (turtle.isCpuCullingAvailable()) {
+        ImGui::TextDisabled("Clic derecho sobre una rama para seleccionarla");
+    }
+
+    ImGui::End();
+}
+
+// =============================================================================
+// Ventana del Bosque
+// =============================================================================
+
+void UI::renderForestWindow(Forest& forest, const TurtleGraphics& turtle) {
+    ImGui::Begin("Bosque", nullptr, ImGuiWindowFlags_AlwaysAutoResize);
+
+    ImGui::SeparatorText("Especies");
+    for (int i = 0; i < NUM_PRESETS; ++i) {
+        bool selected = m_forestSpecies[static_cast<size_t>(i)] != 0;
+        if (ImGui::Checkbox(PRESETS[i].name, &selected)) {
+            m_forestSpecies[static_cast<size_t>(i)] = selected ? 1 : 0;
+        }
+        if (i % 2 == 0 && i + 1 < NUM_PRESETS) {
+            ImGui::SameLine(200.0F);
+        }
+    }
+
+    ImGui::SeparatorText("Distribucion");
+    ImGui::SliderInt("Arboles", &m_forestLayout.treeCount, 1, 20000, "%d",
+                     ImGuiSliderFlags_Logarithmic);
+    ImGui::SliderInt("Generaciones##bosque", &m_forestLayout.generations, 0, 8,
+                     m_forestLayout.generations == 0 ? "las del preset" : "%d");
+    ImGui::DragFloatRange2("Radio", &m_forestLayout.innerRadius, &m_forestLayout.outerRadius,
+                           0.05F, 0.0F, 40.0F, "claro %.1f", "borde %.1f");
+    ImGui::DragFloatRange2("Escala", &m_forestLayout.minScale, &m_forestLayout.maxScale, 0.01F,
+                           0.1F, 3.0F, "%.2f", "%.2f");
+    ImGui::SliderFloat("Variacion de tinte", &m_forestLayout.tintVariation, 0.0F, 0.5F);
+    ImGui::InputInt("Semilla##bosque", &m_forestSeed);
+
+    if (ImGui::Button("Plantar", ImVec2(120.0F, 0))) {
+        // Las especies nuevas se generan aqui: cada una solo la primera vez
+        std::vector<int> presets;
+        for (int i = 0; i < NUM_PRESETS; ++i) {
+            if (m_forestSpecies[static_cast<size_t>(i)] != 0) {
+                presets.push_back(i);
+            }
+        }
+        m_forestLayout.seed = static_cast<uint64_t>(static_cast<uint32_t>(m_forestSeed));
+        forest.plant(presets, m_forestLayout, turtle);
+    }
+    ImGui::SameLine();
+    if (ImGui::Button("Talar", ImVec2(120.0F, 0))) {
+        forest.clear();
+    }
+    ImGui::SameLine();
+    ImGui::TextDisabled("(?)");
+    if (ImGui::IsItemHovered()) {
+        ImGui::BeginTooltip();
+        ImGui::Text("Cada especie (preset, generaciones, decaimiento de ancho, fusion de");
+        ImGui::Text("segmentos y rotaciones rapidas) se genera una vez y queda en cache;");
+        ImGui::Text("todos sus arboles comparten sus buffers y se dibujan en una sola llamada");
+        ImGui::Text("instanciada por malla. Largo, anchos y colores son los de la planta");
+        ImGui::Text("principal; los ajustes de la clave se aplican al volver a plantar.");
+        ImGui::EndTooltip();
+    }
+
+    ImGui::SeparatorText("Estadisticas");
+    ImGui::Text("Arboles: %zu (%zu especies en cache)", forest.getTreeCount(),
+                forest.getSpeciesCount());
+    ImGui::Text("Instancias por cuadro: %zu", forest.getInstanceCount());
+    ImGui::Text("Memoria GPU: %.2f MB",
+                static_cast<double>(forest.getGpuBytes()) / (1024.0 * 1024.0));
 
     ImGui::End();
 }
@@ -418,7 +822,7 @@ void UI::renderCameraWindow(float& distance, float& angleX, float& angleY) {
     ImGui::Begin("Camara", nullptr, ImGuiWindowFlags_AlwaysAutoResize);
 
     ImGui::SeparatorText("Camara Orbital");
-    ImGui::SliderFloat("Distancia", &distance, 0.5F, 10.0F);
+    ImGui::SliderFloat("Distancia", &distance, 0.5F, 30.0F);
     ImGui::SliderFloat("Horizontal", &angleX, -180.0F, 180.0F);
     ImGui::SliderFloat("Vertical", &angleY, -89.0F, 89.0F);
 
@@ -456,6 +860,109 @@ void UI::loadPreset(int index) {
     m_useCylinders = preset.useCylinders;
 }
 
+void UI::reinterpret(const TurtleGraphics& turtle, const LSystem& lsystem) {
+    // Un trabajo en curso copio los ajustes viejos; los arboles memoizados, en flujo o en cache
+    // no tienen cadena que reinterpretar
+    if (m_worker.isRunning() || m_lastExpansionMode != EXPANSION_STRING || m_treeFromCache) {
+        m_worker.start(m_lastRequest, turtle);
+        return;
+    }
+
+    // El LSystem visible solo cambia en collect(), asi que el worker puede leerlo
+    GenerationRequest request;
+    request.angle = lsystem.getAngle();
+    request.derived = &lsystem;
+    m_lastRequest = request;
+    m_worker.start(request, turtle);
+}
+
+void UI::setCachedTree(const GenerationRequest& request, size_t stringLength) {
+    m_lastRequest = request;
+    m_lastRequest.cache = &m_geometryCache;
+    m_lastExpansionMode = static_cast<int>(request.mode);
+    m_treeFromCache = true;
+    m_cachedLength = stringLength;
+}
+
+const std::vector<GrowthPrediction>& UI::getGrowthPrediction() {
+    if (m_growth.empty() || m_growthAxiom != m_axiom || m_growthRules != m_rules) {
+        LSystem predictor;
+        predictor.setAxiom(m_axiom);
+        predictor.addRulesFromString(m_rules);
+        m_growth = predictor.predictGrowth(MAX_GENERATIONS);
+        m_growthExtended = predictor.isExtended();
+        m_growthAxiom = m_axiom;
+        m_growthRules = m_rules;
+    }
+    return m_growth;
+}
+
+double UI::estimateMemory(const TurtleGraphics& turtle, int generations, bool materialized,
+                          bool compact) {
+    const std::vector<GrowthPrediction>& growth = getGrowthPrediction();
+    const int generation = std::clamp(generations, 0, MAX_GENERATIONS);
+    const GrowthPrediction& target = growth[static_cast<size_t>(generation)];
+
+    double bytes = 0.0;
+    if (materialized) {
+        // La reescritura lee la generacion anterior mientras escribe la nueva
+        const GrowthPrediction& previous = growth[static_cast<size_t>(std::max(generation - 1, 0))];
+        double strings = target.stringBytes() + previous.stringBytes();
+        if (m_stringPacking != 0 && !m_growthExtended) {
+            strings *= 0.5;  // 4 bits por simbolo; las rachas solo lo reducen
+        }
+        bytes += strings;
+    }
+
+    double cpuBytes = 0.0;
+    double gpuBytes = 0.0;
+    turtle.estimateGeometryBytes(target.branches, target.leaves + target.flowers, compact, cpuBytes,
+                                 gpuBytes);
+    return bytes + cpuBytes + gpuBytes;
+}
+
+bool UI::applyMemoryBudget(GenerationRequest& request, TurtleGraphics& turtle) {
+    m_budgetStatus.clear();
+    const double budget = static_cast<double>(m_memoryBudgetMb) * 1048576.0;
+    bool materialized = request.mode == ExpansionMode::String;
+    bool compact = turtle.getCompactInstances();
+    double bytes = estimateMemory(turtle, request.generations, materialized, compact);
+    if (bytes <= budget)
+        return true;
+
+    char text[160];
+    if (m_budgetPolicy == BUDGET_ADAPT) {
+        // Lo mas barato primero: descartar la cadena, luego reducir las instancias
+        std::string changes;
+        if (materialized) {
+            materialized = false;
+            changes = "streaming";
+            bytes = estimateMemory(turtle, request.generations, materialized, compact);
+        }
+        if (bytes > budget && !compact) {
+            compact = true;
+            changes += changes.empty() ? "instancias compactas" : " e instancias compactas";
+            bytes = estimateMemory(turtle, request.generations, materialized, compact);
+        }
+        if (bytes <= budget) {
+            if (request.mode == ExpansionMode::String) {
+                request.mode = ExpansionMode::Streaming;
+                m_expansionMode = EXPANSION_STREAMING;
+            }
+            turtle.setCompactInstances(compact);
+            std::snprintf(text, sizeof(text), "Presupuesto: se uso %s (%.1f MiB previstos)",
+                          changes.c_str(), bytes / 1048576.0);
+            m_budgetStatus = text;
+            return true;
+        }
+    }
+
+    std::snprintf(text, sizeof(text), "Rechazado: se preven %.1f MiB y el presupuesto es de %d MiB",
+                  bytes / 1048576.0, m_memoryBudgetMb);
+    m_budgetStatus = text;
+    return false;
+}
+
 void UI::applyPresetVisuals(TurtleGraphics& turtle, const LSystemPreset& preset) {
     turtle.set3DMode(preset.is3D);
     turtle.setRenderMode(preset.useCylinders ? RenderMode::Cylinders : RenderMode::Lines);
@@ -24,24 +24,12 @@
 #include <functional>
 #include <glm/glm.hpp>
 #include <string>
+#include <vector>
 
-// Forward declarations
-class TurtleGraphics;
-class LSystem;
-
-/**
- * @brief Preset completo de L-System con ajustes visuales.
- */
-struct LSystemPreset {
-    const char* name;         ///< Nombre a mostrar
-    const char* description;  ///< Descripcion breve
-    const char* axiom;        ///< Cadena inicial
-    const char* rules;        ///< Reglas de produccion (separadas por salto de linea)
-    float angle;              ///< Angulo de rotacion en grados
-    int generations;          ///< Numero de iteraciones
-    bool is3D;                ///< Usar modo de rotacion 3D
-    bool useCylinders;        ///< Usar renderizado de cilindros (vs lineas)
-};
+#include "Presets.h"
+#include "core/FramePacer.h"
+#include "lsystem/GenerationWorker.h"
+#include "scene/Forest.h"
 
 /**
  * @class UI
@@ -78,8 +66,12 @@ public:
     /**
      * @brief Renderiza la ventana de informacion de depuracion.
      * @param window Ventana GLFW para consultas de framebuffer.
+     * @param turtle Renderizador del que se muestran estadisticas de geometria.
+     * @param lsystem Generador del que se muestra la memoria de las cadenas.
+     * @param pacer Ajustes de redibujo y limite de FPS, y presupuesto del cuadro.
      */
-    void renderDebugWindow(GLFWwindow* window);
+    void renderDebugWindow(GLFWwindow* window, const TurtleGraphics& turtle,
+                           const LSystem& lsystem, FramePacer& pacer);
 
     /**
      * @brief Renderiza la ventana de control de L-System.
@@ -90,11 +82,34 @@ public:
     void renderLSystemWindow(TurtleGraphics& turtle, LSystem& lsystem,
                              const std::function<void()>& onGenerate);
 
+    /**
+     * @brief Renderiza la ventana del bosque (especies, distribucion y estadisticas).
+     * @param forest Bosque que se planta con los ajustes de la ventana.
+     * @param turtle Tortuga principal: sus ajustes de interpretacion pasan a las especies.
+     */
+    void renderForestWindow(Forest& forest, const TurtleGraphics& turtle);
+
     /**
      * @brief Renderiza la ventana de controles de camara.
      */
     void renderCameraWindow(float& distance, float& angleX, float& angleY);
 
+    /**
+     * @brief Indica si la interfaz pudo cambiar la escena en este cuadro.
+     *
+     * Cuenta un control en uso o recien soltado (los botones y casillas actuan al
+     * soltarse) y la animacion de crecimiento. Llamar una vez por cuadro, despues
+     * de las ventanas.
+     */
+    bool pollSceneChanges();
+
+    /**
+     * @brief Hay trabajo que avanza sin entrada: generacion en curso o animacion.
+     */
+    bool isBusy() const {
+        return m_worker.isRunning() || m_growthPlaying;
+    }
+
     /**
      * @brief Obtiene el color de fondo actual.
      * @return Puntero a arreglo de floats RGBA.
@@ -124,19 +139,110 @@ public:
         return m_generations;
     }
 
+    /**
+     * @brief Registra que el arbol visible se cargo del cache de geometria.
+     *
+     * El LSystem visible queda sin derivacion, asi que reinterpret() relanza
+     * 'request' en lugar de reinterpretar la cadena.
+     * @param stringLength Longitud de cadena guardada con la geometria.
+     */
+    void setCachedTree(const GenerationRequest& request, size_t stringLength);
+
 private:
     void loadPreset(int index);
     void applyPresetVisuals(TurtleGraphics& turtle, const LSystemPreset& preset);
 
+    /**
+     * @brief Reconstruye la geometria con los parametros actuales de la tortuga.
+     *
+     * Con una cadena ya generada solo se reinterpreta; si hay un trabajo en curso o
+     * el arbol no tiene cadena materializada, se relanza el ultimo trabajo.
+     */
+    void reinterpret(const TurtleGraphics& turtle, const LSystem& lsystem);
+
+    /**
+     * @brief Ajustes de FramePacer y costo del cuadro contra su presupuesto.
+     */
+    void renderPacingSection(FramePacer& pacer);
+
+    /**
+     * @brief Graficas de tiempo por etapa (Profiler) y grabacion de trazas.
+     */
+    void renderProfilerSection();
+
+    /**
+     * @brief Prevision de las generaciones 0..MAX_GENERATIONS del axioma y las reglas
+     *        editados (LSystem::predictGrowth()); se recalcula solo cuando cambian.
+     */
+    const std::vector<GrowthPrediction>& getGrowthPrediction();
+
+    /**
+     * @brief Memoria estimada de un arbol: cadenas (si se materializan) y geometria.
+     * @param materialized Modo Cadena completa: la generacion anterior y la nueva
+     *        conviven durante la reescritura.
+     * @param compact Instancias compactas en GPU.
+     */
+    double estimateMemory(const TurtleGraphics& turtle, int generations, bool materialized,
+                          bool compact);
+
+    /**
+     * @brief Aplica el presupuesto de memoria a un trabajo antes de lanzarlo.
+     * @return false si se rechaza. Con BUDGET_ADAPT puede pasar el trabajo a
+     *         streaming y la tortuga a instancias compactas.
+     */
+    bool applyMemoryBudget(GenerationRequest& request, TurtleGraphics& turtle);
+
     ImGuiIO* m_io{nullptr};
+    bool m_itemWasActive{false};  ///< Algun control activo en el cuadro anterior
     float m_backgroundColor[4]{0.08F, 0.09F, 0.11F, 1.0F};
+    std::string m_traceStatus;  ///< Resultado del ultimo guardado de traza
+    static constexpr const char* TRACE_FILE = "arboles_trace.json";
 
     // L-System parameters
     char m_axiom[256]{};
     char m_rules[2048]{};
     float m_angle{25.0F};
     int m_generations{4};
+    static constexpr int MAX_GENERATIONS = 10;
+    int m_seed{1};  ///< Semilla de las reglas estocasticas
     int m_currentPreset{0};
+    bool m_parallelRewrite{true};
+    int m_expansionMode{0};      ///< EXPANSION_STRING, EXPANSION_STREAMING o EXPANSION_MEMOIZED
+    int m_stringPacking{0};      ///< SymbolPacking de la cadena completa
+    int m_lastExpansionMode{0};  ///< Modo usado en la ultima generacion
+    size_t m_streamedLength{0};  ///< Simbolos entregados por el ultimo flujo
+    GenerationWorker m_worker;   ///< Genera e interpreta fuera del bucle de render
+    GenerationRequest m_lastRequest;  ///< Ultimo trabajo lanzado (ver reinterpret())
+    GeometryCache m_geometryCache;    ///< Geometria interpretada en disco
+    bool m_useGeometryCache{true};
+    bool m_treeFromCache{false};  ///< El arbol visible se cargo del cache
+    size_t m_cachedLength{0};     ///< Longitud de cadena guardada con ese arbol
+    size_t m_cacheDiskBytes{0};   ///< Se recalcula al recoger un trabajo o vaciar el cache
+
+    static constexpr int EXPANSION_STRING = 0;
+    static constexpr int EXPANSION_STREAMING = 1;
+    static constexpr int EXPANSION_MEMOIZED = 2;
+
+    // Limites de memoria
+    std::vector<GrowthPrediction> m_growth;
+    std::string m_growthAxiom;  ///< Axioma y reglas con que se calculo m_growth
+    std::string m_growthRules;
+    bool m_growthExtended{false};  ///< Reglas estocasticas o parametricas: sin empaquetar
+    int m_memoryBudgetMb{2048};
+    int m_budgetPolicy{1};        ///< BUDGET_REFUSE o BUDGET_ADAPT
+    std::string m_budgetStatus;   ///< Ultima decision del presupuesto (vacio: cupo)
+    static constexpr int BUDGET_REFUSE = 0;
+    static constexpr int BUDGET_ADAPT = 1;
+
+    // Animacion de crecimiento (arboles construidos por el flujo de simbolos)
+    float m_growthTime{0.0F};  ///< Instante mostrado, en generaciones
+    bool m_growthPlaying{false};
+    static constexpr float GROWTH_SPEED = 1.0F;  ///< Generaciones por segundo
+
+    // Bosque
+    std::vector<char> m_forestSpecies;  ///< Preset elegido como especie (uno por PRESETS)
+    ForestLayout m_forestLayout;
+    int m_forestSeed{1};
 
     // Rendering parameters
     float m_branchColor[3]{0.45F, 0.30F, 0.15F};